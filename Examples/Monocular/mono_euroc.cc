@@ -21,35 +21,34 @@
 
 #include<iostream>
 #include<algorithm>
-#include<fstream>
 #include<chrono>
 #include<thread>
 
 #include<opencv2/opencv.hpp>
 
 #include<System.h>
+#include<Dataset.h>
 
 using namespace std;
 
 static inline void usleep(int64_t usec) { std::this_thread::sleep_for(std::chrono::microseconds(usec)); }
 
-void LoadImages(const string &strImagePath, const string &strPathTimes,
-                vector<string> &vstrImages, vector<double> &vTimeStamps);
-
 int main(int argc, char **argv)
 {
+    // Dataset reader options: --prefetch=N --threads=N --cache=file
+    const ORB_SLAM2::DatasetReader::Parameters readerParams = ORB_SLAM2::ReadDatasetOptions(argc, argv);
+
     if(argc != 5)
     {
-        cerr << endl << "Usage: ./mono_tum path_to_vocabulary path_to_settings path_to_image_folder path_to_times_file" << endl;
+        cerr << endl << "Usage: ./mono_euroc path_to_vocabulary path_to_settings path_to_image_folder path_to_times_file "
+             << "[--prefetch=N] [--threads=N] [--cache=file]" << endl;
         return 1;
     }
 
     // Retrieve paths to images
-    vector<string> vstrImageFilenames;
-    vector<double> vTimestamps;
-    LoadImages(string(argv[3]), string(argv[4]), vstrImageFilenames, vTimestamps);
+    const ORB_SLAM2::Dataset dataset = ORB_SLAM2::Dataset::EuRoC(argv[3], "", argv[4]);
 
-    int nImages = vstrImageFilenames.size();
+    int nImages = dataset.Size();
 
     if(nImages<=0)
     {
@@ -57,6 +56,9 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    // Start decoding the images while the system loads
+    auto reader = ORB_SLAM2::DatasetReader::Create(dataset, readerParams);
+
     // Create SLAM system. It initializes all system threads and gets ready to process frames.
     auto SLAM = ORB_SLAM2::System::Create(argv[1],argv[2],ORB_SLAM2::System::MONOCULAR,true);
 
@@ -69,19 +71,14 @@ int main(int argc, char **argv)
     cout << "Images in the sequence: " << nImages << endl << endl;
 
     // Main loop
-    cv::Mat im;
+    ORB_SLAM2::DatasetFrame frame;
     for(int ni=0; ni<nImages; ni++)
     {
-        // Read image from file
-        im = cv::imread(vstrImageFilenames[ni],cv::IMREAD_UNCHANGED);
-        double tframe = vTimestamps[ni];
-
-        if(im.empty())
-        {
-            cerr << endl << "Failed to load image at: "
-                 <<  vstrImageFilenames[ni] << endl;
+        // Read image (decoded ahead by the dataset reader)
+        if(!reader->Read(frame))
             return 1;
-        }
+        const cv::Mat& im = frame.image;
+        double tframe = frame.timestamp;
 
 		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
 
@@ -97,9 +94,9 @@ int main(int argc, char **argv)
         // Wait to load the next frame
         double T=0;
         if(ni<nImages-1)
-            T = vTimestamps[ni+1]-tframe;
+            T = dataset.Timestamp(ni+1)-tframe;
         else if(ni>0)
-            T = tframe-vTimestamps[ni-1];
+            T = tframe-dataset.Timestamp(ni-1);
 
         if(ttrack<T)
             usleep((T-ttrack)*1e6);
@@ -124,27 +121,3 @@ int main(int argc, char **argv)
 
     return 0;
 }
-
-void LoadImages(const string &strImagePath, const string &strPathTimes,
-                vector<string> &vstrImages, vector<double> &vTimeStamps)
-{
-    ifstream fTimes;
-    fTimes.open(strPathTimes.c_str());
-    vTimeStamps.reserve(5000);
-    vstrImages.reserve(5000);
-    while(!fTimes.eof())
-    {
-        string s;
-        getline(fTimes,s);
-        if(!s.empty())
-        {
-            stringstream ss;
-            ss << s;
-            vstrImages.push_back(strImagePath + "/" + ss.str() + ".png");
-            double t;
-            ss >> t;
-            vTimeStamps.push_back(t/1e9);
-
-        }
-    }
-}
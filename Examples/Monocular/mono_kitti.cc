@@ -21,36 +21,37 @@
 
 #include<iostream>
 #include<algorithm>
-#include<fstream>
 #include<chrono>
 #include<thread>
-#include<iomanip>
 
 #include<opencv2/opencv.hpp>
 
 #include"System.h"
+#include"Dataset.h"
 
 using namespace std;
 
 static inline void usleep(int64_t usec) { std::this_thread::sleep_for(std::chrono::microseconds(usec)); }
 
-void LoadImages(const string &strSequence, vector<string> &vstrImageFilenames,
-                vector<double> &vTimestamps);
-
 int main(int argc, char **argv)
 {
+    // Dataset reader options: --prefetch=N --threads=N --cache=file
+    const ORB_SLAM2::DatasetReader::Parameters readerParams = ORB_SLAM2::ReadDatasetOptions(argc, argv);
+
     if(argc != 4)
     {
-        cerr << endl << "Usage: ./mono_kitti path_to_vocabulary path_to_settings path_to_sequence" << endl;
+        cerr << endl << "Usage: ./mono_kitti path_to_vocabulary path_to_settings path_to_sequence "
+             << "[--prefetch=N] [--threads=N] [--cache=file]" << endl;
         return 1;
     }
 
     // Retrieve paths to images
-    vector<string> vstrImageFilenames;
-    vector<double> vTimestamps;
-    LoadImages(string(argv[3]), vstrImageFilenames, vTimestamps);
+    const ORB_SLAM2::Dataset dataset = ORB_SLAM2::Dataset::KITTI(argv[3], false);
 
-    int nImages = vstrImageFilenames.size();
+    int nImages = dataset.Size();
+
+    // Start decoding the images while the system loads
+    auto reader = ORB_SLAM2::DatasetReader::Create(dataset, readerParams);
 
     // Create SLAM system. It initializes all system threads and gets ready to process frames.
     auto SLAM = ORB_SLAM2::System::Create(argv[1],argv[2],ORB_SLAM2::System::MONOCULAR,true);
@@ -64,18 +65,14 @@ int main(int argc, char **argv)
     cout << "Images in the sequence: " << nImages << endl << endl;
 
     // Main loop
-    cv::Mat im;
+    ORB_SLAM2::DatasetFrame frame;
     for(int ni=0; ni<nImages; ni++)
     {
-        // Read image from file
-        im = cv::imread(vstrImageFilenames[ni],cv::IMREAD_UNCHANGED);
-        double tframe = vTimestamps[ni];
-
-        if(im.empty())
-        {
-            cerr << endl << "Failed to load image at: " << vstrImageFilenames[ni] << endl;
+        // Read image (decoded ahead by the dataset reader)
+        if(!reader->Read(frame))
             return 1;
-        }
+        const cv::Mat& im = frame.image;
+        double tframe = frame.timestamp;
 
 		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
 
@@ -91,9 +88,9 @@ int main(int argc, char **argv)
         // Wait to load the next frame
         double T=0;
         if(ni<nImages-1)
-            T = vTimestamps[ni+1]-tframe;
+            T = dataset.Timestamp(ni+1)-tframe;
         else if(ni>0)
-            T = tframe-vTimestamps[ni-1];
+            T = tframe-dataset.Timestamp(ni-1);
 
         if(ttrack<T)
             usleep((T-ttrack)*1e6);
@@ -118,35 +115,3 @@ int main(int argc, char **argv)
 
     return 0;
 }
-
-void LoadImages(const string &strPathToSequence, vector<string> &vstrImageFilenames, vector<double> &vTimestamps)
-{
-    ifstream fTimes;
-    string strPathTimeFile = strPathToSequence + "/times.txt";
-    fTimes.open(strPathTimeFile.c_str());
-    while(!fTimes.eof())
-    {
-        string s;
-        getline(fTimes,s);
-        if(!s.empty())
-        {
-            stringstream ss;
-            ss << s;
-            double t;
-            ss >> t;
-            vTimestamps.push_back(t);
-        }
-    }
-
-    string strPrefixLeft = strPathToSequence + "/image_0/";
-
-    const int nTimes = vTimestamps.size();
-    vstrImageFilenames.resize(nTimes);
-
-    for(int i=0; i<nTimes; i++)
-    {
-        stringstream ss;
-        ss << setfill('0') << setw(6) << i;
-        vstrImageFilenames[i] = strPrefixLeft + ss.str() + ".png";
-    }
-}
@@ -21,36 +21,37 @@
 
 #include<iostream>
 #include<algorithm>
-#include<fstream>
 #include<chrono>
 #include<thread>
 
 #include<opencv2/opencv.hpp>
 
 #include<System.h>
+#include<Dataset.h>
 
 using namespace std;
 
 static inline void usleep(int64_t usec) { std::this_thread::sleep_for(std::chrono::microseconds(usec)); }
 
-void LoadImages(const string &strFile, vector<string> &vstrImageFilenames,
-                vector<double> &vTimestamps);
-
 int main(int argc, char **argv)
 {
+    // Dataset reader options: --prefetch=N --threads=N --cache=file
+    const ORB_SLAM2::DatasetReader::Parameters readerParams = ORB_SLAM2::ReadDatasetOptions(argc, argv);
+
     if(argc != 4)
     {
-        cerr << endl << "Usage: ./mono_tum path_to_vocabulary path_to_settings path_to_sequence" << endl;
+        cerr << endl << "Usage: ./mono_tum path_to_vocabulary path_to_settings path_to_sequence "
+             << "[--prefetch=N] [--threads=N] [--cache=file]" << endl;
         return 1;
     }
 
     // Retrieve paths to images
-    vector<string> vstrImageFilenames;
-    vector<double> vTimestamps;
-    string strFile = string(argv[3])+"/rgb.txt";
-    LoadImages(strFile, vstrImageFilenames, vTimestamps);
+    const ORB_SLAM2::Dataset dataset = ORB_SLAM2::Dataset::TUM(argv[3]);
+
+    int nImages = dataset.Size();
 
-    int nImages = vstrImageFilenames.size();
+    // Start decoding the images while the system loads
+    auto reader = ORB_SLAM2::DatasetReader::Create(dataset, readerParams);
 
     // Create SLAM system. It initializes all system threads and gets ready to process frames.
     auto SLAM = ORB_SLAM2::System::Create(argv[1],argv[2],ORB_SLAM2::System::MONOCULAR,true);
@@ -64,19 +65,14 @@ int main(int argc, char **argv)
     cout << "Images in the sequence: " << nImages << endl << endl;
 
     // Main loop
-    cv::Mat im;
+    ORB_SLAM2::DatasetFrame frame;
     for(int ni=0; ni<nImages; ni++)
     {
-        // Read image from file
-        im = cv::imread(string(argv[3])+"/"+vstrImageFilenames[ni],cv::IMREAD_UNCHANGED);
-        double tframe = vTimestamps[ni];
-
-        if(im.empty())
-        {
-            cerr << endl << "Failed to load image at: "
-                 << string(argv[3]) << "/" << vstrImageFilenames[ni] << endl;
+        // Read image (decoded ahead by the dataset reader)
+        if(!reader->Read(frame))
             return 1;
-        }
+        const cv::Mat& im = frame.image;
+        double tframe = frame.timestamp;
 
 		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
 
@@ -92,9 +88,9 @@ int main(int argc, char **argv)
         // Wait to load the next frame
         double T=0;
         if(ni<nImages-1)
-            T = vTimestamps[ni+1]-tframe;
+            T = dataset.Timestamp(ni+1)-tframe;
         else if(ni>0)
-            T = tframe-vTimestamps[ni-1];
+            T = tframe-dataset.Timestamp(ni-1);
 
         if(ttrack<T)
             usleep((T-ttrack)*1e6);
@@ -119,32 +115,3 @@ int main(int argc, char **argv)
 
     return 0;
 }
-
-void LoadImages(const string &strFile, vector<string> &vstrImageFilenames, vector<double> &vTimestamps)
-{
-    ifstream f;
-    f.open(strFile.c_str());
-
-    // skip first three lines
-    string s0;
-    getline(f,s0);
-    getline(f,s0);
-    getline(f,s0);
-
-    while(!f.eof())
-    {
-        string s;
-        getline(f,s);
-        if(!s.empty())
-        {
-            stringstream ss;
-            ss << s;
-            double t;
-            string sRGB;
-            ss >> t;
-            vTimestamps.push_back(t);
-            ss >> sRGB;
-            vstrImageFilenames.push_back(sRGB);
-        }
-    }
-}
@@ -21,7 +21,6 @@
 
 #include <iostream>
 #include <algorithm>
-#include <fstream>
 #include <chrono>
 #include <thread>
 #include <numeric>
@@ -29,64 +28,34 @@
 #include <opencv2/opencv.hpp>
 
 #include <System.h>
+#include <Dataset.h>
 
 static inline void usleep(int64_t usec) { std::this_thread::sleep_for(std::chrono::microseconds(usec)); }
 
-template <class... Args>
-static std::string FormatString(const char* fmt, Args... args)
-{
-	const int BUF_SIZE = 1024;
-	char buf[BUF_SIZE];
-	std::snprintf(buf, BUF_SIZE, fmt, args...);
-	return std::string(buf);
-}
-
-static int LoadImages(const char* path, std::vector<std::string>& images, std::vector<std::string>& depths,
-	std::vector<double>& timestamps)
-{
-	std::ifstream ifs(path);
-	CV_Assert(!ifs.fail());
-
-	int nframes = 0;
-	std::string line, filename1, filename2;
-	double stamp1, stamp2;
-	while (std::getline(ifs, line))
-	{
-		std::stringstream ss(line);
-		ss >> stamp1 >> filename1 >> stamp2 >> filename2;
-		images.push_back(filename1);
-		depths.push_back(filename2);
-		timestamps.push_back(stamp1);
-		nframes++;
-	}
-	return nframes;
-}
-
 int main(int argc, char **argv)
 {
+	// Dataset reader options: --prefetch=N --threads=N --cache=file
+	const ORB_SLAM2::DatasetReader::Parameters readerParams = ORB_SLAM2::ReadDatasetOptions(argc, argv);
+
 	if (argc < 5)
 	{
-		std::cerr << std::endl << "Usage: ./rgbd_tum path_to_vocabulary path_to_settings path_to_sequence path_to_association [use_viewer]" << std::endl;
+		std::cerr << std::endl << "Usage: ./rgbd_tum path_to_vocabulary path_to_settings path_to_sequence path_to_association [use_viewer] "
+			"[--prefetch=N] [--threads=N] [--cache=file]" << std::endl;
 		return 1;
 	}
 
-	// Retrieve paths to images
-	std::vector<std::string> images;
-	std::vector<std::string> depths;
-	std::vector<double> timestamps;
-	const int nimages = LoadImages(argv[4], images, depths, timestamps);
+	// Retrieve paths to images and depthmaps
+	const ORB_SLAM2::Dataset dataset = ORB_SLAM2::Dataset::TUMRGBD(argv[3], argv[4]);
+	const int nimages = dataset.Size();
 
-	// Check consistency in the number of images and depthmaps
-	if (images.empty())
+	if (dataset.Empty())
 	{
 		std::cerr << std::endl << "No images found in provided path." << std::endl;
 		return 1;
 	}
-	else if (depths.size() != images.size())
-	{
-		std::cerr << std::endl << "Different number of images for rgb and depth." << std::endl;
-		return 1;
-	}
+
+	// Start decoding the images while the system loads
+	auto reader = ORB_SLAM2::DatasetReader::Create(dataset, readerParams);
 
 	// Create SLAM system. It initializes all system threads and gets ready to process frames.
 	auto SLAM = ORB_SLAM2::System::Create(argv[1], argv[2], ORB_SLAM2::System::RGBD, true);
@@ -100,19 +69,16 @@ int main(int argc, char **argv)
 	std::cout << "Images in the sequence: " << nimages << std::endl << std::endl;
 
 	// Main loop
-	cv::Mat imRGB, imD;
+	ORB_SLAM2::DatasetFrame frame;
 	for (int i = 0; i < nimages; i++)
 	{
-		// Read image and depthmap from file
-		const cv::Mat image = cv::imread(FormatString("%s/%s", argv[3], images[i].c_str()), cv::IMREAD_UNCHANGED);
-		const cv::Mat depth = cv::imread(FormatString("%s/%s", argv[3], depths[i].c_str()), cv::IMREAD_UNCHANGED);
-		const double timestamp = timestamps[i];
-
-		if (image.empty())
-		{
-			std::cerr << std::endl << "Failed to load image at: " << std::string(argv[3]) << "/" << images[i] << std::endl;
+		// Read image and depthmap (decoded ahead by the dataset reader)
+		if (!reader->Read(frame))
 			return 1;
-		}
+
+		const cv::Mat& image = frame.image;
+		const cv::Mat& depth = frame.image2;
+		const double timestamp = frame.timestamp;
 
 		const auto t1 = std::chrono::steady_clock::now();
 
@@ -122,7 +88,7 @@ int main(int argc, char **argv)
 		const auto t2 = std::chrono::steady_clock::now();
 
 		const double T1 = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
-		const double T2 = i < nimages - 1 ? timestamps[i + 1] - timestamp : timestamp - timestamps[i - 1];
+		const double T2 = i < nimages - 1 ? dataset.Timestamp(i + 1) - timestamp : timestamp - dataset.Timestamp(i - 1);
 
 		trackTimes[i] = T1;
 
@@ -21,7 +21,6 @@
 
 #include <iostream>
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <chrono>
 #include <thread>
@@ -30,36 +29,10 @@
 #include <opencv2/opencv.hpp>
 
 #include <System.h>
+#include <Dataset.h>
 
 static inline void usleep(int64_t usec) { std::this_thread::sleep_for(std::chrono::microseconds(usec)); }
 
-template <class... Args>
-static std::string FormatString(const char* fmt, Args... args)
-{
-	const int BUF_SIZE = 1024;
-	char buf[BUF_SIZE];
-	std::snprintf(buf, BUF_SIZE, fmt, args...);
-	return std::string(buf);
-}
-
-static int LoadImages(const char* I0Path, const char* I1Path, const char* timePath,
-	std::vector<std::string>& I0s, std::vector<std::string>& I1s, std::vector<double>& stamps)
-{
-	std::ifstream ifs(timePath);
-	CV_Assert(!ifs.fail());
-
-	int nframes = 0;
-	std::string line;
-	while (std::getline(ifs, line))
-	{
-		I0s.push_back(FormatString("%s/%s.png", I0Path, line.c_str()));
-		I1s.push_back(FormatString("%s/%s.png", I1Path, line.c_str()));
-		stamps.push_back(1e-9 * std::stoull(line));
-		nframes++;
-	}
-	return nframes;
-}
-
 class Rectify
 {
 
@@ -112,29 +85,26 @@ private:
 
 int main(int argc, char* argv[])
 {
+	// Dataset reader options: --prefetch=N --threads=N --cache=file
+	ORB_SLAM2::DatasetReader::Parameters readerParams = ORB_SLAM2::ReadDatasetOptions(argc, argv);
+
 	if (argc < 6)
 	{
-		std::cerr << "Usage: ./stereo_euroc path_to_vocabulary path_to_settings path_to_left_folder path_to_right_folder path_to_times_file" << std::endl;
+		std::cerr << "Usage: ./stereo_euroc path_to_vocabulary path_to_settings path_to_left_folder path_to_right_folder path_to_times_file "
+			"[--prefetch=N] [--threads=N] [--cache=file]" << std::endl;
 		return 1;
 	}
 
 	// Load sequence
-	std::vector<std::string> ILs, IRs;
-	std::vector<double> timestamps;
-	const int nimages = LoadImages(argv[3], argv[4], argv[5], ILs, IRs, timestamps);
+	const ORB_SLAM2::Dataset dataset = ORB_SLAM2::Dataset::EuRoC(argv[3], argv[4], argv[5]);
+	const int nimages = dataset.Size();
 
-	if (ILs.empty() || IRs.empty())
+	if (dataset.Empty())
 	{
 		std::cerr << "ERROR: No images in provided path." << std::endl;
 		return 1;
 	}
 
-	if (ILs.size() != IRs.size())
-	{
-		std::cerr << "ERROR: Different number of left and right images." << std::endl;
-		return 1;
-	}
-
 	// Read rectification parameters
 	cv::FileStorage settings(argv[2], cv::FileStorage::READ);
 	if (!settings.isOpened())
@@ -151,6 +121,20 @@ int main(int argc, char* argv[])
 		return 1;
 	}
 
+	// Rectification runs on the decoding threads (a cached sequence holds rectified images)
+	readerParams.transform = [&](ORB_SLAM2::DatasetFrame& frame)
+	{
+		cv::Mat IL, IR;
+		rectifyL(frame.image, IL);
+		rectifyR(frame.image2, IR);
+		frame.image = IL;
+		frame.image2 = IR;
+	};
+	readerParams.transformSettings = argv[2];
+
+	// Start decoding the images while the system loads
+	auto reader = ORB_SLAM2::DatasetReader::Create(dataset, readerParams);
+
 	// Create SLAM system. It initializes all system threads and gets ready to process frames.
 	auto SLAM = ORB_SLAM2::System::Create(argv[1], argv[2], ORB_SLAM2::System::STEREO, true);
 
@@ -163,21 +147,16 @@ int main(int argc, char* argv[])
 	std::cout << "Images in the sequence: " << nimages << std::endl << std::endl;
 
 	// Main loop
-	cv::Mat IL, IR;
+	ORB_SLAM2::DatasetFrame frame;
 	for (int i = 0; i < nimages; i++)
 	{
-		const cv::Mat _IL = cv::imread(ILs[i], cv::IMREAD_UNCHANGED);
-		const cv::Mat _IR = cv::imread(IRs[i], cv::IMREAD_UNCHANGED);
-		if (_IL.empty() || _IR.empty())
-		{
-			std::cout << "imread failed." << std::endl;
+		// Read the rectified images (decoded ahead by the dataset reader)
+		if (!reader->Read(frame))
 			break;
-		}
-
-		rectifyL(_IL, IL);
-		rectifyR(_IR, IR);
 
-		const double timestamp = timestamps[i];
+		const cv::Mat& IL = frame.image;
+		const cv::Mat& IR = frame.image2;
+		const double timestamp = frame.timestamp;
 
 		const auto t1 = std::chrono::steady_clock::now();
 
@@ -188,7 +167,7 @@ int main(int argc, char* argv[])
 
 		// Wait to load the next frame
 		const double T1 = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
-		const double T2 = i < nimages - 1 ? timestamps[i + 1] - timestamp : timestamp - timestamps[i - 1];
+		const double T2 = i < nimages - 1 ? dataset.Timestamp(i + 1) - timestamp : timestamp - dataset.Timestamp(i - 1);
 
 		trackTimes[i] = T1;
 
@@ -26,53 +26,28 @@
 #include <opencv2/opencv.hpp>
 
 #include <System.h>
+#include <Dataset.h>
 
 static inline void usleep(int64_t usec) { std::this_thread::sleep_for(std::chrono::microseconds(usec)); }
 
-template <class... Args>
-static std::string FormatString(const char* fmt, Args... args)
-{
-	const int BUF_SIZE = 1024;
-	char buf[BUF_SIZE];
-	std::snprintf(buf, BUF_SIZE, fmt, args...);
-	return std::string(buf);
-}
-
-static int LoadImages(const char* path, std::vector<std::string>& I0s, std::vector<std::string>& I1s,
-	std::vector<double>& timestamps)
-{
-	std::ifstream ifs(FormatString("%s/times.txt", path));
-	CV_Assert(!ifs.fail());
-
-	double timestamp;
-	while (ifs >> timestamp)
-		timestamps.push_back(timestamp);
-
-	const int nframes = static_cast<int>(timestamps.size());
-	I0s.resize(nframes);
-	I1s.resize(nframes);
-	for (int i = 0; i < nframes; i++)
-	{
-		I0s[i] = FormatString("%s/image_0/%06d.png", path, i);
-		I1s[i] = FormatString("%s/image_1/%06d.png", path, i);
-	}
-	return nframes;
-}
-
 int main(int argc, char **argv)
 {
+	// Dataset reader options: --prefetch=N --threads=N --cache=file
+	const ORB_SLAM2::DatasetReader::Parameters readerParams = ORB_SLAM2::ReadDatasetOptions(argc, argv);
+
 	if (argc < 4)
 	{
-		std::cerr << "Usage: ./stereo_kitti path_to_vocabulary path_to_settings path_to_sequence [use_viewer]" << std::endl;
+		std::cerr << "Usage: ./stereo_kitti path_to_vocabulary path_to_settings path_to_sequence [use_viewer] "
+			"[--prefetch=N] [--threads=N] [--cache=file]" << std::endl;
 		return 1;
 	}
 
 	// Retrieve paths to images
-	std::vector<std::string> ILs;
-	std::vector<std::string> IRs;
-	std::vector<double> timestamps;
+	const ORB_SLAM2::Dataset dataset = ORB_SLAM2::Dataset::KITTI(argv[3], true);
+	const int nimages = dataset.Size();
 
-	const int nimages = LoadImages(argv[3], ILs, IRs, timestamps);
+	// Start decoding the images while the system loads
+	auto reader = ORB_SLAM2::DatasetReader::Create(dataset, readerParams);
 
 	// Create SLAM system. It initializes all system threads and gets ready to process frames.
 	const bool useViewer = argc > 4 ? std::stoi(argv[4]) != 0 : true;
@@ -87,18 +62,16 @@ int main(int argc, char **argv)
 	std::cout << "Images in the sequence: " << nimages << std::endl << std::endl;
 
 	// Main loop
+	ORB_SLAM2::DatasetFrame frame;
 	for (int i = 0; i < nimages; i++)
 	{
-		// Read left and right images from file
-		const cv::Mat IL = cv::imread(ILs[i], cv::IMREAD_UNCHANGED);
-		const cv::Mat IR = cv::imread(IRs[i], cv::IMREAD_UNCHANGED);
-		const double timestamp = timestamps[i];
-
-		if (IL.empty())
-		{
-			std::cerr << std::endl << "Failed to load image at: " << ILs[i] << std::endl;
+		// Read left and right images (decoded ahead by the dataset reader)
+		if (!reader->Read(frame))
 			return 1;
-		}
+
+		const cv::Mat& IL = frame.image;
+		const cv::Mat& IR = frame.image2;
+		const double timestamp = frame.timestamp;
 
 		const auto t1 = std::chrono::steady_clock::now();
 
@@ -108,7 +81,7 @@ int main(int argc, char **argv)
 		const auto t2 = std::chrono::steady_clock::now();
 
 		const double T1 = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
-		const double T2 = i < nimages - 1 ? timestamps[i + 1] - timestamp : timestamp - timestamps[i - 1];
+		const double T2 = i < nimages - 1 ? dataset.Timestamp(i + 1) - timestamp : timestamp - dataset.Timestamp(i - 1);
 
 		trackTimes[i] = T1;
 
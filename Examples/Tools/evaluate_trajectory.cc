@@ -0,0 +1,480 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+// Camera pose in the world (Twc) at a given time
+struct StampedPose
+{
+	double timestamp;
+	Eigen::Matrix3d R;
+	Eigen::Vector3d t;
+};
+
+struct ErrorStats
+{
+	int count;
+	double rmse, mean, median, std, max;
+	ErrorStats() : count(0), rmse(0), mean(0), median(0), std(0), max(0) {}
+};
+
+struct FrameTimeStats
+{
+	int frames;
+	double mean, median, p90, p99, max, total;
+	FrameTimeStats() : frames(0), mean(0), median(0), p90(0), p99(0), max(0), total(0) {}
+};
+
+static bool ReadOption(const std::string& arg, const std::string& name, std::string& value)
+{
+	if (arg.compare(0, name.size(), name) != 0)
+		return false;
+	value = arg.substr(name.size());
+	return true;
+}
+
+static void PrintUsage()
+{
+	std::cerr << std::endl << "Usage: ./evaluate_trajectory groundtruth estimate [options]" << std::endl
+		<< "  --align=se3|sim3|none   alignment of the estimate to the ground truth (default se3, monocular needs sim3)" << std::endl
+		<< "  --max-diff=S            maximum timestamp difference of associated poses (default 0.02)" << std::endl
+		<< "  --delta=S               step of the relative pose error, in seconds or KITTI frames (default 1)" << std::endl
+		<< "  --times=path            per-frame tracking times (timestamp seconds), see Examples/Tools/replay" << std::endl
+		<< "  --json=path             write the accuracy and speed report in JSON" << std::endl
+		<< "  --max-ate=M             exit with status 2 if the ATE RMSE is larger" << std::endl
+		<< "  --max-rpe=M             exit with status 2 if the translational RPE RMSE is larger" << std::endl;
+}
+
+// Reads a TUM (timestamp tx ty tz qx qy qz qw) or a KITTI (3x4 row-major matrix) trajectory.
+// KITTI poses have no timestamp, the line index is used instead.
+static bool LoadTrajectory(const std::string& filename, std::vector<StampedPose>& trajectory, bool& kitti)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open trajectory file at: " << filename << std::endl;
+		return false;
+	}
+
+	trajectory.clear();
+	size_t columns = 0;
+	int lineNumber = 0;
+	std::string line;
+	std::vector<double> values;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream ss(line);
+		values.clear();
+		double value;
+		while (ss >> value)
+			values.push_back(value);
+		if (values.empty())
+			continue;
+
+		if (columns == 0)
+			columns = values.size();
+		if (values.size() != columns || (columns != 8 && columns != 12))
+		{
+			std::cerr << filename << ":" << lineNumber << ": expected 8 (TUM) or 12 (KITTI) values per line" << std::endl;
+			return false;
+		}
+
+		StampedPose pose;
+		if (columns == 8)
+		{
+			pose.timestamp = values[0];
+			pose.t << values[1], values[2], values[3];
+			pose.R = Eigen::Quaterniond(values[7], values[4], values[5], values[6]).normalized().toRotationMatrix();
+		}
+		else
+		{
+			pose.timestamp = static_cast<double>(trajectory.size());
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+					pose.R(r, c) = values[4 * r + c];
+				pose.t(r) = values[4 * r + 3];
+			}
+		}
+		trajectory.push_back(pose);
+	}
+
+	if (trajectory.empty())
+	{
+		std::cerr << "The trajectory " << filename << " is empty" << std::endl;
+		return false;
+	}
+
+	std::stable_sort(std::begin(trajectory), std::end(trajectory),
+		[](const StampedPose& lhs, const StampedPose& rhs) { return lhs.timestamp < rhs.timestamp; });
+	kitti = columns == 12;
+	return true;
+}
+
+// Reads the per-frame tracking times written by the replay tools
+static bool LoadFrameTimes(const std::string& filename, std::vector<double>& times)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open frame times file at: " << filename << std::endl;
+		return false;
+	}
+
+	times.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ss(line);
+		double timestamp, seconds;
+		if (ss >> timestamp >> seconds)
+			times.push_back(seconds);
+	}
+	return true;
+}
+
+// Associates each estimated pose with the closest ground truth pose in time.
+// A ground truth pose is used at most once.
+static void Associate(const std::vector<StampedPose>& groundTruth, const std::vector<StampedPose>& estimate,
+	double maxDiff, std::vector<int>& gtIndices, std::vector<int>& estIndices)
+{
+	gtIndices.clear();
+	estIndices.clear();
+	int lastMatch = -1;
+	for (int i = 0; i < static_cast<int>(estimate.size()); i++)
+	{
+		const double timestamp = estimate[i].timestamp;
+		const auto it = std::lower_bound(std::begin(groundTruth), std::end(groundTruth), timestamp,
+			[](const StampedPose& pose, double t) { return pose.timestamp < t; });
+
+		int best = -1;
+		double bestDiff = maxDiff;
+		const int idx = static_cast<int>(it - std::begin(groundTruth));
+		for (int j = idx - 1; j <= idx; j++)
+		{
+			if (j < 0 || j >= static_cast<int>(groundTruth.size()))
+				continue;
+			const double diff = std::abs(groundTruth[j].timestamp - timestamp);
+			if (diff <= bestDiff)
+			{
+				best = j;
+				bestDiff = diff;
+			}
+		}
+
+		if (best < 0 || best <= lastMatch)
+			continue;
+
+		gtIndices.push_back(best);
+		estIndices.push_back(i);
+		lastMatch = best;
+	}
+}
+
+static ErrorStats ComputeStats(std::vector<double> errors)
+{
+	ErrorStats stats;
+	stats.count = static_cast<int>(errors.size());
+	if (errors.empty())
+		return stats;
+
+	double sum = 0, sum2 = 0;
+	for (double e : errors)
+	{
+		sum += e;
+		sum2 += e * e;
+		stats.max = std::max(stats.max, e);
+	}
+	stats.mean = sum / stats.count;
+	stats.rmse = std::sqrt(sum2 / stats.count);
+	stats.std = std::sqrt(std::max(sum2 / stats.count - stats.mean * stats.mean, 0.0));
+
+	std::nth_element(std::begin(errors), std::begin(errors) + stats.count / 2, std::end(errors));
+	stats.median = errors[stats.count / 2];
+	return stats;
+}
+
+static FrameTimeStats ComputeFrameTimeStats(std::vector<double> times)
+{
+	FrameTimeStats stats;
+	stats.frames = static_cast<int>(times.size());
+	if (times.empty())
+		return stats;
+
+	std::sort(std::begin(times), std::end(times));
+	const auto Percentile = [&](double p) { return times[std::min(static_cast<int>(p * stats.frames), stats.frames - 1)]; };
+	stats.total = std::accumulate(std::begin(times), std::end(times), 0.0);
+	stats.mean = stats.total / stats.frames;
+	stats.median = Percentile(0.5);
+	stats.p90 = Percentile(0.9);
+	stats.p99 = Percentile(0.99);
+	stats.max = times.back();
+	return stats;
+}
+
+static double RotationAngle(const Eigen::Matrix3d& R)
+{
+	const double c = std::min(std::max(0.5 * (R.trace() - 1), -1.0), 1.0);
+	return std::acos(c);
+}
+
+static std::string JsonString(const std::string& str)
+{
+	std::string out = "\"";
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+static void WriteJsonStats(std::ostream& os, const ErrorStats& stats, const std::string& indent)
+{
+	os << "{" << std::endl
+		<< indent << "  \"rmse\": " << stats.rmse << "," << std::endl
+		<< indent << "  \"mean\": " << stats.mean << "," << std::endl
+		<< indent << "  \"median\": " << stats.median << "," << std::endl
+		<< indent << "  \"std\": " << stats.std << "," << std::endl
+		<< indent << "  \"max\": " << stats.max << std::endl
+		<< indent << "}";
+}
+
+// Aligns an estimated trajectory (TUM or KITTI format) to the ground truth and computes
+// the absolute trajectory error (ATE, translation of the aligned poses) and the relative pose error
+// (RPE, drift of the motion over --delta). Monocular trajectories have an arbitrary scale and need --align=sim3.
+// With --times, the tracking time statistics of the same run are added to the report, so that
+// a speed-up and its effect on accuracy are checked together (see --max-ate and --max-rpe).
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string groundTruthFile = argv[1];
+	const std::string estimateFile = argv[2];
+	std::string alignment = "se3", timesFile, jsonFile, value;
+	double maxDiff = 0.02, delta = 1, maxATE = -1, maxRPE = -1;
+
+	for (int i = 3; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		bool valid = true;
+		if (ReadOption(arg, "--align=", value))
+		{
+			alignment = value;
+			valid = value == "se3" || value == "sim3" || value == "none";
+		}
+		else if (ReadOption(arg, "--max-diff=", value))
+			maxDiff = std::stod(value);
+		else if (ReadOption(arg, "--delta=", value))
+			valid = (delta = std::stod(value)) > 0;
+		else if (ReadOption(arg, "--times=", value))
+			timesFile = value;
+		else if (ReadOption(arg, "--json=", value))
+			jsonFile = value;
+		else if (ReadOption(arg, "--max-ate=", value))
+			maxATE = std::stod(value);
+		else if (ReadOption(arg, "--max-rpe=", value))
+			maxRPE = std::stod(value);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Invalid option: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	std::vector<StampedPose> groundTruth, estimate;
+	bool kittiGT, kittiEst;
+	if (!LoadTrajectory(groundTruthFile, groundTruth, kittiGT) || !LoadTrajectory(estimateFile, estimate, kittiEst))
+		return 1;
+	if (kittiGT != kittiEst)
+	{
+		std::cerr << "Both trajectories must be in the same format (KITTI poses are associated by index)" << std::endl;
+		return 1;
+	}
+
+	std::vector<int> gtIndices, estIndices;
+	Associate(groundTruth, estimate, kittiGT ? 0.0 : maxDiff, gtIndices, estIndices);
+	const int nmatches = static_cast<int>(gtIndices.size());
+	if (nmatches < 3)
+	{
+		std::cerr << "Only " << nmatches << " poses could be associated, check the timestamps and --max-diff" << std::endl;
+		return 1;
+	}
+
+	// Alignment of the estimate to the ground truth (Umeyama): p_gt = s * R * p_est + t
+	Eigen::Matrix3Xd positionsGT(3, nmatches), positionsEst(3, nmatches);
+	for (int i = 0; i < nmatches; i++)
+	{
+		positionsGT.col(i) = groundTruth[gtIndices[i]].t;
+		positionsEst.col(i) = estimate[estIndices[i]].t;
+	}
+
+	Eigen::Matrix3d alignR = Eigen::Matrix3d::Identity();
+	Eigen::Vector3d alignT = Eigen::Vector3d::Zero();
+	double scale = 1;
+	if (alignment != "none")
+	{
+		const Eigen::Matrix4d T = Eigen::umeyama(positionsEst, positionsGT, alignment == "sim3");
+		scale = alignment == "sim3" ? std::cbrt(T.block<3, 3>(0, 0).determinant()) : 1.0;
+		alignR = T.block<3, 3>(0, 0) / scale;
+		alignT = T.block<3, 1>(0, 3);
+	}
+
+	// Absolute trajectory error
+	std::vector<double> errors(nmatches);
+	for (int i = 0; i < nmatches; i++)
+		errors[i] = (scale * alignR * positionsEst.col(i) + alignT - positionsGT.col(i)).norm();
+	const ErrorStats ate = ComputeStats(errors);
+
+	// Relative pose error between each pose and the first one at least delta later.
+	// The estimated motion is scaled by the alignment, the rotation of the alignment cancels out.
+	std::vector<double> errorsT, errorsR;
+	for (int i = 0, j = 0; i < nmatches; i++)
+	{
+		const StampedPose& gt1 = groundTruth[gtIndices[i]];
+		const StampedPose& est1 = estimate[estIndices[i]];
+		j = std::max(j, i + 1);
+		while (j < nmatches && groundTruth[gtIndices[j]].timestamp < gt1.timestamp + delta)
+			j++;
+		if (j >= nmatches)
+			break;
+
+		const StampedPose& gt2 = groundTruth[gtIndices[j]];
+		const StampedPose& est2 = estimate[estIndices[j]];
+		const Eigen::Matrix3d relRGT = gt1.R.transpose() * gt2.R;
+		const Eigen::Vector3d relTGT = gt1.R.transpose() * (gt2.t - gt1.t);
+		const Eigen::Matrix3d relREst = est1.R.transpose() * est2.R;
+		const Eigen::Vector3d relTEst = scale * (est1.R.transpose() * (est2.t - est1.t));
+
+		errorsT.push_back((relRGT.transpose() * (relTEst - relTGT)).norm());
+		errorsR.push_back(RotationAngle(relRGT.transpose() * relREst) * 180 / M_PI);
+	}
+	const ErrorStats rpeT = ComputeStats(errorsT);
+	const ErrorStats rpeR = ComputeStats(errorsR);
+
+	std::vector<double> times;
+	if (!timesFile.empty() && !LoadFrameTimes(timesFile, times))
+		return 1;
+	const FrameTimeStats speed = ComputeFrameTimeStats(times);
+
+	const double coverage = static_cast<double>(nmatches) / groundTruth.size();
+	std::cout << "associated poses: " << nmatches << " / " << groundTruth.size() << " ground truth, "
+		<< estimate.size() << " estimated" << std::endl;
+	std::cout << "alignment: " << alignment << ", scale: " << scale << std::endl;
+	std::cout << "ATE (m): rmse " << ate.rmse << ", mean " << ate.mean << ", median " << ate.median
+		<< ", max " << ate.max << std::endl;
+	std::cout << "RPE over " << delta << " (" << rpeT.count << " pairs): translation rmse " << rpeT.rmse
+		<< " m, rotation rmse " << rpeR.rmse << " deg" << std::endl;
+	if (speed.frames > 0)
+	{
+		std::cout << "tracking time (ms): mean " << 1000 * speed.mean << ", median " << 1000 * speed.median
+			<< ", p90 " << 1000 * speed.p90 << ", max " << 1000 * speed.max << std::endl;
+	}
+
+	if (!jsonFile.empty())
+	{
+		std::ofstream json(jsonFile);
+		if (!json.is_open())
+		{
+			std::cerr << "Failed to open JSON file at: " << jsonFile << std::endl;
+			return 1;
+		}
+
+		json << std::setprecision(9);
+		json << "{" << std::endl
+			<< "  \"groundtruth\": " << JsonString(groundTruthFile) << "," << std::endl
+			<< "  \"estimate\": " << JsonString(estimateFile) << "," << std::endl
+			<< "  \"accuracy\": {" << std::endl
+			<< "    \"alignment\": " << JsonString(alignment) << "," << std::endl
+			<< "    \"scale\": " << scale << "," << std::endl
+			<< "    \"associated\": " << nmatches << "," << std::endl
+			<< "    \"coverage\": " << coverage << "," << std::endl
+			<< "    \"ate\": ";
+		WriteJsonStats(json, ate, "    ");
+		json << "," << std::endl
+			<< "    \"rpe\": {" << std::endl
+			<< "      \"delta\": " << delta << "," << std::endl
+			<< "      \"pairs\": " << rpeT.count << "," << std::endl
+			<< "      \"translation\": ";
+		WriteJsonStats(json, rpeT, "      ");
+		json << "," << std::endl
+			<< "      \"rotation_deg\": ";
+		WriteJsonStats(json, rpeR, "      ");
+		json << std::endl
+			<< "    }" << std::endl
+			<< "  }";
+		if (speed.frames > 0)
+		{
+			json << "," << std::endl
+				<< "  \"speed\": {" << std::endl
+				<< "    \"frames\": " << speed.frames << "," << std::endl
+				<< "    \"total_s\": " << speed.total << "," << std::endl
+				<< "    \"mean_ms\": " << 1000 * speed.mean << "," << std::endl
+				<< "    \"median_ms\": " << 1000 * speed.median << "," << std::endl
+				<< "    \"p90_ms\": " << 1000 * speed.p90 << "," << std::endl
+				<< "    \"p99_ms\": " << 1000 * speed.p99 << "," << std::endl
+				<< "    \"max_ms\": " << 1000 * speed.max << "," << std::endl
+				<< "    \"fps\": " << 1 / speed.mean << std::endl
+				<< "  }";
+		}
+		json << std::endl << "}" << std::endl;
+	}
+
+	bool passed = true;
+	if (maxATE >= 0 && ate.rmse > maxATE)
+	{
+		std::cerr << "ATE RMSE " << ate.rmse << " exceeds " << maxATE << std::endl;
+		passed = false;
+	}
+	if (maxRPE >= 0 && rpeT.rmse > maxRPE)
+	{
+		std::cerr << "RPE translation RMSE " << rpeT.rmse << " exceeds " << maxRPE << std::endl;
+		passed = false;
+	}
+
+	return passed ? 0 : 2;
+}
@@ -0,0 +1,919 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <set>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <new>
+
+#include <opencv2/opencv.hpp>
+
+#include <System.h>
+#include <ORBVocabulary.h>
+#include <ORBextractor.h>
+#include <ORBmatcher.h>
+#include <Optimizer.h>
+#include <PnPsolver.h>
+#include <Frame.h>
+#include <KeyFrame.h>
+#include <MapPoint.h>
+#include <Map.h>
+#include <KeyFrameDatabase.h>
+#include <CameraProjection.h>
+#include <SyntheticSequence.h>
+#include <ThreadSignal.h>
+
+using namespace ORB_SLAM2;
+
+// Microbenchmarks of the core kernels on a synthetic scene (no dataset needed).
+// Each kernel reports the time and the number of operator new calls per operation.
+// Allocations made with malloc (e.g. cv::Mat buffers) are not counted.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation counting
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size > 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark runner
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Keeps the results of the kernels alive
+static volatile int64_t sink;
+
+using Clock = std::chrono::steady_clock;
+
+static double ElapsedSec(Clock::time_point from, Clock::time_point to)
+{
+	return std::chrono::duration_cast<std::chrono::duration<double>>(to - from).count();
+}
+
+class Benchmark
+{
+public:
+
+	Benchmark(const std::string& filter, double minTime) : filter_(filter), minTime_(minTime)
+	{
+		std::cout << std::left << std::setw(52) << "kernel" << std::right << std::setw(14) << "ns/op"
+			<< std::setw(14) << "allocs/op" << std::setw(12) << "iterations" << std::endl;
+	}
+
+	bool Selected(const std::string& name) const
+	{
+		return filter_.empty() || name.find(filter_) != std::string::npos;
+	}
+
+	// op is timed in batches, for kernels too fast to read the clock at each call
+	template <class Op>
+	void Run(const std::string& name, Op op)
+	{
+		if (!Selected(name))
+			return;
+
+		op();
+
+		uint64_t iterations = 1;
+		for (;;)
+		{
+			const uint64_t allocs0 = allocations.load();
+			const auto t0 = Clock::now();
+			for (uint64_t i = 0; i < iterations; i++)
+				op();
+			const double elapsed = ElapsedSec(t0, Clock::now());
+			const uint64_t allocs = allocations.load() - allocs0;
+
+			if (elapsed >= minTime_)
+			{
+				Report(name, elapsed, allocs, iterations);
+				return;
+			}
+
+			const double scale = elapsed > 0 ? 1.2 * minTime_ / elapsed : 100.0;
+			iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 2.0), 100.0));
+		}
+	}
+
+	// setup runs before each op and is not timed, for kernels modifying their inputs
+	template <class Setup, class Op>
+	void Run(const std::string& name, Setup setup, Op op)
+	{
+		if (!Selected(name))
+			return;
+
+		setup();
+		op();
+
+		double elapsed = 0;
+		uint64_t allocs = 0;
+		uint64_t iterations = 0;
+		while (elapsed < minTime_)
+		{
+			setup();
+
+			const uint64_t allocs0 = allocations.load();
+			const auto t0 = Clock::now();
+			op();
+			elapsed += ElapsedSec(t0, Clock::now());
+			allocs += allocations.load() - allocs0;
+			iterations++;
+		}
+
+		Report(name, elapsed, allocs, iterations);
+	}
+
+private:
+
+	void Report(const std::string& name, double elapsed, uint64_t allocs, uint64_t iterations) const
+	{
+		std::cout << std::left << std::setw(52) << name << std::right << std::fixed
+			<< std::setw(14) << std::setprecision(1) << 1e9 * elapsed / iterations
+			<< std::setw(14) << std::setprecision(2) << static_cast<double>(allocs) / iterations
+			<< std::setw(12) << iterations << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	std::string filter_;
+	double minTime_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Synthetic images
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Quantized multi-scale noise (the value noise of the synthetic sequences): flat patches with sharp edges
+// and corners, where FAST fires
+static uchar Texture(float x, float y)
+{
+	float value = 0.f;
+	float amplitude = 0.5f;
+	for (uint32_t cell = 64; cell >= 4; cell /= 2)
+	{
+		value += amplitude * SyntheticSequence::ValueNoise(x / cell, y / cell, cell);
+		amplitude *= 0.6f;
+	}
+	const float levels = 6.f;
+	const float quantized = std::floor(value * levels) / levels;
+	return cv::saturate_cast<uchar>(30 + 220 * quantized + 10 * SyntheticSequence::Lattice(static_cast<int>(x), static_cast<int>(y), 1));
+}
+
+// Rectified pair of a slanted plane: the disparity grows from the top to the bottom rows
+static void RenderStereoPair(const cv::Size& size, float bf, cv::Mat& left, cv::Mat& right)
+{
+	left.create(size, CV_8U);
+	right.create(size, CV_8U);
+	for (int v = 0; v < size.height; v++)
+	{
+		const float Z = 20.f - 18.f * v / size.height;
+		const float disparity = bf / Z;
+		for (int u = 0; u < size.width; u++)
+		{
+			left.at<uchar>(v, u) = Texture(static_cast<float>(u), static_cast<float>(v));
+			right.at<uchar>(v, u) = Texture(u + disparity, static_cast<float>(v));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Synthetic scene
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const double PI = 3.14159265358979;
+
+// Keyframes on a circle looking outwards at a textured cylinder, going around 1.25 times.
+// The second lap observes duplicates of the first lap points, as a drifting system would,
+// so the last keyframes close a loop with the first ones.
+class SyntheticScene
+{
+public:
+
+	struct Point
+	{
+		Point3D Xw;
+		Vec3D normal;
+		cv::Mat descriptor;
+		int octave;
+		float angle;
+	};
+
+	SyntheticScene(int numKeyFrames, int numPoints, const ORBextractor& extractor) : rng_(7), numKeyFrames_(numKeyFrames)
+	{
+		camera_.fx = 458.654f;
+		camera_.fy = 457.296f;
+		camera_.cx = 367.215f;
+		camera_.cy = 248.375f;
+		camera_.baseline = 0.11f;
+		camera_.bf = camera_.baseline * camera_.fx;
+		imageSize_ = cv::Size(752, 480);
+		imageBounds_ = ImageBounds(0.f, static_cast<float>(imageSize_.width), 0.f, static_cast<float>(imageSize_.height));
+
+		pyramid_.nlevels = extractor.GetLevels();
+		pyramid_.scaleFactor = extractor.GetScaleFactor();
+		pyramid_.logScaleFactor = std::log(pyramid_.scaleFactor);
+		pyramid_.scaleFactors = extractor.GetScaleFactors();
+		pyramid_.invScaleFactors = extractor.GetInverseScaleFactors();
+		pyramid_.sigmaSq = extractor.GetScaleSigmaSquares();
+		pyramid_.invSigmaSq = extractor.GetInverseScaleSigmaSquares();
+
+		std::uniform_real_distribution<float> angle(0.f, static_cast<float>(2 * PI));
+		std::uniform_real_distribution<float> height(-1.5f, 1.5f);
+		std::uniform_int_distribution<int> byte(0, 255);
+		std::uniform_int_distribution<int> octave(0, std::min(3, pyramid_.nlevels - 1));
+		std::uniform_real_distribution<float> kpAngle(0.f, 360.f);
+
+		points_.resize(numPoints);
+		for (Point& point : points_)
+		{
+			const float phi = angle(rng_);
+			point.Xw = Point3D(RADIUS * std::cos(phi), height(rng_), RADIUS * std::sin(phi));
+			point.normal = Vec3D(-std::cos(phi), 0.f, -std::sin(phi));
+			point.descriptor = RandomDescriptor();
+			point.octave = octave(rng_);
+			point.angle = kpAngle(rng_);
+		}
+	}
+
+	~SyntheticScene()
+	{
+		// The map deletes the keyframes and map points
+		map_.reset();
+	}
+
+	// Pose on the trajectory, t in keyframe units
+	CameraPose Pose(double t) const
+	{
+		const double theta = 2.5 * PI * t / numKeyFrames_;
+		const Vec3D z(static_cast<float>(std::cos(theta)), 0.f, static_cast<float>(std::sin(theta)));
+		const Vec3D y(0.f, 1.f, 0.f);
+		const Vec3D x = y.cross(z);
+		const Point3D C = CAMERA_RADIUS * z;
+
+		CameraPose::Mat33 Rcw;
+		for (int j = 0; j < 3; j++)
+		{
+			Rcw(0, j) = x(j);
+			Rcw(1, j) = y(j);
+			Rcw(2, j) = z(j);
+		}
+		return CameraPose(Rcw, -(Rcw * C));
+	}
+
+	// First or second lap
+	int Lap(double t) const
+	{
+		return 2.5 * PI * t / numKeyFrames_ >= 2 * PI ? 1 : 0;
+	}
+
+	// Stereo frame at t. pointIndices receives the scene point of each keypoint (-1 for clutter).
+	Frame MakeFrame(frameid_t id, double t, const ORBVocabulary* voc, std::vector<int>& pointIndices)
+	{
+		const CameraPose Tcw = Pose(t);
+		const CameraProjection proj(Tcw, camera_);
+		const Point3D C = Tcw.Inverse().t();
+
+		std::normal_distribution<float> pixelNoise(0.f, 0.5f);
+		std::normal_distribution<float> angleNoise(0.f, 2.f);
+		std::uniform_real_distribution<float> uniform(0.f, 1.f);
+		std::uniform_int_distribution<int> flips(0, 6);
+
+		KeyPoints keypoints;
+		std::vector<float> uright, depth;
+		std::vector<cv::Mat> descriptors;
+		pointIndices.clear();
+
+		for (size_t i = 0; i < points_.size(); i++)
+		{
+			const Point& point = points_[i];
+			const Point3D Xc = proj.WorldToCamera(point.Xw);
+			if (Xc(2) < 0.5f)
+				continue;
+
+			const Point2D pt = proj.CameraToImage(Xc);
+			if (!imageBounds_.Contains(pt.x, pt.y))
+				continue;
+
+			const Vec3D view = (C - point.Xw) * (1.f / static_cast<float>(cv::norm(C - point.Xw)));
+			if (view.dot(point.normal) < 0.5f || uniform(rng_) < 0.1f)
+				continue;
+
+			cv::KeyPoint keypoint;
+			keypoint.pt = Point2D(pt.x + pixelNoise(rng_), pt.y + pixelNoise(rng_));
+			keypoint.octave = point.octave;
+			keypoint.size = 31.f * pyramid_.scaleFactors[point.octave];
+			keypoint.angle = std::fmod(point.angle + angleNoise(rng_) + 360.f, 360.f);
+			keypoint.response = 1.f;
+
+			keypoints.push_back(keypoint);
+			uright.push_back(keypoint.pt.x - camera_.bf / Xc(2));
+			depth.push_back(Xc(2));
+			descriptors.push_back(FlipBits(point.descriptor, flips(rng_)));
+			pointIndices.push_back(static_cast<int>(i));
+		}
+
+		// Clutter: features without a map point
+		std::uniform_real_distribution<float> u(0.f, static_cast<float>(imageSize_.width));
+		std::uniform_real_distribution<float> v(0.f, static_cast<float>(imageSize_.height));
+		std::uniform_int_distribution<int> octave(0, pyramid_.nlevels - 1);
+		const size_t numClutter = keypoints.size() / 8;
+		for (size_t i = 0; i < numClutter; i++)
+		{
+			cv::KeyPoint keypoint(u(rng_), v(rng_), 31.f, 360.f * uniform(rng_), 1.f, octave(rng_));
+			keypoints.push_back(keypoint);
+			uright.push_back(-1.f);
+			depth.push_back(-1.f);
+			descriptors.push_back(RandomDescriptor());
+			pointIndices.push_back(-1);
+		}
+
+		cv::Mat descriptorMat;
+		if (!descriptors.empty())
+			cv::vconcat(descriptors, descriptorMat);
+
+		Frame frame(id, voc, t, camera_, keypoints, keypoints, uright, depth, descriptorMat, pyramid_, imageBounds_);
+		frame.SetPose(Tcw);
+		if (voc)
+			frame.ComputeBoW();
+		return frame;
+	}
+
+	// Descriptors of the scene points, to train a vocabulary
+	std::vector<std::vector<cv::Mat>> GetFeatures() const
+	{
+		std::vector<std::vector<cv::Mat>> features(1);
+		for (const Point& point : points_)
+			features[0].push_back(point.descriptor);
+		return features;
+	}
+
+	// Builds the keyframes, map points, covisibility graph and keyframe database
+	void BuildMap(const ORBVocabulary* voc)
+	{
+		map_ = std::make_unique<Map>();
+		keyFrameDB_ = std::make_unique<KeyFrameDatabase>(*voc);
+		mappoints_[0].assign(points_.size(), nullptr);
+		mappoints_[1].assign(points_.size(), nullptr);
+
+		std::vector<int> pointIndices;
+		for (int i = 0; i < numKeyFrames_; i++)
+		{
+			Frame frame = MakeFrame(i, i, voc, pointIndices);
+			KeyFrame* keyframe = new KeyFrame(frame, map_.get(), keyFrameDB_.get(), i == 0);
+			map_->AddKeyFrame(keyframe);
+
+			std::vector<MapPoint*>& mappoints = mappoints_[Lap(i)];
+			for (size_t j = 0; j < pointIndices.size(); j++)
+			{
+				const int idx = pointIndices[j];
+				if (idx < 0)
+					continue;
+
+				if (!mappoints[idx])
+				{
+					mappoints[idx] = new MapPoint(points_[idx].Xw, keyframe, map_.get());
+					map_->AddMapPoint(mappoints[idx]);
+				}
+				mappoints[idx]->AddObservation(keyframe, j);
+				keyframe->AddMapPoint(mappoints[idx], j);
+			}
+			keyframes_.push_back(keyframe);
+		}
+
+		for (int lap = 0; lap < 2; lap++)
+		{
+			for (MapPoint* mappoint : mappoints_[lap])
+			{
+				if (!mappoint)
+					continue;
+				mappoint->ComputeDistinctiveDescriptors();
+				mappoint->UpdateNormalAndDepth();
+			}
+		}
+
+		for (KeyFrame* keyframe : keyframes_)
+		{
+			keyframe->UpdateConnections();
+			keyFrameDB_->add(keyframe);
+		}
+	}
+
+	// Map points of a frame, from its scene point indices
+	void AssociateMapPoints(Frame& frame, const std::vector<int>& pointIndices, int lap) const
+	{
+		for (size_t i = 0; i < pointIndices.size(); i++)
+			frame.mappoints[i] = pointIndices[i] >= 0 ? mappoints_[lap][pointIndices[i]] : nullptr;
+	}
+
+	// Random rigid perturbation: rotation (rad) and translation (m) scales
+	CameraPose Perturb(const CameraPose& T, float rotation, float translation)
+	{
+		std::normal_distribution<float> noise(0.f, 1.f);
+		const cv::Vec3f w(rotation * noise(rng_), rotation * noise(rng_), rotation * noise(rng_));
+		cv::Matx33f dR;
+		cv::Rodrigues(w, dR);
+		const CameraPose::Mat31 dt(translation * noise(rng_), translation * noise(rng_), translation * noise(rng_));
+		return CameraPose(dR, dt) * T;
+	}
+
+	Point3D Perturb(const Point3D& X, float translation)
+	{
+		std::normal_distribution<float> noise(0.f, translation);
+		return X + Point3D(noise(rng_), noise(rng_), noise(rng_));
+	}
+
+	const CameraParams& GetCamera() const { return camera_; }
+	const cv::Size& GetImageSize() const { return imageSize_; }
+	Map* GetMap() { return map_.get(); }
+	KeyFrameDatabase* GetKeyFrameDB() { return keyFrameDB_.get(); }
+	const std::vector<KeyFrame*>& GetKeyFrames() const { return keyframes_; }
+	const std::vector<MapPoint*>& GetMapPoints(int lap) const { return mappoints_[lap]; }
+
+private:
+
+	cv::Mat RandomDescriptor()
+	{
+		std::uniform_int_distribution<int> byte(0, 255);
+		cv::Mat descriptor(1, 32, CV_8U);
+		for (int i = 0; i < 32; i++)
+			descriptor.at<uchar>(0, i) = static_cast<uchar>(byte(rng_));
+		return descriptor;
+	}
+
+	cv::Mat FlipBits(const cv::Mat& descriptor, int nbits)
+	{
+		std::uniform_int_distribution<int> bit(0, 255);
+		cv::Mat flipped = descriptor.clone();
+		for (int i = 0; i < nbits; i++)
+		{
+			const int b = bit(rng_);
+			flipped.at<uchar>(0, b / 8) ^= static_cast<uchar>(1 << (b % 8));
+		}
+		return flipped;
+	}
+
+	static constexpr float RADIUS = 6.f;
+	static constexpr float CAMERA_RADIUS = 1.5f;
+
+	std::mt19937 rng_;
+	int numKeyFrames_;
+	CameraParams camera_;
+	cv::Size imageSize_;
+	ImageBounds imageBounds_;
+	ScalePyramidInfo pyramid_;
+	std::vector<Point> points_;
+
+	std::unique_ptr<Map> map_;
+	std::unique_ptr<KeyFrameDatabase> keyFrameDB_;
+	std::vector<KeyFrame*> keyframes_;
+	std::vector<MapPoint*> mappoints_[2];
+};
+
+constexpr float SyntheticScene::RADIUS;
+constexpr float SyntheticScene::CAMERA_RADIUS;
+
+// Fills the tracking variables of the map points visible in the frame, as the local map tracking does
+static void ProjectLocalMap(const Frame& frame, const std::vector<MapPoint*>& mappoints,
+	std::vector<MapPointProjection>& projections)
+{
+	const CameraProjection proj(frame.pose, frame.camera);
+	const Point3D Ow = frame.GetCameraCenter();
+	projections.clear();
+	for (MapPoint* mappoint : mappoints)
+	{
+		mappoint->trackInView = false;
+
+		const Point3D Xw = mappoint->GetWorldPos();
+		const Point3D Xc = proj.WorldToCamera(Xw);
+		if (Xc(2) < 0.f)
+			continue;
+
+		const Point2D pt = proj.CameraToImage(Xc);
+		if (!frame.imageBounds.Contains(pt.x, pt.y))
+			continue;
+
+		const Vec3D PO = Xw - Ow;
+		const float dist = static_cast<float>(cv::norm(PO));
+		if (dist < mappoint->GetMinDistanceInvariance() || dist > mappoint->GetMaxDistanceInvariance())
+			continue;
+
+		const float viewCos = static_cast<float>(PO.dot(mappoint->GetNormal()) / dist);
+		if (viewCos < 0.5f)
+			continue;
+
+		mappoint->trackInView = true;
+		mappoint->trackProjX = pt.x;
+		mappoint->trackProjXR = pt.x - proj.DepthToDisparity(Xc(2));
+		mappoint->trackProjY = pt.y;
+		mappoint->trackScaleLevel = mappoint->PredictScale(dist, &frame);
+		mappoint->trackViewCos = viewCos;
+
+		MapPointProjection projection;
+		projection.mappoint = mappoint;
+		projection.x = mappoint->trackProjX;
+		projection.y = mappoint->trackProjY;
+		projection.xR = mappoint->trackProjXR;
+		projection.scaleLevel = mappoint->trackScaleLevel;
+		projection.viewCos = viewCos;
+		projections.push_back(projection);
+	}
+}
+
+// Map points of the keyframe and its covisible keyframes
+static std::vector<MapPoint*> GetLocalMapPoints(KeyFrame* keyframe)
+{
+	std::vector<KeyFrame*> keyframes = keyframe->GetVectorCovisibleKeyFrames();
+	keyframes.push_back(keyframe);
+
+	std::set<MapPoint*> mappoints;
+	for (KeyFrame* neighbor : keyframes)
+		for (MapPoint* mappoint : neighbor->GetMapPointMatches())
+			if (mappoint && !mappoint->isBad())
+				mappoints.insert(mappoint);
+
+	return std::vector<MapPoint*>(std::begin(mappoints), std::end(mappoints));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Thread wakeup
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Hands requests over to a worker thread, as Tracking hands keyframes over to Local Mapping.
+// The worker either waits on a ThreadSignal, or checks the request every pollingMs milliseconds
+// (the sleep of the Local Mapping loop before the signals was 3 ms).
+class Handoff
+{
+public:
+
+	Handoff(int pollingMs) : pollingMs_(pollingMs), request_(false), finish_(false), ack_(false),
+		worker_(&Handoff::Run, this) {}
+
+	~Handoff()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			finish_ = true;
+		}
+		signal_.Notify();
+		worker_.join();
+	}
+
+	// Returns once the worker has woken up and acknowledged the request
+	void Request()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			request_ = true;
+		}
+		signal_.Notify();
+		while (!ack_.exchange(false, std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+
+private:
+
+	bool CheckRequest()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		return request_ || finish_;
+	}
+
+	void Run()
+	{
+		for (;;)
+		{
+			if (pollingMs_ > 0)
+			{
+				while (!CheckRequest())
+					std::this_thread::sleep_for(std::chrono::milliseconds(pollingMs_));
+			}
+			else
+			{
+				signal_.Wait([this] { return CheckRequest(); });
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (finish_)
+					return;
+				request_ = false;
+			}
+			ack_.store(true, std::memory_order_release);
+		}
+	}
+
+	const int pollingMs_;
+	std::mutex mutex_;
+	bool request_;
+	bool finish_;
+	std::atomic<bool> ack_;
+	ThreadSignal signal_;
+	std::thread worker_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool ReadOption(const std::string& arg, const std::string& name, std::string& value)
+{
+	if (arg.compare(0, name.size(), name) != 0)
+		return false;
+	value = arg.substr(name.size());
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter, vocabularyFile, value;
+	double minTime = 0.5;
+	int numKeyFrames = 40;
+	int numPoints = 4000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (ReadOption(arg, "--filter=", value))
+			filter = value;
+		else if (ReadOption(arg, "--vocabulary=", value))
+			vocabularyFile = value;
+		else if (ReadOption(arg, "--min-time=", value))
+			minTime = std::stod(value);
+		else if (ReadOption(arg, "--keyframes=", value))
+			numKeyFrames = std::max(std::stoi(value), 8);
+		else if (ReadOption(arg, "--points=", value))
+			numPoints = std::max(std::stoi(value), 100);
+		else
+		{
+			std::cerr << "Usage: ./kernel_benchmark [--filter=substring] [--min-time=seconds] [--vocabulary=path]"
+				<< " [--keyframes=N] [--points=N]" << std::endl;
+			return 1;
+		}
+	}
+
+	ORBextractor extractorL(ORBextractor::Parameters(1200));
+	ORBextractor extractorR(ORBextractor::Parameters(1200));
+	SyntheticScene scene(numKeyFrames, numPoints, extractorL);
+
+	// The stock vocabulary if given, otherwise a small one trained on the scene
+	System::VocabularyPointer voc;
+	if (!vocabularyFile.empty())
+	{
+		std::cout << "Loading vocabulary " << vocabularyFile << " ..." << std::endl;
+		voc = System::LoadVocabulary(vocabularyFile);
+		if (!voc)
+		{
+			std::cerr << "Failed to open vocabulary at: " << vocabularyFile << std::endl;
+			return 1;
+		}
+	}
+	else
+	{
+		std::cout << "Training a vocabulary on the synthetic scene ..." << std::endl;
+		auto trained = std::make_shared<ORBVocabulary>();
+		trained->create(scene.GetFeatures(), 10, 4, DBoW2::TF_IDF, DBoW2::L1_NORM);
+		voc = trained;
+	}
+
+	std::cout << "Building the synthetic map ..." << std::endl;
+	scene.BuildMap(voc.get());
+	std::cout << "keyframes: " << scene.GetMap()->KeyFramesInMap() << ", map points: " << scene.GetMap()->MapPointsInMap()
+		<< std::endl << std::endl;
+
+	const std::vector<KeyFrame*>& keyframes = scene.GetKeyFrames();
+	const int current = numKeyFrames / 4;
+	KeyFrame* currentKF = keyframes[current];
+
+	// Frame between two keyframes of the first lap, with its true pose as prediction
+	std::vector<int> framePoints, lastFramePoints;
+	Frame frame = scene.MakeFrame(numKeyFrames, current + 0.5, voc.get(), framePoints);
+	Frame lastFrame = scene.MakeFrame(numKeyFrames + 1, current, voc.get(), lastFramePoints);
+	scene.AssociateMapPoints(lastFrame, lastFramePoints, 0);
+
+	// Loop: last keyframe (second lap) and the first lap keyframe at the same place
+	KeyFrame* loopKF = keyframes.back();
+	const int revisited = static_cast<int>(std::round(numKeyFrames - 1 - numKeyFrames / 1.25));
+	KeyFrame* oldKF = keyframes[std::max(revisited, 0)];
+
+	Benchmark bench(filter, minTime);
+
+	// Feature extraction and stereo matching
+	cv::Mat imageL, imageR;
+	RenderStereoPair(scene.GetImageSize(), scene.GetCamera().bf, imageL, imageR);
+	{
+		KeyPoints keypoints;
+		cv::Mat descriptors;
+		bench.Run("ORBextractor::Extract", [&]() {
+			extractorL.Extract(imageL, keypoints, descriptors);
+			sink = keypoints.size();
+		});
+	}
+	{
+		KeyPoints keypointsL, keypointsR;
+		cv::Mat descriptorsL, descriptorsR;
+		extractorL.Extract(imageL, keypointsL, descriptorsL);
+		extractorR.Extract(imageR, keypointsR, descriptorsR);
+		std::vector<float> uright, depth;
+		bench.Run("ComputeStereoMatches", [&]() {
+			ComputeStereoMatches(keypointsL, descriptorsL, extractorL.GetImagePyramid(),
+				keypointsR, descriptorsR, extractorR.GetImagePyramid(),
+				extractorL.GetScaleFactors(), extractorL.GetInverseScaleFactors(), scene.GetCamera(), uright, depth);
+			sink = uright.size();
+		});
+	}
+
+	// Matching
+	{
+		const int rows = frame.descriptors.rows;
+		int i = 0;
+		bench.Run("ORBmatcher::DescriptorDistance", [&]() {
+			sink = ORBmatcher::DescriptorDistance(frame.descriptors.row(i), frame.descriptors.row((i + 1) % rows));
+			i = (i + 1) % rows;
+		});
+	}
+	{
+		const std::vector<MapPoint*> localMap = GetLocalMapPoints(currentKF);
+		std::vector<MapPointProjection> projections;
+		ProjectLocalMap(frame, localMap, projections);
+
+		ORBmatcher matcher(0.8f);
+		auto reset = [&]() { std::fill(std::begin(frame.mappoints), std::end(frame.mappoints), nullptr); };
+		bench.Run("ORBmatcher::SearchByProjection(local map)", reset, [&]() {
+			sink = matcher.SearchByProjection(frame, localMap, 1.f);
+		});
+		bench.Run("ORBmatcher::SearchByProjection(projections)", reset, [&]() {
+			sink = matcher.SearchByProjection(frame, projections, 1.f);
+		});
+	}
+	{
+		ORBmatcher matcher(0.9f, true);
+		bench.Run("ORBmatcher::SearchByProjection(last frame)",
+			[&]() { std::fill(std::begin(frame.mappoints), std::end(frame.mappoints), nullptr); },
+			[&]() { sink = matcher.SearchByProjection(frame, lastFrame, 7.f, false); });
+	}
+	{
+		ORBmatcher matcher(0.9f, true);
+		const std::set<MapPoint*> alreadyFound;
+		bench.Run("ORBmatcher::SearchByProjection(keyframe)",
+			[&]() { std::fill(std::begin(frame.mappoints), std::end(frame.mappoints), nullptr); },
+			[&]() { sink = matcher.SearchByProjection(frame, currentKF, alreadyFound, 10.f, 100); });
+	}
+	{
+		ORBmatcher matcher(0.75f, true);
+		const Sim3 Scw(loopKF->GetPose());
+		const std::vector<MapPoint*> loopMapPoints = GetLocalMapPoints(oldKF);
+		std::vector<MapPoint*> matched;
+		bench.Run("ORBmatcher::SearchByProjection(Sim3)",
+			[&]() { matched.assign(loopKF->N, nullptr); },
+			[&]() { sink = matcher.SearchByProjection(loopKF, Scw, loopMapPoints, matched, 10); });
+	}
+	{
+		ORBmatcher matcher(0.75f, true);
+		std::vector<MapPoint*> matches;
+		bench.Run("ORBmatcher::SearchByBoW(keyframe, frame)", [&]() {
+			sink = matcher.SearchByBoW(currentKF, frame, matches);
+		});
+		bench.Run("ORBmatcher::SearchByBoW(keyframe, keyframe)", [&]() {
+			sink = matcher.SearchByBoW(loopKF, oldKF, matches);
+		});
+	}
+
+	// Optimization
+	{
+		const CameraPose Tcw = frame.pose;
+		bench.Run("Optimizer::PoseOptimization",
+			[&]() {
+				scene.AssociateMapPoints(frame, framePoints, 0);
+				std::fill(std::begin(frame.outlier), std::end(frame.outlier), false);
+				frame.SetPose(scene.Perturb(Tcw, 0.01f, 0.05f));
+			},
+			[&]() { sink = Optimizer::PoseOptimization(&frame, scene.GetMap()); });
+		frame.SetPose(Tcw);
+	}
+	{
+		// Restores a perturbed copy of the true poses and positions before each run
+		std::vector<CameraPose> poses;
+		for (KeyFrame* keyframe : keyframes)
+			poses.push_back(scene.Perturb(keyframe->GetPose(), 0.002f, 0.01f));
+
+		std::vector<MapPoint*> mappoints = scene.GetMap()->GetAllMapPoints();
+		std::vector<Point3D> positions;
+		for (MapPoint* mappoint : mappoints)
+			positions.push_back(scene.Perturb(mappoint->GetWorldPos(), 0.01f));
+
+		bool stopFlag = false;
+		bench.Run("Optimizer::LocalBundleAdjustment",
+			[&]() {
+				for (size_t i = 0; i < keyframes.size(); i++)
+					keyframes[i]->SetPose(poses[i]);
+				for (size_t i = 0; i < mappoints.size(); i++)
+					mappoints[i]->SetWorldPos(positions[i]);
+			},
+			[&]() { Optimizer::LocalBundleAdjustment(currentKF, &stopFlag, scene.GetMap()); });
+	}
+	{
+		ORBmatcher matcher(0.75f, true);
+		std::vector<MapPoint*> bowMatches, matches;
+		matcher.SearchByBoW(loopKF, oldKF, bowMatches);
+
+		const Sim3 S12True(loopKF->GetPose() * oldKF->GetPose().Inverse());
+		Sim3 S12;
+		bench.Run("Optimizer::OptimizeSim3",
+			[&]() {
+				matches = bowMatches;
+				S12 = Sim3(scene.Perturb(S12True, 0.01f, 0.05f));
+			},
+			[&]() { sink = Optimizer::OptimizeSim3(loopKF, oldKF, matches, S12, 10.f, true); });
+	}
+
+	// Place recognition
+	{
+		DBoW2::BowVector bowVector;
+		DBoW2::FeatureVector featureVector;
+		bench.Run("TemplatedVocabulary::transform", [&]() {
+			bowVector.clear();
+			featureVector.clear();
+			voc->transform(frame.descriptors, bowVector, featureVector, 4);
+			sink = bowVector.size();
+		});
+	}
+	bench.Run("KeyFrameDatabase::DetectLoopCandidates", [&]() {
+		sink = scene.GetKeyFrameDB()->DetectLoopCandidates(loopKF, 0.f).size();
+	});
+	{
+		ORBmatcher matcher(0.75f, true);
+		std::vector<MapPoint*> matches;
+		matcher.SearchByBoW(currentKF, frame, matches);
+
+		std::unique_ptr<PnPsolver> solver;
+		bench.Run("PnPsolver::iterate",
+			[&]() {
+				solver = std::make_unique<PnPsolver>(frame, matches);
+				solver->SetRansacParameters(0.99, 10, 300, 4, 0.5f, 5.991f);
+			},
+			[&]() {
+				bool noMore;
+				std::vector<bool> inliers;
+				int ninliers;
+				sink = solver->iterate(5, noMore, inliers, ninliers).rows;
+			});
+	}
+
+	// Keyframe handoff to Local Mapping: wakeup latency with and without the signal
+	{
+		Handoff handoff(0);
+		bench.Run("ThreadSignal wakeup (keyframe handoff)", [&]() { handoff.Request(); });
+	}
+	{
+		Handoff handoff(3);
+		bench.Run("3 ms polling wakeup (keyframe handoff)", [&]() { handoff.Request(); });
+	}
+
+	return 0;
+}
@@ -0,0 +1,233 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include <System.h>
+#include <LocalizationServer.h>
+#include <SyntheticSequence.h>
+
+using ORB_SLAM2::System;
+using ORB_SLAM2::Localizer;
+using ORB_SLAM2::LocalizationServer;
+using ORB_SLAM2::SyntheticSequence;
+using ORB_SLAM2::CameraPose;
+
+// Stress check of the localization server.
+// A first session maps a synthetic sequence, then hands its map over to a LocalizationServer.
+// N threads each create a localizer and localize every frame of the sequence against the shared map at once,
+// and their camera centers are compared with the ground truth (expressed in the frame of the first camera,
+// the origin of the map). Exits with status 2 if a localized camera is farther than the largest error accepted.
+
+struct LocalizerResult
+{
+	int localized;
+	double maxError;
+	double sumError;
+	double localizingSec;
+	LocalizerResult() : localized(0), maxError(0), sumError(0), localizingSec(0) {}
+};
+
+static cv::Mat TrackFrame(System& SLAM, System::Sensor sensor, const ORB_SLAM2::DatasetFrame& frame)
+{
+	if (sensor == System::STEREO)
+		return SLAM.TrackStereo(frame.image, frame.image2, frame.timestamp);
+	if (sensor == System::RGBD)
+		return SLAM.TrackRGBD(frame.image, frame.image2, frame.timestamp);
+	return SLAM.TrackMonocular(frame.image, frame.timestamp);
+}
+
+static cv::Mat LocalizeFrame(Localizer& localizer, System::Sensor sensor, const ORB_SLAM2::DatasetFrame& frame)
+{
+	if (sensor == System::STEREO)
+		return localizer.LocalizeStereo(frame.image, frame.image2, frame.timestamp);
+	if (sensor == System::RGBD)
+		return localizer.LocalizeRGBD(frame.image, frame.image2, frame.timestamp);
+	return localizer.LocalizeMonocular(frame.image, frame.timestamp);
+}
+
+static void RunLocalizer(const LocalizationServer& server, const std::string& settingsFile,
+	const SyntheticSequence& sequence, int nframes, LocalizerResult& result)
+{
+	const System::Sensor sensor = static_cast<System::Sensor>(sequence.GetParameters().sensor);
+	Localizer::Pointer localizer = server.CreateLocalizer(settingsFile, sensor);
+	if (!localizer)
+		return;
+
+	const CameraPose T0w = sequence.GetPose(0);
+	ORB_SLAM2::DatasetFrame frame;
+	for (int i = 0; i < nframes; i++)
+	{
+		sequence.Render(i, frame);
+
+		const auto t1 = std::chrono::steady_clock::now();
+		const cv::Mat Tcw = LocalizeFrame(*localizer, sensor, frame);
+		const auto t2 = std::chrono::steady_clock::now();
+		result.localizingSec += std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+
+		if (Tcw.empty())
+			continue;
+
+		// Ground truth relative to the first camera
+		const CameraPose Tc0 = sequence.GetPose(i) * T0w.Inverse();
+		const double error = cv::norm(CameraPose(cv::Mat1f(Tcw)).Invt() - Tc0.Invt());
+		result.localized++;
+		result.sumError += error;
+		result.maxError = std::max(result.maxError, error);
+	}
+}
+
+static bool ReadOption(const std::string& arg, const std::string& name, std::string& value)
+{
+	if (arg.compare(0, name.size(), name) != 0)
+		return false;
+	value = arg.substr(name.size());
+	return true;
+}
+
+static void PrintUsage()
+{
+	std::cerr << std::endl << "Usage: ./localization_stress path_to_vocabulary output_directory [options]" << std::endl
+		<< "  --threads=N      concurrent localizers (default 8)" << std::endl
+		<< "  --sensor=mono|stereo|rgbd (default stereo)" << std::endl
+		<< "  --blocks=N       city blocks per side (default 2)" << std::endl
+		<< "  --max-error=X    largest camera center error accepted in meters (default 0.5)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string vocabularyFile = argv[1];
+	const std::string directory = argv[2];
+	std::string value;
+	int nthreads = 8;
+	double maxError = 0.5;
+	SyntheticSequence::Parameters param;
+	param.blocks = 2;
+	param.laps = 1;
+
+	// The localizers render their frames concurrently
+	param.numThreads = 1;
+
+	for (int i = 3; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		bool valid = true;
+		if (ReadOption(arg, "--threads=", value))
+			nthreads = std::max(std::stoi(value), 1);
+		else if (ReadOption(arg, "--sensor=", value))
+		{
+			if (value == "mono")
+				param.sensor = System::MONOCULAR;
+			else if (value == "stereo")
+				param.sensor = System::STEREO;
+			else if (value == "rgbd")
+				param.sensor = System::RGBD;
+			else
+				valid = false;
+		}
+		else if (ReadOption(arg, "--blocks=", value))
+			param.blocks = std::max(std::stoi(value), 1);
+		else if (ReadOption(arg, "--max-error=", value))
+			maxError = std::stod(value);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Invalid option: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	const SyntheticSequence sequence(param);
+	const std::string settingsFile = directory + "/settings.yaml";
+	if (!sequence.WriteSettings(settingsFile))
+		return 1;
+	const int nframes = sequence.Size();
+	const System::Sensor sensor = static_cast<System::Sensor>(param.sensor);
+
+	// Mapping
+	auto SLAM = System::Create(vocabularyFile, settingsFile, sensor, false);
+	SLAM->SetReplayMode(true);
+	ORB_SLAM2::DatasetFrame frame;
+	for (int i = 0; i < nframes; i++)
+	{
+		sequence.Render(i, frame);
+		TrackFrame(*SLAM, sensor, frame);
+	}
+	SLAM->Shutdown();
+
+	const std::unique_ptr<LocalizationServer> server = SLAM->CreateLocalizationServer();
+	if (!server)
+	{
+		std::cerr << "Failed to create the localization server" << std::endl;
+		return 1;
+	}
+	std::cout << "map: " << server->KeyFramesInMap() << " keyframes, " << server->MapPointsInMap() << " points" << std::endl;
+
+	// Every localizer on the whole sequence at once
+	std::vector<LocalizerResult> results(nthreads);
+	std::vector<std::thread> threads;
+	const auto t1 = std::chrono::steady_clock::now();
+	for (int i = 0; i < nthreads; i++)
+		threads.emplace_back(RunLocalizer, std::cref(*server), settingsFile, std::cref(sequence), nframes, std::ref(results[i]));
+	for (std::thread& thread : threads)
+		thread.join();
+	const auto t2 = std::chrono::steady_clock::now();
+	const double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+
+	std::cout << "-------" << std::endl << std::endl << std::fixed << std::setprecision(3);
+
+	bool failed = false;
+	for (int i = 0; i < nthreads; i++)
+	{
+		const LocalizerResult& result = results[i];
+		std::cout << "localizer " << i << ": " << result.localized << " / " << nframes << " frames localized, error mean "
+			<< result.sumError / std::max(result.localized, 1) << " m, max " << result.maxError << " m, "
+			<< 1e3 * result.localizingSec / nframes << " ms/frame" << std::endl;
+		failed = failed || result.localized == 0 || result.maxError > maxError;
+	}
+
+	std::cout << nthreads << " localizers in " << elapsed << " s: " << nthreads * nframes / elapsed << " frames/s" << std::endl;
+
+	if (failed)
+	{
+		std::cerr << "FAILED: a localizer lost the map or exceeded the largest error" << std::endl;
+		return 2;
+	}
+
+	std::cout << "OK" << std::endl;
+	return 0;
+}
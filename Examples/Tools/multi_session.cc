@@ -0,0 +1,232 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+#include <opencv2/opencv.hpp>
+
+#include <System.h>
+#include <SyntheticSequence.h>
+
+using ORB_SLAM2::System;
+using ORB_SLAM2::SyntheticSequence;
+
+// Stress check of several independent SLAM sessions in one process.
+// The sessions share the vocabulary and run concurrently on the same synthetic sequence, in the deterministic
+// mode of the system. A first session runs alone as the reference: if any state leaked between instances
+// (ids, mutexes, scratch buffers), the concurrent sessions would not reproduce its camera poses.
+// Exits with status 2 if a session differs from the reference by more than the tolerance.
+
+struct SessionResult
+{
+	std::vector<cv::Mat> poses;
+	double trackingSec;
+	SessionResult() : trackingSec(0) {}
+};
+
+static void RunSession(const System::VocabularyPointer& voc, const std::string& settingsFile,
+	const SyntheticSequence& sequence, int nframes, SessionResult& result)
+{
+	const System::Sensor sensor = static_cast<System::Sensor>(sequence.GetParameters().sensor);
+	auto SLAM = System::Create(voc, settingsFile, sensor, false);
+	SLAM->SetReplayMode(true);
+
+	ORB_SLAM2::DatasetFrame frame;
+	result.poses.reserve(nframes);
+	for (int i = 0; i < nframes; i++)
+	{
+		sequence.Render(i, frame);
+
+		const auto t1 = std::chrono::steady_clock::now();
+
+		cv::Mat Tcw;
+		if (sensor == System::STEREO)
+			Tcw = SLAM->TrackStereo(frame.image, frame.image2, frame.timestamp);
+		else if (sensor == System::RGBD)
+			Tcw = SLAM->TrackRGBD(frame.image, frame.image2, frame.timestamp);
+		else
+			Tcw = SLAM->TrackMonocular(frame.image, frame.timestamp);
+
+		const auto t2 = std::chrono::steady_clock::now();
+		result.trackingSec += std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+		result.poses.push_back(Tcw.clone());
+	}
+
+	SLAM->Shutdown();
+}
+
+// Largest difference between the poses of two sessions (infinity if one tracked a frame the other did not)
+static double MaxDifference(const SessionResult& lhs, const SessionResult& rhs)
+{
+	double maxDiff = 0;
+	for (size_t i = 0; i < std::min(lhs.poses.size(), rhs.poses.size()); i++)
+	{
+		if (lhs.poses[i].empty() != rhs.poses[i].empty())
+			return std::numeric_limits<double>::infinity();
+		if (!lhs.poses[i].empty())
+			maxDiff = std::max(maxDiff, cv::norm(lhs.poses[i], rhs.poses[i], cv::NORM_INF));
+	}
+	return maxDiff;
+}
+
+static int CountTracked(const SessionResult& result)
+{
+	return static_cast<int>(std::count_if(std::begin(result.poses), std::end(result.poses),
+		[](const cv::Mat& Tcw) { return !Tcw.empty(); }));
+}
+
+static bool ReadOption(const std::string& arg, const std::string& name, std::string& value)
+{
+	if (arg.compare(0, name.size(), name) != 0)
+		return false;
+	value = arg.substr(name.size());
+	return true;
+}
+
+static void PrintUsage()
+{
+	std::cerr << std::endl << "Usage: ./multi_session path_to_vocabulary output_directory [options]" << std::endl
+		<< "  --sessions=N     concurrent sessions (default 4)" << std::endl
+		<< "  --sensor=mono|stereo|rgbd (default stereo)" << std::endl
+		<< "  --blocks=N       city blocks per side (default 2)" << std::endl
+		<< "  --frames=N       frames per session (default: the whole route)" << std::endl
+		<< "  --tolerance=X    largest pose difference accepted (default 0)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string vocabularyFile = argv[1];
+	const std::string directory = argv[2];
+	std::string value;
+	int nsessions = 4;
+	int nframes = 0;
+	double tolerance = 0;
+	SyntheticSequence::Parameters param;
+	param.blocks = 2;
+	param.laps = 1;
+
+	// The sessions render their frames concurrently
+	param.numThreads = 1;
+
+	for (int i = 3; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		bool valid = true;
+		if (ReadOption(arg, "--sessions=", value))
+			nsessions = std::max(std::stoi(value), 1);
+		else if (ReadOption(arg, "--sensor=", value))
+		{
+			if (value == "mono")
+				param.sensor = System::MONOCULAR;
+			else if (value == "stereo")
+				param.sensor = System::STEREO;
+			else if (value == "rgbd")
+				param.sensor = System::RGBD;
+			else
+				valid = false;
+		}
+		else if (ReadOption(arg, "--blocks=", value))
+			param.blocks = std::max(std::stoi(value), 1);
+		else if (ReadOption(arg, "--frames=", value))
+			nframes = std::stoi(value);
+		else if (ReadOption(arg, "--tolerance=", value))
+			tolerance = std::stod(value);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Invalid option: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	const SyntheticSequence sequence(param);
+	const std::string settingsFile = directory + "/settings.yaml";
+	if (!sequence.WriteSettings(settingsFile))
+		return 1;
+	if (nframes <= 0 || nframes > sequence.Size())
+		nframes = sequence.Size();
+
+	std::cout << "Loading vocabulary " << vocabularyFile << " ..." << std::endl;
+	const System::VocabularyPointer voc = System::LoadVocabulary(vocabularyFile);
+	if (!voc)
+	{
+		std::cerr << "Failed to open vocabulary at: " << vocabularyFile << std::endl;
+		return 1;
+	}
+
+	// Reference: one session alone
+	SessionResult reference;
+	const auto t0 = std::chrono::steady_clock::now();
+	RunSession(voc, settingsFile, sequence, nframes, reference);
+	const auto t1 = std::chrono::steady_clock::now();
+
+	// The same sequence in every session at once
+	std::vector<SessionResult> results(nsessions);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < nsessions; i++)
+		threads.emplace_back(RunSession, voc, settingsFile, std::cref(sequence), nframes, std::ref(results[i]));
+	for (std::thread& thread : threads)
+		thread.join();
+	const auto t2 = std::chrono::steady_clock::now();
+
+	const double referenceSec = std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+	const double concurrentSec = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+
+	std::cout << "-------" << std::endl << std::endl << std::fixed << std::setprecision(3);
+	std::cout << "reference: " << CountTracked(reference) << " / " << nframes << " frames tracked, "
+		<< referenceSec << " s, tracking " << reference.trackingSec << " s" << std::endl;
+
+	bool failed = false;
+	for (int i = 0; i < nsessions; i++)
+	{
+		const double diff = MaxDifference(reference, results[i]);
+		std::cout << "session " << i << ": " << CountTracked(results[i]) << " / " << nframes << " frames tracked, tracking "
+			<< results[i].trackingSec << " s, max pose difference " << std::scientific << diff << std::fixed << std::endl;
+		failed = failed || !(diff <= tolerance);
+	}
+
+	std::cout << nsessions << " sessions in " << concurrentSec << " s: " << nsessions * nframes / concurrentSec
+		<< " frames/s (one session: " << nframes / referenceSec << " frames/s)" << std::endl;
+
+	if (failed)
+	{
+		std::cerr << "FAILED: the concurrent sessions do not reproduce the reference session" << std::endl;
+		return 2;
+	}
+
+	std::cout << "OK" << std::endl;
+	return 0;
+}
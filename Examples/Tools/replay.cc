@@ -0,0 +1,126 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include <System.h>
+#include <Recording.h>
+
+using ORB_SLAM2::System;
+
+// Replays a recording (see Recorder.file in the settings files) in the deterministic mode of the system,
+// as fast as possible, and reports the slowest frames. Two replays of the same recording give the same result.
+// The trajectories and the frame times are saved in the working directory for Examples/Tools/evaluate_trajectory.
+int main(int argc, char** argv)
+{
+	if (argc < 4 || argc > 5)
+	{
+		std::cerr << std::endl << "Usage: ./replay path_to_vocabulary path_to_settings path_to_recording [number_of_slowest_frames]" << std::endl;
+		return 1;
+	}
+
+	// A recording started by the settings file would record the replay itself
+	cv::FileStorage settings(argv[2], cv::FileStorage::READ);
+	if (!settings.isOpened())
+	{
+		std::cerr << "Failed to open settings file at: " << argv[2] << std::endl;
+		return 1;
+	}
+	if (!settings["Recorder.file"].empty())
+	{
+		std::cerr << "Remove Recorder.file from the settings file to replay a recording" << std::endl;
+		return 1;
+	}
+
+	auto recording = ORB_SLAM2::RecordingReader::Open(argv[3]);
+	if (!recording)
+		return 1;
+
+	const int numSlowest = argc > 4 ? std::stoi(argv[4]) : 10;
+	const System::Sensor sensor = static_cast<System::Sensor>(recording->GetSensor());
+
+	auto SLAM = System::Create(argv[1], argv[2], sensor, false);
+	SLAM->SetReplayMode(true);
+
+	std::vector<double> timestamps;
+	std::vector<double> times;
+
+	ORB_SLAM2::DatasetFrame frame;
+	while (recording->Read(frame))
+	{
+		const auto t1 = std::chrono::steady_clock::now();
+
+		if (sensor == System::STEREO)
+			SLAM->TrackStereo(frame.image, frame.image2, frame.timestamp);
+		else if (sensor == System::RGBD)
+			SLAM->TrackRGBD(frame.image, frame.image2, frame.timestamp);
+		else
+			SLAM->TrackMonocular(frame.image, frame.timestamp);
+
+		// Includes the mapping work triggered by the frame
+		const auto t2 = std::chrono::steady_clock::now();
+
+		timestamps.push_back(frame.timestamp);
+		times.push_back(std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count());
+	}
+
+	SLAM->Shutdown();
+
+	const int nframes = static_cast<int>(times.size());
+	if (nframes == 0)
+	{
+		std::cerr << "The recording is empty" << std::endl;
+		return 1;
+	}
+
+	std::vector<int> order(nframes);
+	std::iota(std::begin(order), std::end(order), 0);
+	std::sort(std::begin(order), std::end(order), [&](int lhs, int rhs) { return times[lhs] > times[rhs]; });
+
+	std::cout << "-------" << std::endl << std::endl;
+	std::cout << "frames: " << nframes << std::endl;
+	std::cout << "median frame time: " << times[order[nframes / 2]] << std::endl;
+	std::cout << "mean frame time: " << std::accumulate(std::begin(times), std::end(times), 0.0) / nframes << std::endl;
+	std::cout << std::endl << "slowest frames (index, timestamp, time):" << std::endl;
+	for (int i = 0; i < std::min(numSlowest, nframes); i++)
+	{
+		const int idx = order[i];
+		std::cout << std::setw(6) << idx << " " << std::fixed << std::setprecision(6) << timestamps[idx]
+			<< " " << times[idx] << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	// Save camera trajectory
+	SLAM->SaveKeyFrameTrajectoryTUM("KeyFrameTrajectory.txt");
+	if (sensor != System::MONOCULAR)
+		SLAM->SaveTrajectoryTUM("CameraTrajectory.txt");
+	ORB_SLAM2::SaveFrameTimes("FrameTimes.txt", timestamps, times);
+
+	return 0;
+}
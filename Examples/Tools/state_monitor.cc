@@ -0,0 +1,113 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+
+#include <StateReader.h>
+
+using ORB_SLAM2::StateReader;
+namespace SharedState = ORB_SLAM2::SharedState;
+
+// Prints the camera position of each frame and the size of the map received from a running system
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::cerr << std::endl << "Usage: ./state_monitor shared_memory_name (Publisher.name in the settings file)" << std::endl;
+		return 1;
+	}
+
+	StateReader::Pointer reader;
+	while (!(reader = StateReader::Open(argv[1])))
+	{
+		std::cout << "Waiting for " << argv[1] << " ..." << std::endl;
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+	reader->SeekToEnd();
+
+	std::unordered_map<uint64_t, SharedState::KeyFrameRecord> keyframes;
+	std::unordered_map<uint64_t, SharedState::MapPointRecord> mappoints;
+	size_t tracked = 0;
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	StateReader::Message message;
+	for (;;)
+	{
+		if (!reader->Next(message))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		// Copy the payload before checking that it was not overwritten
+		if (message.type == SharedState::POSE)
+		{
+			const SharedState::PoseMessage pose = *message.Records<SharedState::PoseMessage>();
+			if (!reader->Valid(message))
+				continue;
+
+			std::cout << "frame " << message.frameId << " t " << message.timestamp << " state " << pose.trackingState;
+			if (pose.valid)
+			{
+				// Camera center: -R' * t
+				const float* T = pose.Tcw;
+				for (int i = 0; i < 3; i++)
+					std::cout << " " << -(T[i] * T[3] + T[4 + i] * T[7] + T[8 + i] * T[11]);
+			}
+			std::cout << " tracked " << tracked << " keyframes " << keyframes.size() << " mappoints " << mappoints.size()
+				<< " lost " << reader->GetLost() << std::endl;
+		}
+		else if (message.type == SharedState::KEYPOINTS)
+		{
+			tracked = message.part == 0 ? message.NumRecords<SharedState::KeyPointRecord>()
+				: tracked + message.NumRecords<SharedState::KeyPointRecord>();
+		}
+		else if (message.type == SharedState::KEYFRAMES)
+		{
+			for (size_t i = 0; i < message.NumRecords<SharedState::KeyFrameRecord>(); i++)
+			{
+				const SharedState::KeyFrameRecord record = message.Records<SharedState::KeyFrameRecord>()[i];
+				keyframes[record.id] = record;
+			}
+		}
+		else if (message.type == SharedState::MAPPOINTS)
+		{
+			for (size_t i = 0; i < message.NumRecords<SharedState::MapPointRecord>(); i++)
+			{
+				const SharedState::MapPointRecord record = message.Records<SharedState::MapPointRecord>()[i];
+				mappoints[record.id] = record;
+			}
+		}
+		else if (message.type == SharedState::RESET)
+		{
+			keyframes.clear();
+			mappoints.clear();
+			std::cout << "map reset" << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#include <StatePublisher.h>
+#include <StateReader.h>
+#include <Frame.h>
+#include <Tracking.h>
+
+using namespace ORB_SLAM2;
+
+// Stress check of the shared memory ring (StatePublisher / StateReader).
+// One writer publishes pose messages as fast as it can into a small ring while several readers consume them.
+// Every entry of a pose is derived from the frame id, so a message torn by a concurrent write is detected
+// if the reader accepts it (Valid returns true). Exits with status 2 if any torn message was accepted.
+
+// Values exactly representable as float
+static float PoseValue(uint64_t frameId, int i)
+{
+	return static_cast<float>((frameId * 13 + i) & 0xFFFFF);
+}
+
+static CameraPose MakePose(uint64_t frameId)
+{
+	CameraPose::Mat33 R;
+	CameraPose::Mat31 t;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			R(i, j) = PoseValue(frameId, 4 * i + j);
+		t(i) = PoseValue(frameId, 4 * i + 3);
+	}
+	return CameraPose(R, t);
+}
+
+struct ReaderStats
+{
+	uint64_t accepted;
+	uint64_t rejected;
+	uint64_t lost;
+	uint64_t torn;
+	uint64_t unordered;
+	ReaderStats() : accepted(0), rejected(0), lost(0), torn(0), unordered(0) {}
+};
+
+static void RunReader(const std::string& name, const std::atomic<bool>& done, ReaderStats& stats)
+{
+	StateReader::Pointer reader = StateReader::Open(name);
+	if (!reader)
+	{
+		std::cerr << "Failed to open " << name << std::endl;
+		return;
+	}
+
+	uint64_t lastIndex = 0;
+	bool first = true;
+	StateReader::Message message;
+	for (;;)
+	{
+		// Everything was published before done is set
+		const bool finished = done.load(std::memory_order_acquire);
+		if (!reader->Next(message))
+		{
+			if (finished)
+				break;
+			std::this_thread::yield();
+			continue;
+		}
+
+		if (!first && message.index <= lastIndex)
+			stats.unordered++;
+		first = false;
+		lastIndex = message.index;
+
+		if (message.type != SharedState::POSE)
+			continue;
+
+		// Copy the payload before checking that it was not overwritten
+		const SharedState::PoseMessage pose = *message.Records<SharedState::PoseMessage>();
+		const uint64_t frameId = message.frameId;
+		if (!reader->Valid(message))
+		{
+			stats.rejected++;
+			continue;
+		}
+
+		stats.accepted++;
+		bool consistent = pose.valid != 0;
+		for (int i = 0; i < 12; i++)
+			consistent = consistent && pose.Tcw[i] == PoseValue(frameId, i);
+		if (!consistent)
+			stats.torn++;
+	}
+
+	stats.lost = reader->GetLost();
+}
+
+static bool ReadOption(const std::string& arg, const std::string& name, std::string& value)
+{
+	if (arg.compare(0, name.size(), name) != 0)
+		return false;
+	value = arg.substr(name.size());
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string value;
+	uint64_t numFrames = 1000000;
+	int numReaders = 4;
+	StatePublisher::Parameters param;
+	param.name = "/orb_slam2_stress_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	param.numSlots = 8;
+	param.slotSize = 256;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (ReadOption(arg, "--frames=", value))
+			numFrames = std::stoull(value);
+		else if (ReadOption(arg, "--readers=", value))
+			numReaders = std::max(std::stoi(value), 1);
+		else if (ReadOption(arg, "--slots=", value))
+			param.numSlots = std::stoi(value);
+		else
+		{
+			std::cerr << "Usage: ./state_stress [--frames=N] [--readers=N] [--slots=N]" << std::endl;
+			return 1;
+		}
+	}
+
+	StatePublisher::Pointer publisher = StatePublisher::Create(param);
+	if (!publisher)
+		return 1;
+
+	std::atomic<bool> done(false);
+	std::vector<ReaderStats> stats(numReaders);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < numReaders; i++)
+		readers.emplace_back(RunReader, param.name, std::cref(done), std::ref(stats[i]));
+
+	// Pose and keypoint messages (the frame has no keypoints)
+	const auto start = std::chrono::steady_clock::now();
+	Frame frame;
+	for (uint64_t id = 0; id < numFrames; id++)
+	{
+		frame.id = id;
+		frame.timestamp = 0.01 * id;
+		frame.SetPose(MakePose(id));
+		publisher->PublishFrame(frame, Tracking::STATE_OK);
+	}
+	const double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+		std::chrono::steady_clock::now() - start).count();
+
+	done.store(true, std::memory_order_release);
+	for (std::thread& reader : readers)
+		reader.join();
+
+	std::cout << "published " << 2 * numFrames << " messages in " << elapsed << " s ("
+		<< 1e9 * elapsed / std::max<uint64_t>(2 * numFrames, 1) << " ns/message), " << param.numSlots << " slots" << std::endl;
+
+	uint64_t torn = 0, unordered = 0;
+	for (int i = 0; i < numReaders; i++)
+	{
+		std::cout << "reader " << i << ": accepted " << stats[i].accepted << ", rejected " << stats[i].rejected
+			<< ", lost " << stats[i].lost << ", torn " << stats[i].torn << ", out of order " << stats[i].unordered << std::endl;
+		torn += stats[i].torn;
+		unordered += stats[i].unordered;
+	}
+
+	if (torn > 0 || unordered > 0)
+	{
+		std::cerr << "FAILED: torn or out of order messages were accepted" << std::endl;
+		return 2;
+	}
+
+	std::cout << "OK" << std::endl;
+	return 0;
+}
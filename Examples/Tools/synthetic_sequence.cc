@@ -0,0 +1,197 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include <System.h>
+#include <Recording.h>
+#include <SyntheticSequence.h>
+
+using ORB_SLAM2::System;
+using ORB_SLAM2::SyntheticSequence;
+
+static bool ReadOption(const std::string& arg, const std::string& name, std::string& value)
+{
+	if (arg.compare(0, name.size(), name) != 0)
+		return false;
+	value = arg.substr(name.size());
+	return true;
+}
+
+static void PrintUsage()
+{
+	std::cerr << std::endl << "Usage: ./synthetic_sequence output_directory [options]" << std::endl
+		<< "  --sensor=mono|stereo|rgbd     (default stereo)" << std::endl
+		<< "  --route=loop|lawnmower|random (default loop)" << std::endl
+		<< "  --blocks=N                    city blocks per side (default 4)" << std::endl
+		<< "  --laps=N                      times the route is driven (default 2)" << std::endl
+		<< "  --speed=M                     meters per frame (default 0.1)" << std::endl
+		<< "  --fps=N                       (default 20)" << std::endl
+		<< "  --seed=N                      (default 0)" << std::endl
+		<< "  --vocabulary=path             run the system on the rendered frames instead of writing a recording" << std::endl;
+}
+
+// Generates a synthetic sequence in output_directory: settings.yaml, groundtruth.txt (TUM format) and
+// recording.orbrec (see Examples/Tools/replay). With --vocabulary, the frames are tracked as they are rendered
+// (in the deterministic mode of the system) and the estimated trajectories and frame times are saved next to
+// the ground truth, ready for Examples/Tools/evaluate_trajectory.
+// Large maps are obtained with many blocks (e.g. --route=lawnmower --blocks=40) and several laps.
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string directory = argv[1];
+	std::string vocabularyFile, value;
+	SyntheticSequence::Parameters param;
+
+	for (int i = 2; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		bool valid = true;
+		if (ReadOption(arg, "--sensor=", value))
+		{
+			if (value == "mono")
+				param.sensor = System::MONOCULAR;
+			else if (value == "stereo")
+				param.sensor = System::STEREO;
+			else if (value == "rgbd")
+				param.sensor = System::RGBD;
+			else
+				valid = false;
+		}
+		else if (ReadOption(arg, "--route=", value))
+		{
+			if (value == "loop")
+				param.route = SyntheticSequence::LOOP;
+			else if (value == "lawnmower")
+				param.route = SyntheticSequence::LAWNMOWER;
+			else if (value == "random")
+				param.route = SyntheticSequence::RANDOM;
+			else
+				valid = false;
+		}
+		else if (ReadOption(arg, "--blocks=", value))
+			param.blocks = std::stoi(value);
+		else if (ReadOption(arg, "--laps=", value))
+			param.laps = std::stoi(value);
+		else if (ReadOption(arg, "--speed=", value))
+			param.speed = std::stof(value);
+		else if (ReadOption(arg, "--fps=", value))
+			param.fps = std::stof(value);
+		else if (ReadOption(arg, "--seed=", value))
+			param.seed = static_cast<uint32_t>(std::stoul(value));
+		else if (ReadOption(arg, "--vocabulary=", value))
+			vocabularyFile = value;
+		else
+			valid = false;
+
+		if (!valid || param.speed <= 0 || param.fps <= 0)
+		{
+			std::cerr << "Invalid option: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	const SyntheticSequence sequence(param);
+	const std::string settingsFile = directory + "/settings.yaml";
+	if (!sequence.WriteSettings(settingsFile) || !sequence.WriteGroundTruth(directory + "/groundtruth.txt"))
+		return 1;
+
+	const int nframes = sequence.Size();
+	std::cout << "Route: " << std::fixed << std::setprecision(0) << sequence.GetLength() << " m, "
+		<< nframes << " frames" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+
+	const System::Sensor sensor = static_cast<System::Sensor>(param.sensor);
+	ORB_SLAM2::DatasetFrame frame;
+
+	if (vocabularyFile.empty())
+	{
+		auto recorder = ORB_SLAM2::Recorder::Create(directory + "/recording.orbrec", sensor);
+		if (!recorder)
+			return 1;
+
+		for (int i = 0; i < nframes; i++)
+		{
+			sequence.Render(i, frame);
+			recorder->Write(frame.image, frame.image2, frame.timestamp);
+			if ((i + 1) % 1000 == 0)
+				std::cout << "frame " << i + 1 << " / " << nframes << std::endl;
+		}
+		return 0;
+	}
+
+	auto SLAM = System::Create(vocabularyFile, settingsFile, sensor, false);
+	SLAM->SetReplayMode(true);
+
+	std::vector<double> timestamps, times;
+	timestamps.reserve(nframes);
+	times.reserve(nframes);
+	for (int i = 0; i < nframes; i++)
+	{
+		sequence.Render(i, frame);
+
+		const auto t1 = std::chrono::steady_clock::now();
+
+		if (sensor == System::STEREO)
+			SLAM->TrackStereo(frame.image, frame.image2, frame.timestamp);
+		else if (sensor == System::RGBD)
+			SLAM->TrackRGBD(frame.image, frame.image2, frame.timestamp);
+		else
+			SLAM->TrackMonocular(frame.image, frame.timestamp);
+
+		const auto t2 = std::chrono::steady_clock::now();
+		timestamps.push_back(frame.timestamp);
+		times.push_back(std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count());
+
+		if ((i + 1) % 1000 == 0)
+			std::cout << "frame " << i + 1 << " / " << nframes << std::endl;
+	}
+
+	SLAM->Shutdown();
+
+	std::vector<double> sorted = times;
+	std::sort(std::begin(sorted), std::end(sorted));
+
+	std::cout << "-------" << std::endl << std::endl;
+	std::cout << "median tracking time: " << sorted[nframes / 2] << std::endl;
+	std::cout << "mean tracking time: " << std::accumulate(std::begin(times), std::end(times), 0.0) / nframes << std::endl;
+
+	SLAM->SaveKeyFrameTrajectoryTUM(directory + "/KeyFrameTrajectory.txt");
+	if (sensor != System::MONOCULAR)
+		SLAM->SaveTrajectoryTUM(directory + "/CameraTrajectory.txt");
+	ORB_SLAM2::SaveFrameTimes(directory + "/FrameTimes.txt", timestamps, times);
+
+	return 0;
+}
@@ -0,0 +1,327 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include <ORBVocabulary.h>
+#include <ORBextractor.h>
+
+using ORB_SLAM2::ORBVocabulary;
+using ORB_SLAM2::ORBextractor;
+
+// Descriptor dump: for each image, the number of descriptors (int32)
+// followed by the descriptors (32 bytes each)
+using DescriptorDump = std::vector<cv::Mat>;
+
+static const int DESCRIPTOR_BYTES = 32;
+
+static bool EndsWith(const std::string& str, const std::string& suffix)
+{
+	return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool LoadVocabulary(ORBVocabulary& voc, const std::string& filename)
+{
+	return EndsWith(filename, ".bin") ? voc.loadFromBinaryFile(filename) : voc.loadFromTextFile(filename);
+}
+
+static void LoadVocabularyOrExit(ORBVocabulary& voc, const std::string& filename)
+{
+	std::cout << "Loading vocabulary " << filename << " ..." << std::endl;
+	if (!LoadVocabulary(voc, filename))
+	{
+		std::cerr << "Failed to open vocabulary at: " << filename << std::endl;
+		std::exit(-1);
+	}
+}
+
+static int LoadImages(const std::string& filename, std::vector<std::string>& images)
+{
+	std::ifstream ifs(filename);
+	CV_Assert(!ifs.fail());
+
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		if (!line.empty() && line[0] != '#')
+			images.push_back(line);
+	}
+	return static_cast<int>(images.size());
+}
+
+static void SaveDescriptors(const std::string& filename, const DescriptorDump& dump)
+{
+	std::ofstream ofs(filename, std::ios::binary);
+	CV_Assert(!ofs.fail());
+
+	for (const cv::Mat& descriptors : dump)
+	{
+		const int32_t rows = descriptors.rows;
+		ofs.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+		for (int i = 0; i < rows; i++)
+			ofs.write(reinterpret_cast<const char*>(descriptors.ptr(i)), DESCRIPTOR_BYTES);
+	}
+}
+
+static int LoadDescriptors(const std::string& filename, DescriptorDump& dump)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	CV_Assert(!ifs.fail());
+
+	int32_t rows;
+	while (ifs.read(reinterpret_cast<char*>(&rows), sizeof(rows)))
+	{
+		cv::Mat descriptors(rows, DESCRIPTOR_BYTES, CV_8U);
+		ifs.read(reinterpret_cast<char*>(descriptors.data), rows * DESCRIPTOR_BYTES);
+		CV_Assert(!ifs.fail());
+		dump.push_back(descriptors);
+	}
+	return static_cast<int>(dump.size());
+}
+
+static void LoadDescriptorsOrExit(const std::string& filename, DescriptorDump& dump)
+{
+	const int nimages = LoadDescriptors(filename, dump);
+	const size_t nfeatures = std::accumulate(std::begin(dump), std::end(dump), size_t(0),
+		[](size_t sum, const cv::Mat& descriptors) { return sum + descriptors.rows; });
+
+	std::cout << "Loaded " << nfeatures << " descriptors of " << nimages << " images from " << filename << std::endl;
+	if (nimages == 0)
+		std::exit(-1);
+}
+
+// Splits the dump into one cv::Mat per descriptor, as expected by the vocabulary
+static std::vector<std::vector<cv::Mat>> ToFeatures(const DescriptorDump& dump)
+{
+	std::vector<std::vector<cv::Mat>> features(dump.size());
+	for (size_t i = 0; i < dump.size(); i++)
+	{
+		features[i].reserve(dump[i].rows);
+		for (int j = 0; j < dump[i].rows; j++)
+			features[i].push_back(dump[i].row(j));
+	}
+	return features;
+}
+
+static void PrintVocabulary(const ORBVocabulary& voc)
+{
+	std::cout << "k: " << voc.getBranchingFactor() << ", L: " << voc.getDepthLevels()
+		<< ", words: " << voc.size() << ", memory: " << voc.getMemoryUsage() / (1 << 20) << " MB" << std::endl;
+}
+
+static int Extract(const std::string& settingsFile, const std::string& imageList, const std::string& output)
+{
+	cv::FileStorage settings(settingsFile, cv::FileStorage::READ);
+	if (!settings.isOpened())
+	{
+		std::cerr << "Failed to open settings file at: " << settingsFile << std::endl;
+		return 1;
+	}
+
+	ORBextractor::Parameters param;
+	param.nfeatures = settings["ORBextractor.nFeatures"];
+	param.scaleFactor = settings["ORBextractor.scaleFactor"];
+	param.nlevels = settings["ORBextractor.nLevels"];
+	param.iniThFAST = settings["ORBextractor.iniThFAST"];
+	param.minThFAST = settings["ORBextractor.minThFAST"];
+	ORBextractor extractor(param);
+
+	std::vector<std::string> images;
+	const int nimages = LoadImages(imageList, images);
+
+	DescriptorDump dump(nimages);
+	for (int i = 0; i < nimages; i++)
+	{
+		const cv::Mat image = cv::imread(images[i], cv::IMREAD_GRAYSCALE);
+		if (image.empty())
+		{
+			std::cerr << "Failed to load image at: " << images[i] << std::endl;
+			return 1;
+		}
+
+		ORB_SLAM2::KeyPoints keypoints;
+		extractor.Extract(image, keypoints, dump[i]);
+	}
+
+	SaveDescriptors(output, dump);
+	std::cout << "Extracted descriptors of " << nimages << " images" << std::endl;
+
+	return 0;
+}
+
+static int Train(const std::string& input, const std::string& output, int k, int L)
+{
+	DescriptorDump dump;
+	LoadDescriptorsOrExit(input, dump);
+
+	// same weighting and scoring as the stock vocabulary
+	ORBVocabulary voc;
+	const auto t1 = std::chrono::steady_clock::now();
+	voc.create(ToFeatures(dump), k, L, DBoW2::TF_IDF, DBoW2::L1_NORM);
+	const auto t2 = std::chrono::steady_clock::now();
+
+	std::cout << "Trained in " << std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count()
+		<< " s" << std::endl;
+	PrintVocabulary(voc);
+
+	voc.saveToBinaryFile(output);
+
+	return 0;
+}
+
+static int Prune(const std::string& vocabularyFile, const std::string& input, const std::string& output, int minCount)
+{
+	ORBVocabulary voc;
+	LoadVocabularyOrExit(voc, vocabularyFile);
+	PrintVocabulary(voc);
+
+	DescriptorDump dump;
+	LoadDescriptorsOrExit(input, dump);
+
+	const int removed = voc.prune(ToFeatures(dump), minCount);
+	std::cout << "Removed " << removed << " words" << std::endl;
+	PrintVocabulary(voc);
+
+	voc.saveToBinaryFile(output);
+
+	return 0;
+}
+
+static int Convert(const std::string& vocabularyFile, const std::string& output)
+{
+	ORBVocabulary voc;
+	LoadVocabularyOrExit(voc, vocabularyFile);
+	voc.saveToBinaryFile(output);
+
+	return 0;
+}
+
+struct VocabularyReport
+{
+	double loadTime;
+	double transformTime;
+	size_t memory;
+	double recall;
+};
+
+// Place recognition proxy for relocalization: odd images query a database made of the even images.
+// A query succeeds if its best scoring database image is at most maxGap images away
+static VocabularyReport Evaluate(const std::string& vocabularyFile, const DescriptorDump& dump, int maxGap)
+{
+	VocabularyReport report;
+	ORBVocabulary voc;
+
+	const auto t1 = std::chrono::steady_clock::now();
+	LoadVocabularyOrExit(voc, vocabularyFile);
+	const auto t2 = std::chrono::steady_clock::now();
+
+	report.loadTime = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+	report.memory = voc.getMemoryUsage();
+
+	const int nimages = static_cast<int>(dump.size());
+	std::vector<DBoW2::BowVector> bowVectors(nimages);
+	DBoW2::FeatureVector featureVector;
+
+	const auto t3 = std::chrono::steady_clock::now();
+	for (int i = 0; i < nimages; i++)
+		voc.transform(dump[i], bowVectors[i], featureVector, 4);
+	const auto t4 = std::chrono::steady_clock::now();
+
+	report.transformTime = 1e3 * std::chrono::duration_cast<std::chrono::duration<double>>(t4 - t3).count() / nimages;
+
+	int nqueries = 0, nhits = 0;
+	for (int q = 1; q < nimages; q += 2)
+	{
+		int bestId = -1;
+		double bestScore = 0;
+		for (int d = 0; d < nimages; d += 2)
+		{
+			const double score = voc.score(bowVectors[q], bowVectors[d]);
+			if (score > bestScore)
+			{
+				bestScore = score;
+				bestId = d;
+			}
+		}
+
+		nqueries++;
+		if (bestId >= 0 && std::abs(bestId - q) <= maxGap)
+			nhits++;
+	}
+
+	report.recall = nqueries > 0 ? 1. * nhits / nqueries : 0;
+
+	return report;
+}
+
+static int Report(const std::string& stockFile, const std::string& vocabularyFile, const std::string& input, int maxGap)
+{
+	DescriptorDump dump;
+	LoadDescriptorsOrExit(input, dump);
+
+	const VocabularyReport stock = Evaluate(stockFile, dump, maxGap);
+	const VocabularyReport reduced = Evaluate(vocabularyFile, dump, maxGap);
+
+	const auto printRow = [](const char* name, const VocabularyReport& report)
+	{
+		std::printf("%-8s %12.3f %16.3f %12.1f %10.3f\n", name, report.loadTime, report.transformTime,
+			report.memory / 1048576., report.recall);
+	};
+
+	std::cout << std::endl << "-------" << std::endl;
+	std::printf("%-8s %12s %16s %12s %10s\n", "", "load [s]", "transform [ms]", "memory [MB]", "recall@1");
+	printRow("stock", stock);
+	printRow("reduced", reduced);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const std::string command = argc > 1 ? argv[1] : "";
+
+	if (command == "extract" && argc == 5)
+		return Extract(argv[2], argv[3], argv[4]);
+
+	if (command == "train" && argc >= 4)
+		return Train(argv[2], argv[3], argc > 4 ? std::stoi(argv[4]) : 10, argc > 5 ? std::stoi(argv[5]) : 6);
+
+	if (command == "prune" && argc >= 5)
+		return Prune(argv[2], argv[3], argv[4], argc > 5 ? std::stoi(argv[5]) : 1);
+
+	if (command == "convert" && argc == 4)
+		return Convert(argv[2], argv[3]);
+
+	if (command == "report" && argc >= 5)
+		return Report(argv[2], argv[3], argv[4], argc > 5 ? std::stoi(argv[5]) : 2);
+
+	std::cerr << "Usage: ./vocabulary_tool extract path_to_settings path_to_image_list output_descriptors" << std::endl;
+	std::cerr << "       ./vocabulary_tool train path_to_descriptors output_vocabulary [k] [L]" << std::endl;
+	std::cerr << "       ./vocabulary_tool prune path_to_vocabulary path_to_descriptors output_vocabulary [min_count]" << std::endl;
+	std::cerr << "       ./vocabulary_tool convert path_to_vocabulary output_vocabulary" << std::endl;
+	std::cerr << "       ./vocabulary_tool report path_to_stock_vocabulary path_to_vocabulary path_to_descriptors [max_gap]" << std::endl;
+	return 1;
+}
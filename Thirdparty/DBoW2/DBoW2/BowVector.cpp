@@ -31,17 +31,27 @@ BowVector::~BowVector(void)
 
 // --------------------------------------------------------------------------
 
+void BowVector::clear()
+{
+  m_ids.clear();
+  m_values.clear();
+}
+
+// --------------------------------------------------------------------------
+
 void BowVector::addWeight(WordId id, WordValue v)
 {
-  BowVector::iterator vit = this->lower_bound(id);
+  std::vector<WordId>::iterator vit = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+  const size_t i = vit - m_ids.begin();
   
-  if(vit != this->end() && !(this->key_comp()(id, vit->first)))
+  if(vit != m_ids.end() && *vit == id)
   {
-    vit->second += v;
+    m_values[i] += v;
   }
   else
   {
-    this->insert(vit, BowVector::value_type(id, v));
+    m_ids.insert(vit, id);
+    m_values.insert(m_values.begin() + i, v);
   }
 }
 
@@ -49,51 +59,96 @@ void BowVector::addWeight(WordId id, WordValue v)
 
 void BowVector::addIfNotExist(WordId id, WordValue v)
 {
-  BowVector::iterator vit = this->lower_bound(id);
+  std::vector<WordId>::iterator vit = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+  const size_t i = vit - m_ids.begin();
   
-  if(vit == this->end() || (this->key_comp()(id, vit->first)))
+  if(vit == m_ids.end() || *vit != id)
   {
-    this->insert(vit, BowVector::value_type(id, v));
+    m_ids.insert(vit, id);
+    m_values.insert(m_values.begin() + i, v);
   }
 }
 
 // --------------------------------------------------------------------------
 
+static bool lessWordId(const BowVector::Entry &a, const BowVector::Entry &b)
+{
+  return a.first < b.first;
+}
+
+void BowVector::assign(std::vector<Entry> &words, bool accumulate)
+{
+  // stable: repeated words are accumulated in the given order
+  std::stable_sort(words.begin(), words.end(), lessWordId);
+
+  clear();
+  m_ids.reserve(words.size());
+  m_values.reserve(words.size());
+
+  std::vector<Entry>::const_iterator wit;
+  for(wit = words.begin(); wit != words.end(); ++wit)
+  {
+    if(!m_ids.empty() && m_ids.back() == wit->first)
+    {
+      if(accumulate) m_values.back() += wit->second;
+    }
+    else
+    {
+      m_ids.push_back(wit->first);
+      m_values.push_back(wit->second);
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void BowVector::divide(WordValue d)
+{
+  for(size_t i = 0; i < m_values.size(); ++i)
+    m_values[i] /= d;
+}
+
+// --------------------------------------------------------------------------
+
 void BowVector::normalize(LNorm norm_type)
 {
   double norm = 0.0; 
-  BowVector::iterator it;
+  std::vector<WordValue>::iterator it;
 
   if(norm_type == DBoW2::L1)
   {
-    for(it = begin(); it != end(); ++it)
-      norm += fabs(it->second);
+    for(it = m_values.begin(); it != m_values.end(); ++it)
+      norm += fabs(*it);
   }
   else
   {
-    for(it = begin(); it != end(); ++it)
-      norm += it->second * it->second;
+    for(it = m_values.begin(); it != m_values.end(); ++it)
+      norm += *it * *it;
 		norm = sqrt(norm);  
   }
 
   if(norm > 0.0)
   {
-    for(it = begin(); it != end(); ++it)
-      it->second /= norm;
+    for(it = m_values.begin(); it != m_values.end(); ++it)
+      *it /= norm;
   }
 }
 
 // --------------------------------------------------------------------------
 
+bool BowVector::operator==(const BowVector &v) const
+{
+  return m_ids == v.m_ids && m_values == v.m_values;
+}
+
+// --------------------------------------------------------------------------
+
 std::ostream& operator<< (std::ostream &out, const BowVector &v)
 {
-  BowVector::const_iterator vit;
-  std::vector<unsigned int>::const_iterator iit;
-  unsigned int i = 0; 
   const unsigned int N = v.size();
-  for(vit = v.begin(); vit != v.end(); ++vit, ++i)
+  for(unsigned int i = 0; i < N; ++i)
   {
-    out << "<" << vit->first << ", " << vit->second << ">";
+    out << "<" << v.id(i) << ", " << v.value(i) << ">";
     
     if(i < N-1) out << ", ";
   }
@@ -107,16 +162,15 @@ void BowVector::saveM(const std::string &filename, size_t W) const
   std::fstream f(filename.c_str(), std::ios::out);
   
   WordId last = 0;
-  BowVector::const_iterator bit;
-  for(bit = this->begin(); bit != this->end(); ++bit)
+  for(size_t i = 0; i < m_ids.size(); ++i)
   {
-    for(; last < bit->first; ++last)
+    for(; last < m_ids[i]; ++last)
     {
       f << "0 ";
     }
-    f << bit->second << " ";
+    f << m_values[i] << " ";
     
-    last = bit->first + 1;
+    last = m_ids[i] + 1;
   }
   for(; last < (WordId)W; ++last)
     f << "0 ";
@@ -11,8 +11,8 @@
 #define __D_T_BOW_VECTOR__
 
 #include <iostream>
-#include <map>
 #include <vector>
+#include <utility>
 
 namespace DBoW2 {
 
@@ -52,12 +52,15 @@ enum ScoringType
   DOT_PRODUCT,
 };
 
-/// Vector of words to represent images
-class BowVector: 
-	public std::map<WordId, WordValue>
+/// Vector of words to represent images.
+/// Word ids and values are stored in two flat arrays sorted by word id
+class BowVector
 {
 public:
 
+	/// Word id and value
+	typedef std::pair<WordId, WordValue> Entry;
+
 	/** 
 	 * Constructor
 	 */
@@ -67,7 +70,60 @@ public:
 	 * Destructor
 	 */
 	~BowVector(void);
-	
+
+	/**
+	 * Returns the number of words in the vector
+	 * @return number of words
+	 */
+	inline size_t size() const { return m_ids.size(); }
+
+	/**
+	 * Returns whether the vector has no words
+	 * @return true iff the vector is empty
+	 */
+	inline bool empty() const { return m_ids.empty(); }
+
+	/**
+	 * Removes all the words
+	 */
+	void clear();
+
+	/**
+	 * Returns the word ids, sorted in increasing order
+	 * @return word ids
+	 */
+	inline const std::vector<WordId>& ids() const { return m_ids; }
+
+	/**
+	 * Returns the word values, in the same order as the word ids
+	 * @return word values
+	 */
+	inline const std::vector<WordValue>& values() const { return m_values; }
+
+	/**
+	 * Returns the id of the i-th word
+	 * @param i index of the word in the vector
+	 * @return word id
+	 */
+	inline WordId id(size_t i) const { return m_ids[i]; }
+
+	/**
+	 * Returns the value of the i-th word
+	 * @param i index of the word in the vector
+	 * @return word value
+	 */
+	inline WordValue value(size_t i) const { return m_values[i]; }
+
+	/**
+	 * Returns the heap memory used by the vector in bytes
+	 * @return number of bytes
+	 */
+	inline size_t getMemoryUsage() const
+	{
+		return m_ids.capacity() * sizeof(WordId) +
+			m_values.capacity() * sizeof(WordValue);
+	}
+
 	/**
 	 * Adds a value to a word value existing in the vector, or creates a new
 	 * word with the given value
@@ -75,7 +131,7 @@ public:
 	 * @param v value to create the word with, or to add to existing word
 	 */
 	void addWeight(WordId id, WordValue v);
-	
+
 	/**
 	 * Adds a word with a value to the vector only if this does not exist yet
 	 * @param id word id to look for
@@ -83,11 +139,34 @@ public:
 	 */
 	void addIfNotExist(WordId id, WordValue v);
 
+	/**
+	 * Replaces the content of the vector with the given words at once.
+	 * This is the cheap way to build a vector from unsorted words
+	 * @param words words in any order, possibly repeated. They are sorted
+	 *   in place
+	 * @param accumulate if true, the values of a repeated word are added up
+	 *   in the given order (as addWeight); otherwise only the first value is
+	 *   kept (as addIfNotExist)
+	 */
+	void assign(std::vector<Entry> &words, bool accumulate);
+
+	/**
+	 * Divides all the values by the given number
+	 * @param d
+	 */
+	void divide(WordValue d);
+
 	/**
 	 * L1-Normalizes the values in the vector 
 	 * @param norm_type norm used
 	 */
 	void normalize(LNorm norm_type);
+
+	/**
+	 * Returns whether two vectors have the same words and values
+	 * @param v
+	 */
+	bool operator==(const BowVector &v) const;
 	
 	/**
 	 * Prints the content of the bow vector
@@ -102,6 +181,14 @@ public:
 	 * @param W number of words in the vocabulary
 	 */
 	void saveM(const std::string &filename, size_t W) const;
+
+private:
+
+	/// Word ids, sorted
+	std::vector<WordId> m_ids;
+
+	/// Word values
+	std::vector<WordValue> m_values;
 };
 
 } // namespace DBoW2
@@ -8,8 +8,8 @@
  */
 
 #include "FeatureVector.h"
-#include <map>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 
 namespace DBoW2 {
@@ -28,20 +28,73 @@ FeatureVector::~FeatureVector(void)
 
 // ---------------------------------------------------------------------------
 
+void FeatureVector::clear()
+{
+  m_nodes.clear();
+  m_offsets.clear();
+  m_features.clear();
+}
+
+// ---------------------------------------------------------------------------
+
 void FeatureVector::addFeature(NodeId id, unsigned int i_feature)
 {
-  FeatureVector::iterator vit = this->lower_bound(id);
-  
-  if(vit != this->end() && vit->first == id)
+  if(m_offsets.empty()) m_offsets.push_back(0);
+
+  std::vector<NodeId>::iterator vit = std::lower_bound(m_nodes.begin(), m_nodes.end(), id);
+  const size_t i = vit - m_nodes.begin();
+
+  if(vit == m_nodes.end() || *vit != id)
   {
-    vit->second.push_back(i_feature);
+    // new node with no features yet
+    m_nodes.insert(vit, id);
+    m_offsets.insert(m_offsets.begin() + i + 1, m_offsets[i]);
   }
-  else
+
+  // append the feature to the node and shift the following ones
+  m_features.insert(m_features.begin() + m_offsets[i+1], i_feature);
+  for(size_t j = i + 1; j < m_offsets.size(); ++j)
+    ++m_offsets[j];
+}
+
+// ---------------------------------------------------------------------------
+
+static bool lessNodeId(const FeatureVector::Entry &a, const FeatureVector::Entry &b)
+{
+  return a.first < b.first;
+}
+
+void FeatureVector::assign(std::vector<Entry> &features)
+{
+  // stable: the features of a node keep the given order
+  std::stable_sort(features.begin(), features.end(), lessNodeId);
+
+  clear();
+  if(features.empty()) return;
+
+  m_features.reserve(features.size());
+  m_offsets.push_back(0);
+
+  std::vector<Entry>::const_iterator fit;
+  for(fit = features.begin(); fit != features.end(); ++fit)
   {
-    vit = this->insert(vit, FeatureVector::value_type(id, 
-      std::vector<unsigned int>() ));
-    vit->second.push_back(i_feature);
+    if(m_nodes.empty() || m_nodes.back() != fit->first)
+    {
+      if(!m_nodes.empty()) m_offsets.push_back(m_features.size());
+      m_nodes.push_back(fit->first);
+    }
+    m_features.push_back(fit->second);
   }
+
+  m_offsets.push_back(m_features.size());
+}
+
+// ---------------------------------------------------------------------------
+
+bool FeatureVector::operator==(const FeatureVector &v) const
+{
+  return m_nodes == v.m_nodes && m_offsets == v.m_offsets &&
+    m_features == v.m_features;
 }
 
 // ---------------------------------------------------------------------------
@@ -49,32 +102,20 @@ void FeatureVector::addFeature(NodeId id, unsigned int i_feature)
 std::ostream& operator<<(std::ostream &out, 
   const FeatureVector &v)
 {
-  if(!v.empty())
+  for(size_t i = 0; i < v.size(); ++i)
   {
-    FeatureVector::const_iterator vit = v.begin();
-    
-    const std::vector<unsigned int>* f = &vit->second;
+    const FeatureVector::Features f = v.features(i);
 
-    out << "<" << vit->first << ": [";
-    if(!f->empty()) out << (*f)[0];
-    for(unsigned int i = 1; i < f->size(); ++i)
-    {
-      out << ", " << (*f)[i];
-    }
-    out << "]>";
+    if(i > 0) out << ", ";
+    out << "<" << v.nodeId(i) << ": [";
     
-    for(++vit; vit != v.end(); ++vit)
+    if(!f.empty()) out << f[0];
+    for(unsigned int j = 1; j < f.size(); ++j)
     {
-      f = &vit->second;
-      
-      out << ", <" << vit->first << ": [";
-      if(!f->empty()) out << (*f)[0];
-      for(unsigned int i = 1; i < f->size(); ++i)
-      {
-        out << ", " << (*f)[i];
-      }
-      out << "]>";
+      out << ", " << f[j];
     }
+    
+    out << "]>";
   }
   
   return out;  
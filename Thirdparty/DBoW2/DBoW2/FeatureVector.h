@@ -11,18 +11,40 @@
 #define __D_T_FEATURE_VECTOR__
 
 #include "BowVector.h"
-#include <map>
 #include <vector>
+#include <utility>
 #include <iostream>
 
 namespace DBoW2 {
 
-/// Vector of nodes with indexes of local features
-class FeatureVector: 
-  public std::map<NodeId, std::vector<unsigned int> >
+/// Vector of nodes with indexes of local features.
+/// Node ids are stored sorted in a flat array, and the feature indexes of
+/// all the nodes in a single array in compressed sparse row layout
+class FeatureVector
 {
 public:
 
+  /// Node id and feature index
+  typedef std::pair<NodeId, unsigned int> Entry;
+
+  /// Feature indexes of a node
+  class Features
+  {
+  public:
+    Features(const unsigned int *first, const unsigned int *last)
+      : m_first(first), m_last(last) {}
+
+    inline const unsigned int* begin() const { return m_first; }
+    inline const unsigned int* end() const { return m_last; }
+    inline size_t size() const { return m_last - m_first; }
+    inline bool empty() const { return m_first == m_last; }
+    inline unsigned int operator[](size_t i) const { return m_first[i]; }
+
+  private:
+    const unsigned int *m_first;
+    const unsigned int *m_last;
+  };
+
   /**
    * Constructor
    */
@@ -32,6 +54,57 @@ public:
    * Destructor
    */
   ~FeatureVector(void);
+
+  /**
+   * Returns the number of nodes in the vector
+   * @return number of nodes
+   */
+  inline size_t size() const { return m_nodes.size(); }
+
+  /**
+   * Returns whether the vector has no nodes
+   * @return true iff the vector is empty
+   */
+  inline bool empty() const { return m_nodes.empty(); }
+
+  /**
+   * Removes all the nodes
+   */
+  void clear();
+
+  /**
+   * Returns the node ids, sorted in increasing order
+   * @return node ids
+   */
+  inline const std::vector<NodeId>& nodes() const { return m_nodes; }
+
+  /**
+   * Returns the id of the i-th node
+   * @param i index of the node in the vector
+   * @return node id
+   */
+  inline NodeId nodeId(size_t i) const { return m_nodes[i]; }
+
+  /**
+   * Returns the feature indexes of the i-th node
+   * @param i index of the node in the vector
+   * @return feature indexes
+   */
+  inline Features features(size_t i) const
+  {
+    return Features(m_features.data() + m_offsets[i],
+      m_features.data() + m_offsets[i+1]);
+  }
+
+  /**
+   * Returns the heap memory used by the vector in bytes
+   * @return number of bytes
+   */
+  inline size_t getMemoryUsage() const
+  {
+    return m_nodes.capacity() * sizeof(NodeId) +
+      (m_offsets.capacity() + m_features.capacity()) * sizeof(unsigned int);
+  }
   
   /**
    * Adds a feature to an existing node, or adds a new node with an initial
@@ -41,13 +114,37 @@ public:
    */
   void addFeature(NodeId id, unsigned int i_feature);
 
+  /**
+   * Replaces the content of the vector with the given features at once.
+   * This is the cheap way to build a vector from unsorted nodes
+   * @param features node and feature index pairs in any order. They are
+   *   sorted in place; the features of a node keep the given order
+   */
+  void assign(std::vector<Entry> &features);
+
+  /**
+   * Returns whether two vectors have the same nodes and features
+   * @param v
+   */
+  bool operator==(const FeatureVector &v) const;
+
   /**
    * Sends a string versions of the feature vector through the stream
    * @param out stream
    * @param v feature vector
    */
   friend std::ostream& operator<<(std::ostream &out, const FeatureVector &v);
-    
+
+private:
+
+  /// Node ids, sorted
+  std::vector<NodeId> m_nodes;
+
+  /// Features of the i-th node are m_features[m_offsets[i]..m_offsets[i+1])
+  std::vector<unsigned int> m_offsets;
+
+  /// Feature indexes of all the nodes
+  std::vector<unsigned int> m_features;
 };
 
 } // namespace DBoW2
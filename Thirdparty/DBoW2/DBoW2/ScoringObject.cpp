@@ -20,43 +20,55 @@ const double GeneralScoring::LOG_EPS = log(DBL_EPSILON); // FLT_EPSILON
 // ---------------------------------------------------------------------------
 // ---------------------------------------------------------------------------
 
-double L1Scoring::score(const BowVector &v1, const BowVector &v2) const
+/**
+ * Merges the sorted word ids of two vectors and sums op(v_i, w_i) over the
+ * words present in both
+ */
+template<class Op>
+static inline double sumCommonWords(const BowVector &v1, const BowVector &v2,
+  Op op)
 {
-  BowVector::const_iterator v1_it, v2_it;
-  const BowVector::const_iterator v1_end = v1.end();
-  const BowVector::const_iterator v2_end = v2.end();
-  
-  v1_it = v1.begin();
-  v2_it = v2.begin();
-  
+  const WordId *id1 = v1.ids().data();
+  const WordId *id2 = v2.ids().data();
+  const WordValue *val1 = v1.values().data();
+  const WordValue *val2 = v2.values().data();
+  const size_t n1 = v1.size();
+  const size_t n2 = v2.size();
+
   double score = 0;
-  
-  while(v1_it != v1_end && v2_it != v2_end)
+  size_t i = 0, j = 0;
+
+  while(i < n1 && j < n2)
   {
-    const WordValue& vi = v1_it->second;
-    const WordValue& wi = v2_it->second;
-    
-    if(v1_it->first == v2_it->first)
-    {
-      score += fabs(vi - wi) - fabs(vi) - fabs(wi);
-      
-      // move v1 and v2 forward
-      ++v1_it;
-      ++v2_it;
-    }
-    else if(v1_it->first < v2_it->first)
+    const WordId a = id1[i];
+    const WordId b = id2[j];
+
+    if(a == b)
     {
-      // move v1 forward
-      v1_it = v1.lower_bound(v2_it->first);
-      // v1_it = (first element >= v2_it.id)
+      score += op(val1[i], val2[j]);
+      ++i;
+      ++j;
     }
     else
     {
-      // move v2 forward
-      v2_it = v2.lower_bound(v1_it->first);
-      // v2_it = (first element >= v1_it.id)
+      // move forward the vector with the lower id, without branching
+      i += (a < b);
+      j += (b < a);
     }
   }
+
+  return score;
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double L1Scoring::score(const BowVector &v1, const BowVector &v2) const
+{
+  double score = sumCommonWords(v1, v2, [](WordValue vi, WordValue wi)
+  {
+    return fabs(vi - wi) - fabs(vi) - fabs(wi);
+  });
   
   // ||v - w||_{L1} = 2 + Sum(|v_i - w_i| - |v_i| - |w_i|) 
   //		for all i | v_i != 0 and w_i != 0 
@@ -72,41 +84,10 @@ double L1Scoring::score(const BowVector &v1, const BowVector &v2) const
 
 double L2Scoring::score(const BowVector &v1, const BowVector &v2) const
 {
-  BowVector::const_iterator v1_it, v2_it;
-  const BowVector::const_iterator v1_end = v1.end();
-  const BowVector::const_iterator v2_end = v2.end();
-  
-  v1_it = v1.begin();
-  v2_it = v2.begin();
-  
-  double score = 0;
-  
-  while(v1_it != v1_end && v2_it != v2_end)
+  double score = sumCommonWords(v1, v2, [](WordValue vi, WordValue wi)
   {
-    const WordValue& vi = v1_it->second;
-    const WordValue& wi = v2_it->second;
-    
-    if(v1_it->first == v2_it->first)
-    {
-      score += vi * wi;
-      
-      // move v1 and v2 forward
-      ++v1_it;
-      ++v2_it;
-    }
-    else if(v1_it->first < v2_it->first)
-    {
-      // move v1 forward
-      v1_it = v1.lower_bound(v2_it->first);
-      // v1_it = (first element >= v2_it.id)
-    }
-    else
-    {
-      // move v2 forward
-      v2_it = v2.lower_bound(v1_it->first);
-      // v2_it = (first element >= v1_it.id)
-    }
-  }
+    return vi * wi;
+  });
   
   // ||v - w||_{L2} = sqrt( 2 - 2 * Sum(v_i * w_i) )
 	//		for all i | v_i != 0 and w_i != 0 )
@@ -125,43 +106,13 @@ double L2Scoring::score(const BowVector &v1, const BowVector &v2) const
 double ChiSquareScoring::score(const BowVector &v1, const BowVector &v2) 
   const
 {
-  BowVector::const_iterator v1_it, v2_it;
-  const BowVector::const_iterator v1_end = v1.end();
-  const BowVector::const_iterator v2_end = v2.end();
-  
-  v1_it = v1.begin();
-  v2_it = v2.begin();
-  
-  double score = 0;
-  
   // all the items are taken into account
-  
-  while(v1_it != v1_end && v2_it != v2_end)
+  // (v-w)^2/(v+w) - v - w = -4 vw/(v+w)
+  // we move the -4 out
+  double score = sumCommonWords(v1, v2, [](WordValue vi, WordValue wi)
   {
-    const WordValue& vi = v1_it->second;
-    const WordValue& wi = v2_it->second;
-    
-    if(v1_it->first == v2_it->first)
-    {
-      // (v-w)^2/(v+w) - v - w = -4 vw/(v+w)
-      // we move the -4 out
-      if(vi + wi != 0.0) score += vi * wi / (vi + wi);
-      
-      // move v1 and v2 forward
-      ++v1_it;
-      ++v2_it;
-    }
-    else if(v1_it->first < v2_it->first)
-    {
-      // move v1 forward
-      v1_it = v1.lower_bound(v2_it->first);
-    }
-    else
-    {
-      // move v2 forward
-      v2_it = v2.lower_bound(v1_it->first);
-    }
-  }
+    return vi + wi != 0.0 ? vi * wi / (vi + wi) : 0.0;
+  });
     
   // this takes the -4 into account
   score = 2. * score; // [0..1]
@@ -174,48 +125,48 @@ double ChiSquareScoring::score(const BowVector &v1, const BowVector &v2)
 
 double KLScoring::score(const BowVector &v1, const BowVector &v2) const
 { 
-  BowVector::const_iterator v1_it, v2_it;
-  const BowVector::const_iterator v1_end = v1.end();
-  const BowVector::const_iterator v2_end = v2.end();
-  
-  v1_it = v1.begin();
-  v2_it = v2.begin();
+  const WordId *id1 = v1.ids().data();
+  const WordId *id2 = v2.ids().data();
+  const WordValue *val1 = v1.values().data();
+  const WordValue *val2 = v2.values().data();
+  const size_t n1 = v1.size();
+  const size_t n2 = v2.size();
   
   double score = 0;
+  size_t i = 0, j = 0;
   
   // all the items or v are taken into account
   
-  while(v1_it != v1_end && v2_it != v2_end)
+  while(i < n1 && j < n2)
   {
-    const WordValue& vi = v1_it->second;
-    const WordValue& wi = v2_it->second;
+    const WordValue vi = val1[i];
+    const WordValue wi = val2[j];
     
-    if(v1_it->first == v2_it->first)
+    if(id1[i] == id2[j])
     {
       if(vi != 0 && wi != 0) score += vi * log(vi/wi);
       
       // move v1 and v2 forward
-      ++v1_it;
-      ++v2_it;
+      ++i;
+      ++j;
     }
-    else if(v1_it->first < v2_it->first)
+    else if(id1[i] < id2[j])
     {
       // move v1 forward
       score += vi * (log(vi) - LOG_EPS);
-      ++v1_it;
+      ++i;
     }
     else
     {
-      // move v2_it forward, do not add any score
-      v2_it = v2.lower_bound(v1_it->first);
-      // v2_it = (first element >= v1_it.id)
+      // move v2 forward, do not add any score
+      ++j;
     }
   }
   
   // sum rest of items of v
-  for(; v1_it != v1_end; ++v1_it) 
-    if(v1_it->second != 0)
-      score += v1_it->second * (log(v1_it->second) - LOG_EPS);
+  for(; i < n1; ++i) 
+    if(val1[i] != 0)
+      score += val1[i] * (log(val1[i]) - LOG_EPS);
   
   return score; // cannot be scaled
 }
@@ -226,41 +177,10 @@ double KLScoring::score(const BowVector &v1, const BowVector &v2) const
 double BhattacharyyaScoring::score(const BowVector &v1, 
   const BowVector &v2) const
 {
-  BowVector::const_iterator v1_it, v2_it;
-  const BowVector::const_iterator v1_end = v1.end();
-  const BowVector::const_iterator v2_end = v2.end();
-  
-  v1_it = v1.begin();
-  v2_it = v2.begin();
-  
-  double score = 0;
-  
-  while(v1_it != v1_end && v2_it != v2_end)
+  double score = sumCommonWords(v1, v2, [](WordValue vi, WordValue wi)
   {
-    const WordValue& vi = v1_it->second;
-    const WordValue& wi = v2_it->second;
-    
-    if(v1_it->first == v2_it->first)
-    {
-      score += sqrt(vi * wi);
-      
-      // move v1 and v2 forward
-      ++v1_it;
-      ++v2_it;
-    }
-    else if(v1_it->first < v2_it->first)
-    {
-      // move v1 forward
-      v1_it = v1.lower_bound(v2_it->first);
-      // v1_it = (first element >= v2_it.id)
-    }
-    else
-    {
-      // move v2 forward
-      v2_it = v2.lower_bound(v1_it->first);
-      // v2_it = (first element >= v1_it.id)
-    }
-  }
+    return sqrt(vi * wi);
+  });
 
   return score; // already scaled
 }
@@ -271,41 +191,10 @@ double BhattacharyyaScoring::score(const BowVector &v1,
 double DotProductScoring::score(const BowVector &v1, 
   const BowVector &v2) const
 {
-  BowVector::const_iterator v1_it, v2_it;
-  const BowVector::const_iterator v1_end = v1.end();
-  const BowVector::const_iterator v2_end = v2.end();
-  
-  v1_it = v1.begin();
-  v2_it = v2.begin();
-  
-  double score = 0;
-  
-  while(v1_it != v1_end && v2_it != v2_end)
+  double score = sumCommonWords(v1, v2, [](WordValue vi, WordValue wi)
   {
-    const WordValue& vi = v1_it->second;
-    const WordValue& wi = v2_it->second;
-    
-    if(v1_it->first == v2_it->first)
-    {
-      score += vi * wi;
-      
-      // move v1 and v2 forward
-      ++v1_it;
-      ++v2_it;
-    }
-    else if(v1_it->first < v2_it->first)
-    {
-      // move v1 forward
-      v1_it = v1.lower_bound(v2_it->first);
-      // v1_it = (first element >= v2_it.id)
-    }
-    else
-    {
-      // move v2 forward
-      v2_it = v2.lower_bound(v1_it->first);
-      // v2_it = (first element >= v1_it.id)
-    }
-  }
+    return vi * wi;
+  });
 
   return score; // cannot scale
 }
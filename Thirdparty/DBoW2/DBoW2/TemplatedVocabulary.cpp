@@ -1,5 +1,16 @@
 #include "TemplatedVocabulary.h"
 
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <thread>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace DBoW2 {
 
 template class TemplatedVocabulary<FORB::TDescriptor, FORB>;
@@ -21,9 +32,11 @@ struct GetInt
 template<>
 bool TemplatedVocabulary<FORB::TDescriptor, FORB>::loadFromTextFile(const std::string &filename)
 {
-	FILE* fp = fopen(filename.c_str(), "r");
-	if (!fp)
+	// closed on every return
+	std::unique_ptr<FILE, int(*)(FILE*)> file(fopen(filename.c_str(), "r"), fclose);
+	if (!file)
 		return false;
+	FILE* fp = file.get();
 
 	const int MAX_COUNT = 256;
 	char buffer[MAX_COUNT];
@@ -86,7 +99,355 @@ bool TemplatedVocabulary<FORB::TDescriptor, FORB>::loadFromTextFile(const std::s
 		}
 	}
 
+	file.reset();
+
+	buildFlatTree();
+
 	return true;
 }
 
+// Binary vocabulary file:
+//   header: magic, k, L, scoring, weighting (int32) and number of nodes
+//           without the root (uint32)
+//   nodes:  parent id (uint32), is leaf (uint8), descriptor (FORB::L bytes)
+//           and weight (double), in node id order starting at 1
+// Values are stored with the byte order of the machine that wrote the file
+static const char BINARY_MAGIC[8] = { 'D', 'B', 'o', 'W', '2', 'B', 'I', 'N' };
+static const size_t BINARY_NODE_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + FORB::L + sizeof(double);
+
+template<>
+bool TemplatedVocabulary<FORB::TDescriptor, FORB>::loadFromBinaryFile(const std::string &filename)
+{
+	std::ifstream ifs(filename.c_str(), std::ios::binary | std::ios::ate);
+	if (!ifs.is_open())
+		return false;
+
+	const size_t fileSize = static_cast<size_t>(ifs.tellg());
+	std::vector<char> buffer(fileSize);
+	ifs.seekg(0);
+	if (!ifs.read(buffer.data(), fileSize))
+		return false;
+
+	const size_t headerSize = sizeof(BINARY_MAGIC) + 4 * sizeof(int32_t) + sizeof(uint32_t);
+	if (fileSize < headerSize || memcmp(buffer.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+	{
+		std::cerr << "Vocabulary loading failure: This is not a correct binary file!" << endl;
+		return false;
+	}
+
+	const char* ptr = buffer.data() + sizeof(BINARY_MAGIC);
+	int32_t header[4];
+	uint32_t nnodes;
+	memcpy(header, ptr, sizeof(header)); ptr += sizeof(header);
+	memcpy(&nnodes, ptr, sizeof(nnodes)); ptr += sizeof(nnodes);
+
+	const int k = header[0], L = header[1], n1 = header[2], n2 = header[3];
+	if (k < 0 || k>20 || L < 1 || L>10 || n1 < 0 || n1>5 || n2 < 0 || n2>3 ||
+		fileSize != headerSize + nnodes * BINARY_NODE_SIZE)
+	{
+		std::cerr << "Vocabulary loading failure: This is not a correct binary file!" << endl;
+		return false;
+	}
+
+	m_k = k;
+	m_L = L;
+	m_scoring = (ScoringType)n1;
+	m_weighting = (WeightingType)n2;
+	createScoringObject();
+
+	m_nodes.clear();
+	m_words.clear();
+	m_nodes.resize(nnodes + 1);
+	m_nodes[0].id = 0;
+
+	for (uint32_t nid = 1; nid <= nnodes; nid++)
+	{
+		uint32_t pid;
+		uint8_t isLeaf;
+		double weight;
+		memcpy(&pid, ptr, sizeof(pid)); ptr += sizeof(pid);
+		memcpy(&isLeaf, ptr, sizeof(isLeaf)); ptr += sizeof(isLeaf);
+
+		if (pid >= nid)
+		{
+			std::cerr << "Vocabulary loading failure: Corrupted binary file!" << endl;
+			m_nodes.clear();
+			return false;
+		}
+
+		Node& node = m_nodes[nid];
+		node.id = nid;
+		node.descriptor.create(cv::Size(FORB::L, 1), CV_8U);
+		memcpy(node.descriptor.data, ptr, FORB::L); ptr += FORB::L;
+		memcpy(&weight, ptr, sizeof(weight)); ptr += sizeof(weight);
+
+		node.parent = pid;
+		node.weight = weight;
+		m_nodes[pid].children.push_back(nid);
+
+		if (!isLeaf)
+			node.children.reserve(m_k);
+	}
+
+	// leaves get their word ids in node order, as in loadFromTextFile
+	createWords();
+	buildFlatTree();
+
+	return true;
+}
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::saveToBinaryFile(const std::string &filename) const
+{
+	std::ofstream ofs(filename.c_str(), std::ios::binary);
+	if (!ofs.is_open())
+		throw std::string("Could not open file ") + filename;
+
+	const int32_t header[4] = { m_k, m_L, m_scoring, m_weighting };
+	const uint32_t nnodes = m_nodes.empty() ? 0 : static_cast<uint32_t>(m_nodes.size() - 1);
+	ofs.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(&nnodes), sizeof(nnodes));
+
+	std::vector<char> buffer(BINARY_NODE_SIZE);
+	for (size_t i = 1; i < m_nodes.size(); i++)
+	{
+		const Node& node = m_nodes[i];
+		const uint32_t pid = node.parent;
+		const uint8_t isLeaf = node.isLeaf() ? 1 : 0;
+		const double weight = node.weight;
+
+		char* ptr = buffer.data();
+		memcpy(ptr, &pid, sizeof(pid)); ptr += sizeof(pid);
+		memcpy(ptr, &isLeaf, sizeof(isLeaf)); ptr += sizeof(isLeaf);
+		memcpy(ptr, node.descriptor.data, FORB::L); ptr += FORB::L;
+		memcpy(ptr, &weight, sizeof(weight));
+
+		ofs.write(buffer.data(), buffer.size());
+	}
+}
+
+template<>
+size_t TemplatedVocabulary<FORB::TDescriptor, FORB>::getDescriptorMemory(const FORB::TDescriptor &descriptor) const
+{
+	// the matrix header is counted in sizeof(Node)
+	return descriptor.total() * descriptor.elemSize();
+}
+
+// ORB descriptors are 256 bits long
+static const int DESC_BYTES = 32;
+
+#ifdef __AVX2__
+
+// Hamming distance of two 256-bit descriptors.
+// Bits are counted per nibble with a lookup table and summed with a SAD
+static inline int HammingAVX2(__m256i a, const unsigned char* b)
+{
+	const __m256i lut = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+
+	const __m256i x = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+	const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+	const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+	const __m256i sad = _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+	const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sad), _mm256_extracti128_si256(sad, 1));
+	return static_cast<int>(_mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1));
+}
+
+#endif
+
+// Returns the index of the descriptor in block[0..n) closest to query.
+// Ties are resolved in favour of the lowest index, as in the node-by-node search
+static inline unsigned int NearestDescriptor(const unsigned char* query, const unsigned char* block,
+	unsigned int n)
+{
+	unsigned int best = 0;
+	int bestDist = std::numeric_limits<int>::max();
+
+#ifdef __AVX2__
+	const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query));
+	for (unsigned int i = 0; i < n; i++, block += DESC_BYTES)
+	{
+		const int dist = HammingAVX2(q, block);
+		if (dist < bestDist)
+		{
+			bestDist = dist;
+			best = i;
+		}
+	}
+#else
+	uint64_t q[4];
+	memcpy(q, query, DESC_BYTES);
+	for (unsigned int i = 0; i < n; i++, block += DESC_BYTES)
+	{
+		uint64_t b[4];
+		memcpy(b, block, DESC_BYTES);
+		const int dist =
+			__builtin_popcountll(q[0] ^ b[0]) + __builtin_popcountll(q[1] ^ b[1]) +
+			__builtin_popcountll(q[2] ^ b[2]) + __builtin_popcountll(q[3] ^ b[3]);
+		if (dist < bestDist)
+		{
+			bestDist = dist;
+			best = i;
+		}
+	}
+#endif
+
+	return best;
+}
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::buildFlatTree()
+{
+	m_flat_nodes.clear();
+	m_flat_descriptors.clear();
+
+	if (m_nodes.empty())
+		return;
+
+	CV_Assert(FORB::L == DESC_BYTES);
+
+	m_flat_nodes.reserve(m_nodes.size());
+	m_flat_descriptors.resize(m_nodes.size() * DESC_BYTES);
+
+	// breadth-first traversal: the flat index of a node is its position in the queue,
+	// so the children of a node are assigned consecutive flat indices
+	std::queue<NodeId> queue;
+	queue.push(0);
+
+	while (!queue.empty())
+	{
+		const Node& node = m_nodes[queue.front()];
+		queue.pop();
+
+		FlatNode flat;
+		flat.first_child = static_cast<unsigned int>(m_flat_nodes.size() + queue.size() + 1);
+		flat.n_children = static_cast<unsigned int>(node.children.size());
+		flat.node_id = node.id;
+
+		if (!node.descriptor.empty())
+			memcpy(&m_flat_descriptors[m_flat_nodes.size() * DESC_BYTES], node.descriptor.data, DESC_BYTES);
+
+		m_flat_nodes.push_back(flat);
+
+		for (NodeId child : node.children)
+			queue.push(child);
+	}
+}
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::transformFlat(const unsigned char *feature,
+	WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const
+{
+	// level at which the node must be stored in nid, if given
+	const int nid_level = m_L - levelsup;
+	if (nid_level <= 0 && nid != NULL) *nid = 0; // root
+
+	const unsigned char* descriptors = m_flat_descriptors.data();
+
+	// propagate the feature down the tree, one contiguous block of children per level
+	unsigned int final_id = 0; // root
+	int current_level = 0;
+
+	do
+	{
+		++current_level;
+		const FlatNode& node = m_flat_nodes[final_id];
+		final_id = node.first_child +
+			NearestDescriptor(feature, descriptors + node.first_child * DESC_BYTES, node.n_children);
+
+		if (nid != NULL && current_level == nid_level)
+			*nid = m_flat_nodes[final_id].node_id;
+
+	} while (m_flat_nodes[final_id].n_children > 0);
+
+	// turn node id into word id
+	const Node& leaf = m_nodes[m_flat_nodes[final_id].node_id];
+	word_id = leaf.word_id;
+	weight = leaf.weight;
+}
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::transform(const FORB::TDescriptor &feature,
+	WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const
+{
+	transformFlat(feature.ptr<unsigned char>(), word_id, weight, nid, levelsup);
+}
+
+// A thread is only worth starting for at least this many descriptors
+static const int MIN_FEATURES_PER_THREAD = 500;
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::transform(const cv::Mat &features,
+	BowVector &v, FeatureVector &fv, int levelsup, int nthreads) const
+{
+	v.clear();
+	fv.clear();
+
+	if (empty() || features.empty())
+		return;
+
+	CV_Assert(features.type() == CV_8U && features.cols == DESC_BYTES);
+
+	const int N = features.rows;
+	std::vector<WordId> wordIds(N);
+	std::vector<WordValue> weights(N);
+	std::vector<NodeId> nodeIds(N);
+
+	auto descend = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+			transformFlat(features.ptr<unsigned char>(i), wordIds[i], weights[i], &nodeIds[i], levelsup);
+	};
+
+	if (nthreads <= 0)
+		nthreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	nthreads = std::max(std::min(nthreads, N / MIN_FEATURES_PER_THREAD), 1);
+
+	if (nthreads == 1)
+	{
+		descend(0, N);
+	}
+	else
+	{
+		const int chunk = (N + nthreads - 1) / nthreads;
+		std::vector<std::thread> threads;
+		threads.reserve(nthreads - 1);
+		for (int begin = chunk; begin < N; begin += chunk)
+			threads.emplace_back(descend, begin, std::min(begin + chunk, N));
+		descend(0, std::min(chunk, N));
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// accumulate in feature order, so that the result does not depend on the threads
+	LNorm norm;
+	const bool must = m_scoring_object->mustNormalize(norm);
+	const bool accumulate = m_weighting == TF || m_weighting == TF_IDF;
+
+	std::vector<BowVector::Entry> words;
+	std::vector<FeatureVector::Entry> nodes;
+	words.reserve(N);
+	nodes.reserve(N);
+
+	for (int i = 0; i < N; i++)
+	{
+		if (weights[i] <= 0) // stopped
+			continue;
+
+		words.push_back(BowVector::Entry(wordIds[i], weights[i]));
+		nodes.push_back(FeatureVector::Entry(nodeIds[i], i));
+	}
+
+	v.assign(words, accumulate);
+	fv.assign(nodes);
+
+	if (accumulate && !v.empty() && !must)
+		v.divide(v.size()); // unnecessary when normalizing
+
+	if (must) v.normalize(norm);
+}
+
 } // namespace DBoW2
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <opencv2/core/core.hpp>
 #include <limits>
+#include <thread>
 
 #include "FeatureVector.h"
 #include "BowVector.h"
@@ -148,6 +149,21 @@ public:
   virtual void transform(const std::vector<TDescriptor>& features,
     BowVector &v, FeatureVector &fv, int levelsup) const;
 
+  /**
+   * Transform a block of descriptors (one per row) into a bow vector and a
+   * feature vector without splitting it into single descriptors.
+   * The tree descent may be shared among several threads; the result is the
+   * same regardless of the number of threads. Threads are started and joined
+   * on every call, which a single frame is not worth: one thread by default
+   * @param features descriptors, one per row
+   * @param v (out) bow vector
+   * @param fv (out) feature vector of nodes and feature indexes
+   * @param levelsup levels to go up the vocabulary tree to get the node index
+   * @param nthreads maximum number of threads (0: hardware concurrency)
+   */
+  void transform(const cv::Mat &features, BowVector &v, FeatureVector &fv,
+    int levelsup, int nthreads = 1) const;
+
   /**
    * Transforms a single feature into a word (without weight)
    * @param feature
@@ -291,6 +307,56 @@ public:
    */
   virtual int stopWords(double minWeight);
 
+  /**
+   * Loads the vocabulary from a binary file written by saveToBinaryFile.
+   * Only available for specialized descriptor classes
+   * @param filename
+   * @return true iff the file could be read
+   */
+  bool loadFromBinaryFile(const std::string &filename);
+
+  /**
+   * Saves the vocabulary into a binary file. The file holds the same data
+   * as the text file, but it is several times smaller and faster to load.
+   * Only available for specialized descriptor classes
+   * @param filename
+   */
+  void saveToBinaryFile(const std::string &filename) const;
+
+  /**
+   * Removes the words that are seen less than minCount times when
+   * transforming the given features, together with the nodes that are left
+   * without words below them. Features that used to fall into a removed word
+   * are quantized into the closest remaining sibling afterwards.
+   * Weights of the remaining words are kept.
+   * If no word reaches minCount, the vocabulary is not modified
+   * @param features features of the images the vocabulary will be used with
+   * @param minCount minimum number of features per word
+   * @return number of words removed
+   */
+  int prune(const std::vector<std::vector<TDescriptor> > &features, 
+    int minCount);
+
+  /**
+   * Returns an estimation of the memory used by the vocabulary in bytes,
+   * including the tree nodes, the descriptors and the flat tree
+   * @return number of bytes
+   */
+  size_t getMemoryUsage() const;
+
+  /**
+   * Sets the number of threads used to create, prune and weight the
+   * vocabulary. The result does not depend on the number of threads
+   * @param nthreads number of threads (0: hardware concurrency)
+   */
+  inline void setNumThreads(int nthreads) { m_nthreads = nthreads; }
+
+  /**
+   * Returns the number of threads used to create the vocabulary
+   * @return number of threads (0: hardware concurrency)
+   */
+  inline int getNumThreads() const { return m_nthreads; }
+
 protected:
 
   /// Pointer to descriptor
@@ -331,6 +397,19 @@ protected:
     inline bool isLeaf() const { return children.empty(); }
   };
 
+  /// Node of the flattened tree.
+  /// Flat nodes are stored in breadth-first order, so the children of a node
+  /// are contiguous, and so are their descriptors in m_flat_descriptors
+  struct FlatNode
+  {
+    /// Flat index of the first child
+    unsigned int first_child;
+    /// Number of children (0 if the node is a leaf)
+    unsigned int n_children;
+    /// Id of the node in m_nodes
+    NodeId node_id;
+  };
+
 protected:
 
   /**
@@ -364,6 +443,19 @@ protected:
    * @param id (out) word id
    */
   virtual void transform(const TDescriptor &feature, WordId &id) const;
+
+  /**
+   * Returns the word id associated to a feature given as raw bytes by
+   * descending the flat tree. Only available for specialized descriptor
+   * classes that build the flat tree
+   * @param feature pointer to the descriptor data
+   * @param id (out) word id
+   * @param weight (out) word weight
+   * @param nid (out) if given, id of the node "levelsup" levels up
+   * @param levelsup
+   */
+  void transformFlat(const unsigned char *feature, WordId &id,
+    WordValue &weight, NodeId *nid, int levelsup) const;
       
   /**
    * Creates a level in the tree, under the parent, by running kmeans with
@@ -404,6 +496,30 @@ protected:
    * @param features
    */
   void setNodeWeights(const vector<vector<TDescriptor> > &features);
+
+  /**
+   * Builds the flattened breadth-first copy of the tree used by transform.
+   * Must be called every time the structure of m_nodes changes.
+   * Only specialized descriptor classes build it; the generic version
+   * leaves it empty and transform walks m_nodes instead
+   */
+  void buildFlatTree();
+
+  /**
+   * Returns the heap memory owned by a descriptor, not counted by sizeof
+   * @param descriptor
+   * @return number of bytes
+   */
+  size_t getDescriptorMemory(const TDescriptor &descriptor) const;
+
+  /**
+   * Runs func(begin, end) on consecutive ranges of [0, n) with up to
+   * m_nthreads threads. Small ranges are run in the calling thread
+   * @param n number of items
+   * @param func function to call for each range
+   */
+  template<class Func>
+  void parallelFor(size_t n, const Func &func) const;
   
 protected:
 
@@ -428,6 +544,15 @@ protected:
   /// Words of the vocabulary (tree leaves)
   /// this condition holds: m_words[wid]->word_id == wid
   std::vector<Node*> m_words;
+
+  /// Flattened tree (breadth-first order, m_flat_nodes[0] is the root)
+  std::vector<FlatNode> m_flat_nodes;
+
+  /// Descriptors of the flat nodes, stored contiguously in the same order
+  std::vector<unsigned char> m_flat_descriptors;
+
+  /// Number of threads used to create the vocabulary (0: all)
+  int m_nthreads;
   
 };
 
@@ -437,7 +562,7 @@ template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
   (int k, int L, WeightingType weighting, ScoringType scoring)
   : m_k(k), m_L(L), m_weighting(weighting), m_scoring(scoring),
-  m_scoring_object(NULL)
+  m_scoring_object(NULL), m_nthreads(0)
 {
   createScoringObject();
 }
@@ -446,7 +571,7 @@ TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
 
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
-  (const std::string &filename): m_scoring_object(NULL)
+  (const std::string &filename): m_scoring_object(NULL), m_nthreads(0)
 {
   load(filename);
 }
@@ -455,7 +580,7 @@ TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
 
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
-  (const char *filename): m_scoring_object(NULL)
+  (const char *filename): m_scoring_object(NULL), m_nthreads(0)
 {
   load(filename);
 }
@@ -519,7 +644,7 @@ void TemplatedVocabulary<TDescriptor,F>::setWeightingType(WeightingType type)
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary(
   const TemplatedVocabulary<TDescriptor, F> &voc)
-  : m_scoring_object(NULL)
+  : m_scoring_object(NULL), m_nthreads(0)
 {
   *this = voc;
 }
@@ -543,6 +668,7 @@ TemplatedVocabulary<TDescriptor,F>::operator=
   this->m_L = voc.m_L;
   this->m_scoring = voc.m_scoring;
   this->m_weighting = voc.m_weighting;
+  this->m_nthreads = voc.m_nthreads;
 
   this->createScoringObject();
   
@@ -551,6 +677,7 @@ TemplatedVocabulary<TDescriptor,F>::operator=
   
   this->m_nodes = voc.m_nodes;
   this->createWords();
+  this->buildFlatTree();
   
   return *this;
 }
@@ -584,6 +711,9 @@ void TemplatedVocabulary<TDescriptor,F>::create(
   // create the words
   createWords();
 
+  // the flat tree is used by transform when setting the weights
+  buildFlatTree();
+
   // and set the weight of each node of the tree
   setNodeWeights(training_features);
   
@@ -694,63 +824,61 @@ void TemplatedVocabulary<TDescriptor,F>::HKmeansStep(NodeId parent_id,
       {
         // calculate cluster centres
 
-        for(unsigned int c = 0; c < clusters.size(); ++c)
+        parallelFor(clusters.size(), [&](size_t begin, size_t end)
         {
-          vector<pDescriptor> cluster_descriptors;
-          cluster_descriptors.reserve(groups[c].size());
-          
-          /*
-          for(unsigned int d = 0; d < descriptors.size(); ++d)
+          for(size_t c = begin; c < end; ++c)
           {
-            if( assoc.find<unsigned char>(c, d) )
+            // a cluster may lose all its features when there are repeated
+            // descriptors; it keeps its centre then
+            if(groups[c].empty()) continue;
+
+            vector<pDescriptor> cluster_descriptors;
+            cluster_descriptors.reserve(groups[c].size());
+
+            vector<unsigned int>::const_iterator vit;
+            for(vit = groups[c].begin(); vit != groups[c].end(); ++vit)
             {
-              cluster_descriptors.push_back(descriptors[d]);
+              cluster_descriptors.push_back(descriptors[*vit]);
             }
+
+            F::meanValue(cluster_descriptors, clusters[c]);
           }
-          */
-          
-          vector<unsigned int>::const_iterator vit;
-          for(vit = groups[c].begin(); vit != groups[c].end(); ++vit)
-          {
-            cluster_descriptors.push_back(descriptors[*vit]);
-          }
-          
-          
-          F::meanValue(cluster_descriptors, clusters[c]);
-        }
+        });
         
       } // if(!first_time)
 
       // 2. Associate features with clusters
 
       // calculate distances to cluster centers
-      groups.clear();
-      groups.resize(clusters.size(), vector<unsigned int>());
       current_association.resize(descriptors.size());
 
-      //assoc.clear();
-
-      typename vector<pDescriptor>::const_iterator fit;
-      //unsigned int d = 0;
-      for(fit = descriptors.begin(); fit != descriptors.end(); ++fit)//, ++d)
+      parallelFor(descriptors.size(), [&](size_t begin, size_t end)
       {
-        double best_dist = F::distance(*(*fit), clusters[0]);
-        unsigned int icluster = 0;
-        
-        for(unsigned int c = 1; c < clusters.size(); ++c)
+        for(size_t d = begin; d < end; ++d)
         {
-          double dist = F::distance(*(*fit), clusters[c]);
-          if(dist < best_dist)
+          double best_dist = F::distance(*descriptors[d], clusters[0]);
+          unsigned int icluster = 0;
+
+          for(unsigned int c = 1; c < clusters.size(); ++c)
           {
-            best_dist = dist;
-            icluster = c;
+            double dist = F::distance(*descriptors[d], clusters[c]);
+            if(dist < best_dist)
+            {
+              best_dist = dist;
+              icluster = c;
+            }
           }
-        }
 
-        //assoc.ref<unsigned char>(icluster, d) = 1;
+          current_association[d] = icluster;
+        }
+      });
 
-        groups[icluster].push_back(fit - descriptors.begin());
-        current_association[ fit - descriptors.begin() ] = icluster;
+      // group the features in their order, as done serially
+      groups.clear();
+      groups.resize(clusters.size(), vector<unsigned int>());
+      for(unsigned int d = 0; d < current_association.size(); ++d)
+      {
+        groups[current_association[d]].push_back(d);
       }
       
       // kmeans++ ensures all the clusters has any feature associated with them
@@ -861,26 +989,27 @@ void TemplatedVocabulary<TDescriptor,F>::initiateClustersKMpp(
   clusters.push_back(*pfeatures[ifeature]);
 
   // compute the initial distances
-  typename vector<pDescriptor>::const_iterator fit;
-  vector<double>::iterator dit;
-  dit = min_dists.begin();
-  for(fit = pfeatures.begin(); fit != pfeatures.end(); ++fit, ++dit)
+  parallelFor(pfeatures.size(), [&](size_t begin, size_t end)
   {
-    *dit = F::distance(*(*fit), clusters.back());
-  }  
+    for(size_t i = begin; i < end; ++i)
+      min_dists[i] = F::distance(*pfeatures[i], clusters.back());
+  });
 
+  vector<double>::iterator dit;
   while((int)clusters.size() < m_k)
   {
     // 2.
-    dit = min_dists.begin();
-    for(fit = pfeatures.begin(); fit != pfeatures.end(); ++fit, ++dit)
+    parallelFor(pfeatures.size(), [&](size_t begin, size_t end)
     {
-      if(*dit > 0)
+      for(size_t i = begin; i < end; ++i)
       {
-        double dist = F::distance(*(*fit), clusters.back());
-        if(dist < *dit) *dit = dist;
+        if(min_dists[i] > 0)
+        {
+          double dist = F::distance(*pfeatures[i], clusters.back());
+          if(dist < min_dists[i]) min_dists[i] = dist;
+        }
       }
-    }
+    });
     
     // 3.
     double dist_sum = std::accumulate(min_dists.begin(), min_dists.end(), 0.0);
@@ -942,6 +1071,15 @@ void TemplatedVocabulary<TDescriptor,F>::createWords()
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::buildFlatTree()
+{
+  m_flat_nodes.clear();
+  m_flat_descriptors.clear();
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::setNodeWeights
   (const vector<vector<TDescriptor> > &training_features)
@@ -962,27 +1100,37 @@ void TemplatedVocabulary<TDescriptor,F>::setNodeWeights
     // Note: this actually calculates the idf part of the tf-idf score.
     // The complete tf-idf score is calculated in ::transform
 
+    // quantize the features of every document in parallel
+    vector<vector<WordId> > doc_words(NDocs);
+    parallelFor(NDocs, [&](size_t begin, size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+      {
+        const vector<TDescriptor> &doc = training_features[i];
+        doc_words[i].resize(doc.size());
+        for(size_t j = 0; j < doc.size(); ++j)
+          transform(doc[j], doc_words[i][j]);
+      }
+    });
+
     vector<unsigned int> Ni(NWords, 0);
     vector<bool> counted(NWords, false);
     
-    typename vector<vector<TDescriptor> >::const_iterator mit;
-    typename vector<TDescriptor>::const_iterator fit;
-
-    for(mit = training_features.begin(); mit != training_features.end(); ++mit)
+    for(unsigned int i = 0; i < NDocs; ++i)
     {
-      fill(counted.begin(), counted.end(), false);
+      const vector<WordId> &words = doc_words[i];
 
-      for(fit = mit->begin(); fit < mit->end(); ++fit)
+      for(size_t j = 0; j < words.size(); ++j)
       {
-        WordId word_id;
-        transform(*fit, word_id);
-
-        if(!counted[word_id])
+        if(!counted[words[j]])
         {
-          Ni[word_id]++;
-          counted[word_id] = true;
+          Ni[words[j]]++;
+          counted[words[j]] = true;
         }
       }
+
+      for(size_t j = 0; j < words.size(); ++j)
+        counted[words[j]] = false;
     }
 
     // set ln(N/Ni)
@@ -1080,46 +1228,32 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
   LNorm norm;
   bool must = m_scoring_object->mustNormalize(norm);
 
-	typename vector<TDescriptor>::const_iterator fit;
+  // w is the idf value if TF_IDF, 1 if TF
+  // w is idf if IDF, or 1 if BINARY
+  const bool accumulate = m_weighting == TF || m_weighting == TF_IDF;
+
+  std::vector<BowVector::Entry> words;
+  words.reserve(features.size());
 
-  if(m_weighting == TF || m_weighting == TF_IDF)
+	typename vector<TDescriptor>::const_iterator fit;
+  for(fit = features.begin(); fit < features.end(); ++fit)
   {
-    for(fit = features.begin(); fit < features.end(); ++fit)
-    {
-      WordId id;
-      WordValue w; 
-      // w is the idf value if TF_IDF, 1 if TF
-      
-      transform(*fit, id, w);
-      
-      // not stopped
-      if(w > 0) v.addWeight(id, w);
-    }
+    WordId id;
+    WordValue w; 
     
-    if(!v.empty() && !must)
-    {
-      // unnecessary when normalizing
-      const double nd = v.size();
-      for(BowVector::iterator vit = v.begin(); vit != v.end(); vit++) 
-        vit->second /= nd;
-    }
+    transform(*fit, id, w);
     
+    // not stopped
+    if(w > 0) words.push_back(BowVector::Entry(id, w));
   }
-  else // IDF || BINARY
+
+  v.assign(words, accumulate);
+  
+  if(accumulate && !v.empty() && !must)
   {
-    for(fit = features.begin(); fit < features.end(); ++fit)
-    {
-      WordId id;
-      WordValue w;
-      // w is idf if IDF, or 1 if BINARY
-      
-      transform(*fit, id, w);
-      
-      // not stopped
-      if(w > 0) v.addIfNotExist(id, w);
-      
-    } // if add_features
-  } // if m_weighting == ...
+    // unnecessary when normalizing
+    v.divide(v.size());
+  }
   
   if(must) v.normalize(norm);
 }
@@ -1142,62 +1276,62 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
   // normalize 
   LNorm norm;
   bool must = m_scoring_object->mustNormalize(norm);
+
+  // w is the idf value if TF_IDF, 1 if TF
+  // w is idf if IDF, or 1 if BINARY
+  const bool accumulate = m_weighting == TF || m_weighting == TF_IDF;
+
+  std::vector<BowVector::Entry> words;
+  std::vector<FeatureVector::Entry> nodes;
+  words.reserve(features.size());
+  nodes.reserve(features.size());
   
   typename vector<TDescriptor>::const_iterator fit;
-  
-  if(m_weighting == TF || m_weighting == TF_IDF)
+  unsigned int i_feature = 0;
+  for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
   {
-    unsigned int i_feature = 0;
-    for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
-    {
-      WordId id;
-      NodeId nid;
-      WordValue w; 
-      // w is the idf value if TF_IDF, 1 if TF
-      
-      transform(*fit, id, w, &nid, levelsup);
-      
-      if(w > 0) // not stopped
-      { 
-        v.addWeight(id, w);
-        fv.addFeature(nid, i_feature);
-      }
-    }
+    WordId id;
+    NodeId nid;
+    WordValue w; 
     
-    if(!v.empty() && !must)
-    {
-      // unnecessary when normalizing
-      const double nd = v.size();
-      for(BowVector::iterator vit = v.begin(); vit != v.end(); vit++) 
-        vit->second /= nd;
+    transform(*fit, id, w, &nid, levelsup);
+    
+    if(w > 0) // not stopped
+    { 
+      words.push_back(BowVector::Entry(id, w));
+      nodes.push_back(FeatureVector::Entry(nid, i_feature));
     }
-  
   }
-  else // IDF || BINARY
+
+  v.assign(words, accumulate);
+  fv.assign(nodes);
+  
+  if(accumulate && !v.empty() && !must)
   {
-    unsigned int i_feature = 0;
-    for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
-    {
-      WordId id;
-      NodeId nid;
-      WordValue w;
-      // w is idf if IDF, or 1 if BINARY
-      
-      transform(*fit, id, w, &nid, levelsup);
-      
-      if(w > 0) // not stopped
-      {
-        v.addIfNotExist(id, w);
-        fv.addFeature(nid, i_feature);
-      }
-    }
-  } // if m_weighting == ...
+    // unnecessary when normalizing
+    v.divide(v.size());
+  }
   
   if(must) v.normalize(norm);
 }
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F> 
+void TemplatedVocabulary<TDescriptor,F>::transform(const cv::Mat &features,
+  BowVector &v, FeatureVector &fv, int levelsup, int /*nthreads*/) const
+{
+  // generic version: split the block and transform serially
+  std::vector<TDescriptor> vfeatures;
+  vfeatures.reserve(features.rows);
+  for(int i = 0; i < features.rows; ++i)
+    vfeatures.push_back(features.row(i));
+
+  transform(vfeatures, v, fv, levelsup);
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F> 
 inline double TemplatedVocabulary<TDescriptor,F>::score
   (const BowVector &v1, const BowVector &v2) const
@@ -1337,6 +1471,148 @@ int TemplatedVocabulary<TDescriptor,F>::stopWords(double minWeight)
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+int TemplatedVocabulary<TDescriptor,F>::prune
+  (const std::vector<std::vector<TDescriptor> > &features, int minCount)
+{
+  if(m_words.empty()) return 0;
+
+  // count the features that fall into each word
+  vector<vector<WordId> > doc_words(features.size());
+  parallelFor(features.size(), [&](size_t begin, size_t end)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      doc_words[i].resize(features[i].size());
+      for(size_t j = 0; j < features[i].size(); ++j)
+        transform(features[i][j], doc_words[i][j]);
+    }
+  });
+
+  vector<unsigned int> counts(m_words.size(), 0);
+  for(size_t i = 0; i < doc_words.size(); ++i)
+    for(size_t j = 0; j < doc_words[i].size(); ++j)
+      counts[doc_words[i][j]]++;
+
+  // keep the words seen enough times and their ancestors
+  vector<bool> keep(m_nodes.size(), false);
+  int nkept = 0;
+  for(WordId wid = 0; wid < m_words.size(); ++wid)
+  {
+    if((int)counts[wid] < minCount) continue;
+    ++nkept;
+
+    NodeId nid = m_words[wid]->id;
+    while(nid != 0 && !keep[nid])
+    {
+      keep[nid] = true;
+      nid = m_nodes[nid].parent;
+    }
+  }
+
+  if(nkept == 0) return 0;
+  keep[0] = true;
+
+  // parents always precede their children in m_nodes, so the nodes can be
+  // renumbered in a single pass
+  vector<NodeId> new_ids(m_nodes.size(), 0);
+  vector<Node> nodes;
+  nodes.reserve(m_nodes.size());
+
+  for(NodeId nid = 0; nid < m_nodes.size(); ++nid)
+  {
+    if(!keep[nid]) continue;
+
+    const Node &old_node = m_nodes[nid];
+    new_ids[nid] = nodes.size();
+
+    nodes.push_back(Node(nodes.size()));
+    Node &node = nodes.back();
+    node.weight = old_node.weight;
+    node.descriptor = old_node.descriptor;
+
+    if(nid != 0)
+    {
+      node.parent = new_ids[old_node.parent];
+      nodes[node.parent].children.push_back(node.id);
+    }
+  }
+
+  const int removed = (int)m_words.size() - nkept;
+
+  m_words.clear();
+  m_nodes.swap(nodes);
+  createWords();
+  buildFlatTree();
+
+  return removed;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::getMemoryUsage() const
+{
+  size_t bytes = sizeof(*this);
+
+  bytes += m_nodes.capacity() * sizeof(Node);
+  for(size_t i = 0; i < m_nodes.size(); ++i)
+  {
+    bytes += m_nodes[i].children.capacity() * sizeof(NodeId);
+    bytes += getDescriptorMemory(m_nodes[i].descriptor);
+  }
+
+  bytes += m_words.capacity() * sizeof(Node*);
+  bytes += m_flat_nodes.capacity() * sizeof(FlatNode);
+  bytes += m_flat_descriptors.capacity();
+
+  return bytes;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::getDescriptorMemory
+  (const TDescriptor &) const
+{
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class Func>
+void TemplatedVocabulary<TDescriptor,F>::parallelFor
+  (size_t n, const Func &func) const
+{
+  // below this number of items per thread, threads are not worth it
+  const size_t MIN_ITEMS_PER_THREAD = 1000;
+
+  size_t nthreads = m_nthreads > 0 ? m_nthreads : 
+    std::thread::hardware_concurrency();
+  nthreads = std::min(nthreads, n / MIN_ITEMS_PER_THREAD);
+
+  if(nthreads <= 1)
+  {
+    func(0, n);
+    return;
+  }
+
+  const size_t chunk = (n + nthreads - 1) / nthreads;
+
+  vector<std::thread> threads;
+  threads.reserve(nthreads - 1);
+  for(size_t begin = chunk; begin < n; begin += chunk)
+    threads.emplace_back(func, begin, std::min(begin + chunk, n));
+
+  func(0, std::min(chunk, n));
+
+  for(size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 bool TemplatedVocabulary<TDescriptor,F>::loadFromTextFile(const std::string &filename)
 {
@@ -1422,6 +1698,8 @@ bool TemplatedVocabulary<TDescriptor,F>::loadFromTextFile(const std::string &fil
         }
     }
 
+    buildFlatTree();
+
     return true;
 
 }
@@ -1622,6 +1900,8 @@ void TemplatedVocabulary<TDescriptor,F>::load(const cv::FileStorage &fs,
     m_nodes[nid].word_id = wid;
     m_words[wid] = &m_nodes[nid];
   }
+
+  buildFlatTree();
 }
 
 // --------------------------------------------------------------------------
@@ -1666,6 +1946,30 @@ std::ostream& operator<<(std::ostream &os,
 template<>
 bool TemplatedVocabulary<FORB::TDescriptor, FORB>::loadFromTextFile(const std::string &filename);
 
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::buildFlatTree();
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::transform(const FORB::TDescriptor &feature,
+  WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const;
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::transformFlat(const unsigned char *feature,
+  WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const;
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::transform(const cv::Mat &features,
+  BowVector &v, FeatureVector &fv, int levelsup, int nthreads) const;
+
+template<>
+bool TemplatedVocabulary<FORB::TDescriptor, FORB>::loadFromBinaryFile(const std::string &filename);
+
+template<>
+void TemplatedVocabulary<FORB::TDescriptor, FORB>::saveToBinaryFile(const std::string &filename) const;
+
+template<>
+size_t TemplatedVocabulary<FORB::TDescriptor, FORB>::getDescriptorMemory(const FORB::TDescriptor &descriptor) const;
+
 extern template class TemplatedVocabulary<FORB::TDescriptor, FORB>;
 
 } // namespace DBoW2
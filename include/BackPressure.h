@@ -0,0 +1,103 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include <cstdint>
+
+namespace ORB_SLAM2
+{
+
+// Overload policy for the input frames.
+// The input lag is the delay of a frame with respect to its timestamp, relative to the smallest delay seen so far.
+// When the lag grows, frames are tracked with the motion model only (downgraded) or skipped (dropped).
+// Keyframe insertion is throttled when the lag grows or when the mapping and loop closing queues are deep.
+class BackPressure
+{
+public:
+
+	enum Decision
+	{
+		PROCESS = 0,
+		DOWNGRADE = 1,
+		DROP = 2
+	};
+
+	struct Parameters
+	{
+		// Input lag above which frames are downgraded / dropped (0 disables them)
+		float downgradeLagMs;
+		float dropLagMs;
+
+		// Maximum number of consecutive downgraded / dropped frames
+		int maxConsecutiveDowngrades;
+		int maxConsecutiveDrops;
+
+		// Queue depths at which keyframe insertion is throttled (0 disables them)
+		int maxMappingQueue;
+		int maxLoopQueue;
+
+		Parameters();
+	};
+
+	struct Counters
+	{
+		uint64_t processed;
+		uint64_t downgraded;
+		uint64_t dropped;
+		uint64_t throttled;
+		Counters();
+	};
+
+	BackPressure(const Parameters& param);
+
+	bool Enabled() const;
+
+	// Decides how to process the frame with the given timestamp (in seconds).
+	// Frames are always processed when tracking is not OK.
+	Decision Update(double timestamp, int mappingQueue, int loopQueue, bool trackingOK);
+
+	// True if keyframe insertion must be restricted to frames where tracking is weak
+	bool ThrottleKeyFrames() const;
+
+	// Input lag of the last frame in milliseconds
+	double GetLagMs() const;
+
+	// Forgets the lag reference (the timestamps may restart)
+	void Reset();
+
+	const Counters& GetCounters() const;
+
+private:
+
+	Parameters param_;
+	Counters counters_;
+	bool hasOffset_;
+	double offset_;
+	double lagMs_;
+	bool throttle_;
+	int consecutiveDowngrades_;
+	int consecutiveDrops_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // BACKPRESSURE_H
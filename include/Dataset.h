@@ -0,0 +1,126 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <opencv2/core.hpp>
+
+namespace ORB_SLAM2
+{
+
+// Images of a dataset frame
+struct DatasetFrame
+{
+	cv::Mat image;
+	cv::Mat image2; // right image (stereo) or depthmap (RGB-D), empty for monocular sequences
+	double timestamp;
+};
+
+// Image files and timestamps of a sequence in one of the supported dataset layouts
+class Dataset
+{
+public:
+
+	// TUM RGB-D benchmark: monocular sequence listed in rgb.txt
+	static Dataset TUM(const std::string& sequencePath);
+
+	// TUM RGB-D benchmark: RGB-D sequence listed in an association file (rgb and depth files relative to the sequence)
+	static Dataset TUMRGBD(const std::string& sequencePath, const std::string& associationFile);
+
+	// EuRoC MAV: image folders and timestamps file (nanoseconds). rightPath is empty for monocular sequences.
+	static Dataset EuRoC(const std::string& leftPath, const std::string& rightPath, const std::string& timesFile);
+
+	// KITTI odometry: sequence folder with times.txt, image_0 and (stereo) image_1
+	static Dataset KITTI(const std::string& sequencePath, bool stereo);
+
+	int Size() const;
+	bool Empty() const;
+
+	double Timestamp(int i) const;
+
+	// File of the first (0) or second (1) image of the frame (empty if the frames have a single image)
+	const std::string& Filename(int i, int image) const;
+
+	// Reads and decodes the images of the frame. Returns false if an image cannot be read.
+	bool Read(int i, DatasetFrame& frame) const;
+
+private:
+
+	std::vector<double> timestamps_;
+	std::vector<std::string> filenames_[2];
+};
+
+// Reads the frames of a dataset in order. The images are decoded ahead of time on worker threads,
+// or mapped from a cache file holding the decoded images.
+class DatasetReader
+{
+public:
+
+	using Pointer = std::unique_ptr<DatasetReader>;
+
+	// Processing applied to the decoded frames (e.g. rectification) on the worker threads
+	using Transform = std::function<void(DatasetFrame& frame)>;
+
+	struct Parameters
+	{
+		// Maximum number of decoded frames waiting to be read
+		int queueSize;
+
+		// Number of decoding threads
+		int numThreads;
+
+		// Cache file of decoded (and transformed) frames. It is built on the first run and mapped on the next ones.
+		// Empty disables the cache.
+		std::string cacheFile;
+
+		Transform transform;
+
+		// Settings file read by the transform, if any. The cache is rebuilt when its contents change, or when the
+		// image files of the dataset change (paths, timestamps, file sizes and modification times are compared).
+		std::string transformSettings;
+
+		Parameters();
+	};
+
+	static Pointer Create(const Dataset& dataset, const Parameters& param = Parameters());
+
+	// Next frame of the sequence. Returns false at the end of the sequence or if the frame cannot be read.
+	// Frames mapped from a cache are valid until the reader is destroyed.
+	virtual bool Read(DatasetFrame& frame) = 0;
+
+	// Index of the next frame
+	virtual int Position() const = 0;
+
+	virtual ~DatasetReader();
+};
+
+// Reads the reader options from the command line (--prefetch=N, --threads=N, --cache=file) and removes them from it
+DatasetReader::Parameters ReadDatasetOptions(int& argc, char** argv);
+
+} //namespace ORB_SLAM
+
+#endif // DATASET_H
@@ -68,6 +68,9 @@ public:
 	void AssignFeatures(const KeyPoints& keypoints, const ImageBounds& imageBounds, int nlevels);
 	std::vector<size_t> GetFeaturesInArea(float x, float y, float r, int minLevel = -1, int maxLevel = -1) const;
 
+	// Bytes held by the grid, the object itself included (the cells are stored inline)
+	size_t GetMemoryUsage() const;
+
 private:
 	static const int ROWS = 48;
 	static const int COLS = 64;
@@ -89,12 +92,12 @@ public:
 	Frame(const Frame& frame);
 
 	// Constructor for stereo and RGB-D cameras.
-	Frame(ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
+	Frame(frameid_t id, const ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
 		const KeyPoints& keypointsUn, const std::vector<float>& uright, const std::vector<float>& depth,
 		const cv::Mat& descriptors, const ScalePyramidInfo& pyramid, const ImageBounds& imageBounds);
 
 	// Constructor for Monocular cameras.
-	Frame(ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
+	Frame(frameid_t id, const ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
 		const KeyPoints& keypointsUn, const cv::Mat& descriptors, const ScalePyramidInfo& pyramid, const ImageBounds& imageBounds);
 
 	// Compute Bag of Words representation.
@@ -115,7 +118,7 @@ public:
 
 public:
 	// Vocabulary used for relocalization.
-	ORBVocabulary* voc;
+	const ORBVocabulary* voc;
 
 	// Frame timestamp.
 	double timestamp;
@@ -156,8 +159,7 @@ public:
 	// Camera pose.
 	CameraPose pose;
 
-	// Current and Next Frame id.
-	static frameid_t nextId;
+	// Frame id. Ids are given by the System that creates the frames.
 	frameid_t id;
 
 	// Reference Keyframe.
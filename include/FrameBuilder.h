@@ -0,0 +1,104 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMEBUILDER_H
+#define FRAMEBUILDER_H
+
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include "Frame.h"
+#include "ORBextractor.h"
+#include "ThreadParams.h"
+
+namespace ORB_SLAM2
+{
+
+// Builds frames from the input images of one camera:
+// color conversion, ORB extraction, undistortion and stereo/depth association.
+class FrameBuilder
+{
+public:
+
+	// Reads the camera and ORB extractor parameters from the settings file
+	FrameBuilder(const cv::FileStorage& settings, int sensor);
+
+	// Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
+	// Stereo images must be synchronized and rectified. The depthmap must be registered to the RGB frame.
+	// For monocular cameras, the initialization extractor (twice as many features) is used if init is true.
+	Frame Stereo(frameid_t id, const ORBVocabulary* voc, const cv::Mat& imageL, const cv::Mat& imageR, double timestamp);
+	Frame RGBD(frameid_t id, const ORBVocabulary* voc, const cv::Mat& image, const cv::Mat& depth, double timestamp);
+	Frame Monocular(frameid_t id, const ORBVocabulary* voc, const cv::Mat& image, double timestamp, bool init);
+
+	// Load new calibration
+	void ChangeCalibration(const cv::FileStorage& settings);
+
+	// See ORBextractor::SetFeatureBudget (not applied to the initialization extractor)
+	void SetFeatureBudget(int nfeatures, int nactiveLevels);
+
+	const CameraParams& GetCamera() const;
+	const cv::Mat1f& GetDistCoeffs() const;
+	const ORBextractor::Parameters& GetExtractorParameters() const;
+	bool IsRGB() const;
+
+	// Grayscale image of the last frame
+	const cv::Mat& GetImage() const;
+
+private:
+
+	int sensor_;
+
+	// Calibration matrix
+	CameraParams camera_;
+	cv::Mat1f distCoeffs_;
+
+	// For RGB-D inputs only. For some datasets (e.g. TUM) the depthmap values are scaled.
+	float depthFactor_;
+
+	// Color order (true RGB, false BGR, ignored if grayscale)
+	bool RGB_;
+
+	// ORB
+	ORBextractor::Parameters extractorParams_;
+	std::unique_ptr<ORBextractor> extractorL_;
+	std::unique_ptr<ORBextractor> extractorR_;
+	std::unique_ptr<ORBextractor> extractorIni_;
+
+	// Scheduling of the stereo extraction workers
+	ThreadParams extractorThread_;
+
+	// Scale Level Info
+	ScalePyramidInfo pyramid_;
+
+	ImageBounds imageBounds_;
+
+	// Work buffers
+	cv::Mat imageL_;
+	cv::Mat imageR_;
+	cv::Mat depthMap_;
+	KeyPoints keypointsL_, keypointsR_, keypointsUn_;
+	std::vector<float> uright_, depth_;
+	cv::Mat descriptorsL_, descriptorsR_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // FRAMEBUILDER_H
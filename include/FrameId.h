@@ -25,6 +25,7 @@ namespace ORB_SLAM2
 {
 
 using frameid_t = long unsigned int;
+using mappointid_t = long unsigned int;
 
 } // namespace ORB_SLAM
 
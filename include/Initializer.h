@@ -20,6 +20,7 @@
 #ifndef INITIALIZER_H
 #define INITIALIZER_H
 
+#include<random>
 #include<opencv2/opencv.hpp>
 #include "Frame.h"
 
@@ -94,6 +95,9 @@ private:
     // Ransac sets
     std::vector<std::vector<size_t> > mvSets;   
 
+    // Seeded per initializer, so that the samples do not depend on the other sessions of the process
+    std::mt19937 mRng;
+
 };
 
 } //namespace ORB_SLAM
@@ -21,9 +21,13 @@
 #ifndef KEYFRAME_H
 #define KEYFRAME_H
 
+#include <map>
+#include <set>
 #include <mutex>
+#include <atomic>
 
 #include "Frame.h"
+#include "MemoryStats.h"
 
 namespace ORB_SLAM2
 {
@@ -36,7 +40,8 @@ class KeyFrame
 {
 public:
 
-	KeyFrame(const Frame& frame, Map* map, KeyFrameDatabase* keyframeDB);
+	// The first keyframe of a map is its origin (see Map::CreateMap)
+	KeyFrame(const Frame& frame, Map* map, KeyFrameDatabase* keyframeDB, bool origin = false);
 
 	// Pose functions
 	void SetPose(const CameraPose& pose);
@@ -79,6 +84,9 @@ public:
 	int TrackedMapPoints(int minObs) const;
 	MapPoint* GetMapPoint(size_t idx) const;
 
+	// Incremented every time a MapPoint is added, erased or replaced
+	unsigned int GetMapPointsVersion() const;
+
 	// KeyPoint functions
 	std::vector<size_t> GetFeaturesInArea(float x, float y, float r) const;
 	Point3D UnprojectStereo(int i) const;
@@ -97,15 +105,23 @@ public:
 	// Compute Scene Depth (q=2 median). Used in monocular.
 	float ComputeSceneMedianDepth(int q) const;
 
+	// Adds the memory held by the keyframe to the statistics
+	void AddMemoryUsage(MemoryStats::KeyFrames& memory) const;
+
 	// The following variables are accesed from only 1 thread or never change (no mutex needed).
 public:
 
-	static frameid_t nextId;
 	frameid_t id;
 	const frameid_t frameId;
 
 	const double timestamp;
 
+	// Map of the atlas the keyframe was created in (see Map::GetMapId for the map it belongs to)
+	const int mapIndex;
+
+	// First keyframe of its map. It is the root of the spanning tree and it is never erased.
+	const bool origin;
+
 	// Grid (to speed up feature matching)
 	FeaturesGrid grid;
 
@@ -121,9 +137,6 @@ public:
 	frameid_t loopQuery;
 	int loopWords;
 	float loopScore;
-	frameid_t relocQuery;
-	int relocWords;
-	float relocScore;
 
 	// Variables used by loop closing
 	CameraPose TcwGBA;
@@ -164,10 +177,11 @@ protected:
 	
 	// MapPoints associated to keypoints
 	std::vector<MapPoint*> mappoints_;
+	std::atomic<unsigned int> mappointsVersion_;
 
 	// BoW
 	KeyFrameDatabase* keyFrameDB_;
-	ORBVocabulary* voc_;
+	const ORBVocabulary* voc_;
 
 	std::map<KeyFrame*, int> connectionTo_;
 	std::vector<KeyFrame*> orderedConnectedKeyFrames_;
@@ -25,8 +25,11 @@
 #include <list>
 #include <set>
 #include <mutex>
+#include <atomic>
 
 #include "ORBVocabulary.h"
+#include "LockStats.h"
+#include "MemoryStats.h"
 
 namespace ORB_SLAM2
 {
@@ -49,19 +52,30 @@ public:
 	// Loop Detection
 	std::vector<KeyFrame*> DetectLoopCandidates(KeyFrame* keyframe, float minScore);
 
-	// Relocalization
-	std::vector<KeyFrame*> DetectRelocalizationCandidates(Frame* frame);
+	// Relocalization. It does not modify the keyframes, so it can be called by several trackers at once.
+	std::vector<KeyFrame*> DetectRelocalizationCandidates(const Frame& frame) const;
+
+	// Adds the memory held by the inverted file to the statistics
+	void AddMemoryUsage(MemoryStats& stats) const;
+
+	// Marks the database as read-only. Queries do not lock it anymore.
+	void Freeze();
 
 protected:
 
+	std::unique_lock<std::mutex> LockUnlessFrozen(LockSite* site) const;
+
 	// Associated vocabulary
 	const ORBVocabulary* voc_;
 
 	// Inverted file
 	std::vector<std::list<KeyFrame*>> wordIdToKFs_;
 
+	// Read without the mutex by LockUnlessFrozen
+	std::atomic<bool> frozen_;
+
 	// Mutex
-	std::mutex mutex_;
+	mutable std::mutex mutex_;
 };
 
 } //namespace ORB_SLAM
@@ -0,0 +1,99 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef KEYFRAMEQUEUE_H
+#define KEYFRAMEQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+namespace ORB_SLAM2
+{
+
+class KeyFrame;
+
+// Bounded single-producer/single-consumer ring queue handing keyframes over from one thread to the next.
+// TryPush() must only be called from the producer thread, and TryPop()/Clear() from one thread at a time
+// (the consumer, or another thread while the consumer is stopped). Size() and GetStats() can be called from any thread.
+class KeyFrameQueue
+{
+public:
+
+	struct Stats
+	{
+		uint64_t pushed;
+		uint64_t popped;
+
+		// Pushes rejected because the queue was full
+		uint64_t overflows;
+
+		int maxDepth;
+
+		// Time spent in the queue
+		double meanDwellMs;
+		double maxDwellMs;
+
+		Stats();
+	};
+
+	KeyFrameQueue(int capacity);
+
+	// Returns false if the queue is full
+	bool TryPush(KeyFrame* keyframe);
+
+	// Returns nullptr if the queue is empty.
+	// wasFull is set to true if the queue was full before the call.
+	KeyFrame* TryPop(bool* wasFull = nullptr);
+
+	// Pops all the keyframes
+	void Clear();
+
+	bool Empty() const;
+	bool Full() const;
+	int Size() const;
+
+	Stats GetStats() const;
+
+private:
+
+	struct Slot
+	{
+		KeyFrame* keyframe;
+		int64_t pushTime;
+	};
+
+	std::vector<Slot> slots_;
+
+	// Number of keyframes pushed / popped so far.
+	// tail_ is only written by the producer and head_ by the consumer.
+	std::atomic<uint64_t> head_;
+	std::atomic<uint64_t> tail_;
+
+	std::atomic<uint64_t> overflows_;
+	std::atomic<int> maxDepth_;
+	std::atomic<int64_t> totalDwell_;
+	std::atomic<int64_t> maxDwell_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // KEYFRAMEQUEUE_H
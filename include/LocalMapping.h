@@ -23,6 +23,8 @@
 
 #include <memory>
 
+#include "KeyFrameQueue.h"
+
 namespace ORB_SLAM2
 {
 
@@ -52,6 +54,8 @@ public:
 	virtual void RequestStop() = 0;
 	virtual void RequestReset() = 0;
 	virtual bool Stop() = 0;
+	// Blocks until Local Mapping has effectively stopped (or finished) after RequestStop()
+	virtual void WaitUntilStopped() = 0;
 	virtual void Release() = 0;
 	virtual bool isStopped() const = 0;
 	virtual bool stopRequested() const = 0;
@@ -66,6 +70,15 @@ public:
 
 	virtual int KeyframesInQueue() const = 0;
 
+	// True if InsertKeyFrame would block until Local Mapping pops a keyframe
+	virtual bool KeyFrameQueueFull() const = 0;
+
+	// Blocks until the queued keyframes have been processed, or Local Mapping is stopped or finished
+	virtual void WaitUntilIdle() = 0;
+
+	// Depth and dwell time of the keyframe queue
+	virtual KeyFrameQueue::Stats GetQueueStats() const = 0;
+
 	virtual ~LocalMapping();
 };
 
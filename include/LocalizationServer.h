@@ -0,0 +1,85 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LOCALIZATIONSERVER_H
+#define LOCALIZATIONSERVER_H
+
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+
+#include "System.h"
+
+namespace ORB_SLAM2
+{
+
+class Map;
+class KeyFrameDatabase;
+
+// Localization-only tracker of one camera against the map of a LocalizationServer.
+// Its state is only the last frame, the motion model and its own local map,
+// so several localizers can run concurrently (each one from a single thread).
+class Localizer
+{
+public:
+
+	using Pointer = std::unique_ptr<Localizer>;
+
+	// Same input as System::TrackStereo/TrackRGBD/TrackMonocular.
+	// Returns the camera pose (empty if the camera could not be localized).
+	virtual cv::Mat LocalizeStereo(const cv::Mat& imageL, const cv::Mat& imageR, double timestamp) = 0;
+	virtual cv::Mat LocalizeRGBD(const cv::Mat& image, const cv::Mat& depth, double timestamp) = 0;
+	virtual cv::Mat LocalizeMonocular(const cv::Mat& image, double timestamp) = 0;
+
+	// True if the last frame could not be localized
+	virtual bool IsLost() const = 0;
+
+	// Forgets the motion model and the local map. The next frame is relocalized.
+	virtual void Reset() = 0;
+
+	virtual ~Localizer();
+};
+
+// Serves a finished map to many localizers.
+// The map and the keyframe database are frozen: they are never modified again,
+// so the localizers query them without taking any lock.
+class LocalizationServer
+{
+public:
+
+	using Pointer = std::unique_ptr<LocalizationServer>;
+
+	static Pointer Create(const System::VocabularyPointer& voc, std::unique_ptr<Map> map,
+		std::unique_ptr<KeyFrameDatabase> keyFrameDB);
+
+	// Creates a localizer for a camera described by the settings file (camera and ORB parameters).
+	// The localizers must be destroyed before the server.
+	virtual Localizer::Pointer CreateLocalizer(const System::Path& settingsFile, System::Sensor sensor) const = 0;
+
+	virtual size_t KeyFramesInMap() const = 0;
+	virtual size_t MapPointsInMap() const = 0;
+
+	virtual ~LocalizationServer();
+};
+
+} //namespace ORB_SLAM
+
+#endif // LOCALIZATIONSERVER_H
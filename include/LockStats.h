@@ -0,0 +1,118 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LOCKSTATS_H
+#define LOCKSTATS_H
+
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+#include "SharedMutex.h"
+
+namespace ORB_SLAM2
+{
+
+// Lock contention statistics.
+// When built with ORB_SLAM2_LOCK_STATS (cmake -DORB_SLAM2_LOCK_STATS=ON), every lock taken through
+// LockMutex(mutex, LOCK_SITE("Class::Lock")) records its acquisitions and wait times per call site,
+// and the call site holding the mutex when a thread had to wait. Otherwise LOCK_SITE is nullptr
+// and LockMutex/LockShared are plain std::unique_lock/std::shared_lock.
+
+// Wait time histogram: bin i counts the waits shorter than 2^i microseconds (the last bin the longer ones)
+static const int LOCK_WAIT_BINS = 20;
+
+struct LockSite
+{
+	LockSite(const char* lockClass, const char* file, int line);
+
+	const char* lockClass;
+	const char* file;
+	int line;
+
+	std::atomic<uint64_t> acquisitions;
+	std::atomic<uint64_t> contentions;
+	std::atomic<uint64_t> totalWaitNs;
+	std::atomic<uint64_t> maxWaitNs;
+	std::atomic<uint64_t> waitHistogram[LOCK_WAIT_BINS];
+};
+
+#ifdef ORB_SLAM2_LOCK_STATS
+#define LOCK_SITE(lockClass) \
+	(&([]() -> ::ORB_SLAM2::LockSite& { static ::ORB_SLAM2::LockSite site(lockClass, __FILE__, __LINE__); return site; }()))
+#else
+#define LOCK_SITE(lockClass) nullptr
+#endif
+
+std::unique_lock<std::mutex> LockInstrumented(std::mutex& mutex, LockSite* site);
+std::unique_lock<SharedMutex> LockInstrumented(SharedMutex& mutex, LockSite* site);
+std::shared_lock<SharedMutex> LockSharedInstrumented(SharedMutex& mutex, LockSite* site);
+
+// Locks the mutex, recording the acquisition in the statistics of the site (if any)
+inline std::unique_lock<std::mutex> LockMutex(std::mutex& mutex, LockSite* site)
+{
+	if (!site)
+		return std::unique_lock<std::mutex>(mutex);
+	return LockInstrumented(mutex, site);
+}
+
+inline std::unique_lock<SharedMutex> LockMutex(SharedMutex& mutex, LockSite* site)
+{
+	if (!site)
+		return std::unique_lock<SharedMutex>(mutex);
+	return LockInstrumented(mutex, site);
+}
+
+// Same for a read (shared) lock
+inline std::shared_lock<SharedMutex> LockShared(SharedMutex& mutex, LockSite* site)
+{
+	if (!site)
+		return std::shared_lock<SharedMutex>(mutex);
+	return LockSharedInstrumented(mutex, site);
+}
+
+struct LockStats
+{
+	std::string lockClass;
+	std::string site;
+	uint64_t acquisitions;
+	uint64_t contentions;
+	double totalWaitMs;
+	double maxWaitMs;
+	std::vector<uint64_t> waitHistogram;
+
+	// Call sites that were holding the mutex when this one had to wait, and how many times
+	std::vector<std::pair<std::string, uint64_t>> blockedBy;
+};
+
+// Statistics of every call site used so far (empty if not built with ORB_SLAM2_LOCK_STATS)
+std::vector<LockStats> GetLockStats();
+
+// Prints the statistics grouped by lock class, most contended first
+void PrintLockStats(std::ostream& os);
+
+} //namespace ORB_SLAM
+
+#endif // LOCKSTATS_H
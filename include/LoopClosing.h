@@ -24,6 +24,8 @@
 #include <memory>
 
 #include "KeyFrameDatabase.h"
+#include "KeyFrameQueue.h"
+#include "ThreadParams.h"
 
 namespace ORB_SLAM2
 {
@@ -41,7 +43,9 @@ public:
 
 	using Pointer = std::unique_ptr<LoopClosing>;
 
-	static Pointer Create(Map* map, KeyFrameDatabase* keyframeDB, ORBVocabulary* voc, bool fixScale);
+	// globalBAThread: scheduling of the threads running the global bundle adjustments
+	static Pointer Create(Map* map, KeyFrameDatabase* keyframeDB, const ORBVocabulary* voc, bool fixScale,
+		const ThreadParams& globalBAThread = ThreadParams());
 	
 	virtual void SetTracker(Tracking* tracker) = 0;
 
@@ -52,10 +56,20 @@ public:
 
 	virtual void InsertKeyFrame(KeyFrame* keyframe) = 0;
 
+	virtual int KeyframesInQueue() const = 0;
+
+	// Depth and dwell time of the keyframe queue
+	virtual KeyFrameQueue::Stats GetQueueStats() const = 0;
+
 	virtual void RequestReset() = 0;
 
 	virtual bool isRunningGBA() const = 0;
 	virtual bool isFinishedGBA() const = 0;
+	// Blocks until the Global Bundle Adjustment in progress (if any) has finished
+	virtual void WaitForGBA() = 0;
+
+	// Blocks until the queued keyframes have been processed (the global BA they launch may still be running)
+	virtual void WaitUntilIdle() = 0;
 
 	virtual void RequestFinish() = 0;
 
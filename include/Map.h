@@ -24,8 +24,11 @@
 #include <set>
 #include <vector>
 #include <mutex>
+#include <atomic>
 
 #include "FrameId.h"
+#include "LockStats.h"
+#include "MemoryStats.h"
 
 namespace ORB_SLAM2
 {
@@ -55,16 +58,60 @@ public:
 	size_t MapPointsInMap() const;
 	size_t KeyFramesInMap() const;
 
+	// Multiple maps (atlas).
+	// When tracking stays lost, a new map is started in this container instead of clearing it.
+	// The maps share the keyframes, map points, ids and the keyframe database, so that relocalization
+	// and loop detection search all of them. Loop Closing merges two maps when it recognizes a place of one in the other.
+	// A map merged into another takes its id.
+
+	// Starts a new map, which becomes the current one. The current map is reused if it has no keyframes.
+	int CreateMap();
+
+	// Map the new keyframes are added to: the one being tracked
+	int GetCurrentMap() const;
+	void SetCurrentMap(int mapId);
+
+	int GetMapId(const KeyFrame* keyframe) const;
+
+	// Map id of every map index (see KeyFrame::mapIndex), resolved under a single lock.
+	// Cheaper than GetMapId when many keyframes are checked. Indices created later are not included.
+	std::vector<int> GetMapIds() const;
+
+	// Merges the map "from" into the map "into". The poses must have been brought to the frame of "into" before.
+	void MergeMaps(int from, int into);
+
+	size_t KeyFramesInMap(int mapId) const;
+
+	// Number of maps with keyframes
+	int MapsInAtlas() const;
+
+	// True for the origin of a map not merged into another one. It is fixed in the optimizations.
+	bool IsAnchor(const KeyFrame* keyframe) const;
+
 	frameid_t GetMaxKFid() const;
 
+	// Adds the memory held by the keyframes, the map points (erased ones included) and the map itself to the statistics
+	void AddMemoryUsage(MemoryStats& stats) const;
+
+	// Ids of new KeyFrames and MapPoints. They are unique within this map.
+	frameid_t NewKeyFrameId();
+	mappointid_t NewMapPointId();
+
 	void Clear();
 
+	// Marks the map as read-only. From then on the map, its keyframes and its map points are not modified,
+	// and they can be read from several threads without locking.
+	void Freeze();
+	bool IsFrozen() const;
+
 	std::vector<KeyFrame*> keyFrameOrigins;
 
-	std::mutex mutexMapUpdate;
+	// Taken for writing when keyframe poses and map point positions are corrected (bundle adjustment results,
+	// loop correction, map initialization) and for reading by the tracking, so that they do not change during a frame
+	SharedMutex mutexMapUpdate;
 
-	// This avoid that two points are created simultaneously in separate threads (id conflict)
-	std::mutex mutexPointCreation;
+	// Locked while MapPoint positions are written or read for pose optimization
+	std::mutex mutexPointPositions;
 
 protected:
 
@@ -75,15 +122,38 @@ protected:
 
 	frameid_t maxKFId_;
 
+	// MapPoints can be created from Tracking and Local Mapping
+	std::atomic<frameid_t> nextKFId_;
+	std::atomic<mappointid_t> nextMPId_;
+
 	// Index related to a big change in the map (loop closure, global BA)
 	int bigChangeId_;
 
 	std::set<MapPoint*> erasedMappoints_;
 	std::set<KeyFrame*> erasedKeyframes_;
 
+	// Read without the mutex by LockUnlessFrozen
+	std::atomic<bool> frozen_;
+
+	// Maps by index (see KeyFrame::mapIndex)
+	struct AtlasEntry
+	{
+		int mergedInto; // own index if not merged
+		size_t nkeyframes;
+		AtlasEntry();
+	};
+
+	int FindMap(int index) const;
+
+	std::vector<AtlasEntry> atlas_;
+	int currentMap_;
+
 	mutable std::mutex mutexMap_;
 };
 
+// Locks the mutex of an object of the map, unless the map is frozen
+std::unique_lock<std::mutex> LockUnlessFrozen(std::mutex& mutex, const Map* map, LockSite* site = nullptr);
+
 } //namespace ORB_SLAM
 
 #endif // MAP_H
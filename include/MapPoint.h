@@ -23,11 +23,13 @@
 
 #include <map>
 #include <mutex>
+#include <atomic>
 
 #include <opencv2/core/core.hpp>
 
 #include "FrameId.h"
 #include "Point.h"
+#include "MemoryStats.h"
 
 namespace ORB_SLAM2
 {
@@ -40,8 +42,6 @@ class MapPoint
 {
 public:
 
-	using mappointid_t = long unsigned int;
-
 	MapPoint(const Point3D& Xw, KeyFrame* referenceKF, Map* map);
 	MapPoint(const Point3D& Xw, Map* map, Frame* frame, int idx);
 
@@ -54,6 +54,9 @@ public:
 	std::map<KeyFrame*, size_t> GetObservations() const;
 	int Observations() const;
 
+	// Incremented every time the observations change
+	unsigned int GetObservationsVersion() const;
+
 	void AddObservation(KeyFrame* keyframe, size_t idx);
 	void EraseObservation(KeyFrame* keyframe);
 
@@ -76,6 +79,9 @@ public:
 
 	void UpdateNormalAndDepth();
 
+	// Adds the memory held by the map point to the statistics
+	void AddMemoryUsage(MemoryStats::MapPoints& memory) const;
+
 	float GetMinDistanceInvariance() const;
 	float GetMaxDistanceInvariance() const;
 	int PredictScale(float currentDist, const KeyFrame* keyframe) const;
@@ -84,7 +90,6 @@ public:
 public:
 
 	mappointid_t id;
-	static mappointid_t nextId;
 	int firstKFid;
 	int firstFrame;
 	
@@ -95,7 +100,6 @@ public:
 	bool trackInView;
 	int trackScaleLevel;
 	float trackViewCos;
-	frameid_t trackReferenceForFrame;
 	frameid_t lastFrameSeen;
 
 	// Variables used by local mapping
@@ -109,8 +113,6 @@ public:
 	Point3D posGBA;
 	frameid_t BAGlobalForKF;
 
-	static std::mutex& GetGlobalMutex();
-
 protected:
 
 	// Position in absolute coordinates
@@ -119,6 +121,7 @@ protected:
 	// Keyframes observing the point and associated index in keyframe
 	std::map<KeyFrame*, size_t> observations_;
 	int nobservations_;
+	std::atomic<unsigned int> observationsVersion_;
 
 	// Mean viewing direction
 	Vec3D normal_;
@@ -0,0 +1,134 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <cstddef>
+#include <vector>
+#include <set>
+#include <map>
+#include <list>
+#include <deque>
+#include <ostream>
+
+#include <opencv2/core.hpp>
+
+namespace ORB_SLAM2
+{
+
+// Heap memory held by the map, the place recognition structures and the trajectory, in bytes.
+// Containers are estimated from their capacity plus the node overhead of the standard library,
+// so the figures track the real footprint closely but are not exact allocator counts.
+struct MemoryStats
+{
+	struct KeyFrames
+	{
+		size_t count;
+		size_t keypoints;   // distorted and undistorted keypoints, stereo coordinates, depths
+		size_t descriptors;
+		size_t grid;        // feature grid and its copy of the keypoints
+		size_t bow;         // BoW and feature vectors
+		size_t graph;       // map point matches, covisibility graph, spanning tree, loop edges
+		size_t other;       // objects and scale pyramids
+		size_t Total() const;
+		KeyFrames();
+	};
+
+	struct MapPoints
+	{
+		size_t count;
+		size_t observations;
+		size_t descriptors;
+		size_t other;       // objects
+		size_t Total() const;
+		MapPoints();
+	};
+
+	KeyFrames keyframes;
+	MapPoints mappoints;
+
+	// Keyframes and map points erased from the map. They stay allocated until the map is cleared.
+	KeyFrames erasedKeyframes;
+	MapPoints erasedMappoints;
+
+	// Sets of keyframes and map points of the map
+	size_t mapIndex;
+
+	// Inverted file of the keyframe database
+	size_t keyFrameDatabase;
+	size_t keyFrameDatabaseEntries;
+
+	size_t vocabulary;
+
+	// Frames kept by the tracking to recover the camera trajectory
+	size_t trajectory;
+	size_t trajectoryFrames;
+
+	size_t Total() const;
+	MemoryStats();
+};
+
+// Prints the statistics in MB, one line per subsystem
+void PrintMemoryStats(std::ostream& os, const MemoryStats& stats);
+
+// Estimated heap memory of the standard containers (excluding the memory owned by their elements)
+static const size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+static const size_t LIST_NODE_OVERHEAD = 2 * sizeof(void*);
+
+template <class T>
+size_t HeapBytes(const std::vector<T>& v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+template <class T, class C>
+size_t HeapBytes(const std::set<T, C>& s)
+{
+	return s.size() * (TREE_NODE_OVERHEAD + sizeof(T));
+}
+
+template <class K, class V, class C>
+size_t HeapBytes(const std::map<K, V, C>& m)
+{
+	return m.size() * (TREE_NODE_OVERHEAD + sizeof(std::pair<const K, V>));
+}
+
+template <class T>
+size_t HeapBytes(const std::list<T>& l)
+{
+	return l.size() * (LIST_NODE_OVERHEAD + sizeof(T));
+}
+
+template <class T>
+size_t HeapBytes(const std::deque<T>& d)
+{
+	return d.size() * sizeof(T);
+}
+
+inline size_t HeapBytes(const cv::Mat& m)
+{
+	return m.total() * m.elemSize();
+}
+
+} //namespace ORB_SLAM
+
+#endif // MEMORYSTATS_H
@@ -54,7 +54,13 @@ public:
 	// Mask is ignored in the current implementation.
 	void Extract(const cv::Mat& image, KeyPoints& keypoints, cv::Mat& descriptors);
 
+	// Changes the number of features and the number of pyramid levels in which they are detected.
+	// The scale pyramid info is not modified, so the keypoints stay compatible with the existing map.
+	void SetFeatureBudget(int nfeatures, int nactiveLevels);
+
 	int GetLevels() const;
+	int GetNumFeatures() const;
+	int GetActiveLevels() const;
 	float GetScaleFactor() const;
 	const std::vector<float>& GetScaleFactors() const;
 	const std::vector<float>& GetInverseScaleFactors() const;
@@ -77,6 +83,8 @@ private:
 	std::vector<cv::Point> pattern_;
 
 	Parameters param_;
+	int nfeatures_;
+	int nactiveLevels_;
 };
 
 } //namespace ORB_SLAM
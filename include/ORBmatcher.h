@@ -44,6 +44,16 @@ void ComputeStereoMatches(
 	const std::vector<float>& scaleFactors, const std::vector<float>& invScaleFactors, const CameraParams& camera,
 	std::vector<float>& uright, std::vector<float>& depth);
 
+// Projection of a map point in a frame, used to search matches in the local map.
+// Trackers sharing a read-only map keep these themselves instead of the tracking variables of the MapPoint.
+struct MapPointProjection
+{
+	MapPoint* mappoint;
+	float x, y, xR;
+	int scaleLevel;
+	float viewCos;
+};
+
 class ORBmatcher
 {
 public:
@@ -56,6 +66,7 @@ public:
 	// Search matches between Frame keypoints and projected MapPoints. Returns number of matches
 	// Used to track the local map (Tracking)
 	int SearchByProjection(Frame& frame, const std::vector<MapPoint*>& mappoints, float th = 3);
+	int SearchByProjection(Frame& frame, const std::vector<MapPointProjection>& projections, float th = 3);
 
 	// Project MapPoints tracked in last frame into the current frame and search matches.
 	// Used to track from previous frame (Tracking)
@@ -21,6 +21,9 @@
 #ifndef OPTIMIZER_H
 #define OPTIMIZER_H
 
+#include <map>
+#include <set>
+
 #include "FrameId.h"
 #include "Sim3.h"
 
@@ -38,7 +41,8 @@ using LoopConnections = std::map<KeyFrame*, std::set<KeyFrame*>>;
 namespace Optimizer
 {
 
-void BundleAdjustment(const std::vector<KeyFrame*>& keyframes, const std::vector<MapPoint*>& mappoints,
+// The anchors of the map (see Map::IsAnchor) are fixed
+void BundleAdjustment(const Map* map, const std::vector<KeyFrame*>& keyframes, const std::vector<MapPoint*>& mappoints,
 	int niterations = 5, bool* stopFlag = nullptr, frameid_t loopKFId = 0, bool robust = true);
 
 void GlobalBundleAdjustemnt(Map* map, int niterations, bool* stopFlag = nullptr, frameid_t loopKFId = 0,
@@ -46,7 +50,7 @@ void GlobalBundleAdjustemnt(Map* map, int niterations, bool* stopFlag = nullptr,
 
 void LocalBundleAdjustment(KeyFrame* currKeyFrame, bool* stopFlag, Map* map);
 
-int PoseOptimization(Frame* pFrame);
+int PoseOptimization(Frame* frame, Map* map);
 
 // if bFixScale is true, 6DoF optimization (stereo,rgbd), 7DoF otherwise (mono)
 void OptimizeEssentialGraph(Map* map, KeyFrame* loopKF, KeyFrame* currKF,
@@ -52,6 +52,7 @@
 #define PNPSOLVER_H
 
 #include <vector>
+#include <random>
 
 #include <opencv2/core/core.hpp>
 
@@ -173,6 +174,9 @@ private:
 	// Indices for random selection [0 .. N-1]
 	std::vector<size_t> mvAllIndices;
 
+	// Seeded per solver, so that the samples do not depend on the other threads
+	std::mt19937 mRng;
+
 	// RANSAC probability
 	double mRansacProb;
 
@@ -0,0 +1,81 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include "Dataset.h"
+
+namespace ORB_SLAM2
+{
+
+// Binary container of the inputs of a run (images, depthmaps and timestamps of every Track* call),
+// to reproduce it later (see System::SetReplayMode and Examples/Tools/replay).
+// 8 and 16-bit images are stored as PNG (lossless), other types uncompressed.
+class Recorder
+{
+public:
+
+	using Pointer = std::unique_ptr<Recorder>;
+
+	// sensor: System::Sensor of the recorded system. Returns nullptr if the file cannot be created.
+	static Pointer Create(const std::string& filename, int sensor);
+
+	// Records the input of a Track* call (image2 is the right image or the depthmap, empty for monocular).
+	// The images are copied: encoding and writing run on a background thread, which this call only waits for
+	// when it falls too far behind, so no input is ever skipped.
+	virtual void Write(const cv::Mat& image, const cv::Mat& image2, double timestamp) = 0;
+
+	// Writes the queued frames and closes the file
+	virtual ~Recorder();
+};
+
+// Reads the frames of a recording in order
+class RecordingReader
+{
+public:
+
+	using Pointer = std::unique_ptr<RecordingReader>;
+
+	// Returns nullptr if the file cannot be opened or is not a recording
+	static Pointer Open(const std::string& filename);
+
+	// System::Sensor of the recorded system
+	virtual int GetSensor() const = 0;
+
+	// Next frame. Returns false at the end of the recording or if it is truncated.
+	virtual bool Read(DatasetFrame& frame) = 0;
+
+	virtual ~RecordingReader();
+};
+
+// Saves the per-frame tracking times of a run (timestamp seconds), see Examples/Tools/evaluate_trajectory --times
+void SaveFrameTimes(const std::string& filename, const std::vector<double>& timestamps, const std::vector<double>& times);
+
+} //namespace ORB_SLAM
+
+#endif // RECORDING_H
@@ -0,0 +1,72 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RELOCALIZER_H
+#define RELOCALIZER_H
+
+#include "FrameId.h"
+#include "CameraPose.h"
+
+namespace ORB_SLAM2
+{
+
+class Map;
+class KeyFrame;
+class KeyFrameDatabase;
+class Frame;
+
+// Recovers the camera pose of a frame against the whole map:
+// keyframe database query, BoW matching and PnP RANSAC with every candidate keyframe.
+// Shortly after a loss, the keyframes around the last tracked pose are searched by projection first.
+// The map and the database are only read.
+class Relocalizer
+{
+public:
+
+	Relocalizer(Map* map, const KeyFrameDatabase* keyFrameDB);
+
+	// Sets the pose and the map point matches of the frame if it succeeds
+	bool Relocalize(Frame& currFrame);
+
+	// Last tracked frame and motion model (empty if unknown), used as the prior of the next relocalizations
+	void SetPosePrior(const Frame& frame, const cv::Mat& velocity);
+	void ClearPosePrior();
+
+	frameid_t GetLastRelocFrameId() const;
+
+private:
+
+	// Projection matching with the keyframes around the pose prior
+	bool RelocalizeNearPrior(Frame& currFrame);
+
+	Map* map_;
+	const KeyFrameDatabase* keyFrameDB_;
+	frameid_t lastRelocFrameId_;
+
+	// Pose predicted for the frame after the last tracked one, relative to its reference keyframe
+	CameraPose priorTcr_;
+	KeyFrame* priorKF_;
+	frameid_t priorFrameId_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // RELOCALIZER_H
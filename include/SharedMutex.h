@@ -0,0 +1,108 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SHAREDMUTEX_H
+#define SHAREDMUTEX_H
+
+#include <mutex>
+#include <condition_variable>
+
+namespace ORB_SLAM2
+{
+
+// Writer-preferring reader-writer mutex.
+// Readers do not block each other. Once a writer is waiting, new readers wait behind it,
+// so frequent readers (the tracking, every frame) can not starve the writers.
+// Usable with std::unique_lock (write) and std::shared_lock (read).
+class SharedMutex
+{
+public:
+
+	SharedMutex() : readers_(0), waitingWriters_(0), writer_(false) {}
+
+	void lock()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		waitingWriters_++;
+		writersCond_.wait(lock, [this] { return !writer_ && readers_ == 0; });
+		waitingWriters_--;
+		writer_ = true;
+	}
+
+	bool try_lock()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (writer_ || readers_ > 0)
+			return false;
+		writer_ = true;
+		return true;
+	}
+
+	void unlock()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			writer_ = false;
+		}
+		writersCond_.notify_one();
+		readersCond_.notify_all();
+	}
+
+	void lock_shared()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		readersCond_.wait(lock, [this] { return !writer_ && waitingWriters_ == 0; });
+		readers_++;
+	}
+
+	bool try_lock_shared()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (writer_ || waitingWriters_ > 0)
+			return false;
+		readers_++;
+		return true;
+	}
+
+	void unlock_shared()
+	{
+		bool last = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			last = --readers_ == 0;
+		}
+		if (last)
+			writersCond_.notify_one();
+	}
+
+private:
+
+	std::mutex mutex_;
+	std::condition_variable readersCond_;
+	std::condition_variable writersCond_;
+	int readers_;
+	int waitingWriters_;
+	bool writer_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // SHAREDMUTEX_H
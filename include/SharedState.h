@@ -0,0 +1,132 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+namespace ORB_SLAM2
+{
+
+// Layout of the shared memory written by StatePublisher and read by StateReader.
+// It is a ring of fixed-size message slots with a single writer. Each slot is guarded by a sequence number
+// (odd while the slot is written), so readers never block the writer: they detect and skip the messages
+// that were overwritten before or while they read them.
+// Only plain types are used, so that readers do not depend on the rest of the library.
+namespace SharedState
+{
+
+static const char MAGIC[8] = { 'O', 'R', 'B', 'S', 'T', 'A', 'T', '1' };
+
+// Bytes before the first slot
+static const size_t HEADER_BYTES = 64;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The shared state needs lock-free 64-bit atomics");
+
+enum MessageType : uint32_t
+{
+	POSE = 1,      // PoseMessage of the last frame
+	KEYPOINTS = 2, // KeyPointRecord array: keypoints of the last frame tracked to map points
+	KEYFRAMES = 3, // KeyFrameRecord array: new keyframe, or all the keyframes after a map correction
+	MAPPOINTS = 4, // MapPointRecord array: map points of a new keyframe, or all the map points after a map correction
+	RESET = 5      // The map was reset: everything received before is obsolete
+};
+
+struct Header
+{
+	char magic[8];
+	uint32_t numSlots;
+	uint32_t slotSize; // bytes of a slot, SlotHeader included
+
+	// Number of messages written so far
+	std::atomic<uint64_t> published;
+};
+
+static_assert(sizeof(Header) <= HEADER_BYTES, "Header too large");
+
+struct SlotHeader
+{
+	// 2 * index + 1 while message index is written, 2 * index + 2 once it is complete
+	std::atomic<uint64_t> sequence;
+
+	uint32_t type;
+	uint32_t size; // payload bytes
+
+	uint64_t frameId;
+	double timestamp;
+
+	// Arrays too large for a slot are split into several messages
+	uint32_t part;
+	uint32_t parts;
+};
+
+struct PoseMessage
+{
+	int32_t trackingState; // Tracking::State
+	int32_t valid;         // 0 if the camera was not localized
+	float Tcw[12];         // world to camera, 3x4 row-major
+};
+
+struct KeyPointRecord
+{
+	float u, v;    // undistorted keypoint
+	float X, Y, Z; // map point position
+	uint32_t reserved;
+	uint64_t mappointId;
+};
+
+struct KeyFrameRecord
+{
+	uint64_t id;
+	double timestamp;
+	float Twc[12]; // camera to world, 3x4 row-major
+};
+
+struct MapPointRecord
+{
+	uint64_t id;
+	float X, Y, Z;
+	uint32_t reserved;
+};
+
+inline size_t SharedSize(uint32_t numSlots, uint32_t slotSize)
+{
+	return HEADER_BYTES + static_cast<size_t>(numSlots) * slotSize;
+}
+
+inline SlotHeader* GetSlot(void* base, uint32_t slotSize, size_t slot)
+{
+	return reinterpret_cast<SlotHeader*>(static_cast<char*>(base) + HEADER_BYTES + slot * slotSize);
+}
+
+inline const SlotHeader* GetSlot(const void* base, uint32_t slotSize, size_t slot)
+{
+	return reinterpret_cast<const SlotHeader*>(static_cast<const char*>(base) + HEADER_BYTES + slot * slotSize);
+}
+
+} // namespace SharedState
+
+} //namespace ORB_SLAM
+
+#endif // SHAREDSTATE_H
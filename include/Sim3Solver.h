@@ -23,6 +23,7 @@
 #define SIM3SOLVER_H
 
 #include <vector>
+#include <random>
 
 #include <opencv2/opencv.hpp>
 
@@ -70,6 +71,9 @@ private:
 	// Indices for random selection
 	std::vector<size_t> allIndices_;
 
+	// Seeded per solver, so that the samples do not depend on the other threads
+	std::mt19937 rng_;
+
 	// Projections
 	std::vector<Point2D> points1_;
 	std::vector<Point2D> points2_;
@@ -0,0 +1,71 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef STATEPUBLISHER_H
+#define STATEPUBLISHER_H
+
+#include <string>
+#include <memory>
+
+namespace ORB_SLAM2
+{
+
+class Frame;
+class Map;
+
+// Publishes the tracking output in a shared memory ring buffer for other local processes (see SharedState.h
+// for the layout and StateReader for the consumer side): camera pose, tracked keypoints and map changes.
+// The publisher never waits for the readers.
+class StatePublisher
+{
+public:
+
+	using Pointer = std::unique_ptr<StatePublisher>;
+
+	struct Parameters
+	{
+		// POSIX shared memory object name (e.g. "/orb_slam2"). Empty disables the publisher.
+		std::string name;
+
+		int numSlots;
+		int slotSize;
+
+		Parameters();
+	};
+
+	// Creates the shared memory object. Returns nullptr if it cannot be created (always on platforms other than Linux).
+	static Pointer Create(const Parameters& param);
+
+	// Pose, tracking state and tracked keypoints of the frame
+	virtual void PublishFrame(const Frame& frame, int trackingState) = 0;
+
+	// Map changes: the new reference keyframe of the frame and its map points, or the whole map after a correction
+	// (loop closure, global BA). Call with the map update lock held.
+	virtual void PublishMap(const Map& map, const Frame& frame) = 0;
+
+	virtual void PublishReset() = 0;
+
+	virtual ~StatePublisher();
+};
+
+} //namespace ORB_SLAM
+
+#endif // STATEPUBLISHER_H
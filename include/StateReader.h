@@ -0,0 +1,82 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef STATEREADER_H
+#define STATEREADER_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "SharedState.h"
+
+namespace ORB_SLAM2
+{
+
+// Reads the state published by a system in shared memory (see StatePublisher).
+// It does not depend on the rest of the library: link the ORB_SLAM2_StateReader library only.
+class StateReader
+{
+public:
+
+	using Pointer = std::unique_ptr<StateReader>;
+
+	// A message in the shared memory. The data is not copied: check Valid after using it.
+	struct Message
+	{
+		uint64_t index;
+		uint32_t type;
+		uint32_t size;
+		uint64_t frameId;
+		double timestamp;
+		uint32_t part;
+		uint32_t parts;
+		const void* data;
+
+		// Array messages
+		template <class Record>
+		const Record* Records() const { return static_cast<const Record*>(data); }
+		template <class Record>
+		size_t NumRecords() const { return size / sizeof(Record); }
+	};
+
+	// Opens the shared memory object of the publisher (Publisher.name in the settings file).
+	// Returns nullptr if it does not exist (always on platforms other than Linux).
+	static Pointer Open(const std::string& name);
+
+	// Next message. Returns false if there is none yet.
+	// Messages overwritten before being read are skipped and counted as lost.
+	virtual bool Next(Message& message) = 0;
+
+	// True if the message was not overwritten since Next returned it
+	virtual bool Valid(const Message& message) const = 0;
+
+	// Skips the messages published so far
+	virtual void SeekToEnd() = 0;
+
+	virtual uint64_t GetLost() const = 0;
+
+	virtual ~StateReader();
+};
+
+} //namespace ORB_SLAM
+
+#endif // STATEREADER_H
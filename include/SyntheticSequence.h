@@ -0,0 +1,124 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SYNTHETICSEQUENCE_H
+#define SYNTHETICSEQUENCE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "CameraParameters.h"
+#include "CameraPose.h"
+#include "Dataset.h"
+
+namespace ORB_SLAM2
+{
+
+// Procedural sequence for benchmarks: a camera driving through the streets of a city of textured blocks,
+// rendered on the CPU by ray casting, with exact ground truth.
+// The streets form a grid with intersections (I, J), 0 <= I, J <= blocks. Every route is closed,
+// so each lap revisits the places of the previous one and the start of the route closes a loop.
+// The map grows with the number of blocks; its revisits grow with the number of laps.
+class SyntheticSequence
+{
+public:
+
+	enum Route
+	{
+		LOOP = 0,      // around the city
+		LAWNMOWER = 1, // along the east-west streets, then back to the start
+		RANDOM = 2     // random walk between intersections, then back to the start
+	};
+
+	struct Parameters
+	{
+		// System::Sensor of the rendered images
+		int sensor;
+
+		Route route;
+		int blocks;
+		int laps;
+
+		// Distance travelled per frame (m) and frame rate
+		float speed;
+		float fps;
+
+		// Seed of the random route and of the block heights
+		uint32_t seed;
+
+		// Pinhole rectified camera (no distortion)
+		cv::Size imageSize;
+		CameraParams camera;
+
+		// Number of rendering threads (0: number of cores)
+		int numThreads;
+
+		Parameters();
+	};
+
+	SyntheticSequence(const Parameters& param);
+
+	int Size() const;
+	double Timestamp(int i) const;
+
+	// Ground truth pose of the (left) camera at frame i
+	CameraPose GetPose(int i) const;
+
+	// Renders frame i: grayscale image, plus the right image (stereo) or the depthmap (RGB-D, CV_16U in millimeters)
+	void Render(int i, DatasetFrame& frame) const;
+
+	// Length of the whole route in meters
+	double GetLength() const;
+
+	const Parameters& GetParameters() const;
+
+	// Settings file with the camera calibration and default ORB parameters
+	bool WriteSettings(const std::string& filename) const;
+
+	// Ground truth trajectory of every frame in the TUM RGB-D format (same as System::SaveTrajectoryTUM)
+	bool WriteGroundTruth(const std::string& filename) const;
+
+	// Procedural noise in [0, 1] of the textures: random value at an integer lattice point,
+	// and its smooth interpolation between the lattice points
+	static float Lattice(int x, int y, uint32_t seed);
+	static float ValueNoise(float x, float y, uint32_t seed);
+
+private:
+
+	// Position on the ground plane (x, z) at distance s along the route, and with the corners rounded
+	cv::Point2f RoutePosition(double s) const;
+	cv::Point2f SmoothPosition(double s) const;
+
+	void RenderImage(const CameraPose& Tcw, cv::Mat& image, cv::Mat* depth) const;
+
+	Parameters param_;
+	std::vector<cv::Point2f> waypoints_;
+	std::vector<double> distances_;
+	double lapLength_;
+	int size_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // SYNTHETICSEQUENCE_H
@@ -27,10 +27,16 @@
 
 #include <opencv2/core/core.hpp>
 
+#include "ORBVocabulary.h"
+#include "BackPressure.h"
+#include "TrajectoryWriter.h"
+#include "MemoryStats.h"
+
 namespace ORB_SLAM2
 {
 
 class MapPoint;
+class LocalizationServer;
 
 class System
 {
@@ -40,24 +46,33 @@ public:
 
 	using Pointer = std::unique_ptr<System>;
 	using Path = std::string;
+	using VocabularyPointer = std::shared_ptr<const ORBVocabulary>;
+
+	// Load a vocabulary (text, or binary if the file name ends with ".bin").
+	// The returned vocabulary is read-only and can be shared by several systems.
+	// Returns nullptr if the file could not be loaded.
+	static VocabularyPointer LoadVocabulary(const Path& vocabularyFile);
 
 	// Initialize the SLAM system. It launches the Local Mapping, Loop Closing and Viewer threads.
 	static Pointer Create(const Path& vocabularyFile, const Path& settingsFile, Sensor sensor, bool useViewer = true);
 
+	// Initialize the SLAM system with an already loaded vocabulary.
+	static Pointer Create(const VocabularyPointer& voc, const Path& settingsFile, Sensor sensor, bool useViewer = true);
+
 	// Proccess the given stereo frame. Images must be synchronized and rectified.
 	// Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
-	// Returns the camera pose (empty if tracking fails).
+	// Returns the camera pose (empty if tracking fails or the frame was dropped under overload).
 	virtual cv::Mat TrackStereo(const cv::Mat& imageL, const cv::Mat& imageR, double timestamp) = 0;
 
 	// Process the given rgbd frame. Depthmap must be registered to the RGB frame.
 	// Input image: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
 	// Input depthmap: Float (CV_32F).
-	// Returns the camera pose (empty if tracking fails).
+	// Returns the camera pose (empty if tracking fails or the frame was dropped under overload).
 	virtual cv::Mat TrackRGBD(const cv::Mat& image, const cv::Mat& depth, double timestamp) = 0;
 
 	// Proccess the given monocular frame
 	// Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
-	// Returns the camera pose (empty if tracking fails).
+	// Returns the camera pose (empty if tracking fails or the frame was dropped under overload).
 	virtual cv::Mat TrackMonocular(const cv::Mat& image, double timestamp) = 0;
 
 	// This stops local mapping thread (map building) and performs only camera tracking.
@@ -78,6 +93,11 @@ public:
 	// This function must be called before saving the trajectory.
 	virtual void Shutdown() = 0;
 
+	// Hands the map and the keyframe database over to a localization server,
+	// which shares them with many localization-only trackers.
+	// Call first Shutdown(). The system must not be used afterwards.
+	virtual std::unique_ptr<LocalizationServer> CreateLocalizationServer() = 0;
+
 	// Save camera trajectory in the TUM RGB-D dataset format.
 	// Only for stereo and RGB-D. This method does not work for monocular.
 	// Call first Shutdown()
@@ -96,6 +116,26 @@ public:
 	// See format details at: http://www.cvlibs.net/datasets/kitti/eval_odometry.php
 	virtual void SaveTrajectoryKITTI(const Path &filename) const = 0;
 
+	// Streams the camera trajectory to a file while tracking, to bound the memory of long runs.
+	// Only the last window frames are kept in memory. Older frames are resolved and written in batches,
+	// so their poses do not receive later corrections (loop closures, global BA).
+	// The remaining frames are written by StopTrajectoryStream, Reset and Shutdown.
+	// Frames written to the stream are not saved by the Save* functions.
+	// With several maps (Atlas.maxLostFrames), the stream stays in the frame of the largest map at the first write.
+	// Frames tracked in another map are written as lost, also if that map is merged later.
+	virtual bool StartTrajectoryStream(const Path& filename, TrajectoryWriter::Format format, int window = 1000) = 0;
+	virtual void StopTrajectoryStream() = 0;
+
+	// Records the inputs of the Track* calls (images, depthmaps, timestamps) to reproduce the run with
+	// Examples/Tools/replay. Recording starts at construction if Recorder.file is set in the settings file.
+	virtual bool StartRecording(const Path& filename) = 0;
+	virtual void StopRecording() = 0;
+
+	// Deterministic mode for replaying recordings: after each Track* call, waits until Local Mapping,
+	// Loop Closing and global BA have processed the keyframes it inserted, and disables the latency
+	// budget and the overload policy. Runs on the same input then give the same result.
+	virtual void SetReplayMode(bool flag) = 0;
+
 	// TODO: Save/Load functions
 	// SaveMap(const Path &filename);
 	// LoadMap(const Path &filename);
@@ -106,6 +146,15 @@ public:
 	virtual std::vector<MapPoint*> GetTrackedMapPoints() const = 0;
 	virtual std::vector<cv::KeyPoint> GetTrackedKeyPointsUn() const = 0;
 
+	// Number of frames processed, downgraded, dropped and with keyframe insertion throttled under overload
+	virtual BackPressure::Counters GetBackPressureCounters() const = 0;
+
+	// Memory held by the map (erased keyframes and map points included), the keyframe database,
+	// the vocabulary and the trajectory kept by the tracking. Call it from the thread calling Track*,
+	// never concurrently with Reset(): the reset deletes the keyframes and map points it walks.
+	// It is also printed every Memory.logInterval seconds of input if set in the settings file.
+	virtual MemoryStats GetMemoryStats() const = 0;
+
 	// Load new settings
 	// The focal lenght should be similar or scale prediction will fail when projecting points
 	// TODO: Modify MapPoint::PredictScale to take into account focal lenght
@@ -0,0 +1,94 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef THREADPARAMS_H
+#define THREADPARAMS_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+
+#include <opencv2/core.hpp>
+
+namespace ORB_SLAM2
+{
+
+// Threads of the system that can be configured from the settings file
+enum ThreadRole
+{
+	TRACKING_THREAD = 0,    // thread calling System::Track*
+	EXTRACTOR_THREAD = 1,   // stereo ORB extraction workers
+	LOCAL_MAPPING_THREAD = 2,
+	LOOP_CLOSING_THREAD = 3,
+	GLOBAL_BA_THREAD = 4,
+	VIEWER_THREAD = 5,
+	NUM_THREAD_ROLES
+};
+
+// Scheduling of a thread: name (shown by top, perf, gdb...), CPU affinity, nice level and real-time priority
+struct ThreadParams
+{
+	std::string name;
+
+	// False for a thread the library does not own (the one calling System::Track*): its name is left unchanged
+	bool setName;
+
+	// CPUs the thread may run on (empty: any)
+	std::vector<int> cpus;
+
+	// Nice level (-20 to 19), applied if setNice is true
+	bool setNice;
+	int nice;
+
+	// SCHED_FIFO priority (1 to 99), 0 keeps the default scheduler
+	int fifoPriority;
+
+	ThreadParams(const std::string& name = "");
+};
+
+// Reads the parameters of the thread from the settings file:
+//   Threads.cpus: "0-3"                 CPUs shared by all the threads without their own list
+//   Threads.<Role>.cpus: "2,3"          (Role: Tracking, Extractor, LocalMapping, LoopClosing, GlobalBA, Viewer)
+//   Threads.<Role>.nice: -5
+//   Threads.<Role>.fifoPriority: 10
+// The tracking thread is the caller's: only the Threads.Tracking keys apply to it, and it is not renamed.
+ThreadParams ReadThreadParams(const cv::FileStorage& settings, ThreadRole role);
+
+// Applies the parameters to the calling thread. Failures (e.g. missing privileges for SCHED_FIFO) are reported
+// and leave the thread with its previous settings.
+void ApplyThreadParams(const ThreadParams& params);
+
+// Launches a thread that applies the parameters before running the function
+template <class Function, class... Args>
+std::thread LaunchThread(const ThreadParams& params, Function&& f, Args&&... args)
+{
+	auto task = std::bind(std::forward<Function>(f), std::forward<Args>(args)...);
+	return std::thread([params, task]() mutable
+	{
+		ApplyThreadParams(params);
+		task();
+	});
+}
+
+} //namespace ORB_SLAM
+
+#endif // THREADPARAMS_H
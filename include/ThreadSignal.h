@@ -19,16 +19,43 @@
 */
 
 
-#ifndef USLEEP_H
-#define USLEEP_H
+#ifndef THREADSIGNAL_H
+#define THREADSIGNAL_H
 
-#include <cstdint>
+#include <mutex>
+#include <condition_variable>
 
 namespace ORB_SLAM2
 {
 
-void usleep(int64_t usec);
+// Wakes up the threads waiting for a condition on state guarded by other mutexes.
+// The condition is evaluated with the signal mutex held, so a Notify() issued after
+// the state has changed can not be missed. Notify() must be called once the mutexes
+// guarding the state have been released, since the condition takes them.
+class ThreadSignal
+{
+public:
+
+	void Notify()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cond_.notify_all();
+	}
+
+	// Blocks until the condition holds
+	template <class Predicate>
+	void Wait(Predicate condition)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cond_.wait(lock, condition);
+	}
+
+private:
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+};
 
-}
+} //namespace ORB_SLAM
 
-#endif // USLEEP_H
+#endif // THREADSIGNAL_H
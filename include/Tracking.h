@@ -23,6 +23,7 @@
 #define TRACKING_H
 
 #include <memory>
+#include <deque>
 
 #include <opencv2/opencv.hpp>
 
@@ -49,7 +50,7 @@ struct TrackPoint
 	TrackPoint(const Frame& frame, bool lost);
 };
 
-using Trajectory = std::vector<TrackPoint>;
+using Trajectory = std::deque<TrackPoint>;
 
 class Tracking
 {
@@ -79,10 +80,15 @@ public:
 		// and inserted from just one frame. Far points requiere a match in two keyframes.
 		float thDepth;
 
+		// Frames tracking may stay lost (trying to relocalize) before a new map is started in the atlas.
+		// Zero disables the atlas: the map is reset if tracking is lost soon after initialization,
+		// otherwise the system tries to relocalize until it succeeds.
+		int maxLostFrames;
+
 		Parameters(int minFrames, int maxFrames, float thDepth);
 	};
 
-	static Pointer Create(System* system, ORBVocabulary* voc, Map* map, KeyFrameDatabase* keyframeDB,
+	static Pointer Create(System* system, const ORBVocabulary* voc, Map* map, KeyFrameDatabase* keyframeDB,
 		int sensor, const Parameters& param);
 
 	virtual cv::Mat Update(Frame& currFrame) = 0;
@@ -92,9 +98,19 @@ public:
 	// Use this function if you have deactivated local mapping and you only want to localize the camera.
 	virtual void InformOnlyTracking(bool flag) = 0;
 
+	// Overload handling: track the next frames with the motion model only (no local map search),
+	// and/or insert keyframes only when tracking is weak.
+	virtual void SetMotionOnly(bool flag) = 0;
+	virtual void SetThrottleKeyFrames(bool flag) = 0;
+
 	virtual void Reset() = 0;
 
+	// Limits the size of the local map and scales the search radius used to match it.
+	// Used to shed work when frames run late.
+	virtual void SetLocalMapBudget(int maxLocalKeyFrames, float searchRadiusScale) = 0;
+
 	virtual int GetState() const = 0;
+	virtual int GetNumInliers() const = 0;
 	virtual int GetLastProcessedState() const = 0;
 
 	virtual const Frame& GetInitialFrame() const = 0;
@@ -105,6 +121,10 @@ public:
 	// Basically we store the reference keyframe for each frame and its relative transformation
 	virtual const Trajectory& GetTrajectory() const = 0;
 
+	// Moves the oldest points out of the trajectory, keeping the last maxSize ones (at least one).
+	// Used to bound the memory of long runs once the removed points are written out.
+	virtual void TrimTrajectory(size_t maxSize, Trajectory& removed) = 0;
+
 	// True if local mapping is deactivated and we are performing only localization
 	virtual bool OnlyTracking() const = 0;
 
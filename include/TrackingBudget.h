@@ -0,0 +1,87 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACKINGBUDGET_H
+#define TRACKINGBUDGET_H
+
+namespace ORB_SLAM2
+{
+
+// Per-frame latency budget controller.
+// It sheds work from feature extraction (number of features, active pyramid levels) and from
+// local map tracking (number of local keyframes, search radius) when frames run late,
+// and restores it when there is headroom or when the number of tracked inliers gets close to failure.
+class TrackingBudget
+{
+public:
+
+	struct Parameters
+	{
+		// Target time per frame in milliseconds. Zero disables the controller.
+		float budgetMs;
+
+		int maxFeatures;
+		int minFeatures;
+		int maxLevels;
+		int minLevels;
+		int maxLocalKeyFrames;
+		int minLocalKeyFrames;
+		float minSearchRadiusScale;
+
+		// Below this number of inliers the quality is raised even if the frame runs late
+		int safeInliers;
+
+		Parameters();
+	};
+
+	// Values to apply to the extractor and the tracker for the next frame
+	struct Settings
+	{
+		int nfeatures;
+		int nlevels;
+		int maxLocalKeyFrames;
+		float searchRadiusScale;
+	};
+
+	TrackingBudget(const Parameters& param);
+
+	bool Enabled() const;
+
+	// Feeds the stage timings of the last frame and the number of inliers it tracked
+	void Update(double extractionMs, double trackingMs, int inliers, bool lost);
+
+	// Restores the full quality
+	void Reset();
+
+	const Settings& GetSettings() const;
+
+private:
+
+	void UpdateSettings();
+
+	Parameters param_;
+	float extractionQuality_;
+	float trackingQuality_;
+	Settings settings_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // TRACKINGBUDGET_H
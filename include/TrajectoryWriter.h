@@ -0,0 +1,92 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TRAJECTORYWRITER_H
+#define TRAJECTORYWRITER_H
+
+#include <string>
+#include <fstream>
+#include <unordered_map>
+
+#include "CameraPose.h"
+
+namespace ORB_SLAM2
+{
+
+class KeyFrame;
+struct TrackPoint;
+
+// Writes camera poses to a trajectory file
+class TrajectoryWriter
+{
+public:
+
+	enum Format
+	{
+		TUM = 0,   // text: timestamp tx ty tz qx qy qz qw (lost frames are skipped)
+		KITTI = 1, // text: 3x4 camera-to-world matrix, row-major (one line per frame)
+		BINARY = 2 // "ORBTRAJ1", then per frame: timestamp (float64), t (3 x float32), q (4 x float32), lost (uint8)
+	};
+
+	// Creates (truncates) the file. Check IsOpen.
+	TrajectoryWriter(const std::string& filename, Format format);
+
+	bool IsOpen() const;
+
+	// Writes the pose (world to camera) of a frame
+	void Write(double timestamp, const CameraPose& Tcw, bool lost);
+
+	void Flush();
+
+private:
+
+	std::ofstream ofs_;
+	Format format_;
+};
+
+// Resolves the poses of tracked frames. A frame pose is stored relative to its reference keyframe, which may
+// have been culled since. Culled keyframes are replaced by their first ancestor in the spanning tree that was not,
+// and the chains found are cached, so that resolving a whole trajectory takes linear time.
+class TrajectoryResolver
+{
+public:
+
+	// World to camera pose of the frame
+	CameraPose Resolve(const TrackPoint& track);
+
+	// Must be called when the keyframes are deleted
+	void Clear();
+
+private:
+
+	// Pose of a culled keyframe relative to an ancestor (valid while the ancestor is not culled)
+	struct Link
+	{
+		const KeyFrame* ancestor;
+		CameraPose Tka;
+	};
+
+	std::unordered_map<const KeyFrame*, Link> links_;
+};
+
+} //namespace ORB_SLAM
+
+#endif // TRAJECTORYWRITER_H
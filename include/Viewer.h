@@ -29,6 +29,7 @@
 #include <memory>
 
 #include "Frame.h"
+#include "ThreadSignal.h"
 
 namespace ORB_SLAM2
 {
@@ -53,6 +54,8 @@ public:
 	void RequestStop();
 	bool isFinished() const;
 	bool isStopped() const;
+	// Blocks until the viewer has effectively stopped (or finished) after RequestStop()
+	void WaitUntilStopped();
 	void Release();
 
 	void SetCurrentCameraPose(const cv::Mat& Tcw);
@@ -79,6 +82,9 @@ private:
 
 	mutable std::mutex mutexFinish_;
 	mutable std::mutex mutexStop_;
+
+	// Wakes up the viewer thread and the threads waiting for it to stop
+	ThreadSignal signal_;
 };
 
 }
@@ -0,0 +1,116 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "BackPressure.h"
+
+#include <chrono>
+
+namespace ORB_SLAM2
+{
+
+static double NowSec()
+{
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::duration<double>>(now).count();
+}
+
+BackPressure::BackPressure(const Parameters& param) : param_(param), throttle_(false)
+{
+	Reset();
+}
+
+bool BackPressure::Enabled() const
+{
+	return param_.downgradeLagMs > 0 || param_.dropLagMs > 0 || param_.maxMappingQueue > 0 || param_.maxLoopQueue > 0;
+}
+
+BackPressure::Decision BackPressure::Update(double timestamp, int mappingQueue, int loopQueue, bool trackingOK)
+{
+	// The smallest delay seen so far is taken as the processing delay of a system keeping up with the input
+	const double delay = NowSec() - timestamp;
+	if (!hasOffset_ || delay < offset_)
+	{
+		offset_ = delay;
+		hasOffset_ = true;
+	}
+	lagMs_ = 1000 * (delay - offset_);
+
+	const bool lagging = param_.downgradeLagMs > 0 && lagMs_ > param_.downgradeLagMs;
+	throttle_ = lagging ||
+		(param_.maxMappingQueue > 0 && mappingQueue >= param_.maxMappingQueue) ||
+		(param_.maxLoopQueue > 0 && loopQueue >= param_.maxLoopQueue);
+	if (throttle_)
+		counters_.throttled++;
+
+	Decision decision = PROCESS;
+	if (trackingOK)
+	{
+		if (param_.dropLagMs > 0 && lagMs_ > param_.dropLagMs && consecutiveDrops_ < param_.maxConsecutiveDrops)
+			decision = DROP;
+		else if (lagging && consecutiveDowngrades_ < param_.maxConsecutiveDowngrades)
+			decision = DOWNGRADE;
+	}
+
+	consecutiveDrops_ = decision == DROP ? consecutiveDrops_ + 1 : 0;
+	consecutiveDowngrades_ = decision == DOWNGRADE ? consecutiveDowngrades_ + 1 : 0;
+
+	switch (decision)
+	{
+	case PROCESS: counters_.processed++; break;
+	case DOWNGRADE: counters_.downgraded++; break;
+	case DROP: counters_.dropped++; break;
+	}
+
+	return decision;
+}
+
+bool BackPressure::ThrottleKeyFrames() const
+{
+	return throttle_;
+}
+
+double BackPressure::GetLagMs() const
+{
+	return lagMs_;
+}
+
+void BackPressure::Reset()
+{
+	hasOffset_ = false;
+	offset_ = 0;
+	lagMs_ = 0;
+	throttle_ = false;
+	consecutiveDowngrades_ = 0;
+	consecutiveDrops_ = 0;
+}
+
+const BackPressure::Counters& BackPressure::GetCounters() const
+{
+	return counters_;
+}
+
+BackPressure::Parameters::Parameters()
+	: downgradeLagMs(0.f), dropLagMs(0.f), maxConsecutiveDowngrades(5), maxConsecutiveDrops(2),
+	maxMappingQueue(0), maxLoopQueue(0) {}
+
+BackPressure::Counters::Counters() : processed(0), downgraded(0), dropped(0), throttled(0) {}
+
+} //namespace ORB_SLAM
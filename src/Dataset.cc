@@ -0,0 +1,662 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Dataset.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+
+#include <opencv2/opencv.hpp>
+
+#include "ThreadParams.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace ORB_SLAM2
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Dataset
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::ifstream OpenList(const std::string& path)
+{
+	std::ifstream ifs(path);
+	if (ifs.fail())
+		std::cerr << "Failed to open " << path << std::endl;
+	return ifs;
+}
+
+Dataset Dataset::TUM(const std::string& sequencePath)
+{
+	Dataset dataset;
+	std::ifstream ifs = OpenList(sequencePath + "/rgb.txt");
+
+	std::string line, filename;
+	double timestamp;
+	while (std::getline(ifs, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::stringstream ss(line);
+		if (!(ss >> timestamp >> filename))
+			continue;
+		dataset.timestamps_.push_back(timestamp);
+		dataset.filenames_[0].push_back(sequencePath + "/" + filename);
+	}
+	return dataset;
+}
+
+Dataset Dataset::TUMRGBD(const std::string& sequencePath, const std::string& associationFile)
+{
+	Dataset dataset;
+	std::ifstream ifs = OpenList(associationFile);
+
+	std::string line, filename1, filename2;
+	double stamp1, stamp2;
+	while (std::getline(ifs, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::stringstream ss(line);
+		if (!(ss >> stamp1 >> filename1 >> stamp2 >> filename2))
+			continue;
+		dataset.timestamps_.push_back(stamp1);
+		dataset.filenames_[0].push_back(sequencePath + "/" + filename1);
+		dataset.filenames_[1].push_back(sequencePath + "/" + filename2);
+	}
+	return dataset;
+}
+
+Dataset Dataset::EuRoC(const std::string& leftPath, const std::string& rightPath, const std::string& timesFile)
+{
+	Dataset dataset;
+	std::ifstream ifs = OpenList(timesFile);
+
+	std::string line, name;
+	while (std::getline(ifs, line))
+	{
+		std::stringstream ss(line);
+		if (!(ss >> name))
+			continue;
+		dataset.timestamps_.push_back(1e-9 * std::stod(name));
+		dataset.filenames_[0].push_back(leftPath + "/" + name + ".png");
+		if (!rightPath.empty())
+			dataset.filenames_[1].push_back(rightPath + "/" + name + ".png");
+	}
+	return dataset;
+}
+
+Dataset Dataset::KITTI(const std::string& sequencePath, bool stereo)
+{
+	Dataset dataset;
+	std::ifstream ifs = OpenList(sequencePath + "/times.txt");
+
+	double timestamp;
+	while (ifs >> timestamp)
+		dataset.timestamps_.push_back(timestamp);
+
+	for (size_t i = 0; i < dataset.timestamps_.size(); i++)
+	{
+		std::stringstream ss;
+		ss << std::setfill('0') << std::setw(6) << i << ".png";
+		dataset.filenames_[0].push_back(sequencePath + "/image_0/" + ss.str());
+		if (stereo)
+			dataset.filenames_[1].push_back(sequencePath + "/image_1/" + ss.str());
+	}
+	return dataset;
+}
+
+int Dataset::Size() const
+{
+	return static_cast<int>(timestamps_.size());
+}
+
+bool Dataset::Empty() const
+{
+	return timestamps_.empty();
+}
+
+double Dataset::Timestamp(int i) const
+{
+	return timestamps_[i];
+}
+
+const std::string& Dataset::Filename(int i, int image) const
+{
+	static const std::string none;
+	return filenames_[image].empty() ? none : filenames_[image][i];
+}
+
+bool Dataset::Read(int i, DatasetFrame& frame) const
+{
+	frame.timestamp = timestamps_[i];
+	frame.image = cv::imread(filenames_[0][i], cv::IMREAD_UNCHANGED);
+	frame.image2 = filenames_[1].empty() ? cv::Mat() : cv::imread(filenames_[1][i], cv::IMREAD_UNCHANGED);
+	return !frame.image.empty() && (filenames_[1].empty() || !frame.image2.empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Prefetching reader
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class AsyncReader : public DatasetReader
+{
+public:
+
+	AsyncReader(const Dataset& dataset, const Parameters& param)
+		: dataset_(dataset), transform_(param.transform), slots_(std::max(param.queueSize, 1)),
+		nextDecode_(0), nextRead_(0), stop_(false)
+	{
+		const int numThreads = std::max(param.numThreads, 1);
+		for (int i = 0; i < numThreads; i++)
+			workers_.push_back(LaunchThread(ThreadParams("orb-reader"), &AsyncReader::Decode, this));
+	}
+
+	~AsyncReader()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		cond_.notify_all();
+		for (std::thread& worker : workers_)
+			worker.join();
+	}
+
+	bool Read(DatasetFrame& frame) override
+	{
+		if (nextRead_ >= dataset_.Size())
+			return false;
+
+		bool ok;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			Slot& slot = slots_[nextRead_ % slots_.size()];
+			cond_.wait(lock, [&] { return slot.ready; });
+
+			frame = std::move(slot.frame);
+			ok = slot.ok;
+			slot.ready = false;
+			nextRead_++;
+		}
+		cond_.notify_all();
+
+		if (!ok)
+		{
+			const int i = nextRead_ - 1;
+			std::cerr << std::endl << "Failed to load image at: " << dataset_.Filename(i, 0) << std::endl;
+		}
+		return ok;
+	}
+
+	int Position() const override
+	{
+		return nextRead_;
+	}
+
+private:
+
+	struct Slot
+	{
+		DatasetFrame frame;
+		bool ready = false;
+		bool ok = false;
+	};
+
+	void Decode()
+	{
+		const int nframes = dataset_.Size();
+		const int queueSize = static_cast<int>(slots_.size());
+		for (;;)
+		{
+			int i;
+			{
+				// A frame is decoded once the one that used its slot has been read
+				std::unique_lock<std::mutex> lock(mutex_);
+				cond_.wait(lock, [&] { return stop_ || nextDecode_ >= nframes || nextDecode_ < nextRead_ + queueSize; });
+				if (stop_ || nextDecode_ >= nframes)
+					return;
+				i = nextDecode_++;
+			}
+
+			DatasetFrame frame;
+			const bool ok = dataset_.Read(i, frame);
+			if (ok && transform_)
+				transform_(frame);
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				Slot& slot = slots_[i % queueSize];
+				slot.frame = std::move(frame);
+				slot.ok = ok;
+				slot.ready = true;
+			}
+			cond_.notify_all();
+		}
+	}
+
+	const Dataset dataset_;
+	const Transform transform_;
+
+	std::vector<Slot> slots_;
+	int nextDecode_;
+	int nextRead_;
+	bool stop_;
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::vector<std::thread> workers_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache file
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Layout: header, one entry per frame, then the image data (rows stored contiguously, 64-byte aligned)
+static const char CACHE_MAGIC[8] = { 'O', 'R', 'B', 'C', 'A', 'C', 'H', '2' };
+static const uint64_t CACHE_ALIGNMENT = 64;
+
+struct CacheHeader
+{
+	char magic[8];
+	uint64_t nframes;
+
+	// Hash of the image files, timestamps and transform settings the cache was built from
+	uint64_t key;
+};
+
+// FNV-1a
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+}
+
+static void HashString(uint64_t& hash, const std::string& str)
+{
+	const uint64_t size = str.size();
+	HashBytes(hash, &size, sizeof(size));
+	HashBytes(hash, str.data(), str.size());
+}
+
+// Size and modification time of a file (size only where stat is not available), nothing if it is missing
+static void HashFileStamp(uint64_t& hash, const std::string& path)
+{
+	if (path.empty())
+		return;
+#ifdef USE_MMAP
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return;
+	const int64_t stamp[2] = { static_cast<int64_t>(st.st_size), static_cast<int64_t>(st.st_mtime) };
+#else
+	std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+	if (!ifs)
+		return;
+	const int64_t stamp[1] = { static_cast<int64_t>(ifs.tellg()) };
+#endif
+	HashBytes(hash, stamp, sizeof(stamp));
+}
+
+// Identifies the inputs of the cache. The image files are identified by their paths, sizes and modification times.
+static uint64_t CacheKey(const Dataset& dataset, const DatasetReader::Parameters& param)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (int i = 0; i < dataset.Size(); i++)
+	{
+		const double timestamp = dataset.Timestamp(i);
+		HashBytes(hash, &timestamp, sizeof(timestamp));
+		HashString(hash, dataset.Filename(i, 0));
+		HashString(hash, dataset.Filename(i, 1));
+		HashFileStamp(hash, dataset.Filename(i, 0));
+		HashFileStamp(hash, dataset.Filename(i, 1));
+	}
+
+	const char transform = param.transform ? 1 : 0;
+	HashBytes(hash, &transform, sizeof(transform));
+	if (!param.transformSettings.empty())
+	{
+		std::ifstream ifs(param.transformSettings, std::ios::binary);
+		std::stringstream contents;
+		contents << ifs.rdbuf();
+		HashString(hash, contents.str());
+	}
+	return hash;
+}
+
+struct CacheImage
+{
+	uint64_t offset;
+	int32_t rows;
+	int32_t cols;
+	int32_t type;
+	int32_t reserved;
+};
+
+struct CacheEntry
+{
+	double timestamp;
+	CacheImage images[2];
+};
+
+static size_t ImageBytes(const CacheImage& image)
+{
+	return static_cast<size_t>(image.rows) * image.cols * CV_ELEM_SIZE(image.type);
+}
+
+static bool WriteImage(std::ofstream& ofs, const cv::Mat& mat, CacheImage& image)
+{
+	std::memset(&image, 0, sizeof(image));
+	if (mat.empty())
+		return true;
+
+	const uint64_t pos = static_cast<uint64_t>(ofs.tellp());
+	const uint64_t offset = (pos + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+	const char zeros[CACHE_ALIGNMENT] = {};
+	ofs.write(zeros, offset - pos);
+
+	image.offset = offset;
+	image.rows = mat.rows;
+	image.cols = mat.cols;
+	image.type = mat.type();
+
+	const size_t rowBytes = mat.cols * mat.elemSize();
+	for (int y = 0; y < mat.rows; y++)
+		ofs.write(reinterpret_cast<const char*>(mat.ptr(y)), rowBytes);
+	return ofs.good();
+}
+
+// Decodes the sequence with a prefetching reader and writes it to the cache file
+static bool BuildCache(const Dataset& dataset, const DatasetReader::Parameters& param, uint64_t key)
+{
+	std::cout << "Building dataset cache " << param.cacheFile << " ..." << std::endl;
+
+	const std::string tmpFile = param.cacheFile + ".tmp";
+	std::ofstream ofs(tmpFile, std::ios::binary);
+	if (!ofs)
+	{
+		std::cerr << "Failed to create " << tmpFile << std::endl;
+		return false;
+	}
+
+	CacheHeader header;
+	std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.nframes = dataset.Size();
+	header.key = key;
+	std::vector<CacheEntry> entries(dataset.Size());
+
+	// The entries are written once the image offsets are known
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(CacheEntry));
+
+	DatasetReader::Parameters readerParam = param;
+	readerParam.cacheFile.clear();
+	AsyncReader reader(dataset, readerParam);
+
+	bool ok = true;
+	DatasetFrame frame;
+	for (CacheEntry& entry : entries)
+	{
+		ok = reader.Read(frame) && WriteImage(ofs, frame.image, entry.images[0]) && WriteImage(ofs, frame.image2, entry.images[1]);
+		if (!ok)
+			break;
+		entry.timestamp = frame.timestamp;
+	}
+
+	if (ok)
+	{
+		ofs.seekp(sizeof(header));
+		ofs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(CacheEntry));
+		ok = ofs.good();
+	}
+	ofs.close();
+
+	if (!ok || std::rename(tmpFile.c_str(), param.cacheFile.c_str()) != 0)
+	{
+		std::cerr << "Failed to write the dataset cache " << param.cacheFile << std::endl;
+		std::remove(tmpFile.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Read-only view of a file. Pages are copied on write, so the images can be modified in place.
+class MappedFile
+{
+public:
+
+	MappedFile() : data_(nullptr), size_(0) {}
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef USE_MMAP
+
+	bool Open(const std::string& path)
+	{
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		void* data = MAP_FAILED;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+			data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		// Frames are read in order: let the kernel read ahead
+		madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+		data_ = static_cast<char*>(data);
+		size_ = st.st_size;
+		return true;
+	}
+
+	void Close()
+	{
+		if (data_)
+			munmap(data_, size_);
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+#else
+
+	bool Open(const std::string& path)
+	{
+		std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+		if (!ifs)
+			return false;
+		buffer_.resize(static_cast<size_t>(ifs.tellg()));
+		ifs.seekg(0);
+		if (!ifs.read(buffer_.data(), buffer_.size()))
+			return false;
+		data_ = buffer_.data();
+		size_ = buffer_.size();
+		return true;
+	}
+
+	void Close()
+	{
+		buffer_.clear();
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+#endif
+
+	char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+
+private:
+
+	char* data_;
+	size_t size_;
+#ifndef USE_MMAP
+	std::vector<char> buffer_;
+#endif
+};
+
+class CacheReader : public DatasetReader
+{
+public:
+
+	CacheReader() : entries_(nullptr), nframes_(0), next_(0) {}
+
+	// Maps the cache file. Returns false if it is missing or does not match the dataset.
+	bool Open(const std::string& path, const Dataset& dataset, uint64_t key)
+	{
+		if (!file_.Open(path))
+			return false;
+
+		if (file_.Size() < sizeof(CacheHeader))
+			return false;
+
+		const CacheHeader* header = reinterpret_cast<const CacheHeader*>(file_.Data());
+		if (std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+			header->nframes != static_cast<uint64_t>(dataset.Size()) || header->key != key ||
+			file_.Size() < sizeof(CacheHeader) + header->nframes * sizeof(CacheEntry))
+			return false;
+
+		entries_ = reinterpret_cast<const CacheEntry*>(file_.Data() + sizeof(CacheHeader));
+		nframes_ = dataset.Size();
+
+		for (int i = 0; i < nframes_; i++)
+			for (const CacheImage& image : entries_[i].images)
+				if (image.offset + ImageBytes(image) > file_.Size())
+					return false;
+		return true;
+	}
+
+	bool Read(DatasetFrame& frame) override
+	{
+		if (next_ >= nframes_)
+			return false;
+
+		const CacheEntry& entry = entries_[next_++];
+		frame.timestamp = entry.timestamp;
+		frame.image = GetImage(entry.images[0]);
+		frame.image2 = GetImage(entry.images[1]);
+		return true;
+	}
+
+	int Position() const override
+	{
+		return next_;
+	}
+
+private:
+
+	cv::Mat GetImage(const CacheImage& image) const
+	{
+		if (image.rows == 0)
+			return cv::Mat();
+		return cv::Mat(image.rows, image.cols, image.type, file_.Data() + image.offset);
+	}
+
+	MappedFile file_;
+	const CacheEntry* entries_;
+	int nframes_;
+	int next_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// DatasetReader
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static DatasetReader::Pointer OpenCache(const Dataset& dataset, const std::string& cacheFile, uint64_t key)
+{
+	auto reader = std::make_unique<CacheReader>();
+	if (!reader->Open(cacheFile, dataset, key))
+		return nullptr;
+	std::cout << "Reading decoded frames from " << cacheFile << std::endl;
+	return std::move(reader);
+}
+
+DatasetReader::Pointer DatasetReader::Create(const Dataset& dataset, const Parameters& param)
+{
+	if (!param.cacheFile.empty())
+	{
+		const uint64_t key = CacheKey(dataset, param);
+		DatasetReader::Pointer reader = OpenCache(dataset, param.cacheFile, key);
+		if (!reader && BuildCache(dataset, param, key))
+			reader = OpenCache(dataset, param.cacheFile, key);
+		if (reader)
+			return reader;
+		std::cerr << "Dataset cache " << param.cacheFile << " is not usable, decoding images instead" << std::endl;
+	}
+	return std::make_unique<AsyncReader>(dataset, param);
+}
+
+DatasetReader::~DatasetReader() {}
+
+DatasetReader::Parameters::Parameters() : queueSize(8), numThreads(2) {}
+
+DatasetReader::Parameters ReadDatasetOptions(int& argc, char** argv)
+{
+	DatasetReader::Parameters param;
+
+	auto matches = [](const std::string& arg, const std::string& option, std::string& value)
+	{
+		if (arg.compare(0, option.size(), option) != 0)
+			return false;
+		value = arg.substr(option.size());
+		return true;
+	};
+
+	int nargs = 0;
+	for (int i = 0; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		std::string value;
+		if (i > 0 && matches(arg, "--prefetch=", value))
+			param.queueSize = std::stoi(value);
+		else if (i > 0 && matches(arg, "--threads=", value))
+			param.numThreads = std::stoi(value);
+		else if (i > 0 && matches(arg, "--cache=", value))
+			param.cacheFile = value;
+		else
+			argv[nargs++] = argv[i];
+	}
+	argc = nargs;
+	return param;
+}
+
+} //namespace ORB_SLAM
@@ -22,13 +22,11 @@
 
 #include "MapPoint.h"
 #include "KeyFrame.h"
-#include "Converter.h"
+#include "MemoryStats.h"
 
 namespace ORB_SLAM2
 {
 
-frameid_t Frame::nextId = 0;
-
 static inline int Round(float v) { return static_cast<int>(std::round(v)); }
 static inline int RoundUp(float v) { return static_cast<int>(std::ceil(v)); }
 static inline int RoundDn(float v) { return static_cast<int>(std::floor(v)); }
@@ -144,6 +142,15 @@ std::vector<size_t> FeaturesGrid::GetFeaturesInArea(float x, float y, float r, i
 	return indices;
 }
 
+size_t FeaturesGrid::GetMemoryUsage() const
+{
+	size_t bytes = sizeof(*this) + HeapBytes(keypoints_);
+	for (unsigned int i = 0; i < COLS; i++)
+		for (unsigned int j = 0; j < ROWS; j++)
+			bytes += HeapBytes(grid_[i][j]);
+	return bytes;
+}
+
 Frame::Frame() {}
 
 //Copy Constructor
@@ -158,15 +165,12 @@ Frame::Frame(const Frame& frame)
 		SetPose(frame.pose);
 }
 
-Frame::Frame(ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
+Frame::Frame(frameid_t id, const ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
 	const KeyPoints& keypointsUn, const std::vector<float>& uright, const std::vector<float>& depth,
 	const cv::Mat& descriptors, const ScalePyramidInfo& pyramid, const ImageBounds& imageBounds)
 	: voc(voc), timestamp(timestamp), camera(camera), keypoints(keypoints), keypointsUn(keypointsUn), uright(uright),
-	depth(depth), descriptors(descriptors.clone()), referenceKF(nullptr), pyramid(pyramid), imageBounds(imageBounds)
+	depth(depth), descriptors(descriptors.clone()), id(id), referenceKF(nullptr), pyramid(pyramid), imageBounds(imageBounds)
 {
-	// Frame ID
-	id = nextId++;
-
 	N = static_cast<int>(keypoints.size());
 
 	mappoints.assign(N, nullptr);
@@ -175,14 +179,11 @@ Frame::Frame(ORBVocabulary* voc, double timestamp, const CameraParams& camera, c
 	grid.AssignFeatures(keypointsUn, imageBounds, pyramid.nlevels);
 }
 
-Frame::Frame(ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
+Frame::Frame(frameid_t id, const ORBVocabulary* voc, double timestamp, const CameraParams& camera, const KeyPoints& keypoints,
 	const KeyPoints& keypointsUn, const cv::Mat& descriptors, const ScalePyramidInfo& pyramid, const ImageBounds& imageBounds)
 	: voc(voc), timestamp(timestamp), camera(camera), keypoints(keypoints), keypointsUn(keypointsUn),
-	descriptors(descriptors.clone()), referenceKF(nullptr), pyramid(pyramid), imageBounds(imageBounds)
+	descriptors(descriptors.clone()), id(id), referenceKF(nullptr), pyramid(pyramid), imageBounds(imageBounds)
 {
-	// Frame ID
-	id = nextId++;
-
 	N = static_cast<int>(keypoints.size());
 
 	// Set no stereo information
@@ -210,7 +211,7 @@ void Frame::ComputeBoW()
 	if (!bowVector.empty())
 		return;
 
-	voc->transform(Converter::toDescriptorVector(descriptors), bowVector, featureVector, 4);
+	voc->transform(descriptors, bowVector, featureVector, 4);
 }
 
 std::vector<size_t> Frame::GetFeaturesInArea(float x, float y, float r, int minLevel, int maxLevel) const
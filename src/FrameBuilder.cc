@@ -0,0 +1,300 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "FrameBuilder.h"
+
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+#include "System.h"
+#include "ORBmatcher.h"
+
+namespace ORB_SLAM2
+{
+
+static CameraParams ReadCameraParams(const cv::FileStorage& fs)
+{
+	CameraParams param;
+	param.fx = fs["Camera.fx"];
+	param.fy = fs["Camera.fy"];
+	param.cx = fs["Camera.cx"];
+	param.cy = fs["Camera.cy"];
+	param.bf = fs["Camera.bf"];
+	param.baseline = param.bf / param.fx;
+	return param;
+}
+
+static cv::Mat1f ReadDistCoeffs(const cv::FileStorage& fs)
+{
+	const float k1 = fs["Camera.k1"];
+	const float k2 = fs["Camera.k2"];
+	const float p1 = fs["Camera.p1"];
+	const float p2 = fs["Camera.p2"];
+	const float k3 = fs["Camera.k3"];
+	cv::Mat1f distCoeffs = k3 == 0 ? (cv::Mat1f(4, 1) << k1, k2, p1, p2) : (cv::Mat1f(5, 1) << k1, k2, p1, p2, k3);
+	return distCoeffs;
+}
+
+static ORBextractor::Parameters ReadExtractorParams(const cv::FileStorage& fs)
+{
+	ORBextractor::Parameters param;
+	param.nfeatures = fs["ORBextractor.nFeatures"];
+	param.scaleFactor = fs["ORBextractor.scaleFactor"];
+	param.nlevels = fs["ORBextractor.nLevels"];
+	param.iniThFAST = fs["ORBextractor.iniThFAST"];
+	param.minThFAST = fs["ORBextractor.minThFAST"];
+	return param;
+}
+
+static float ReadDepthFactor(const cv::FileStorage& fs)
+{
+	const float factor = fs["DepthMapFactor"];
+	return fabs(factor) < 1e-5 ? 1 : 1.f / factor;
+}
+
+static void ConvertToGray(const cv::Mat& src, cv::Mat& dst, bool RGB)
+{
+	static const int codes[] = { cv::COLOR_RGB2GRAY, cv::COLOR_BGR2GRAY, cv::COLOR_RGBA2GRAY, cv::COLOR_BGRA2GRAY };
+
+	const int ch = src.channels();
+	CV_Assert(ch == 1 || ch == 3 || ch == 4);
+
+	if (ch == 1)
+	{
+		dst = src;
+		return;
+	}
+
+	const int idx = ((ch == 3 ? 0 : 1) << 1) + (RGB ? 0 : 1);
+	cv::cvtColor(src, dst, codes[idx]);
+}
+
+static void GetScalePyramidInfo(const ORBextractor& extractor, ScalePyramidInfo& pyramid)
+{
+	pyramid.nlevels = extractor.GetLevels();
+	pyramid.scaleFactor = extractor.GetScaleFactor();
+	pyramid.logScaleFactor = log(pyramid.scaleFactor);
+	pyramid.scaleFactors = extractor.GetScaleFactors();
+	pyramid.invScaleFactors = extractor.GetInverseScaleFactors();
+	pyramid.sigmaSq = extractor.GetScaleSigmaSquares();
+	pyramid.invSigmaSq = extractor.GetInverseScaleSigmaSquares();
+}
+
+// Undistort keypoints given OpenCV distortion parameters.
+// Only for the RGB-D case. Stereo must be already rectified!
+// (called in the constructor).
+static void UndistortKeyPoints(const KeyPoints& src, KeyPoints& dst, const cv::Mat& K, const cv::Mat1f& distCoeffs)
+{
+	if (distCoeffs(0) == 0.f)
+	{
+		dst = src;
+		return;
+	}
+
+	std::vector<cv::Point2f> points(src.size());
+	for (size_t i = 0; i < src.size(); i++)
+		points[i] = src[i].pt;
+
+	cv::undistortPoints(points, points, K, distCoeffs, cv::Mat(), K);
+
+	dst.resize(src.size());
+	for (size_t i = 0; i < src.size(); i++)
+	{
+		cv::KeyPoint keypoint = src[i];
+		keypoint.pt = points[i];
+		dst[i] = keypoint;
+	}
+}
+
+// Computes image bounds for the undistorted image (called in the constructor).
+static ImageBounds ComputeImageBounds(const cv::Mat& image, const cv::Mat& K, const cv::Mat1f& distCoeffs)
+{
+	const float h = static_cast<float>(image.rows);
+	const float w = static_cast<float>(image.cols);
+
+	if (distCoeffs(0) == 0.f)
+		return ImageBounds(0.f, w, 0.f, h);
+
+	std::vector<cv::Point2f> corners = { { 0, 0 },{ w, 0 },{ 0, h },{ w, h } };
+	cv::undistortPoints(corners, corners, K, distCoeffs, cv::Mat(), K);
+
+	ImageBounds imageBounds;
+	imageBounds.minx = std::min(corners[0].x, corners[2].x);
+	imageBounds.maxx = std::max(corners[1].x, corners[3].x);
+	imageBounds.miny = std::min(corners[0].y, corners[1].y);
+	imageBounds.maxy = std::max(corners[2].y, corners[3].y);
+	return imageBounds;
+}
+
+// Associate a "right" coordinate to a keypoint if there is valid depth in the depthmap.
+static void ComputeStereoFromRGBD(const KeyPoints& keypoints, const KeyPoints& keypointsUn, const cv::Mat& depthImage,
+	const CameraParams& camera, std::vector<float>& uright, std::vector<float>& depth)
+{
+	const int nkeypoints = static_cast<int>(keypoints.size());
+
+	uright.assign(nkeypoints, -1.f);
+	depth.assign(nkeypoints, -1.f);
+
+	for (int i = 0; i < nkeypoints; i++)
+	{
+		const cv::KeyPoint& keypoint = keypoints[i];
+		const cv::KeyPoint& keypointUn = keypointsUn[i];
+
+		const int v = static_cast<int>(keypoint.pt.y);
+		const int u = static_cast<int>(keypoint.pt.x);
+		const float d = depthImage.at<float>(v, u);
+		if (d > 0)
+		{
+			depth[i] = d;
+			uright[i] = keypointUn.pt.x - camera.bf / d;
+		}
+	}
+}
+
+FrameBuilder::FrameBuilder(const cv::FileStorage& settings, int sensor) : sensor_(sensor)
+{
+	// Load camera parameters from settings file
+	camera_ = ReadCameraParams(settings);
+	distCoeffs_ = ReadDistCoeffs(settings);
+
+	// Load color
+	RGB_ = static_cast<int>(settings["Camera.RGB"]) != 0;
+
+	// Load depth factor
+	depthFactor_ = sensor == System::RGBD ? ReadDepthFactor(settings) : 1.f;
+
+	// Load ORB parameters
+	extractorParams_ = ReadExtractorParams(settings);
+
+	// Load the scheduling of the extraction workers
+	extractorThread_ = ReadThreadParams(settings, EXTRACTOR_THREAD);
+
+	// Initialize ORB extractors
+	extractorL_ = std::make_unique<ORBextractor>(extractorParams_);
+	if (sensor == System::STEREO)
+		extractorR_ = std::make_unique<ORBextractor>(extractorParams_);
+
+	if (sensor == System::MONOCULAR)
+	{
+		ORBextractor::Parameters iniParams = extractorParams_;
+		iniParams.nfeatures *= 2;
+		extractorIni_ = std::make_unique<ORBextractor>(iniParams);
+	}
+
+	// Scale Level Info
+	GetScalePyramidInfo(*extractorL_, pyramid_);
+}
+
+Frame FrameBuilder::Stereo(frameid_t id, const ORBVocabulary* voc, const cv::Mat& imageL, const cv::Mat& imageR,
+	double timestamp)
+{
+	// Color conversion
+	ConvertToGray(imageL, imageL_, RGB_);
+	ConvertToGray(imageR, imageR_, RGB_);
+
+	// ORB extraction
+	std::thread threadL = LaunchThread(extractorThread_, [&]() { extractorL_->Extract(imageL_, keypointsL_, descriptorsL_); });
+	std::thread threadR = LaunchThread(extractorThread_, [&]() { extractorR_->Extract(imageR_, keypointsR_, descriptorsR_); });
+	threadL.join();
+	threadR.join();
+
+	// Undistortion
+	UndistortKeyPoints(keypointsL_, keypointsUn_, camera_.Mat(), distCoeffs_);
+
+	// Stereo matching
+	ComputeStereoMatches(
+		keypointsL_, descriptorsL_, extractorL_->GetImagePyramid(),
+		keypointsR_, descriptorsR_, extractorR_->GetImagePyramid(),
+		pyramid_.scaleFactors, pyramid_.invScaleFactors, camera_, uright_, depth_);
+
+	// Computes image bounds for the undistorted image
+	if (imageBounds_.Empty())
+		imageBounds_ = ComputeImageBounds(imageL_, camera_.Mat(), distCoeffs_);
+
+	return Frame(id, voc, timestamp, camera_, keypointsL_, keypointsUn_, uright_, depth_,
+		descriptorsL_, pyramid_, imageBounds_);
+}
+
+Frame FrameBuilder::RGBD(frameid_t id, const ORBVocabulary* voc, const cv::Mat& image, const cv::Mat& depth,
+	double timestamp)
+{
+	// Color conversion
+	ConvertToGray(image, imageL_, RGB_);
+
+	// ORB extraction
+	extractorL_->Extract(imageL_, keypointsL_, descriptorsL_);
+
+	// Undistortion
+	UndistortKeyPoints(keypointsL_, keypointsUn_, camera_.Mat(), distCoeffs_);
+
+	// Associate a "right" coordinate to a keypoint if there is valid depth in the depthmap.
+	depth.convertTo(depthMap_, CV_32F, depthFactor_);
+	ComputeStereoFromRGBD(keypointsL_, keypointsUn_, depthMap_, camera_, uright_, depth_);
+
+	// Computes image bounds for the undistorted image
+	if (imageBounds_.Empty())
+		imageBounds_ = ComputeImageBounds(imageL_, camera_.Mat(), distCoeffs_);
+
+	return Frame(id, voc, timestamp, camera_, keypointsL_, keypointsUn_, uright_, depth_,
+		descriptorsL_, pyramid_, imageBounds_);
+}
+
+Frame FrameBuilder::Monocular(frameid_t id, const ORBVocabulary* voc, const cv::Mat& image, double timestamp, bool init)
+{
+	// Color conversion
+	ConvertToGray(image, imageL_, RGB_);
+
+	// ORB extraction
+	auto& extractor = init ? extractorIni_ : extractorL_;
+	extractor->Extract(imageL_, keypointsL_, descriptorsL_);
+
+	// Undistortion
+	UndistortKeyPoints(keypointsL_, keypointsUn_, camera_.Mat(), distCoeffs_);
+
+	// Computes image bounds for the undistorted image
+	if (imageBounds_.Empty())
+		imageBounds_ = ComputeImageBounds(imageL_, camera_.Mat(), distCoeffs_);
+
+	return Frame(id, voc, timestamp, camera_, keypointsL_, keypointsUn_, descriptorsL_, pyramid_, imageBounds_);
+}
+
+void FrameBuilder::ChangeCalibration(const cv::FileStorage& settings)
+{
+	camera_ = ReadCameraParams(settings);
+	distCoeffs_ = ReadDistCoeffs(settings);
+	imageBounds_ = ImageBounds();
+}
+
+void FrameBuilder::SetFeatureBudget(int nfeatures, int nactiveLevels)
+{
+	extractorL_->SetFeatureBudget(nfeatures, nactiveLevels);
+	if (extractorR_)
+		extractorR_->SetFeatureBudget(nfeatures, nactiveLevels);
+}
+
+const CameraParams& FrameBuilder::GetCamera() const { return camera_; }
+const cv::Mat1f& FrameBuilder::GetDistCoeffs() const { return distCoeffs_; }
+const ORBextractor::Parameters& FrameBuilder::GetExtractorParameters() const { return extractorParams_; }
+bool FrameBuilder::IsRGB() const { return RGB_; }
+const cv::Mat& FrameBuilder::GetImage() const { return imageL_; }
+
+} //namespace ORB_SLAM
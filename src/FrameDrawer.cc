@@ -137,10 +137,13 @@ cv::Mat FrameDrawer::DrawFrame()
 
 		const size_t nkeyframes = map_->KeyFramesInMap();
 		const size_t nmappoints = map_->MapPointsInMap();
+		const int nmaps = map_->MapsInAtlas();
 
 		ss << "KFs: " << nkeyframes << ", MPs: " << nmappoints << ", Matches: " << ntracked_;
 		if (ntrackedVO_ > 0)
 			ss << ", + VO matches: " << ntrackedVO_;
+		if (nmaps > 1)
+			ss << ", Maps: " << nmaps;
 	}
 	else if (state == Tracking::STATE_LOST)
 	{
@@ -20,8 +20,6 @@
 
 #include "Initializer.h"
 
-#include "Thirdparty/DBoW2/DUtils/Random.h"
-
 #include "Optimizer.h"
 #include "ORBmatcher.h"
 
@@ -30,7 +28,7 @@
 namespace ORB_SLAM2
 {
 
-Initializer::Initializer(const Frame &ReferenceFrame, float sigma, int iterations)
+Initializer::Initializer(const Frame &ReferenceFrame, float sigma, int iterations) : mRng(0)
 {
     //mK = ReferenceFrame.mK.clone();
 	mK = ReferenceFrame.camera.Mat();
@@ -78,8 +76,6 @@ bool Initializer::Initialize(const Frame &CurrentFrame, const std::vector<int> &
     // Generate sets of 8 points for each RANSAC iteration
     mvSets = std::vector< std::vector<size_t> >(mMaxIterations,std::vector<size_t>(8,0));
 
-    DUtils::Random::SeedRandOnce(0);
-
     for(int it=0; it<mMaxIterations; it++)
     {
         vAvailableIndices = vAllIndices;
@@ -87,7 +83,8 @@ bool Initializer::Initialize(const Frame &CurrentFrame, const std::vector<int> &
         // Select a minimum set
         for(size_t j=0; j<8; j++)
         {
-            int randi = DUtils::Random::RandomInt(0,static_cast<int>(vAvailableIndices.size())-1);
+            std::uniform_int_distribution<int> distribution(0,static_cast<int>(vAvailableIndices.size())-1);
+            int randi = distribution(mRng);
             int idx = static_cast<int>(vAvailableIndices[randi]);
 
             mvSets[it][j] = idx;
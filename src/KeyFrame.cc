@@ -23,17 +23,14 @@
 #include "Map.h"
 #include "MapPoint.h"
 #include "KeyFrameDatabase.h"
-#include "Converter.h"
 
-#define LOCK_MUTEX_POSE()        std::unique_lock<std::mutex> lock1(mutexPose_);
-#define LOCK_MUTEX_CONNECTIONS() std::unique_lock<std::mutex> lock2(mutexConnections_);
-#define LOCK_MUTEX_FEATURES()    std::unique_lock<std::mutex> lock3(mutexFeatures_);
+#define LOCK_MUTEX_POSE()        auto lock1 = LockUnlessFrozen(mutexPose_, map_, LOCK_SITE("KeyFrame::Pose"));
+#define LOCK_MUTEX_CONNECTIONS() auto lock2 = LockUnlessFrozen(mutexConnections_, map_, LOCK_SITE("KeyFrame::Connections"));
+#define LOCK_MUTEX_FEATURES()    auto lock3 = LockUnlessFrozen(mutexFeatures_, map_, LOCK_SITE("KeyFrame::Features"));
 
 namespace ORB_SLAM2
 {
 
-frameid_t KeyFrame::nextId = 0;
-
 using WeightAndKeyFrame = std::pair<int, KeyFrame*>;
 
 template <typename T, typename U>
@@ -48,18 +45,18 @@ static void Split(const std::vector<std::pair<T, U>>& vec12, std::vector<T>& vec
 	}
 }
 
-KeyFrame::KeyFrame(const Frame& frame, Map* map, KeyFrameDatabase* keyframeDB) :
-	frameId(frame.id), timestamp(frame.timestamp), grid(frame.grid),
+KeyFrame::KeyFrame(const Frame& frame, Map* map, KeyFrameDatabase* keyframeDB, bool origin) :
+	frameId(frame.id), timestamp(frame.timestamp), mapIndex(map->GetCurrentMap()), origin(origin), grid(frame.grid),
 	trackReferenceForFrame(0), fuseTargetForKF(0), BALocalForKF(0), BAFixedForKF(0),
-	loopQuery(0), loopWords(0), relocQuery(0), relocWords(0), BAGlobalForKF(0),
+	loopQuery(0), loopWords(0), BAGlobalForKF(0),
 	camera(frame.camera), N(frame.N), keypointsL(frame.keypoints), keypointsUn(frame.keypointsUn),
 	uright(frame.uright), depth(frame.depth), descriptorsL(frame.descriptors.clone()),
 	bowVector(frame.bowVector), featureVector(frame.featureVector), pyramid(frame.pyramid), imageBounds(frame.imageBounds),
-	mappoints_(frame.mappoints), keyFrameDB_(keyframeDB),
+	mappoints_(frame.mappoints), mappointsVersion_(0), keyFrameDB_(keyframeDB),
 	voc_(frame.voc), firstConnection_(true), parent_(nullptr), notErase_(false),
 	toBeErased_(false), bad_(false), halfBaseline_(frame.camera.baseline / 2), map_(map)
 {
-	id = nextId++;
+	id = map->NewKeyFrameId();
 	SetPose(frame.pose);
 }
 
@@ -70,7 +67,7 @@ void KeyFrame::ComputeBoW()
 
 	// Feature vector associate features with nodes in the 4th level (from leaves up)
 	// We assume the vocabulary tree has 6 levels, change the 4 otherwise
-	voc_->transform(Converter::toDescriptorVector(descriptorsL), bowVector, featureVector, 4);
+	voc_->transform(descriptorsL, bowVector, featureVector, 4);
 }
 
 void KeyFrame::SetPose(const CameraPose& pose)
@@ -165,24 +162,30 @@ void KeyFrame::AddMapPoint(MapPoint* mappiont, size_t idx)
 {
 	LOCK_MUTEX_FEATURES();
 	mappoints_[idx] = mappiont;
+	mappointsVersion_++;
 }
 
 void KeyFrame::EraseMapPointMatch(size_t idx)
 {
 	LOCK_MUTEX_FEATURES();
 	mappoints_[idx] = nullptr;
+	mappointsVersion_++;
 }
 
 void KeyFrame::EraseMapPointMatch(MapPoint* mappiont)
 {
 	const int idx = mappiont->GetIndexInKeyFrame(this);
 	if (idx >= 0)
+	{
 		mappoints_[idx] = nullptr;
+		mappointsVersion_++;
+	}
 }
 
 void KeyFrame::ReplaceMapPointMatch(size_t idx, MapPoint* mappiont)
 {
 	mappoints_[idx] = mappiont;
+	mappointsVersion_++;
 }
 
 std::set<MapPoint*> KeyFrame::GetMapPoints() const
@@ -232,6 +235,11 @@ MapPoint* KeyFrame::GetMapPoint(size_t idx) const
 	return mappoints_[idx];
 }
 
+unsigned int KeyFrame::GetMapPointsVersion() const
+{
+	return mappointsVersion_;
+}
+
 void KeyFrame::UpdateConnections()
 {
 	std::vector<MapPoint*> mappoints;
@@ -299,7 +307,7 @@ void KeyFrame::UpdateConnections()
 		connectionTo_ = KFcounter;
 		Split(pairs, orderedWeights_, orderedConnectedKeyFrames_);
 
-		if (firstConnection_ && id != 0)
+		if (firstConnection_ && !origin)
 		{
 			parent_ = orderedConnectedKeyFrames_.front();
 			parent_->AddChild(this);
@@ -381,7 +389,7 @@ void KeyFrame::SetBadFlag()
 	{
 		LOCK_MUTEX_CONNECTIONS();
 
-		if (id == 0)
+		if (origin)
 			return;
 
 		if (notErase_)
@@ -551,4 +559,27 @@ float KeyFrame::ComputeSceneMedianDepth(int q) const
 	return depths[(depths.size() - 1) / q];
 }
 
+void KeyFrame::AddMemoryUsage(MemoryStats::KeyFrames& memory) const
+{
+	memory.count++;
+	memory.keypoints += HeapBytes(keypointsL) + HeapBytes(keypointsUn) + HeapBytes(uright) + HeapBytes(depth);
+	memory.descriptors += HeapBytes(descriptorsL);
+	memory.grid += grid.GetMemoryUsage();
+
+	memory.bow += bowVector.getMemoryUsage() + featureVector.getMemoryUsage();
+
+	memory.other += sizeof(*this) - sizeof(grid) + HeapBytes(pyramid.scaleFactors) + HeapBytes(pyramid.invScaleFactors) +
+		HeapBytes(pyramid.sigmaSq) + HeapBytes(pyramid.invSigmaSq);
+
+	{
+		LOCK_MUTEX_FEATURES();
+		memory.graph += HeapBytes(mappoints_);
+	}
+	{
+		LOCK_MUTEX_CONNECTIONS();
+		memory.graph += HeapBytes(connectionTo_) + HeapBytes(orderedConnectedKeyFrames_) + HeapBytes(orderedWeights_) +
+			HeapBytes(children_) + HeapBytes(loopEdges_);
+	}
+}
+
 } //namespace ORB_SLAM
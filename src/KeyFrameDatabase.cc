@@ -21,17 +21,19 @@
 #include "KeyFrameDatabase.h"
 
 #include <mutex>
+#include <unordered_map>
 
 #include <Thirdparty/DBoW2/DBoW2/BowVector.h>
 
 #include "KeyFrame.h"
+#include "Frame.h"
 
-#define LOCK_MUTEX_DATABASE() std::unique_lock<std::mutex> lock(mutex_);
+#define LOCK_MUTEX_DATABASE() auto lock = LockMutex(mutex_, LOCK_SITE("KeyFrameDatabase"));
 
 namespace ORB_SLAM2
 {
 
-KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary &voc) : voc_(&voc)
+KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary &voc) : voc_(&voc), frozen_(false)
 {
 	wordIdToKFs_.resize(voc.size());
 }
@@ -40,8 +42,8 @@ void KeyFrameDatabase::add(KeyFrame* keyframe)
 {
 	LOCK_MUTEX_DATABASE();
 
-	for (const auto& word : keyframe->bowVector)
-		wordIdToKFs_[word.first].push_back(keyframe);
+	for (DBoW2::WordId wordId : keyframe->bowVector.ids())
+		wordIdToKFs_[wordId].push_back(keyframe);
 }
 
 void KeyFrameDatabase::erase(KeyFrame* keyframe)
@@ -49,10 +51,10 @@ void KeyFrameDatabase::erase(KeyFrame* keyframe)
 	LOCK_MUTEX_DATABASE();
 
 	// Erase elements in the Inverse File for the entry
-	for (const auto& word : keyframe->bowVector)
+	for (DBoW2::WordId wordId : keyframe->bowVector.ids())
 	{
 		// List of keyframes that share the word
-		std::list<KeyFrame*>& keyframes = wordIdToKFs_[word.first];
+		std::list<KeyFrame*>& keyframes = wordIdToKFs_[wordId];
 		auto it = std::find(std::begin(keyframes), std::end(keyframes), keyframe);
 		if (it != std::end(keyframes))
 			keyframes.erase(it);
@@ -75,9 +77,9 @@ std::vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* keyframe
 	{
 		LOCK_MUTEX_DATABASE();
 
-		for (const auto& word : keyframe->bowVector)
+		for (DBoW2::WordId wordId : keyframe->bowVector.ids())
 		{
-			for (KeyFrame* sharingKF : wordIdToKFs_[word.first])
+			for (KeyFrame* sharingKF : wordIdToKFs_[wordId])
 			{
 				if (sharingKF->loopQuery != keyframe->id)
 				{
@@ -170,25 +172,30 @@ std::vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* keyframe
 	return std::vector<KeyFrame*>(std::begin(candidateKFs), std::end(candidateKFs));
 }
 
-std::vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame* frame)
+std::vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(const Frame& frame) const
 {
-	std::list<KeyFrame*> wordSharingKFs;
+	// Words shared with the frame and similarity score of each keyframe.
+	// They are kept here, not in the keyframes, so that several trackers can query the database at once.
+	struct SharingKeyFrame
+	{
+		int words = 0;
+		float score = -1.f;
+	};
+	std::unordered_map<KeyFrame*, SharingKeyFrame> sharing;
+	std::vector<KeyFrame*> wordSharingKFs;
 
 	// Search all keyframes that share a word with current frame
 	{
-		LOCK_MUTEX_DATABASE();
+		auto lock = LockUnlessFrozen(LOCK_SITE("KeyFrameDatabase"));
 
-		for (const auto& word : frame->bowVector)
+		for (DBoW2::WordId wordId : frame.bowVector.ids())
 		{
-			for (KeyFrame* sharingKF : wordIdToKFs_[word.first])
+			for (KeyFrame* sharingKF : wordIdToKFs_[wordId])
 			{
-				if (sharingKF->relocQuery != frame->id)
-				{
-					sharingKF->relocWords = 0;
-					sharingKF->relocQuery = frame->id;
+				SharingKeyFrame& s = sharing[sharingKF];
+				if (s.words == 0)
 					wordSharingKFs.push_back(sharingKF);
-				}
-				sharingKF->relocWords++;
+				s.words++;
 			}
 		}
 	}
@@ -199,23 +206,20 @@ std::vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame* f
 	// Only compare against those keyframes that share enough words
 	int maxCommonWords = 0;
 	for (KeyFrame* sharingKF : wordSharingKFs)
-		maxCommonWords = std::max(maxCommonWords, sharingKF->relocWords);
+		maxCommonWords = std::max(maxCommonWords, sharing[sharingKF].words);
 
 	const int minCommonWords = static_cast<int>(0.8f * maxCommonWords);
 
 	std::list<std::pair<float, KeyFrame*>> scoreAndMatches;
 
-	int nscores = 0;
-
 	// Compute similarity score.
 	for (KeyFrame* sharingKF : wordSharingKFs)
 	{
-		if (sharingKF->relocWords > minCommonWords)
+		SharingKeyFrame& s = sharing[sharingKF];
+		if (s.words > minCommonWords)
 		{
-			nscores++;
-			const float score = static_cast<float>(voc_->score(frame->bowVector, sharingKF->bowVector));
-			sharingKF->relocScore = score;
-			scoreAndMatches.push_back(std::make_pair(score, sharingKF));
+			s.score = static_cast<float>(voc_->score(frame.bowVector, sharingKF->bowVector));
+			scoreAndMatches.push_back(std::make_pair(s.score, sharingKF));
 		}
 	}
 
@@ -229,21 +233,23 @@ std::vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame* f
 	for (const auto& v : scoreAndMatches)
 	{
 		KeyFrame* sharingKF = v.second;
-		
+
 		float bestScore = v.first;
 		float accScore = bestScore;
 		KeyFrame* bestKF = sharingKF;
 
 		for (KeyFrame* neighborKF : sharingKF->GetBestCovisibilityKeyFrames(10))
 		{
-			if (neighborKF->relocQuery != frame->id)
+			auto it = sharing.find(neighborKF);
+			if (it == std::end(sharing) || it->second.score < 0)
 				continue;
 
-			accScore += neighborKF->relocScore;
-			if (neighborKF->relocScore > bestScore)
+			const float neighborScore = it->second.score;
+			accScore += neighborScore;
+			if (neighborScore > bestScore)
 			{
 				bestKF = neighborKF;
-				bestScore = neighborKF->relocScore;
+				bestScore = neighborScore;
 			}
 		}
 
@@ -264,4 +270,28 @@ std::vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame* f
 	return std::vector<KeyFrame*>(std::begin(candidateKFs), std::end(candidateKFs));
 }
 
+void KeyFrameDatabase::AddMemoryUsage(MemoryStats& stats) const
+{
+	auto lock = LockUnlessFrozen(LOCK_SITE("KeyFrameDatabase"));
+	stats.keyFrameDatabase += HeapBytes(wordIdToKFs_);
+	for (const std::list<KeyFrame*>& keyframes : wordIdToKFs_)
+	{
+		stats.keyFrameDatabase += HeapBytes(keyframes);
+		stats.keyFrameDatabaseEntries += keyframes.size();
+	}
+}
+
+void KeyFrameDatabase::Freeze()
+{
+	LOCK_MUTEX_DATABASE();
+	frozen_.store(true, std::memory_order_release);
+}
+
+std::unique_lock<std::mutex> KeyFrameDatabase::LockUnlessFrozen(LockSite* site) const
+{
+	if (frozen_.load(std::memory_order_acquire))
+		return std::unique_lock<std::mutex>(mutex_, std::defer_lock);
+	return LockMutex(mutex_, site);
+}
+
 } //namespace ORB_SLAM
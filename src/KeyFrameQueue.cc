@@ -0,0 +1,120 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "KeyFrameQueue.h"
+
+#include <chrono>
+
+namespace ORB_SLAM2
+{
+
+// Steady clock time in microseconds
+static int64_t NowUs()
+{
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+KeyFrameQueue::KeyFrameQueue(int capacity)
+	: slots_(capacity), head_(0), tail_(0), overflows_(0), maxDepth_(0), totalDwell_(0), maxDwell_(0)
+{
+}
+
+bool KeyFrameQueue::TryPush(KeyFrame* keyframe)
+{
+	const uint64_t tail = tail_.load(std::memory_order_relaxed);
+	const uint64_t head = head_.load(std::memory_order_acquire);
+	if (tail - head >= slots_.size())
+	{
+		overflows_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Slot& slot = slots_[tail % slots_.size()];
+	slot.keyframe = keyframe;
+	slot.pushTime = NowUs();
+	tail_.store(tail + 1, std::memory_order_release);
+
+	const int depth = static_cast<int>(tail + 1 - head);
+	if (depth > maxDepth_.load(std::memory_order_relaxed))
+		maxDepth_.store(depth, std::memory_order_relaxed);
+
+	return true;
+}
+
+KeyFrame* KeyFrameQueue::TryPop(bool* wasFull)
+{
+	const uint64_t head = head_.load(std::memory_order_relaxed);
+	const uint64_t tail = tail_.load(std::memory_order_acquire);
+	if (wasFull)
+		*wasFull = tail - head >= slots_.size();
+	if (head == tail)
+		return nullptr;
+
+	const Slot slot = slots_[head % slots_.size()];
+	head_.store(head + 1, std::memory_order_release);
+
+	const int64_t dwell = NowUs() - slot.pushTime;
+	totalDwell_.fetch_add(dwell, std::memory_order_relaxed);
+	if (dwell > maxDwell_.load(std::memory_order_relaxed))
+		maxDwell_.store(dwell, std::memory_order_relaxed);
+
+	return slot.keyframe;
+}
+
+void KeyFrameQueue::Clear()
+{
+	while (TryPop()) {}
+}
+
+bool KeyFrameQueue::Empty() const
+{
+	return Size() == 0;
+}
+
+bool KeyFrameQueue::Full() const
+{
+	return Size() >= static_cast<int>(slots_.size());
+}
+
+int KeyFrameQueue::Size() const
+{
+	const uint64_t head = head_.load(std::memory_order_acquire);
+	const uint64_t tail = tail_.load(std::memory_order_acquire);
+	return tail > head ? static_cast<int>(tail - head) : 0;
+}
+
+KeyFrameQueue::Stats KeyFrameQueue::GetStats() const
+{
+	Stats stats;
+	stats.popped = head_.load(std::memory_order_acquire);
+	stats.pushed = tail_.load(std::memory_order_acquire);
+	stats.overflows = overflows_.load(std::memory_order_relaxed);
+	stats.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+	stats.maxDwellMs = 1e-3 * maxDwell_.load(std::memory_order_relaxed);
+	if (stats.popped > 0)
+		stats.meanDwellMs = 1e-3 * totalDwell_.load(std::memory_order_relaxed) / stats.popped;
+	return stats;
+}
+
+KeyFrameQueue::Stats::Stats() : pushed(0), popped(0), overflows(0), maxDepth(0), meanDwellMs(0), maxDwellMs(0) {}
+
+} //namespace ORB_SLAM
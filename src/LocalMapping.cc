@@ -25,21 +25,26 @@
 #include "Tracking.h"
 #include "LoopClosing.h"
 #include "ORBmatcher.h"
-#include "Usleep.h"
+#include "ThreadSignal.h"
+#include "KeyFrameQueue.h"
+#include "LockStats.h"
 #include "KeyFrame.h"
 #include "Map.h"
 #include "Optimizer.h"
 #include "CameraProjection.h"
 
-#define LOCK_MUTEX_NEW_KF()    std::unique_lock<std::mutex> lock1(mutexNewKFs_);
-#define LOCK_MUTEX_RESET()     std::unique_lock<std::mutex> lock2(mutexReset_);
-#define LOCK_MUTEX_FINISH()    std::unique_lock<std::mutex> lock3(mutexFinish_);
-#define LOCK_MUTEX_STOP()      std::unique_lock<std::mutex> lock4(mutexStop_);
-#define LOCK_MUTEX_ACCEPT_KF() std::unique_lock<std::mutex> lock5(mutexAccept_);
+#define LOCK_MUTEX_RESET()     auto lock2 = LockMutex(mutexReset_, LOCK_SITE("LocalMapping::Reset"));
+#define LOCK_MUTEX_FINISH()    auto lock3 = LockMutex(mutexFinish_, LOCK_SITE("LocalMapping::Finish"));
+#define LOCK_MUTEX_STOP()      auto lock4 = LockMutex(mutexStop_, LOCK_SITE("LocalMapping::Stop"));
+#define LOCK_MUTEX_ACCEPT_KF() auto lock5 = LockMutex(mutexAccept_, LOCK_SITE("LocalMapping::Accept"));
 
 namespace ORB_SLAM2
 {
 
+// Tracking does not create keyframes while this many are pending (it normally stops inserting far earlier),
+// so it never waits in InsertKeyFrame with the map lock held
+static const int KEYFRAME_QUEUE_CAPACITY = 64;
+
 static inline cv::Matx33f SkewSymmetricMatrix(const Vec3D& v)
 {
 	const float x = v(0);
@@ -76,7 +81,8 @@ public:
 
 	LocalMappingImpl(Map* map, bool monocular, float thDepth) :
 		monocular_(monocular), resetRequested_(false), finishRequested_(false), finished_(true), map_(map),
-		abortBA_(false), stopped_(false), stopRequested_(false), notStop_(false), acceptKeyFrames_(true), thDepth_(thDepth)
+		newKeyFrames_(KEYFRAME_QUEUE_CAPACITY), abortBA_(false), stopped_(false), stopRequested_(false), notStop_(false),
+		acceptKeyFrames_(true), thDepth_(thDepth)
 	{
 	}
 
@@ -92,12 +98,12 @@ public:
 
 	void Update()
 	{
-		KeyFrame* currKeyFrame_;
-		{
-			LOCK_MUTEX_NEW_KF();
-			currKeyFrame_ = newKeyFrames_.front();
-			newKeyFrames_.pop_front();
-		}
+		bool wasFull = false;
+		KeyFrame* currKeyFrame_ = newKeyFrames_.TryPop(&wasFull);
+
+		// Wake up the Tracking if it is waiting for room in the queue
+		if (wasFull)
+			signal_.Notify();
 
 		// BoW conversion and insertion in Map
 		ProcessNewKeyFrame(currKeyFrame_);
@@ -119,7 +125,7 @@ public:
 		if (!CheckNewKeyFrames() && !stopRequested())
 		{
 			// Local BA
-			if (map_->KeyFramesInMap() > 2)
+			if (map_->KeyFramesInMap(map_->GetMapId(currKeyFrame_)) > 2)
 				Optimizer::LocalBundleAdjustment(currKeyFrame_, &abortBA_, map_);
 
 			// Check redundant local Keyframes
@@ -147,10 +153,7 @@ public:
 			else if (Stop())
 			{
 				// Safe area to stop
-				while (isStopped() && !CheckFinish())
-				{
-					usleep(3000);
-				}
+				signal_.Wait([this] { return !isStopped() || CheckFinish(); });
 				if (CheckFinish())
 					break;
 			}
@@ -159,11 +162,13 @@ public:
 
 			// Tracking will see that Local Mapping is busy
 			SetAcceptKeyFrames(true);
+			signal_.Notify(); // WaitUntilIdle
 
 			if (CheckFinish())
 				break;
 
-			usleep(3000);
+			// Sleep until there is something to do
+			signal_.Wait([this] { return CheckNewKeyFrames() || CheckStop() || CheckReset() || CheckFinish(); });
 		}
 
 		SetFinish();
@@ -171,18 +176,22 @@ public:
 
 	void InsertKeyFrame(KeyFrame* keyframe) override
 	{
-		LOCK_MUTEX_NEW_KF();
-		newKeyFrames_.push_back(keyframe);
+		while (!newKeyFrames_.TryPush(keyframe))
+			signal_.Wait([this] { return !newKeyFrames_.Full(); });
+
 		abortBA_ = true;
+		signal_.Notify();
 	}
 
 	// Thread Synch
 	void RequestStop() override
 	{
-		LOCK_MUTEX_STOP();
-		stopRequested_ = true;
-		LOCK_MUTEX_NEW_KF();
-		abortBA_ = true;
+		{
+			LOCK_MUTEX_STOP();
+			stopRequested_ = true;
+			abortBA_ = true;
+		}
+		signal_.Notify();
 	}
 
 	void RequestReset() override
@@ -191,44 +200,47 @@ public:
 			LOCK_MUTEX_RESET();
 			resetRequested_ = true;
 		}
+		signal_.Notify();
 
-		while (true)
-		{
-			{
-				LOCK_MUTEX_RESET();
-				if (!resetRequested_)
-					break;
-			}
-			usleep(3000);
-		}
+		signal_.Wait([this] { return !CheckReset(); });
 	}
 
 	bool Stop() override
 	{
-		LOCK_MUTEX_STOP();
-		if (stopRequested_ && !notStop_)
 		{
+			LOCK_MUTEX_STOP();
+			if (!stopRequested_ || notStop_)
+				return false;
+
 			stopped_ = true;
-			std::cout << "Local Mapping STOP" << std::endl;
-			return true;
 		}
+		signal_.Notify();
+
+		std::cout << "Local Mapping STOP" << std::endl;
+		return true;
+	}
 
-		return false;
+	void WaitUntilStopped() override
+	{
+		signal_.Wait([this] { return isStopped() || isFinished(); });
 	}
 
 	void Release() override
 	{
-		LOCK_MUTEX_STOP();
-		LOCK_MUTEX_FINISH();
+		{
+			LOCK_MUTEX_STOP();
+			LOCK_MUTEX_FINISH();
 
-		if (finished_)
-			return;
+			if (finished_)
+				return;
 
-		stopped_ = false;
-		stopRequested_ = false;
-		for (KeyFrame* keyframe : newKeyFrames_)
-			delete keyframe;
-		newKeyFrames_.clear();
+			stopped_ = false;
+			stopRequested_ = false;
+			// Local Mapping is stopped, so the queue can be emptied from this thread
+			while (KeyFrame* keyframe = newKeyFrames_.TryPop())
+				delete keyframe;
+		}
+		signal_.Notify();
 
 		std::cout << "Local Mapping RELEASE" << std::endl;
 	}
@@ -259,12 +271,18 @@ public:
 
 	bool SetNotStop(bool flag) override
 	{
-		LOCK_MUTEX_STOP();
+		{
+			LOCK_MUTEX_STOP();
+
+			if (flag && stopped_)
+				return false;
 
-		if (flag && stopped_)
-			return false;
+			notStop_ = flag;
+		}
 
-		notStop_ = flag;
+		// A pending stop request can be served now
+		if (!flag)
+			signal_.Notify();
 
 		return true;
 	}
@@ -276,8 +294,11 @@ public:
 
 	void RequestFinish() override
 	{
-		LOCK_MUTEX_FINISH();
-		finishRequested_ = true;
+		{
+			LOCK_MUTEX_FINISH();
+			finishRequested_ = true;
+		}
+		signal_.Notify();
 	}
 
 	bool isFinished() const override
@@ -288,16 +309,30 @@ public:
 
 	int KeyframesInQueue() const override
 	{
-		LOCK_MUTEX_NEW_KF();
-		return static_cast<int>(newKeyFrames_.size());
+		return newKeyFrames_.Size();
+	}
+
+	bool KeyFrameQueueFull() const override
+	{
+		return newKeyFrames_.Full();
+	}
+
+	void WaitUntilIdle() override
+	{
+		// Keyframes are not accepted from the time one is popped until it is fully processed
+		signal_.Wait([this] { return (!CheckNewKeyFrames() && AcceptKeyFrames()) || isStopped() || isFinished(); });
+	}
+
+	KeyFrameQueue::Stats GetQueueStats() const override
+	{
+		return newKeyFrames_.GetStats();
 	}
 
 private:
 
-	bool CheckNewKeyFrames()
+	bool CheckNewKeyFrames() const
 	{
-		LOCK_MUTEX_NEW_KF();
-		return(!newKeyFrames_.empty());
+		return !newKeyFrames_.Empty();
 	}
 
 	void ProcessNewKeyFrame(KeyFrame* currKeyFrame_)
@@ -647,7 +682,7 @@ private:
 		const int minObservations = 3;
 		for (KeyFrame* targetKF : currKeyFrame_->GetVectorCovisibleKeyFrames())
 		{
-			if (targetKF->id == 0)
+			if (targetKF->origin)
 				continue;
 
 			const std::vector<MapPoint*> mappoints = targetKF->GetMapPointMatches();
@@ -702,16 +737,32 @@ private:
 
 	void ResetIfRequested()
 	{
-		LOCK_MUTEX_RESET();
-		if (resetRequested_)
 		{
-			newKeyFrames_.clear();
+			LOCK_MUTEX_RESET();
+			if (!resetRequested_)
+				return;
+
+			newKeyFrames_.Clear();
 			recentAddedMapPoints_.clear();
 			resetRequested_ = false;
 		}
+		signal_.Notify();
+	}
+
+	bool CheckReset() const
+	{
+		LOCK_MUTEX_RESET();
+		return resetRequested_;
 	}
 
-	bool CheckFinish()
+	// True if a stop has been requested and Local Mapping is allowed to stop
+	bool CheckStop() const
+	{
+		LOCK_MUTEX_STOP();
+		return stopRequested_ && !notStop_;
+	}
+
+	bool CheckFinish() const
 	{
 		LOCK_MUTEX_FINISH();
 		return finishRequested_;
@@ -719,10 +770,13 @@ private:
 
 	void SetFinish()
 	{
-		LOCK_MUTEX_FINISH();
-		finished_ = true;
-		LOCK_MUTEX_STOP();
-		stopped_ = true;
+		{
+			LOCK_MUTEX_FINISH();
+			finished_ = true;
+			LOCK_MUTEX_STOP();
+			stopped_ = true;
+		}
+		signal_.Notify();
 	}
 
 	bool monocular_;
@@ -735,7 +789,7 @@ private:
 	LoopClosing* loopCloser_;
 	Tracking* tracker_;
 
-	std::list<KeyFrame*> newKeyFrames_;
+	KeyFrameQueue newKeyFrames_;
 	std::list<MapPoint*> recentAddedMapPoints_;
 
 	bool abortBA_;
@@ -746,11 +800,14 @@ private:
 
 	float thDepth_;
 
-	mutable std::mutex mutexNewKFs_;
 	mutable std::mutex mutexReset_;
 	mutable std::mutex mutexFinish_;
 	mutable std::mutex mutexStop_;
 	mutable std::mutex mutexAccept_;
+
+	// Wakes up the mapping thread, the Tracking waiting for room in the queue
+	// and the threads waiting for Local Mapping to stop, reset or become idle
+	ThreadSignal signal_;
 };
 
 LocalMapping::Pointer LocalMapping::Create(Map* map, bool monocular, float thDepth)
@@ -0,0 +1,430 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "LocalizationServer.h"
+
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Map.h"
+#include "MapPoint.h"
+#include "KeyFrame.h"
+#include "KeyFrameDatabase.h"
+#include "Frame.h"
+#include "FrameBuilder.h"
+#include "ORBmatcher.h"
+#include "Optimizer.h"
+#include "Relocalizer.h"
+#include "CameraProjection.h"
+
+namespace ORB_SLAM2
+{
+
+// The map is shared by all localizers, so none of the functions below write to keyframes or map points
+// (e.g. tracking variables, visible/found counters): only the frame is modified.
+
+static int DiscardOutliers(Frame& currFrame)
+{
+	int ninliers = 0;
+	for (int i = 0; i < currFrame.N; i++)
+	{
+		if (!currFrame.mappoints[i])
+			continue;
+
+		if (currFrame.outlier[i])
+		{
+			currFrame.mappoints[i] = nullptr;
+			currFrame.outlier[i] = false;
+		}
+		else
+		{
+			ninliers++;
+		}
+	}
+	return ninliers;
+}
+
+// Same checks as the tracking frustum test, but the result is returned instead of stored in the MapPoint
+static bool ProjectMapPoint(const Frame& frame, const CameraProjection& proj, MapPoint* mappoint, float minViewingCos,
+	MapPointProjection& projection)
+{
+	const Point3D Ow = frame.GetCameraCenter();
+	const Point3D Xw = mappoint->GetWorldPos();
+	const Point3D Xc = proj.WorldToCamera(Xw);
+
+	if (Xc(2) < 0.f)
+		return false;
+
+	const Point2D pt = proj.CameraToImage(Xc);
+	if (!frame.imageBounds.Contains(pt.x, pt.y))
+		return false;
+
+	const Vec3D PO = Xw - Ow;
+	const float dist = static_cast<float>(cv::norm(PO));
+	if (dist < mappoint->GetMinDistanceInvariance() || dist > mappoint->GetMaxDistanceInvariance())
+		return false;
+
+	const float viewCos = static_cast<float>(PO.dot(mappoint->GetNormal()) / dist);
+	if (viewCos < minViewingCos)
+		return false;
+
+	projection.mappoint = mappoint;
+	projection.x = pt.x;
+	projection.y = pt.y;
+	projection.xR = pt.x - proj.DepthToDisparity(Xc(2));
+	projection.scaleLevel = mappoint->PredictScale(dist, &frame);
+	projection.viewCos = viewCos;
+	return true;
+}
+
+class LocalizerImpl : public Localizer
+{
+public:
+
+	LocalizerImpl(const ORBVocabulary* voc, Map* map, const KeyFrameDatabase* keyFrameDB,
+		const cv::FileStorage& settings, int sensor)
+		: voc_(voc), map_(map), frameBuilder_(settings, sensor), relocalizer_(map, keyFrameDB), sensor_(sensor),
+		referenceKF_(nullptr), lost_(true), nextFrameId_(0)
+	{
+		const float fps = settings["Camera.fps"];
+		maxFrames_ = fps == 0 ? 30 : static_cast<int>(fps);
+	}
+
+	cv::Mat LocalizeStereo(const cv::Mat& imageL, const cv::Mat& imageR, double timestamp) override
+	{
+		Frame currFrame = frameBuilder_.Stereo(nextFrameId_++, voc_, imageL, imageR, timestamp);
+		return Localize(currFrame);
+	}
+
+	cv::Mat LocalizeRGBD(const cv::Mat& image, const cv::Mat& depth, double timestamp) override
+	{
+		Frame currFrame = frameBuilder_.RGBD(nextFrameId_++, voc_, image, depth, timestamp);
+		return Localize(currFrame);
+	}
+
+	cv::Mat LocalizeMonocular(const cv::Mat& image, double timestamp) override
+	{
+		Frame currFrame = frameBuilder_.Monocular(nextFrameId_++, voc_, image, timestamp, false);
+		return Localize(currFrame);
+	}
+
+	bool IsLost() const override
+	{
+		return lost_;
+	}
+
+	void Reset() override
+	{
+		lost_ = true;
+		velocity_ = cv::Mat();
+		lastFrame_ = Frame();
+		referenceKF_ = nullptr;
+		localKeyFrames_.clear();
+		localPoints_.clear();
+	}
+
+private:
+
+	cv::Mat Localize(Frame& currFrame)
+	{
+		bool success = false;
+		if (!lost_)
+		{
+			if (!velocity_.empty() && currFrame.PassedFrom(relocalizer_.GetLastRelocFrameId()) >= 2)
+				success = TrackWithMotionModel(currFrame);
+			if (!success)
+				success = TrackReferenceKeyFrame(currFrame);
+		}
+
+		if (!success)
+			success = relocalizer_.Relocalize(currFrame);
+
+		if (success)
+		{
+			// Same thresholds as the tracking: coarser search and more inliers required after a relocalization
+			const int passedFromLastReloc = currFrame.PassedFrom(relocalizer_.GetLastRelocFrameId());
+			const float th = passedFromLastReloc < 2 ? 5.f : (sensor_ == System::RGBD ? 3.f : 1.f);
+			const int ninliers = TrackLocalMap(currFrame, th);
+			success = ninliers >= (passedFromLastReloc < maxFrames_ ? 50 : 30);
+		}
+
+		lost_ = !success;
+		if (!success)
+		{
+			velocity_ = cv::Mat();
+			return cv::Mat();
+		}
+
+		velocity_ = !lastFrame_.pose.Empty() ? currFrame.pose * lastFrame_.pose.Inverse() : cv::Mat();
+
+		currFrame.referenceKF = referenceKF_;
+		DiscardOutliers(currFrame);
+		lastFrame_ = Frame(currFrame);
+
+		return currFrame.pose.Mat();
+	}
+
+	bool TrackWithMotionModel(Frame& currFrame)
+	{
+		ORBmatcher matcher(0.9f, true);
+
+		currFrame.SetPose(CameraPose(velocity_) * lastFrame_.pose);
+
+		const float threshold = sensor_ == System::STEREO ? 7.f : 15.f;
+		const int minMatches = 20;
+
+		std::fill(std::begin(currFrame.mappoints), std::end(currFrame.mappoints), nullptr);
+		int nmatches = matcher.SearchByProjection(currFrame, lastFrame_, threshold, sensor_ == System::MONOCULAR);
+		if (nmatches < minMatches)
+		{
+			// If few matches, uses a wider window search
+			std::fill(std::begin(currFrame.mappoints), std::end(currFrame.mappoints), nullptr);
+			nmatches = matcher.SearchByProjection(currFrame, lastFrame_, 2 * threshold, sensor_ == System::MONOCULAR);
+		}
+
+		if (nmatches < minMatches)
+			return false;
+
+		Optimizer::PoseOptimization(&currFrame, map_);
+
+		return DiscardOutliers(currFrame) >= 10;
+	}
+
+	bool TrackReferenceKeyFrame(Frame& currFrame)
+	{
+		if (!referenceKF_)
+			return false;
+
+		currFrame.ComputeBoW();
+
+		ORBmatcher matcher(0.7f, true);
+		std::vector<MapPoint*> mappoints;
+		if (matcher.SearchByBoW(referenceKF_, currFrame, mappoints) < 15)
+			return false;
+
+		currFrame.mappoints = mappoints;
+		currFrame.SetPose(lastFrame_.pose);
+
+		Optimizer::PoseOptimization(&currFrame, map_);
+
+		return DiscardOutliers(currFrame) >= 10;
+	}
+
+	void UpdateLocalKeyFrames(Frame& currFrame)
+	{
+		// Each map point votes for the keyframes in which it has been observed
+		std::unordered_map<KeyFrame*, int> votes;
+		for (int i = 0; i < currFrame.N; i++)
+		{
+			MapPoint* mappoint = currFrame.mappoints[i];
+			if (!mappoint)
+				continue;
+
+			if (mappoint->isBad())
+			{
+				currFrame.mappoints[i] = nullptr;
+				continue;
+			}
+
+			for (const auto& observation : mappoint->GetObservations())
+				votes[observation.first]++;
+		}
+
+		if (votes.empty())
+			return;
+
+		std::unordered_set<KeyFrame*> included;
+		localKeyFrames_.clear();
+
+		int maxCount = 0;
+		KeyFrame* maxKeyFrame = nullptr;
+		for (const auto& v : votes)
+		{
+			KeyFrame* keyframe = v.first;
+			if (keyframe->isBad())
+				continue;
+
+			if (v.second > maxCount)
+			{
+				maxCount = v.second;
+				maxKeyFrame = keyframe;
+			}
+
+			localKeyFrames_.push_back(keyframe);
+			included.insert(keyframe);
+		}
+
+		// Include also some neighbors of the voted keyframes
+		auto includeFirst = [&](const auto& candidates)
+		{
+			for (KeyFrame* keyframe : candidates)
+			{
+				if (keyframe && !keyframe->isBad() && included.insert(keyframe).second)
+				{
+					localKeyFrames_.push_back(keyframe);
+					break;
+				}
+			}
+		};
+
+		const size_t nvoted = localKeyFrames_.size();
+		for (size_t k = 0; k < nvoted; k++)
+		{
+			// Limit the number of keyframes
+			if (localKeyFrames_.size() > MAX_LOCAL_KEYFRAMES)
+				break;
+
+			KeyFrame* keyframe = localKeyFrames_[k];
+			includeFirst(keyframe->GetBestCovisibilityKeyFrames(10));
+			includeFirst(keyframe->GetChildren());
+			includeFirst(std::vector<KeyFrame*>{ keyframe->GetParent() });
+		}
+
+		if (maxKeyFrame)
+			referenceKF_ = maxKeyFrame;
+	}
+
+	void UpdateLocalPoints()
+	{
+		std::unordered_set<MapPoint*> included;
+		localPoints_.clear();
+		for (KeyFrame* keyframe : localKeyFrames_)
+		{
+			for (MapPoint* mappoint : keyframe->GetMapPointMatches())
+			{
+				if (mappoint && !mappoint->isBad() && included.insert(mappoint).second)
+					localPoints_.push_back(mappoint);
+			}
+		}
+	}
+
+	int TrackLocalMap(Frame& currFrame, float th)
+	{
+		UpdateLocalKeyFrames(currFrame);
+		UpdateLocalPoints();
+
+		// Do not search map points already matched
+		std::unordered_set<const MapPoint*> matched;
+		for (const MapPoint* mappoint : currFrame.mappoints)
+			if (mappoint)
+				matched.insert(mappoint);
+
+		projections_.clear();
+		const CameraProjection proj(currFrame.pose, currFrame.camera);
+		for (MapPoint* mappoint : localPoints_)
+		{
+			MapPointProjection projection;
+			if (!matched.count(mappoint) && !mappoint->isBad() && ProjectMapPoint(currFrame, proj, mappoint, 0.5f, projection))
+				projections_.push_back(projection);
+		}
+
+		if (!projections_.empty())
+		{
+			ORBmatcher matcher(0.8f);
+			matcher.SearchByProjection(currFrame, projections_, th);
+		}
+
+		Optimizer::PoseOptimization(&currFrame, map_);
+
+		int ninliers = 0;
+		for (int i = 0; i < currFrame.N; i++)
+			if (currFrame.mappoints[i] && !currFrame.outlier[i])
+				ninliers++;
+
+		return ninliers;
+	}
+
+	static const size_t MAX_LOCAL_KEYFRAMES = 80;
+
+	const ORBVocabulary* voc_;
+	Map* map_;
+	FrameBuilder frameBuilder_;
+	Relocalizer relocalizer_;
+	int sensor_;
+	int maxFrames_;
+
+	// Motion model
+	Frame lastFrame_;
+	cv::Mat velocity_;
+
+	// Local map
+	KeyFrame* referenceKF_;
+	std::vector<KeyFrame*> localKeyFrames_;
+	std::vector<MapPoint*> localPoints_;
+	std::vector<MapPointProjection> projections_;
+
+	bool lost_;
+	frameid_t nextFrameId_;
+};
+
+class LocalizationServerImpl : public LocalizationServer
+{
+public:
+
+	LocalizationServerImpl(const System::VocabularyPointer& voc, std::unique_ptr<Map> map,
+		std::unique_ptr<KeyFrameDatabase> keyFrameDB)
+		: voc_(voc), map_(std::move(map)), keyFrameDB_(std::move(keyFrameDB))
+	{
+		map_->Freeze();
+		keyFrameDB_->Freeze();
+	}
+
+	Localizer::Pointer CreateLocalizer(const System::Path& settingsFile, System::Sensor sensor) const override
+	{
+		cv::FileStorage settings(settingsFile.c_str(), cv::FileStorage::READ);
+		if (!settings.isOpened())
+		{
+			std::cerr << "Failed to open settings file at: " << settingsFile << std::endl;
+			std::exit(-1);
+		}
+
+		return std::make_unique<LocalizerImpl>(voc_.get(), map_.get(), keyFrameDB_.get(), settings, sensor);
+	}
+
+	size_t KeyFramesInMap() const override
+	{
+		return map_->KeyFramesInMap();
+	}
+
+	size_t MapPointsInMap() const override
+	{
+		return map_->MapPointsInMap();
+	}
+
+private:
+
+	System::VocabularyPointer voc_;
+	std::unique_ptr<Map> map_;
+	std::unique_ptr<KeyFrameDatabase> keyFrameDB_;
+};
+
+LocalizationServer::Pointer LocalizationServer::Create(const System::VocabularyPointer& voc, std::unique_ptr<Map> map,
+	std::unique_ptr<KeyFrameDatabase> keyFrameDB)
+{
+	return std::make_unique<LocalizationServerImpl>(voc, std::move(map), std::move(keyFrameDB));
+}
+
+Localizer::~Localizer() {}
+
+LocalizationServer::~LocalizationServer() {}
+
+} //namespace ORB_SLAM
@@ -0,0 +1,221 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "LockStats.h"
+
+#include <chrono>
+#include <map>
+#include <algorithm>
+
+namespace ORB_SLAM2
+{
+
+// Call site that acquired each mutex last, indexed by the mutex address.
+// While the mutex is locked it is the site holding it (hash collisions only blur the attribution).
+static const size_t HOLDER_TABLE_SIZE = 4096;
+static std::atomic<LockSite*> holders[HOLDER_TABLE_SIZE];
+
+static std::atomic<LockSite*>& Holder(const void* mutex)
+{
+	const uintptr_t address = reinterpret_cast<uintptr_t>(mutex);
+	return holders[(address >> 4) % HOLDER_TABLE_SIZE];
+}
+
+// Registered call sites and blocking counts. Only used on registration and on contention.
+struct LockRegistry
+{
+	std::mutex mutex;
+	std::vector<const LockSite*> sites;
+	std::map<std::pair<const LockSite*, const LockSite*>, uint64_t> blocked;
+};
+
+static LockRegistry& Registry()
+{
+	static LockRegistry registry;
+	return registry;
+}
+
+static int WaitBin(uint64_t waitNs)
+{
+	const uint64_t waitUs = waitNs / 1000;
+	int bin = 0;
+	while (bin < LOCK_WAIT_BINS - 1 && (1ULL << bin) <= waitUs)
+		bin++;
+	return bin;
+}
+
+static std::string SiteName(const LockSite& site)
+{
+	std::string file(site.file);
+	const size_t slash = file.find_last_of("/\\");
+	if (slash != std::string::npos)
+		file = file.substr(slash + 1);
+	return file + ":" + std::to_string(site.line);
+}
+
+LockSite::LockSite(const char* lockClass, const char* file, int line)
+	: lockClass(lockClass), file(file), line(line), acquisitions(0), contentions(0), totalWaitNs(0), maxWaitNs(0)
+{
+	for (auto& count : waitHistogram)
+		count = 0;
+
+	LockRegistry& registry = Registry();
+	std::unique_lock<std::mutex> lock(registry.mutex);
+	registry.sites.push_back(this);
+}
+
+template <class Lock, class Mutex>
+static Lock Acquire(Mutex& mutex, LockSite* site)
+{
+	Lock lock(mutex, std::try_to_lock);
+	uint64_t waitNs = 0;
+	if (!lock.owns_lock())
+	{
+		const LockSite* holder = Holder(&mutex).load(std::memory_order_relaxed);
+
+		const auto t0 = std::chrono::steady_clock::now();
+		lock.lock();
+		const auto t1 = std::chrono::steady_clock::now();
+		waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+		site->contentions.fetch_add(1, std::memory_order_relaxed);
+		site->totalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+		if (waitNs > site->maxWaitNs.load(std::memory_order_relaxed))
+			site->maxWaitNs.store(waitNs, std::memory_order_relaxed);
+
+		if (holder)
+		{
+			LockRegistry& registry = Registry();
+			std::unique_lock<std::mutex> lockRegistry(registry.mutex);
+			registry.blocked[std::make_pair(site, holder)]++;
+		}
+	}
+
+	site->acquisitions.fetch_add(1, std::memory_order_relaxed);
+	site->waitHistogram[WaitBin(waitNs)].fetch_add(1, std::memory_order_relaxed);
+	Holder(&mutex).store(site, std::memory_order_relaxed);
+
+	return lock;
+}
+
+std::unique_lock<std::mutex> LockInstrumented(std::mutex& mutex, LockSite* site)
+{
+	return Acquire<std::unique_lock<std::mutex>>(mutex, site);
+}
+
+std::unique_lock<SharedMutex> LockInstrumented(SharedMutex& mutex, LockSite* site)
+{
+	return Acquire<std::unique_lock<SharedMutex>>(mutex, site);
+}
+
+std::shared_lock<SharedMutex> LockSharedInstrumented(SharedMutex& mutex, LockSite* site)
+{
+	return Acquire<std::shared_lock<SharedMutex>>(mutex, site);
+}
+
+std::vector<LockStats> GetLockStats()
+{
+	LockRegistry& registry = Registry();
+	std::unique_lock<std::mutex> lock(registry.mutex);
+
+	std::vector<LockStats> stats;
+	stats.reserve(registry.sites.size());
+	for (const LockSite* site : registry.sites)
+	{
+		LockStats s;
+		s.lockClass = site->lockClass;
+		s.site = SiteName(*site);
+		s.acquisitions = site->acquisitions.load(std::memory_order_relaxed);
+		s.contentions = site->contentions.load(std::memory_order_relaxed);
+		s.totalWaitMs = 1e-6 * site->totalWaitNs.load(std::memory_order_relaxed);
+		s.maxWaitMs = 1e-6 * site->maxWaitNs.load(std::memory_order_relaxed);
+		for (const auto& count : site->waitHistogram)
+			s.waitHistogram.push_back(count.load(std::memory_order_relaxed));
+
+		for (const auto& blocked : registry.blocked)
+			if (blocked.first.first == site)
+				s.blockedBy.push_back(std::make_pair(SiteName(*blocked.first.second), blocked.second));
+
+		stats.push_back(s);
+	}
+	return stats;
+}
+
+void PrintLockStats(std::ostream& os)
+{
+	// Group the call sites by lock class
+	std::map<std::string, std::vector<LockStats>> classes;
+	for (const LockStats& s : GetLockStats())
+		classes[s.lockClass].push_back(s);
+
+	std::vector<std::pair<double, std::string>> order;
+	for (const auto& c : classes)
+	{
+		double totalWaitMs = 0;
+		for (const LockStats& s : c.second)
+			totalWaitMs += s.totalWaitMs;
+		order.push_back(std::make_pair(totalWaitMs, c.first));
+	}
+	std::sort(std::rbegin(order), std::rend(order));
+
+	os << "Lock statistics (wait histogram bins: < 1, 2, 4, ... us)" << std::endl;
+	for (const auto& o : order)
+	{
+		std::vector<LockStats>& sites = classes[o.second];
+		std::sort(std::begin(sites), std::end(sites),
+			[](const LockStats& lhs, const LockStats& rhs) { return lhs.totalWaitMs > rhs.totalWaitMs; });
+
+		uint64_t acquisitions = 0, contentions = 0;
+		std::vector<uint64_t> histogram(LOCK_WAIT_BINS, 0);
+		for (const LockStats& s : sites)
+		{
+			acquisitions += s.acquisitions;
+			contentions += s.contentions;
+			for (int i = 0; i < LOCK_WAIT_BINS; i++)
+				histogram[i] += s.waitHistogram[i];
+		}
+
+		// Drop the empty bins at the end
+		while (histogram.size() > 1 && histogram.back() == 0)
+			histogram.pop_back();
+
+		os << o.second << ": " << acquisitions << " acquisitions, " << contentions << " contended, "
+			<< o.first << " ms waiting, histogram:";
+		for (uint64_t count : histogram)
+			os << " " << count;
+		os << std::endl;
+
+		for (const LockStats& s : sites)
+		{
+			os << "  " << s.site << ": " << s.acquisitions << " acquisitions, " << s.contentions << " contended, "
+				<< s.totalWaitMs << " ms waiting (max " << s.maxWaitMs << " ms)";
+			if (!s.blockedBy.empty())
+			{
+				os << ", blocked by:";
+				for (const auto& b : s.blockedBy)
+					os << " " << b.first << " (" << b.second << ")";
+			}
+			os << std::endl;
+		}
+	}
+}
+
+} //namespace ORB_SLAM
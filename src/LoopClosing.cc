@@ -22,6 +22,7 @@
 
 #include <mutex>
 #include <thread>
+#include <atomic>
 
 #include "Sim3Solver.h"
 #include "Optimizer.h"
@@ -32,17 +33,22 @@
 #include "ORBVocabulary.h"
 #include "Tracking.h"
 #include "LocalMapping.h"
-#include "Usleep.h"
+#include "ThreadSignal.h"
+#include "KeyFrameQueue.h"
+#include "LockStats.h"
+#include "ThreadParams.h"
 
-#define LOCK_MUTEX_LOOP_QUEUE() std::unique_lock<std::mutex> lock1(mutexLoopQueue_);
-#define LOCK_MUTEX_FINISH()     std::unique_lock<std::mutex> lock2(mutexFinish_);
-#define LOCK_MUTEX_RESET()      std::unique_lock<std::mutex> lock3(mutexReset_);
-#define LOCK_MUTEX_GLOBAL_BA()  std::unique_lock<std::mutex> lock4(mutexGBA_);
-#define LOCK_MUTEX_MAP_UPDATE() std::unique_lock<std::mutex> lock5(map_->mutexMapUpdate);
+#define LOCK_MUTEX_FINISH()     auto lock2 = LockMutex(mutexFinish_, LOCK_SITE("LoopClosing::Finish"));
+#define LOCK_MUTEX_RESET()      auto lock3 = LockMutex(mutexReset_, LOCK_SITE("LoopClosing::Reset"));
+#define LOCK_MUTEX_GLOBAL_BA()  auto lock4 = LockMutex(mutexGBA_, LOCK_SITE("LoopClosing::GlobalBA"));
+#define LOCK_MUTEX_MAP_UPDATE() auto lock5 = LockMutex(map_->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
 
 namespace ORB_SLAM2
 {
 
+// Keyframes pending loop detection before they start skipping it
+static const int LOOP_QUEUE_CAPACITY = 64;
+
 class LoopDetector
 {
 
@@ -56,7 +62,7 @@ public:
 		std::vector<MapPoint*> loopMapPoints;
 	};
 
-	LoopDetector(KeyFrameDatabase* keyframeDB, ORBVocabulary* voc, bool fixScale)
+	LoopDetector(KeyFrameDatabase* keyframeDB, const ORBVocabulary* voc, bool fixScale)
 		: keyFrameDB_(keyframeDB), voc_(voc), fixScale_(fixScale), minConsistency_(3) {}
 
 	static bool FindLoopInCandidateKFs(KeyFrame* currentKF, std::vector<KeyFrame*>& candidateKFs, Loop& loop, bool fixScale)
@@ -300,7 +306,7 @@ private:
 	using ConsistentGroup = std::pair<std::set<KeyFrame*>, int>;
 
 	KeyFrameDatabase* keyFrameDB_;
-	ORBVocabulary* voc_;
+	const ORBVocabulary* voc_;
 	std::vector<ConsistentGroup> prevConsistentGroups_;
 	bool fixScale_;
 	int minConsistency_;
@@ -350,7 +356,8 @@ class GlobalBA
 {
 public:
 
-	GlobalBA(Map* map) : map_(map), localMapper_(nullptr), running_(false), finished_(true), stop_(false), fullBAIdx_(0) {}
+	GlobalBA(Map* map, const ThreadParams& threadParams) : map_(map), localMapper_(nullptr), threadParams_(threadParams),
+		running_(false), finished_(true), stop_(false), fullBAIdx_(0) {}
 
 	void SetLocalMapper(LocalMapping* localMapper)
 	{
@@ -360,6 +367,8 @@ public:
 	// This function will run in a separate thread
 	void _Run(frameid_t loopKFId)
 	{
+		ApplyThreadParams(threadParams_);
+
 		std::cout << "Starting Global Bundle Adjustment" << std::endl;
 
 		const int idx = fullBAIdx_;
@@ -381,10 +390,7 @@ public:
 				localMapper_->RequestStop();
 
 				// Wait until Local Mapping has effectively stopped
-				while (!localMapper_->isStopped() && !localMapper_->isFinished())
-				{
-					usleep(1000);
-				}
+				localMapper_->WaitUntilStopped();
 
 				// Get Map Mutex
 				LOCK_MUTEX_MAP_UPDATE();
@@ -455,6 +461,7 @@ public:
 			finished_ = true;
 			running_ = false;
 		}
+		signal_.Notify();
 	}
 
 	void Run(frameid_t loopKFId)
@@ -486,15 +493,22 @@ public:
 		return finished_;
 	}
 
+	void WaitUntilFinished()
+	{
+		signal_.Wait([this] { return !Running(); });
+	}
+
 private:
 
 	Map* map_;
 	LocalMapping* localMapper_;
+	ThreadParams threadParams_;
 	bool running_;
 	bool finished_;
 	bool stop_;
 	int fullBAIdx_;
 	mutable std::mutex mutexGBA_;
+	ThreadSignal signal_;
 	ReusableThread thread_;
 };
 
@@ -518,6 +532,43 @@ public:
 		localMapper_ = pLocalMapper;
 	}
 
+	// Moves the map of the current keyframe into the frame of the matched map with the Sim3 of the loop.
+	// The loop is then closed as any other loop (fusion, essential graph and global BA).
+	void MergeMaps(KeyFrame* currentKF, int currentMap, int matchedMap, LoopDetector::Loop& loop)
+	{
+		std::cout << "Merging map " << currentMap << " into map " << matchedMap << std::endl;
+
+		LOCK_MUTEX_MAP_UPDATE();
+
+		// Transformation from the current map to the matched map
+		const Sim3 Swn = loop.Scw.Inverse() * Sim3(currentKF->GetPose());
+		const Sim3 Snw = Swn.Inverse();
+
+		for (KeyFrame* keyframe : map_->GetAllKeyFrames())
+		{
+			if (keyframe->isBad() || map_->GetMapId(keyframe) != currentMap)
+				continue;
+
+			// [R t/s;0 1]
+			const Sim3 Skw = Sim3(keyframe->GetPose()) * Snw;
+			keyframe->SetPose(CameraPose(Skw.R(), (1. / Skw.Scale()) * Skw.t()));
+		}
+
+		for (MapPoint* mappoint : map_->GetAllMapPoints())
+		{
+			if (mappoint->isBad() || map_->GetMapId(mappoint->GetReferenceKeyFrame()) != currentMap)
+				continue;
+
+			mappoint->SetWorldPos(Swn.Map(mappoint->GetWorldPos()));
+			mappoint->UpdateNormalAndDepth();
+		}
+
+		map_->MergeMaps(currentMap, matchedMap);
+
+		// The current keyframe is now where the loop places it
+		loop.Scw = Sim3(currentKF->GetPose());
+	}
+
 	void Correct(KeyFrame* currentKF, LoopDetector::Loop& loop)
 	{
 		std::cout << "Loop detected!" << std::endl;
@@ -538,9 +589,14 @@ public:
 		}
 
 		// Wait until Local Mapping has effectively stopped
-		while (!localMapper_->isStopped())
+		localMapper_->WaitUntilStopped();
+
+		// The loop joins two maps of the atlas
+		const int currentMap = map_->GetMapId(currentKF);
+		const int matchedMap = map_->GetMapId(matchedKF);
+		if (currentMap != matchedMap)
 		{
-			usleep(1000);
+			MergeMaps(currentKF, currentMap, matchedMap, loop);
 		}
 
 		// Ensure current keyframe is updated
@@ -697,9 +753,10 @@ class LoopClosingImpl : public LoopClosing
 
 public:
 
-	LoopClosingImpl(Map *map, KeyFrameDatabase* keyframeDB, ORBVocabulary *voc, bool fixScale)
-		: resetRequested_(false), finishRequested_(false), finished_(true), lastLoopKFId_(0),
-		keyframeDB_(keyframeDB), detector_(keyframeDB, voc, fixScale), corrector_(map, &GBA_, fixScale), GBA_(map)
+	LoopClosingImpl(Map *map, KeyFrameDatabase* keyframeDB, const ORBVocabulary* voc, bool fixScale,
+		const ThreadParams& globalBAThread)
+		: resetRequested_(false), finishRequested_(false), finished_(true), busy_(false), lastLoopKFId_(0),
+		keyFrameQueue_(LOOP_QUEUE_CAPACITY), keyframeDB_(keyframeDB), detector_(keyframeDB, voc, fixScale), corrector_(map, &GBA_, fixScale), GBA_(map, globalBAThread)
 	{
 	}
 
@@ -725,13 +782,11 @@ public:
 			// Check if there are keyframes in the queue
 			if (CheckNewKeyFrames())
 			{
-				KeyFrame* currentKF = nullptr;
-				{
-					LOCK_MUTEX_LOOP_QUEUE();
-					currentKF = keyFrameQueue_.front();
-					keyFrameQueue_.pop_front();
-					currentKF->SetNotErase();
-				}
+				// Set before the queue empties, so that WaitUntilIdle never sees both idle
+				busy_ = true;
+
+				KeyFrame* currentKF = keyFrameQueue_.TryPop();
+				currentKF->SetNotErase();
 
 				// Detect loop candidates and check covisibility consistency
 				// Compute similarity transformation [sR|t]
@@ -752,6 +807,9 @@ public:
 				{
 					currentKF->SetErase();
 				}
+
+				busy_ = false;
+				signal_.Notify();
 			}
 
 			ResetIfRequested();
@@ -759,7 +817,8 @@ public:
 			if (CheckFinish())
 				break;
 
-			usleep(5000);
+			// Sleep until there is something to do
+			signal_.Wait([this] { return CheckNewKeyFrames() || CheckReset() || CheckFinish(); });
 		}
 
 		SetFinish();
@@ -767,9 +826,28 @@ public:
 
 	void InsertKeyFrame(KeyFrame* keyframe) override
 	{
-		LOCK_MUTEX_LOOP_QUEUE();
-		if (keyframe->id != 0)
-			keyFrameQueue_.push_back(keyframe);
+		if (keyframe->origin)
+			return;
+
+		// Local Mapping must not block here (Loop Closing may be waiting for it to stop),
+		// so under overload the keyframe skips loop detection and only goes to the database
+		if (!keyFrameQueue_.TryPush(keyframe))
+		{
+			keyframeDB_->add(keyframe);
+			return;
+		}
+
+		signal_.Notify();
+	}
+
+	int KeyframesInQueue() const override
+	{
+		return keyFrameQueue_.Size();
+	}
+
+	KeyFrameQueue::Stats GetQueueStats() const override
+	{
+		return keyFrameQueue_.GetStats();
 	}
 
 	void RequestReset() override
@@ -778,16 +856,9 @@ public:
 			LOCK_MUTEX_RESET();
 			resetRequested_ = true;
 		}
+		signal_.Notify();
 
-		while (true)
-		{
-			{
-				LOCK_MUTEX_RESET();
-				if (!resetRequested_)
-					break;
-			}
-			usleep(5000);
-		}
+		signal_.Wait([this] { return !CheckReset(); });
 	}
 
 	bool isRunningGBA() const override
@@ -800,10 +871,23 @@ public:
 		return GBA_.Finished();
 	}
 
+	void WaitForGBA() override
+	{
+		GBA_.WaitUntilFinished();
+	}
+
+	void WaitUntilIdle() override
+	{
+		signal_.Wait([this] { return (keyFrameQueue_.Empty() && !busy_) || isFinished(); });
+	}
+
 	void RequestFinish() override
 	{
-		LOCK_MUTEX_FINISH();
-		finishRequested_ = true;
+		{
+			LOCK_MUTEX_FINISH();
+			finishRequested_ = true;
+		}
+		signal_.Notify();
 	}
 
 	bool isFinished() const override
@@ -814,19 +898,27 @@ public:
 
 	bool CheckNewKeyFrames() const
 	{
-		LOCK_MUTEX_LOOP_QUEUE();
-		return(!keyFrameQueue_.empty());
+		return !keyFrameQueue_.Empty();
 	}
 
 	void ResetIfRequested()
 	{
-		LOCK_MUTEX_RESET();
-		if (resetRequested_)
 		{
-			keyFrameQueue_.clear();
+			LOCK_MUTEX_RESET();
+			if (!resetRequested_)
+				return;
+
+			keyFrameQueue_.Clear();
 			lastLoopKFId_ = 0;
 			resetRequested_ = false;
 		}
+		signal_.Notify();
+	}
+
+	bool CheckReset() const
+	{
+		LOCK_MUTEX_RESET();
+		return resetRequested_;
 	}
 
 	bool CheckFinish() const
@@ -848,12 +940,13 @@ private:
 	bool resetRequested_;
 	bool finishRequested_;
 	bool finished_;
+	std::atomic<bool> busy_;
 	frameid_t lastLoopKFId_;
 
 	Tracking* tracker_;
 	LocalMapping* localMapper_;
 
-	std::list<KeyFrame*> keyFrameQueue_;
+	KeyFrameQueue keyFrameQueue_;
 
 	// Loop detector variables
 	KeyFrameDatabase* keyframeDB_;
@@ -865,12 +958,15 @@ private:
 
 	mutable std::mutex mutexReset_;
 	mutable std::mutex mutexFinish_;
-	mutable std::mutex mutexLoopQueue_;
+
+	// Wakes up the loop closing thread and the threads waiting for a reset or for the queue to be processed
+	ThreadSignal signal_;
 };
 
-LoopClosing::Pointer LoopClosing::Create(Map* map, KeyFrameDatabase* keyframeDB, ORBVocabulary* voc, bool fixScale)
+LoopClosing::Pointer LoopClosing::Create(Map* map, KeyFrameDatabase* keyframeDB, const ORBVocabulary* voc, bool fixScale,
+	const ThreadParams& globalBAThread)
 {
-	return std::make_unique<LoopClosingImpl>(map, keyframeDB, voc, fixScale);
+	return std::make_unique<LoopClosingImpl>(map, keyframeDB, voc, fixScale, globalBAThread);
 }
 
 LoopClosing::~LoopClosing() {}
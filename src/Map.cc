@@ -21,16 +21,17 @@
 #include "Map.h"
 
 #include <mutex>
+#include <algorithm>
 
 #include "MapPoint.h"
 #include "KeyFrame.h"
 
-#define LOCK_MUTEX_MAP() std::unique_lock<std::mutex> lock(mutexMap_);
+#define LOCK_MUTEX_MAP() auto lock = LockUnlessFrozen(mutexMap_, this, LOCK_SITE("Map::Map"));
 
 namespace ORB_SLAM2
 {
 
-Map::Map() : maxKFId_(0), bigChangeId_(0) {}
+Map::Map() : maxKFId_(0), nextKFId_(0), nextMPId_(0), bigChangeId_(0), frozen_(false), atlas_(1), currentMap_(0) {}
 
 Map::~Map() { Clear(); }
 
@@ -39,6 +40,7 @@ void Map::AddKeyFrame(KeyFrame* keyframe)
 	LOCK_MUTEX_MAP();
 	keyframes_.insert(keyframe);
 	maxKFId_ = std::max(maxKFId_, keyframe->id);
+	atlas_[keyframe->mapIndex].nkeyframes++;
 }
 
 void Map::AddMapPoint(MapPoint* mappoint)
@@ -60,7 +62,8 @@ void Map::EraseMapPoint(MapPoint* mappoint)
 void Map::EraseKeyFrame(KeyFrame* keyframe)
 {
 	LOCK_MUTEX_MAP();
-	keyframes_.erase(keyframe);
+	if (keyframes_.erase(keyframe))
+		atlas_[keyframe->mapIndex].nkeyframes--;
 
 	// TODO: This only erase the pointer.
 	// Delete the KeyFrame
@@ -115,12 +118,131 @@ std::vector<MapPoint*> Map::GetReferenceMapPoints() const
 	return referenceMapPoints_;
 }
 
+int Map::CreateMap()
+{
+	LOCK_MUTEX_MAP();
+	if (atlas_[currentMap_].nkeyframes > 0)
+	{
+		currentMap_ = static_cast<int>(atlas_.size());
+		atlas_.push_back(AtlasEntry());
+		atlas_.back().mergedInto = currentMap_;
+	}
+	return currentMap_;
+}
+
+int Map::GetCurrentMap() const
+{
+	LOCK_MUTEX_MAP();
+	return FindMap(currentMap_);
+}
+
+void Map::SetCurrentMap(int mapId)
+{
+	LOCK_MUTEX_MAP();
+	currentMap_ = mapId;
+}
+
+int Map::GetMapId(const KeyFrame* keyframe) const
+{
+	LOCK_MUTEX_MAP();
+	return FindMap(keyframe->mapIndex);
+}
+
+std::vector<int> Map::GetMapIds() const
+{
+	LOCK_MUTEX_MAP();
+	std::vector<int> mapIds(atlas_.size());
+	for (size_t i = 0; i < atlas_.size(); i++)
+		mapIds[i] = FindMap(static_cast<int>(i));
+	return mapIds;
+}
+
+void Map::MergeMaps(int from, int into)
+{
+	LOCK_MUTEX_MAP();
+	from = FindMap(from);
+	into = FindMap(into);
+	if (from != into)
+		atlas_[from].mergedInto = into;
+}
+
+size_t Map::KeyFramesInMap(int mapId) const
+{
+	LOCK_MUTEX_MAP();
+	size_t nkeyframes = 0;
+	for (size_t i = 0; i < atlas_.size(); i++)
+		if (FindMap(static_cast<int>(i)) == mapId)
+			nkeyframes += atlas_[i].nkeyframes;
+	return nkeyframes;
+}
+
+int Map::MapsInAtlas() const
+{
+	LOCK_MUTEX_MAP();
+	std::vector<size_t> nkeyframes(atlas_.size(), 0);
+	for (size_t i = 0; i < atlas_.size(); i++)
+		nkeyframes[FindMap(static_cast<int>(i))] += atlas_[i].nkeyframes;
+	return static_cast<int>(std::count_if(std::begin(nkeyframes), std::end(nkeyframes), [](size_t n) { return n > 0; }));
+}
+
+bool Map::IsAnchor(const KeyFrame* keyframe) const
+{
+	if (!keyframe->origin)
+		return false;
+
+	LOCK_MUTEX_MAP();
+	return atlas_[keyframe->mapIndex].mergedInto == keyframe->mapIndex;
+}
+
+int Map::FindMap(int index) const
+{
+	// Merges are rare and the chains short
+	while (atlas_[index].mergedInto != index)
+		index = atlas_[index].mergedInto;
+	return index;
+}
+
 frameid_t Map::GetMaxKFid() const
 {
 	LOCK_MUTEX_MAP();
 	return maxKFId_;
 }
 
+void Map::AddMemoryUsage(MemoryStats& stats) const
+{
+	std::vector<KeyFrame*> keyframes, erasedKeyframes;
+	std::vector<MapPoint*> mappoints, erasedMappoints;
+	{
+		LOCK_MUTEX_MAP();
+		keyframes.assign(std::begin(keyframes_), std::end(keyframes_));
+		mappoints.assign(std::begin(mappoints_), std::end(mappoints_));
+		erasedKeyframes.assign(std::begin(erasedKeyframes_), std::end(erasedKeyframes_));
+		erasedMappoints.assign(std::begin(erasedMappoints_), std::end(erasedMappoints_));
+		stats.mapIndex += HeapBytes(keyframes_) + HeapBytes(mappoints_) + HeapBytes(erasedKeyframes_) +
+			HeapBytes(erasedMappoints_) + HeapBytes(referenceMapPoints_) + HeapBytes(keyFrameOrigins) + HeapBytes(atlas_);
+	}
+
+	// Keyframes and map points are only deleted by Clear
+	for (const KeyFrame* keyframe : keyframes)
+		keyframe->AddMemoryUsage(stats.keyframes);
+	for (const MapPoint* mappoint : mappoints)
+		mappoint->AddMemoryUsage(stats.mappoints);
+	for (const KeyFrame* keyframe : erasedKeyframes)
+		keyframe->AddMemoryUsage(stats.erasedKeyframes);
+	for (const MapPoint* mappoint : erasedMappoints)
+		mappoint->AddMemoryUsage(stats.erasedMappoints);
+}
+
+frameid_t Map::NewKeyFrameId()
+{
+	return nextKFId_++;
+}
+
+mappointid_t Map::NewMapPointId()
+{
+	return nextMPId_++;
+}
+
 void Map::Clear()
 {
 	// Merge all MapPoints and delete
@@ -135,9 +257,35 @@ void Map::Clear()
 
 	mappoints_.clear();
 	keyframes_.clear();
+	erasedMappoints_.clear();
+	erasedKeyframes_.clear();
 	maxKFId_ = 0;
+	nextKFId_ = 0;
+	nextMPId_ = 0;
 	referenceMapPoints_.clear();
 	keyFrameOrigins.clear();
+	atlas_.assign(1, AtlasEntry());
+	currentMap_ = 0;
+}
+
+void Map::Freeze()
+{
+	LOCK_MUTEX_MAP();
+	frozen_.store(true, std::memory_order_release);
+}
+
+bool Map::IsFrozen() const
+{
+	return frozen_.load(std::memory_order_acquire);
+}
+
+Map::AtlasEntry::AtlasEntry() : mergedInto(0), nkeyframes(0) {}
+
+std::unique_lock<std::mutex> LockUnlessFrozen(std::mutex& mutex, const Map* map, LockSite* site)
+{
+	if (map && map->IsFrozen())
+		return std::unique_lock<std::mutex>(mutex, std::defer_lock);
+	return LockMutex(mutex, site);
 }
 
 } //namespace ORB_SLAM
@@ -20,6 +20,8 @@
 
 #include "MapDrawer.h"
 
+#include <algorithm>
+
 #include "Map.h"
 #include "MapPoint.h"
 #include "KeyFrame.h"
@@ -40,6 +42,13 @@ MapDrawer::MapDrawer(Map* map, const std::string &settingsFile) : map_(map)
 	cameraLineWidth_ = settings["Viewer.CameraLineWidth"];
 }
 
+// True if the keyframe belongs to the map. mapIds is a snapshot of Map::GetMapIds,
+// so that the map mutex is not taken for every keyframe and map point.
+static bool InMap(const KeyFrame* keyframe, const std::vector<int>& mapIds, int mapId)
+{
+	return keyframe->mapIndex < static_cast<int>(mapIds.size()) && mapIds[keyframe->mapIndex] == mapId;
+}
+
 void MapDrawer::DrawMapPoints() const
 {
 	const std::vector<MapPoint*>& mappionts = map_->GetAllMapPoints();
@@ -50,13 +59,17 @@ void MapDrawer::DrawMapPoints() const
 	if (mappionts.empty())
 		return;
 
+	// Other maps of the atlas are in their own frame
+	const int mapId = map_->GetCurrentMap();
+	const std::vector<int> mapIds = map_->GetMapIds();
+
 	glPointSize(pointSize_);
 	glBegin(GL_POINTS);
 	glColor3f(0.f, 0.f, 0.f);
 
 	for (MapPoint* mappoint : mappionts)
 	{
-		if (mappoint->isBad() || referenceMPs.count(mappoint))
+		if (mappoint->isBad() || referenceMPs.count(mappoint) || !InMap(mappoint->GetReferenceKeyFrame(), mapIds, mapId))
 			continue;
 		const Point3D pos = mappoint->GetWorldPos();
 		glVertex3f(pos(0), pos(1), pos(2));
@@ -84,7 +97,12 @@ void MapDrawer::DrawKeyFrames(bool drawKF, bool drawGraph) const
 	const float h = 0.75f * w;
 	const float z = 0.6f * w;
 
-	const std::vector<KeyFrame*> keyframes = map_->GetAllKeyFrames();
+	// Only the current map of the atlas
+	std::vector<KeyFrame*> keyframes = map_->GetAllKeyFrames();
+	const int mapId = map_->GetCurrentMap();
+	const std::vector<int> mapIds = map_->GetMapIds();
+	keyframes.erase(std::remove_if(std::begin(keyframes), std::end(keyframes),
+		[&](const KeyFrame* keyframe) { return !InMap(keyframe, mapIds, mapId); }), std::end(keyframes));
 
 	if (drawKF)
 	{
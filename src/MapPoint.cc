@@ -25,10 +25,9 @@
 #include "Map.h"
 #include "ORBmatcher.h"
 
-#define LOCK_MUTEX_POINT_CREATION() std::unique_lock<std::mutex> lock1(map_->mutexPointCreation);
-#define LOCK_MUTEX_POSITION()       std::unique_lock<std::mutex> lock2(mutexPos_);
-#define LOCK_MUTEX_FEATURES()       std::unique_lock<std::mutex> lock3(mutexFeatures_);
-#define LOCK_MUTEX_GLOBAL()         std::unique_lock<std::mutex> lock4(GetGlobalMutex());
+#define LOCK_MUTEX_POSITION()       auto lock2 = LockUnlessFrozen(mutexPos_, map_, LOCK_SITE("MapPoint::Position"));
+#define LOCK_MUTEX_FEATURES()       auto lock3 = LockUnlessFrozen(mutexFeatures_, map_, LOCK_SITE("MapPoint::Features"));
+#define LOCK_MUTEX_GLOBAL()         auto lock4 = LockUnlessFrozen(map_->mutexPointPositions, map_, LOCK_SITE("Map::PointPositions"));
 
 namespace ORB_SLAM2
 {
@@ -39,26 +38,22 @@ static inline Vec3D Normalized(const Vec3D& v)
 	return invn * v;
 }
 
-MapPoint::mappointid_t MapPoint::nextId = 0;
-
 MapPoint::MapPoint(const Point3D& Xw, KeyFrame* referenceKF, Map* map) :
-	firstKFid(referenceKF->id), firstFrame(referenceKF->frameId), trackReferenceForFrame(0), lastFrameSeen(0),
+	firstKFid(referenceKF->id), firstFrame(referenceKF->frameId), lastFrameSeen(0),
 	BALocalForKF(0), fuseCandidateForKF(0), loopPointForKF(0), correctedByKF(0),
-	correctedReference(0), BAGlobalForKF(0), nobservations_(0), referenceKF_(referenceKF), nvisible_(1), nfound_(1), bad_(false),
+	correctedReference(0), BAGlobalForKF(0), nobservations_(0), observationsVersion_(0), referenceKF_(referenceKF), nvisible_(1), nfound_(1), bad_(false),
 	replaced_(nullptr), minDistance_(0), maxDistance_(0), map_(map)
 {
 	Xw_ = Xw;
 	normal_ = Vec3D::zeros();
 	
-	// MapPoints can be created from Tracking and Local Mapping. This mutex avoid conflicts with id.
-	LOCK_MUTEX_POINT_CREATION();
-	id = nextId++;
+	id = map_->NewMapPointId();
 }
 
 MapPoint::MapPoint(const Point3D& Xw, Map* map, Frame* frame, int idx) :
-	firstKFid(-1), firstFrame(frame->id), trackReferenceForFrame(0), lastFrameSeen(0),
+	firstKFid(-1), firstFrame(frame->id), lastFrameSeen(0),
 	BALocalForKF(0), fuseCandidateForKF(0), loopPointForKF(0), correctedByKF(0),
-	correctedReference(0), BAGlobalForKF(0), nobservations_(0), referenceKF_(nullptr), nvisible_(1),
+	correctedReference(0), BAGlobalForKF(0), nobservations_(0), observationsVersion_(0), referenceKF_(nullptr), nvisible_(1),
 	nfound_(1), bad_(false), replaced_(nullptr), map_(map)
 {
 
@@ -76,9 +71,7 @@ MapPoint::MapPoint(const Point3D& Xw, Map* map, Frame* frame, int idx) :
 
 	frame->descriptors.row(idx).copyTo(descriptor_);
 
-	// MapPoints can be created from Tracking and Local Mapping. This mutex avoid conflicts with id.
-	LOCK_MUTEX_POINT_CREATION();
-	id = nextId++;
+	id = map_->NewMapPointId();
 }
 
 void MapPoint::SetWorldPos(const Point3D& Xw)
@@ -114,6 +107,7 @@ void MapPoint::AddObservation(KeyFrame* keyframe, size_t idx)
 		return;
 
 	observations_[keyframe] = idx;
+	observationsVersion_++;
 
 	if (keyframe->uright[idx] >= 0)
 		nobservations_ += 2;
@@ -135,6 +129,7 @@ void MapPoint::EraseObservation(KeyFrame* keyframe)
 				nobservations_--;
 
 			observations_.erase(keyframe);
+			observationsVersion_++;
 
 			if (referenceKF_ == keyframe)
 				referenceKF_ = !observations_.empty() ? std::begin(observations_)->first : nullptr;
@@ -161,6 +156,11 @@ int MapPoint::Observations() const
 	return nobservations_;
 }
 
+unsigned int MapPoint::GetObservationsVersion() const
+{
+	return observationsVersion_;
+}
+
 void MapPoint::SetBadFlag()
 {
 	std::map<KeyFrame*, size_t> observations;
@@ -170,6 +170,7 @@ void MapPoint::SetBadFlag()
 		bad_ = true;
 		observations = observations_;
 		observations_.clear();
+		observationsVersion_++;
 	}
 
 	for (const auto& observation : observations)
@@ -200,6 +201,7 @@ void MapPoint::Replace(MapPoint* mappoint)
 		LOCK_MUTEX_POSITION();
 		observations = observations_;
 		observations_.clear();
+		observationsVersion_++;
 		bad_ = true;
 		nvisible = nvisible_;
 		nfound = nfound_;
@@ -379,6 +381,15 @@ void MapPoint::UpdateNormalAndDepth()
 	}
 }
 
+void MapPoint::AddMemoryUsage(MemoryStats::MapPoints& memory) const
+{
+	LOCK_MUTEX_FEATURES();
+	memory.count++;
+	memory.observations += HeapBytes(observations_);
+	memory.descriptors += HeapBytes(descriptor_);
+	memory.other += sizeof(*this);
+}
+
 float MapPoint::GetMinDistanceInvariance() const
 {
 	LOCK_MUTEX_POSITION();
@@ -413,10 +424,4 @@ int MapPoint::PredictScale(float dist, const Frame* frame) const
 	return std::max(0, std::min(scale, frame->pyramid.nlevels - 1));
 }
 
-std::mutex& MapPoint::GetGlobalMutex()
-{
-	static std::mutex globalMutex;
-	return globalMutex;
-}
-
 } //namespace ORB_SLAM
@@ -0,0 +1,98 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "MemoryStats.h"
+
+#include <iomanip>
+
+namespace ORB_SLAM2
+{
+
+static double MB(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+size_t MemoryStats::KeyFrames::Total() const
+{
+	return keypoints + descriptors + grid + bow + graph + other;
+}
+
+size_t MemoryStats::MapPoints::Total() const
+{
+	return observations + descriptors + other;
+}
+
+size_t MemoryStats::Total() const
+{
+	return keyframes.Total() + mappoints.Total() + erasedKeyframes.Total() + erasedMappoints.Total() +
+		mapIndex + keyFrameDatabase + vocabulary + trajectory;
+}
+
+// Name and size columns of a line, the details follow
+static std::ostream& PrintColumns(std::ostream& os, const char* name, size_t bytes)
+{
+	return os << "  " << std::left << std::setw(20) << name << std::right << std::setw(10) << MB(bytes);
+}
+
+static void PrintKeyFrames(std::ostream& os, const char* name, const MemoryStats::KeyFrames& memory)
+{
+	PrintColumns(os, name, memory.Total())
+		<< "  (" << memory.count << ": keypoints " << MB(memory.keypoints) << ", descriptors " << MB(memory.descriptors)
+		<< ", grid " << MB(memory.grid) << ", BoW " << MB(memory.bow) << ", graph " << MB(memory.graph)
+		<< ", other " << MB(memory.other) << ")" << std::endl;
+}
+
+static void PrintMapPoints(std::ostream& os, const char* name, const MemoryStats::MapPoints& memory)
+{
+	PrintColumns(os, name, memory.Total())
+		<< "  (" << memory.count << ": observations " << MB(memory.observations)
+		<< ", descriptors " << MB(memory.descriptors) << ", other " << MB(memory.other) << ")" << std::endl;
+}
+
+void PrintMemoryStats(std::ostream& os, const MemoryStats& stats)
+{
+	const auto flags = os.flags();
+	const auto precision = os.precision();
+	os << std::fixed << std::setprecision(2);
+
+	os << "Memory (MB): " << MB(stats.Total()) << std::endl;
+	PrintKeyFrames(os, "keyframes", stats.keyframes);
+	PrintMapPoints(os, "map points", stats.mappoints);
+	PrintKeyFrames(os, "erased keyframes", stats.erasedKeyframes);
+	PrintMapPoints(os, "erased map points", stats.erasedMappoints);
+	PrintColumns(os, "map index", stats.mapIndex) << std::endl;
+	PrintColumns(os, "keyframe database", stats.keyFrameDatabase) << "  (" << stats.keyFrameDatabaseEntries << " entries)" << std::endl;
+	PrintColumns(os, "vocabulary", stats.vocabulary) << std::endl;
+	PrintColumns(os, "trajectory", stats.trajectory) << "  (" << stats.trajectoryFrames << " frames)" << std::endl;
+
+	os.flags(flags);
+	os.precision(precision);
+}
+
+MemoryStats::KeyFrames::KeyFrames() : count(0), keypoints(0), descriptors(0), grid(0), bow(0), graph(0), other(0) {}
+
+MemoryStats::MapPoints::MapPoints() : count(0), observations(0), descriptors(0), other(0) {}
+
+MemoryStats::MemoryStats()
+	: mapIndex(0), keyFrameDatabase(0), keyFrameDatabaseEntries(0), vocabulary(0), trajectory(0), trajectoryFrames(0) {}
+
+} //namespace ORB_SLAM
@@ -58,6 +58,7 @@
 #include <array>
 #include <vector>
 #include <iterator>
+#include <algorithm>
 
 #include <opencv2/opencv.hpp>
 
@@ -452,11 +453,11 @@ struct QTreeNode
 	bool divisible;
 };
 
-static void ComputePyramid(const cv::Mat& image, std::vector<cv::Mat>& images, const std::vector<float>& invScaleFactors)
+static void ComputePyramid(const cv::Mat& image, std::vector<cv::Mat>& images, const std::vector<float>& invScaleFactors,
+	int nlevels)
 {
 	CV_Assert(image.type() == CV_8U);
 
-	const int nlevels = static_cast<int>(invScaleFactors.size());
 	images.resize(nlevels);
 
 	image.copyTo(images[0]);
@@ -737,19 +738,28 @@ void ORBextractor::Init()
 	}
 
 	// Compute number of features in each scale
-	ComputeNumFeaturesPerScale(param_.nfeatures, scaleFactor, nlevels, nfeaturesPerScale_);
+	SetFeatureBudget(param_.nfeatures, nlevels);
+}
+
+void ORBextractor::SetFeatureBudget(int nfeatures, int nactiveLevels)
+{
+	nfeatures_ = std::max(nfeatures, 1);
+	nactiveLevels_ = std::max(1, std::min(nactiveLevels, param_.nlevels));
+	ComputeNumFeaturesPerScale(nfeatures_, param_.scaleFactor, nactiveLevels_, nfeaturesPerScale_);
 }
 
 void ORBextractor::Extract(const cv::Mat& image, KeyPoints& keypoints, cv::Mat& descriptors)
 {
-	const int nfeatures = param_.nfeatures;
-	const int nlevels = param_.nlevels;
+	// Only the active levels are detected. The scale factors still cover all levels,
+	// so that the predicted scales of the map points do not depend on the current budget.
+	const int nfeatures = nfeatures_;
+	const int nlevels = nactiveLevels_;
 
 	keypoints_.resize(nlevels);
 	blurImages_.resize(nlevels);
 
 	// Compute pyramid image
-	ComputePyramid(image, images_, invScaleFactors_);
+	ComputePyramid(image, images_, invScaleFactors_, nlevels);
 
 	// Detect FAST corners
 	const int BORDER = EDGE_THRESHOLD - 3;
@@ -820,6 +830,8 @@ void ORBextractor::Extract(const cv::Mat& image, KeyPoints& keypoints, cv::Mat&
 }
 
 int ORBextractor::GetLevels() const { return param_.nlevels; }
+int ORBextractor::GetNumFeatures() const { return nfeatures_; }
+int ORBextractor::GetActiveLevels() const { return nactiveLevels_; }
 float ORBextractor::GetScaleFactor() const { return param_.scaleFactor; }
 const std::vector<float>& ORBextractor::GetScaleFactors() const { return scaleFactors_; }
 const std::vector<float>& ORBextractor::GetInverseScaleFactors() const { return invScaleFactors_; }
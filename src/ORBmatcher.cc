@@ -312,6 +312,62 @@ ORBmatcher::ORBmatcher(float nnratio, bool checkOri) : fNNRatio_(nnratio), check
 {
 }
 
+// Searches the best match of a projected map point in the frame. Returns -1 if there is none.
+static int SearchProjectedPoint(const Frame& frame, MapPoint* mappoint, float u, float v, float ur,
+	int predictedScale, float viewCos, float th, float nnratio)
+{
+	// The size of the window will depend on the viewing direction
+	const float r = RadiusByViewingCos(viewCos);
+	const float radius = th * r * frame.pyramid.scaleFactors[predictedScale];
+
+	const std::vector<size_t> indices = frame.GetFeaturesInArea(u, v, radius, predictedScale - 1, predictedScale);
+	if (indices.empty())
+		return -1;
+
+	const cv::Mat desc1 = mappoint->GetDescriptor();
+
+	int bestDist = 256;
+	int bestLevel = -1;
+	int secondbestDist = 256;
+	int secondBestLevel = -1;
+	int bestIdx = -1;
+
+	// Get best and second matches with near keypoints
+	for (size_t idx : indices)
+	{
+		if (frame.mappoints[idx] && frame.mappoints[idx]->Observations() > 0)
+			continue;
+
+		if (frame.uright[idx] > 0 && fabsf(ur - frame.uright[idx]) > radius)
+			continue;
+
+		const cv::Mat desc2 = frame.descriptors.row(static_cast<int>(idx));
+		const int dist = ORBmatcher::DescriptorDistance(desc1, desc2);
+		if (dist < bestDist)
+		{
+			secondbestDist = bestDist;
+			bestDist = dist;
+			secondBestLevel = bestLevel;
+			bestLevel = frame.keypointsUn[idx].octave;
+			bestIdx = static_cast<int>(idx);
+		}
+		else if (dist < secondbestDist)
+		{
+			secondBestLevel = frame.keypointsUn[idx].octave;
+			secondbestDist = dist;
+		}
+	}
+
+	// Apply ratio to second match (only if best and second are in the same scale level)
+	if (bestDist > TH_HIGH)
+		return -1;
+
+	if (bestLevel == secondBestLevel && bestDist > nnratio * secondbestDist)
+		return -1;
+
+	return bestIdx;
+}
+
 int ORBmatcher::SearchByProjection(Frame& frame, const std::vector<MapPoint*>& mappoints, float th)
 {
 	int nmatches = 0;
@@ -321,59 +377,34 @@ int ORBmatcher::SearchByProjection(Frame& frame, const std::vector<MapPoint*>& m
 		if (!mappoint->trackInView || mappoint->isBad())
 			continue;
 
-		const int predictedScale = mappoint->trackScaleLevel;
-
-		// The size of the window will depend on the viewing direction
-		const float r = RadiusByViewingCos(mappoint->trackViewCos);
-		const float radius = th * r * frame.pyramid.scaleFactors[predictedScale];
-		const float u = mappoint->trackProjX;
-		const float v = mappoint->trackProjY;
-
-		const std::vector<size_t> indices = frame.GetFeaturesInArea(u, v, radius, predictedScale - 1, predictedScale);
-		if (indices.empty())
-			continue;
+		const int bestIdx = SearchProjectedPoint(frame, mappoint, mappoint->trackProjX, mappoint->trackProjY,
+			mappoint->trackProjXR, mappoint->trackScaleLevel, mappoint->trackViewCos, th, fNNRatio_);
 
-		const cv::Mat desc1 = mappoint->GetDescriptor();
+		if (bestIdx >= 0)
+		{
+			frame.mappoints[bestIdx] = mappoint;
+			nmatches++;
+		}
+	}
 
-		int bestDist = 256;
-		int bestLevel = -1;
-		int secondbestDist = 256;
-		int secondBestLevel = -1;
-		int bestIdx = -1;
+	return nmatches;
+}
 
-		// Get best and second matches with near keypoints
-		for (size_t idx : indices)
-		{
-			if (frame.mappoints[idx] && frame.mappoints[idx]->Observations() > 0)
-				continue;
+int ORBmatcher::SearchByProjection(Frame& frame, const std::vector<MapPointProjection>& projections, float th)
+{
+	int nmatches = 0;
 
-			if (frame.uright[idx] > 0 && fabsf(mappoint->trackProjXR - frame.uright[idx]) > radius)
-				continue;
+	for (const MapPointProjection& proj : projections)
+	{
+		if (proj.mappoint->isBad())
+			continue;
 
-			const cv::Mat desc2 = frame.descriptors.row(static_cast<int>(idx));
-			const int dist = DescriptorDistance(desc1, desc2);
-			if (dist < bestDist)
-			{
-				secondbestDist = bestDist;
-				bestDist = dist;
-				secondBestLevel = bestLevel;
-				bestLevel = frame.keypointsUn[idx].octave;
-				bestIdx = static_cast<int>(idx);
-			}
-			else if (dist < secondbestDist)
-			{
-				secondBestLevel = frame.keypointsUn[idx].octave;
-				secondbestDist = dist;
-			}
-		}
+		const int bestIdx = SearchProjectedPoint(frame, proj.mappoint, proj.x, proj.y, proj.xR,
+			proj.scaleLevel, proj.viewCos, th, fNNRatio_);
 
-		// Apply ratio to second match (only if best and second are in the same scale level)
-		if (bestDist <= TH_HIGH)
+		if (bestIdx >= 0)
 		{
-			if (bestLevel == secondBestLevel && bestDist > fNNRatio_ * secondbestDist)
-				continue;
-
-			frame.mappoints[bestIdx] = mappoint;
+			frame.mappoints[bestIdx] = proj.mappoint;
 			nmatches++;
 		}
 	}
@@ -405,48 +436,41 @@ static bool CheckDistEpipolarLine(const cv::KeyPoint& keypoint1, const cv::KeyPo
 
 struct FeatureVectorIterator
 {
-	using Iterator = DBoW2::FeatureVector::const_iterator;
-	using Indices = Iterator::value_type::second_type;
+	using Indices = DBoW2::FeatureVector::Features;
 
-	FeatureVectorIterator(const DBoW2::FeatureVector& fv1, const DBoW2::FeatureVector& fv2) : fv1(fv1), fv2(fv2)
-	{
-		it1 = std::cbegin(fv1);
-		it2 = std::cbegin(fv2);
-	}
+	FeatureVectorIterator(const DBoW2::FeatureVector& fv1, const DBoW2::FeatureVector& fv2)
+		: fv1(fv1), fv2(fv2), nodes1(fv1.nodes()), nodes2(fv2.nodes()), node1(0), node2(0), it1(0), it2(0) {}
 
-	bool end() const { return it1 == std::cend(fv1) || it2 == std::cend(fv2); }
+	bool end() const { return it1 >= nodes1.size() || it2 >= nodes2.size(); }
 
 	bool next()
 	{
+		// node ids are sorted flat arrays, so a linear merge visits each once
 		while (!end())
 		{
-			if (it1->first == it2->first)
+			const DBoW2::NodeId id1 = nodes1[it1];
+			const DBoW2::NodeId id2 = nodes2[it2];
+			if (id1 == id2)
 			{
-				node1 = it1;
-				node2 = it2;
-				++it1;
-				++it2;
+				node1 = it1++;
+				node2 = it2++;
 				return true;
 			}
-			else if (it1->first < it2->first)
-			{
-				it1 = fv1.lower_bound(it2->first);
-			}
-			else
-			{
-				it2 = fv2.lower_bound(it1->first);
-			}
+			it1 += id1 < id2;
+			it2 += id2 < id1;
 		}
 
 		return false;
 	}
 
-	const Indices& indices1() const { return node1->second; };
-	const Indices& indices2() const { return node2->second; };
+	Indices indices1() const { return fv1.features(node1); };
+	Indices indices2() const { return fv2.features(node2); };
 
 	const DBoW2::FeatureVector& fv1;
 	const DBoW2::FeatureVector& fv2;
-	Iterator node1, node2, it1, it2;
+	const std::vector<DBoW2::NodeId>& nodes1;
+	const std::vector<DBoW2::NodeId>& nodes2;
+	size_t node1, node2, it1, it2;
 };
 
 int ORBmatcher::SearchByBoW(KeyFrame* keyframe, Frame& frame, std::vector<MapPoint*>& matches)
@@ -198,11 +198,11 @@ void Optimizer::GlobalBundleAdjustemnt(Map* map, int niterations, bool* stopFlag
 {
 	std::vector<KeyFrame*> keyframes = map->GetAllKeyFrames();
 	std::vector<MapPoint*> mappoints = map->GetAllMapPoints();
-	BundleAdjustment(keyframes, mappoints, niterations, stopFlag, loopKFId, robust);
+	BundleAdjustment(map, keyframes, mappoints, niterations, stopFlag, loopKFId, robust);
 }
 
-void Optimizer::BundleAdjustment(const std::vector<KeyFrame*>& keyframes, const std::vector<MapPoint*>& mappoints,
-	int niterations, bool* stopFlag, frameid_t loopKFId, bool robust)
+void Optimizer::BundleAdjustment(const Map* map, const std::vector<KeyFrame*>& keyframes,
+	const std::vector<MapPoint*>& mappoints, int niterations, bool* stopFlag, frameid_t loopKFId, bool robust)
 {
 	g2o::SparseOptimizer optimizer;
 	CreateOptimizer<g2o::LinearSolverEigen, g2o::BlockSolver_6_3>(optimizer);
@@ -217,7 +217,7 @@ void Optimizer::BundleAdjustment(const std::vector<KeyFrame*>& keyframes, const
 		if (keyframe->isBad())
 			continue;
 
-		auto vertex = CreateVertexSE3(ToSE3Quat(keyframe->GetPose()), keyframe->id, keyframe->id == 0);
+		auto vertex = CreateVertexSE3(ToSE3Quat(keyframe->GetPose()), keyframe->id, map->IsAnchor(keyframe));
 		optimizer.addVertex(vertex);
 		maxKFId = std::max(maxKFId, keyframe->id);
 	}
@@ -342,7 +342,7 @@ void Optimizer::BundleAdjustment(const std::vector<KeyFrame*>& keyframes, const
 	}
 }
 
-int Optimizer::PoseOptimization(Frame* frame)
+int Optimizer::PoseOptimization(Frame* frame, Map* map)
 {
 	g2o::SparseOptimizer optimizer;
 	CreateOptimizer<g2o::LinearSolverDense, g2o::BlockSolver_6_3>(optimizer);
@@ -360,7 +360,7 @@ int Optimizer::PoseOptimization(Frame* frame)
 	std::vector<g2o::HyperGraph::Edge*> edges;
 
 	{
-		std::unique_lock<std::mutex> lock(MapPoint::GetGlobalMutex());
+		auto lock = LockUnlessFrozen(map->mutexPointPositions, map, LOCK_SITE("Map::PointPositions"));
 
 		for (int i = 0; i < nkeypoints; i++)
 		{
@@ -490,6 +490,10 @@ int Optimizer::PoseOptimization(Frame* frame)
 
 void Optimizer::LocalBundleAdjustment(KeyFrame* currKeyFrame, bool* stopFlag, Map* map)
 {
+	// Read section: the problem is built from the current poses and positions.
+	// It does not block the tracking, only the corrections of the map.
+	auto readLock = LockShared(map->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
+
 	// Local KeyFrames: First Breath Search from Current Keyframe
 	std::list<KeyFrame*> localKFs;
 
@@ -548,7 +552,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame* currKeyFrame, bool* stopFlag, Ma
 	// Set Local KeyFrame vertices
 	for (KeyFrame* localKF : localKFs)
 	{
-		auto vertex = CreateVertexSE3(ToSE3Quat(localKF->GetPose()), localKF->id, localKF->id == 0);
+		auto vertex = CreateVertexSE3(ToSE3Quat(localKF->GetPose()), localKF->id, map->IsAnchor(localKF));
 		optimizer.addVertex(vertex);
 		maxKFId = std::max(maxKFId, localKF->id);
 	}
@@ -630,6 +634,8 @@ void Optimizer::LocalBundleAdjustment(KeyFrame* currKeyFrame, bool* stopFlag, Ma
 		}
 	}
 
+	readLock.unlock();
+
 	if (stopFlag && *stopFlag)
 		return;
 
@@ -701,8 +707,8 @@ void Optimizer::LocalBundleAdjustment(KeyFrame* currKeyFrame, bool* stopFlag, Ma
 		}
 	}
 
-	// Get Map Mutex
-	std::unique_lock<std::mutex> lock(map->mutexMapUpdate);
+	// Write section: get Map Mutex
+	auto lock = LockMutex(map->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
 
 	if (!toErase.empty())
 	{
@@ -906,7 +912,7 @@ void Optimizer::OptimizeEssentialGraph(Map* map, KeyFrame* loopKF, KeyFrame* cur
 	optimizer.initializeOptimization();
 	optimizer.optimize(20);
 
-	std::unique_lock<std::mutex> lock(map->mutexMapUpdate);
+	auto lock = LockMutex(map->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
 
 	// SE3 Pose Recovering. Sim3:[sR t;0 1] -> SE3:[R t/s;0 1]
 	for (KeyFrame* keyframe : keyframes)
@@ -55,7 +55,6 @@
 #include <vector>
 #include <cmath>
 #include <opencv2/core/core.hpp>
-#include "Thirdparty/DBoW2/DUtils/Random.h"
 #include <algorithm>
 
 using namespace std;
@@ -66,7 +65,7 @@ namespace ORB_SLAM2
 
 PnPsolver::PnPsolver(const Frame &F, const vector<MapPoint*> &vpMapPointMatches) :
 	pws(0), us(0), alphas(0), pcs(0), maximum_number_of_correspondences(0), number_of_correspondences(0), mnInliersi(0),
-	mnIterations(0), mnBestInliers(0), N(0)
+	mnIterations(0), mnBestInliers(0), N(0), mRng(0)
 {
 	mvpMapPointMatches = vpMapPointMatches;
 	mvP2D.reserve(F.mappoints.size());
@@ -190,7 +189,8 @@ cv::Mat PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInlie
 		// Get min set of points
 		for (short i = 0; i < mRansacMinSet; ++i)
 		{
-			int randi = DUtils::Random::RandomInt(0, static_cast<int>(vAvailableIndices.size()) - 1);
+			std::uniform_int_distribution<int> distribution(0, static_cast<int>(vAvailableIndices.size()) - 1);
+			int randi = distribution(mRng);
 
 			int idx = static_cast<int>(vAvailableIndices[randi]);
 
@@ -863,21 +863,11 @@ void PnPsolver::gauss_newton(const cv::Mat& L_6x10, const cv::Mat& Rho,
 
 void PnPsolver::qr_solve(cv::Mat& A, cv::Mat& b, cv::Mat& X)
 {
-	static int max_nr = 0;
-	static double * A1, *A2;
-
 	const int nr = A.rows;
 	const int nc = A.cols;
 
-	if (max_nr != 0 && max_nr < nr) {
-		delete[] A1;
-		delete[] A2;
-	}
-	if (max_nr < nr) {
-		max_nr = nr;
-		A1 = new double[nr];
-		A2 = new double[nr];
-	}
+	// local buffers, so that several solvers can run concurrently
+	std::vector<double> A1(nr), A2(nr);
 
 	double * pA = A.ptr<double>(), *ppAkk = pA;
 	for (int k = 0; k < nc; k++) {
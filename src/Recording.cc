@@ -0,0 +1,282 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Recording.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>
+
+#include "ThreadParams.h"
+
+namespace ORB_SLAM2
+{
+
+// File layout:
+// header: magic (8 bytes), sensor (int32)
+// frame: timestamp (double), number of images (uint32), images
+// image: rows, cols, type (int32), encoding (uint32), size in bytes (uint64), data
+static const char RECORDING_MAGIC[8] = { 'O', 'R', 'B', 'R', 'E', 'C', '0', '1' };
+
+enum ImageEncoding : uint32_t
+{
+	ENCODING_RAW = 0,
+	ENCODING_PNG = 1
+};
+
+// Frames waiting to be written before Write blocks
+static const size_t RECORDER_QUEUE_SIZE = 16;
+
+template <class T>
+static void WriteValue(std::ostream& os, const T& value)
+{
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static bool ReadValue(std::istream& is, T& value)
+{
+	return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static void WriteImage(std::ostream& os, const cv::Mat& image, std::vector<uchar>& buffer)
+{
+	// PNG is lossless for 8 and 16-bit images, and fast at the lowest compression level
+	const int depth = image.depth();
+	const bool png = (depth == CV_8U || depth == CV_16U) && image.channels() != 2 &&
+		cv::imencode(".png", image, buffer, { cv::IMWRITE_PNG_COMPRESSION, 1 });
+
+	WriteValue(os, static_cast<int32_t>(image.rows));
+	WriteValue(os, static_cast<int32_t>(image.cols));
+	WriteValue(os, static_cast<int32_t>(image.type()));
+	if (png)
+	{
+		WriteValue(os, static_cast<uint32_t>(ENCODING_PNG));
+		WriteValue(os, static_cast<uint64_t>(buffer.size()));
+		os.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	}
+	else
+	{
+		const size_t rowBytes = image.cols * image.elemSize();
+		WriteValue(os, static_cast<uint32_t>(ENCODING_RAW));
+		WriteValue(os, static_cast<uint64_t>(rowBytes * image.rows));
+		for (int y = 0; y < image.rows; y++)
+			os.write(reinterpret_cast<const char*>(image.ptr(y)), rowBytes);
+	}
+}
+
+static bool ReadImage(std::istream& is, cv::Mat& image, std::vector<uchar>& buffer)
+{
+	int32_t rows, cols, type;
+	uint32_t encoding;
+	uint64_t size;
+	if (!ReadValue(is, rows) || !ReadValue(is, cols) || !ReadValue(is, type) || !ReadValue(is, encoding) || !ReadValue(is, size))
+		return false;
+
+	if (rows < 0 || cols < 0)
+		return false;
+
+	if (encoding == ENCODING_RAW)
+	{
+		image.create(rows, cols, type);
+		if (size != image.total() * image.elemSize())
+			return false;
+		return size == 0 || static_cast<bool>(is.read(reinterpret_cast<char*>(image.data), size));
+	}
+
+	if (encoding == ENCODING_PNG)
+	{
+		buffer.resize(size);
+		if (!is.read(reinterpret_cast<char*>(buffer.data()), size))
+			return false;
+		image = cv::imdecode(buffer, cv::IMREAD_UNCHANGED);
+		return image.rows == rows && image.cols == cols && image.type() == type;
+	}
+
+	return false;
+}
+
+class RecorderImpl : public Recorder
+{
+public:
+
+	RecorderImpl(const std::string& filename, std::ofstream& ofs)
+		: filename_(filename), ofs_(std::move(ofs)), stop_(false), failed_(false)
+	{
+		worker_ = LaunchThread(ThreadParams("orb-recorder"), &RecorderImpl::Run, this);
+	}
+
+	void Write(const cv::Mat& image, const cv::Mat& image2, double timestamp) override
+	{
+		DatasetFrame frame;
+		frame.image = image.clone();
+		frame.image2 = image2.clone();
+		frame.timestamp = timestamp;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cond_.wait(lock, [this] { return queue_.size() < RECORDER_QUEUE_SIZE; });
+			queue_.push_back(std::move(frame));
+		}
+		cond_.notify_all();
+	}
+
+	~RecorderImpl()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		cond_.notify_all();
+		worker_.join();
+	}
+
+private:
+
+	void Run()
+	{
+		std::vector<uchar> buffer;
+		for (;;)
+		{
+			DatasetFrame frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				cond_.wait(lock, [this] { return !queue_.empty() || stop_; });
+				if (queue_.empty())
+					break;
+				frame = std::move(queue_.front());
+				queue_.pop_front();
+			}
+			cond_.notify_all();
+
+			const uint32_t numImages = frame.image2.empty() ? 1 : 2;
+			WriteValue(ofs_, frame.timestamp);
+			WriteValue(ofs_, numImages);
+			WriteImage(ofs_, frame.image, buffer);
+			if (numImages > 1)
+				WriteImage(ofs_, frame.image2, buffer);
+
+			if (ofs_.fail() && !failed_)
+			{
+				std::cerr << "Failed to write the recording " << filename_ << std::endl;
+				failed_ = true;
+			}
+		}
+		ofs_.flush();
+	}
+
+	std::string filename_;
+	std::ofstream ofs_;
+	std::deque<DatasetFrame> queue_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	bool stop_;
+	bool failed_;
+	std::thread worker_;
+};
+
+class RecordingReaderImpl : public RecordingReader
+{
+public:
+
+	RecordingReaderImpl(std::ifstream& ifs, int sensor) : ifs_(std::move(ifs)), sensor_(sensor) {}
+
+	int GetSensor() const override
+	{
+		return sensor_;
+	}
+
+	bool Read(DatasetFrame& frame) override
+	{
+		uint32_t numImages;
+		if (!ReadValue(ifs_, frame.timestamp) || !ReadValue(ifs_, numImages) || numImages < 1 || numImages > 2)
+			return false;
+
+		// The images are decoded into new buffers, the previous frame may still be in use
+		frame.image = cv::Mat();
+		frame.image2 = cv::Mat();
+		if (!ReadImage(ifs_, frame.image, buffer_))
+			return false;
+		return numImages < 2 || ReadImage(ifs_, frame.image2, buffer_);
+	}
+
+private:
+
+	std::ifstream ifs_;
+	int sensor_;
+	std::vector<uchar> buffer_;
+};
+
+Recorder::Pointer Recorder::Create(const std::string& filename, int sensor)
+{
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs.is_open())
+	{
+		std::cerr << "Failed to create the recording " << filename << std::endl;
+		return nullptr;
+	}
+
+	ofs.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+	WriteValue(ofs, static_cast<int32_t>(sensor));
+	return std::make_unique<RecorderImpl>(filename, ofs);
+}
+
+Recorder::~Recorder() {}
+
+RecordingReader::Pointer RecordingReader::Open(const std::string& filename)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs.is_open())
+	{
+		std::cerr << "Failed to open the recording " << filename << std::endl;
+		return nullptr;
+	}
+
+	char magic[sizeof(RECORDING_MAGIC)];
+	int32_t sensor;
+	if (!ifs.read(magic, sizeof(magic)) || std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 || !ReadValue(ifs, sensor))
+	{
+		std::cerr << filename << " is not a recording" << std::endl;
+		return nullptr;
+	}
+
+	return std::make_unique<RecordingReaderImpl>(ifs, sensor);
+}
+
+RecordingReader::~RecordingReader() {}
+
+void SaveFrameTimes(const std::string& filename, const std::vector<double>& timestamps, const std::vector<double>& times)
+{
+	std::ofstream file(filename);
+	file << std::fixed;
+	for (size_t i = 0; i < times.size(); i++)
+		file << std::setprecision(6) << timestamps[i] << " " << std::setprecision(9) << times[i] << std::endl;
+}
+
+} //namespace ORB_SLAM
@@ -0,0 +1,310 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Relocalizer.h"
+
+#include <set>
+#include <algorithm>
+
+#include "Map.h"
+#include "KeyFrame.h"
+#include "KeyFrameDatabase.h"
+#include "Frame.h"
+#include "ORBmatcher.h"
+#include "PnPsolver.h"
+#include "Optimizer.h"
+
+namespace ORB_SLAM2
+{
+
+// Frames after the last tracked one during which its pose is used as a prior
+static const int PRIOR_MAX_FRAMES = 30;
+
+// Covisible keyframes of the reference keyframe searched around the pose prior
+static const int PRIOR_NEIGHBORS = 10;
+
+Relocalizer::Relocalizer(Map* map, const KeyFrameDatabase* keyFrameDB)
+	: map_(map), keyFrameDB_(keyFrameDB), lastRelocFrameId_(0), priorKF_(nullptr), priorFrameId_(0) {}
+
+bool Relocalizer::Relocalize(Frame& currFrame)
+{
+	// After a brief loss the camera is usually close to the last tracked pose:
+	// this is much cheaper than the database query and PnP RANSAC on every candidate
+	if (priorKF_ && currFrame.PassedFrom(priorFrameId_) <= PRIOR_MAX_FRAMES && RelocalizeNearPrior(currFrame))
+	{
+		lastRelocFrameId_ = currFrame.id;
+		return true;
+	}
+
+	// Compute Bag of Words Vector
+	currFrame.ComputeBoW();
+
+	// Relocalization is performed when tracking is lost
+	// Track Lost: Query KeyFrame Database for keyframe candidates for relocalisation
+	std::vector<KeyFrame*> candidateKFs = keyFrameDB_->DetectRelocalizationCandidates(currFrame);
+
+	if (candidateKFs.empty())
+		return false;
+
+	const int nkeyframes = static_cast<int>(candidateKFs.size());
+
+	// We perform first an ORB matching with each candidate
+	// If enough matches are found we setup a PnP solver
+	ORBmatcher matcher(0.75f, true);
+
+	std::vector<std::unique_ptr<PnPsolver>> PnPsolvers;
+	PnPsolvers.resize(nkeyframes);
+
+	std::vector<std::vector<MapPoint*>> vmatches;
+	vmatches.resize(nkeyframes);
+
+	std::vector<bool> discarded;
+	discarded.resize(nkeyframes);
+
+	int ncandidates = 0;
+
+	for (int i = 0; i < nkeyframes; i++)
+	{
+		KeyFrame* keyframe = candidateKFs[i];
+		if (keyframe->isBad())
+		{
+			discarded[i] = true;
+		}
+		else
+		{
+			const int nmatches = matcher.SearchByBoW(keyframe, currFrame, vmatches[i]);
+			if (nmatches < 15)
+			{
+				discarded[i] = true;
+				continue;
+			}
+			else
+			{
+				auto solver = std::make_unique<PnPsolver>(currFrame, vmatches[i]);
+				solver->SetRansacParameters(0.99, 10, 300, 4, 0.5f, 5.991f);
+				PnPsolvers[i] = std::move(solver);
+				ncandidates++;
+			}
+		}
+	}
+
+	// Alternatively perform some iterations of P4P RANSAC
+	// Until we found a camera pose supported by enough inliers
+	bool found = false;
+	ORBmatcher matcher2(0.9f, true);
+
+	while (ncandidates > 0 && !found)
+	{
+		for (int i = 0; i < nkeyframes; i++)
+		{
+			if (discarded[i])
+				continue;
+
+			// Perform 5 Ransac Iterations
+			std::vector<bool> isInlier;
+			int nInliers;
+			bool terminate;
+
+			auto& solver = PnPsolvers[i];
+			const cv::Mat Tcw = solver->iterate(5, terminate, isInlier, nInliers);
+
+			// If Ransac reachs max. iterations discard keyframe
+			if (terminate)
+			{
+				discarded[i] = true;
+				ncandidates--;
+			}
+
+			// If a Camera Pose is computed, optimize
+			if (!Tcw.empty())
+			{
+				currFrame.SetPose(CameraPose(Tcw));
+
+				std::set<MapPoint*> foundPoints;
+
+				const int np = static_cast<int>(isInlier.size());
+
+				for (int j = 0; j < np; j++)
+				{
+					if (isInlier[j])
+					{
+						currFrame.mappoints[j] = vmatches[i][j];
+						foundPoints.insert(vmatches[i][j]);
+					}
+					else
+						currFrame.mappoints[j] = nullptr;
+				}
+
+				int ngood = Optimizer::PoseOptimization(&currFrame, map_);
+
+				if (ngood < 10)
+					continue;
+
+				for (int io = 0; io < currFrame.N; io++)
+					if (currFrame.outlier[io])
+						currFrame.mappoints[io] = nullptr;
+
+				// If few inliers, search by projection in a coarse window and optimize again
+				if (ngood < 50)
+				{
+					int nadditional = matcher2.SearchByProjection(currFrame, candidateKFs[i], foundPoints, 10, 100);
+
+					if (nadditional + ngood >= 50)
+					{
+						ngood = Optimizer::PoseOptimization(&currFrame, map_);
+
+						// If many inliers but still not enough, search by projection again in a narrower window
+						// the camera has been already optimized with many points
+						if (ngood > 30 && ngood < 50)
+						{
+							foundPoints.clear();
+							for (int ip = 0; ip < currFrame.N; ip++)
+								if (currFrame.mappoints[ip])
+									foundPoints.insert(currFrame.mappoints[ip]);
+							nadditional = matcher2.SearchByProjection(currFrame, candidateKFs[i], foundPoints, 3, 64);
+
+							// Final optimization
+							if (ngood + nadditional >= 50)
+							{
+								ngood = Optimizer::PoseOptimization(&currFrame, map_);
+
+								for (int io = 0; io < currFrame.N; io++)
+									if (currFrame.outlier[io])
+										currFrame.mappoints[io] = nullptr;
+							}
+						}
+					}
+				}
+
+
+				// If the pose is supported by enough inliers stop ransacs and continue
+				if (ngood >= 50)
+				{
+					found = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+	else
+	{
+		lastRelocFrameId_ = currFrame.id;
+		return true;
+	}
+}
+
+bool Relocalizer::RelocalizeNearPrior(Frame& currFrame)
+{
+	// The prior follows the corrections of its reference keyframe (loop closure, global BA, map merge).
+	// If the keyframe was culled, the pose is chained through its parents as the trajectory does.
+	CameraPose Tcr = priorTcr_;
+	KeyFrame* referenceKF = priorKF_;
+	while (referenceKF && referenceKF->isBad())
+	{
+		Tcr = Tcr * referenceKF->Tcp;
+		referenceKF = referenceKF->GetParent();
+	}
+	if (!referenceKF)
+		return false;
+
+	std::vector<KeyFrame*> nearKFs = referenceKF->GetBestCovisibilityKeyFrames(PRIOR_NEIGHBORS);
+	nearKFs.push_back(referenceKF);
+
+	currFrame.SetPose(Tcr * referenceKF->GetPose());
+	std::fill(std::begin(currFrame.mappoints), std::end(currFrame.mappoints), nullptr);
+
+	// Project the map points of the keyframes in a coarse window, then in a narrower one with the optimized pose
+	struct SearchWindow { float th; int ORBdist; };
+	const SearchWindow windows[] = { { 15.f, 100 }, { 3.f, 64 } };
+
+	ORBmatcher matcher(0.9f, true);
+	std::set<MapPoint*> foundPoints;
+	int ngood = 0;
+	for (const SearchWindow& window : windows)
+	{
+		int nmatches = ngood;
+		for (KeyFrame* keyframe : nearKFs)
+		{
+			if (keyframe->isBad())
+				continue;
+
+			nmatches += matcher.SearchByProjection(currFrame, keyframe, foundPoints, window.th, window.ORBdist);
+
+			for (MapPoint* mappoint : currFrame.mappoints)
+				if (mappoint)
+					foundPoints.insert(mappoint);
+		}
+
+		if (nmatches < 50)
+			break;
+
+		ngood = Optimizer::PoseOptimization(&currFrame, map_);
+
+		for (int i = 0; i < currFrame.N; i++)
+			if (currFrame.outlier[i])
+				currFrame.mappoints[i] = nullptr;
+
+		if (ngood < 10)
+			break;
+
+		foundPoints.clear();
+		for (MapPoint* mappoint : currFrame.mappoints)
+			if (mappoint)
+				foundPoints.insert(mappoint);
+	}
+
+	if (ngood >= 50)
+		return true;
+
+	std::fill(std::begin(currFrame.mappoints), std::end(currFrame.mappoints), nullptr);
+	return false;
+}
+
+void Relocalizer::SetPosePrior(const Frame& frame, const cv::Mat& velocity)
+{
+	priorKF_ = frame.referenceKF;
+	if (!priorKF_ || frame.pose.Empty())
+	{
+		priorKF_ = nullptr;
+		return;
+	}
+
+	const CameraPose Tcw = velocity.empty() ? frame.pose : CameraPose(velocity) * frame.pose;
+	priorTcr_ = Tcw * priorKF_->GetPose().Inverse();
+	priorFrameId_ = frame.id;
+}
+
+void Relocalizer::ClearPosePrior()
+{
+	priorKF_ = nullptr;
+}
+
+frameid_t Relocalizer::GetLastRelocFrameId() const
+{
+	return lastRelocFrameId_;
+}
+
+} //namespace ORB_SLAM
@@ -26,7 +26,6 @@
 #include <cmath>
 
 #include <opencv2/core/core.hpp>
-#include <Thirdparty/DBoW2/DUtils/Random.h>
 
 #include "KeyFrame.h"
 #include "MapPoint.h"
@@ -204,7 +203,7 @@ static void FromCameraToImage(const std::vector<Point3D>& points3D, std::vector<
 }
 
 Sim3Solver::Sim3Solver(const KeyFrame* keyframe1, const KeyFrame* keyframe2, const std::vector<MapPoint*>& matches,
-	bool fixScale) : iterations_(0), maxInliers_(0), fixScale_(fixScale)
+	bool fixScale) : iterations_(0), maxInliers_(0), fixScale_(fixScale), rng_(0)
 {
 	const std::vector<MapPoint*> mappoints1 = keyframe1->GetMapPointMatches();
 
@@ -309,7 +308,8 @@ bool Sim3Solver::iterate(int maxk, Sim3& sim3, std::vector<bool>& isInlier)
 		// Get min set of points
 		for (int c = 0; c < 3; ++c)
 		{
-			const int randi = DUtils::Random::RandomInt(0, static_cast<int>(availableIndices.size() - 1));
+			std::uniform_int_distribution<int> distribution(0, static_cast<int>(availableIndices.size() - 1));
+			const int randi = distribution(rng_);
 			const size_t idx = availableIndices[randi];
 
 			const cv::Mat Xc1(Xc1_[idx]);
@@ -0,0 +1,295 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "StatePublisher.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "SharedState.h"
+#include "Frame.h"
+#include "Map.h"
+#include "KeyFrame.h"
+#include "MapPoint.h"
+#include "Tracking.h"
+
+namespace ORB_SLAM2
+{
+
+using namespace SharedState;
+
+#ifdef __linux__
+
+static void CopyPose(const CameraPose& T, float* dst)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			dst[4 * i + j] = T.R()(i, j);
+		dst[4 * i + 3] = T.t()(i);
+	}
+}
+
+class StatePublisherImpl : public StatePublisher
+{
+public:
+
+	StatePublisherImpl(const std::string& name, void* base, size_t size, uint32_t numSlots, uint32_t slotSize)
+		: name_(name), base_(base), size_(size), numSlots_(numSlots), slotSize_(slotSize),
+		capacity_(slotSize - sizeof(SlotHeader)), header_(static_cast<Header*>(base)),
+		hasKeyFrame_(false), lastKeyFrameId_(0), lastBigChange_(0)
+	{
+		header_->numSlots = numSlots;
+		header_->slotSize = slotSize;
+		header_->published.store(0, std::memory_order_relaxed);
+
+		// Readers check the magic before anything else
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(header_->magic, MAGIC, sizeof(MAGIC));
+	}
+
+	void PublishFrame(const Frame& frame, int trackingState) override
+	{
+		PoseMessage pose;
+		pose.trackingState = trackingState;
+		pose.valid = trackingState == Tracking::STATE_OK && !frame.pose.Empty();
+		if (pose.valid)
+			CopyPose(frame.pose, pose.Tcw);
+		else
+			std::fill(std::begin(pose.Tcw), std::end(pose.Tcw), 0.f);
+
+		Write(POSE, frame.id, frame.timestamp, 0, 1, &pose, sizeof(pose));
+
+		keypoints_.clear();
+		if (pose.valid)
+		{
+			for (size_t i = 0; i < frame.mappoints.size(); i++)
+			{
+				const MapPoint* mappoint = frame.mappoints[i];
+				if (!mappoint || frame.outlier[i] || mappoint->isBad())
+					continue;
+
+				const Point3D Xw = mappoint->GetWorldPos();
+				KeyPointRecord record;
+				record.u = frame.keypointsUn[i].pt.x;
+				record.v = frame.keypointsUn[i].pt.y;
+				record.X = Xw(0);
+				record.Y = Xw(1);
+				record.Z = Xw(2);
+				record.reserved = 0;
+				record.mappointId = mappoint->id;
+				keypoints_.push_back(record);
+			}
+		}
+
+		PublishArray(KEYPOINTS, frame.id, frame.timestamp, keypoints_);
+	}
+
+	void PublishMap(const Map& map, const Frame& frame) override
+	{
+		keyframes_.clear();
+		mappoints_.clear();
+
+		const int bigChange = map.GetLastBigChangeIdx();
+		if (bigChange != lastBigChange_)
+		{
+			// Loop closure or global BA moved the whole map
+			lastBigChange_ = bigChange;
+			for (const KeyFrame* keyframe : map.GetAllKeyFrames())
+				AddKeyFrame(keyframe);
+			for (const MapPoint* mappoint : map.GetAllMapPoints())
+				AddMapPoint(mappoint);
+		}
+		else if (frame.referenceKF && (!hasKeyFrame_ || frame.referenceKF->id > lastKeyFrameId_))
+		{
+			// New keyframe: its map points are the ones it created or observes
+			AddKeyFrame(frame.referenceKF);
+			for (const MapPoint* mappoint : frame.referenceKF->GetMapPointMatches())
+				AddMapPoint(mappoint);
+		}
+
+		if (keyframes_.empty())
+			return;
+
+		PublishArray(KEYFRAMES, frame.id, frame.timestamp, keyframes_);
+		PublishArray(MAPPOINTS, frame.id, frame.timestamp, mappoints_);
+	}
+
+	void PublishReset() override
+	{
+		hasKeyFrame_ = false;
+		lastKeyFrameId_ = 0;
+		Write(RESET, 0, 0, 0, 1, nullptr, 0);
+	}
+
+	~StatePublisherImpl()
+	{
+		munmap(base_, size_);
+		shm_unlink(name_.c_str());
+	}
+
+private:
+
+	void AddKeyFrame(const KeyFrame* keyframe)
+	{
+		if (keyframe->isBad())
+			return;
+
+		KeyFrameRecord record;
+		record.id = keyframe->id;
+		record.timestamp = keyframe->timestamp;
+		CopyPose(keyframe->GetPose().Inverse(), record.Twc);
+		keyframes_.push_back(record);
+
+		if (!hasKeyFrame_ || keyframe->id > lastKeyFrameId_)
+			lastKeyFrameId_ = keyframe->id;
+		hasKeyFrame_ = true;
+	}
+
+	void AddMapPoint(const MapPoint* mappoint)
+	{
+		if (!mappoint || mappoint->isBad())
+			return;
+
+		const Point3D Xw = mappoint->GetWorldPos();
+		MapPointRecord record;
+		record.id = mappoint->id;
+		record.X = Xw(0);
+		record.Y = Xw(1);
+		record.Z = Xw(2);
+		record.reserved = 0;
+		mappoints_.push_back(record);
+	}
+
+	// Splits the records into as many messages as needed
+	template <class Record>
+	void PublishArray(uint32_t type, uint64_t frameId, double timestamp, const std::vector<Record>& records)
+	{
+		const size_t perSlot = capacity_ / sizeof(Record);
+		const size_t parts = std::max<size_t>((records.size() + perSlot - 1) / perSlot, 1);
+		for (size_t part = 0; part < parts; part++)
+		{
+			const size_t begin = part * perSlot;
+			const size_t count = std::min(records.size() - begin, perSlot);
+			Write(type, frameId, timestamp, static_cast<uint32_t>(part), static_cast<uint32_t>(parts),
+				records.data() + begin, count * sizeof(Record));
+		}
+	}
+
+	// Single writer: the slot sequence is odd while its content changes
+	void Write(uint32_t type, uint64_t frameId, double timestamp, uint32_t part, uint32_t parts, const void* data, size_t size)
+	{
+		const uint64_t index = header_->published.load(std::memory_order_relaxed);
+		SlotHeader* slot = GetSlot(base_, slotSize_, index % numSlots_);
+
+		slot->sequence.store(2 * index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot->type = type;
+		slot->size = static_cast<uint32_t>(size);
+		slot->frameId = frameId;
+		slot->timestamp = timestamp;
+		slot->part = part;
+		slot->parts = parts;
+		if (size > 0)
+			std::memcpy(reinterpret_cast<char*>(slot) + sizeof(SlotHeader), data, size);
+
+		slot->sequence.store(2 * index + 2, std::memory_order_release);
+		header_->published.store(index + 1, std::memory_order_release);
+	}
+
+	std::string name_;
+	void* base_;
+	size_t size_;
+	uint32_t numSlots_;
+	uint32_t slotSize_;
+	size_t capacity_;
+	Header* header_;
+
+	bool hasKeyFrame_;
+	frameid_t lastKeyFrameId_;
+	int lastBigChange_;
+
+	// Work buffers
+	std::vector<KeyPointRecord> keypoints_;
+	std::vector<KeyFrameRecord> keyframes_;
+	std::vector<MapPointRecord> mappoints_;
+};
+
+StatePublisher::Pointer StatePublisher::Create(const Parameters& param)
+{
+	if (param.name.empty())
+		return nullptr;
+
+	// Round the slots to cache lines, and make room for a pose message at least
+	const size_t minSlotSize = sizeof(SlotHeader) + sizeof(PoseMessage);
+	const uint32_t slotSize = static_cast<uint32_t>((std::max<size_t>(param.slotSize, minSlotSize) + 63) / 64 * 64);
+	const uint32_t numSlots = static_cast<uint32_t>(std::max(param.numSlots, 2));
+	const size_t size = SharedSize(numSlots, slotSize);
+
+	// Readers of a previous run keep their mapping, new readers get the new object
+	shm_unlink(param.name.c_str());
+	const int fd = shm_open(param.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		std::cerr << "Failed to create the shared memory " << param.name << std::endl;
+		return nullptr;
+	}
+
+	void* base = MAP_FAILED;
+	if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+		base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+	{
+		std::cerr << "Failed to map the shared memory " << param.name << std::endl;
+		shm_unlink(param.name.c_str());
+		return nullptr;
+	}
+
+	return std::make_unique<StatePublisherImpl>(param.name, base, size, numSlots, slotSize);
+}
+
+#else
+
+StatePublisher::Pointer StatePublisher::Create(const Parameters& param)
+{
+	if (!param.name.empty())
+		std::cerr << "The state publisher is not supported on this platform" << std::endl;
+	return nullptr;
+}
+
+#endif
+
+StatePublisher::~StatePublisher() {}
+
+StatePublisher::Parameters::Parameters() : numSlots(256), slotSize(64 * 1024) {}
+
+} //namespace ORB_SLAM
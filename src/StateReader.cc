@@ -0,0 +1,167 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "StateReader.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace ORB_SLAM2
+{
+
+using namespace SharedState;
+
+#ifdef __linux__
+
+class StateReaderImpl : public StateReader
+{
+public:
+
+	StateReaderImpl(const void* base, size_t size)
+		: base_(base), size_(size), header_(static_cast<const Header*>(base)),
+		numSlots_(header_->numSlots), slotSize_(header_->slotSize), next_(0), lost_(0) {}
+
+	bool Next(Message& message) override
+	{
+		for (;;)
+		{
+			const uint64_t published = header_->published.load(std::memory_order_acquire);
+			if (next_ >= published)
+				return false;
+
+			// The writer went around the ring
+			if (published - next_ > numSlots_)
+			{
+				lost_ += published - numSlots_ - next_;
+				next_ = published - numSlots_;
+			}
+
+			const uint64_t index = next_++;
+			const SlotHeader* slot = GetSlot(base_, slotSize_, index % numSlots_);
+			const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * index + 2)
+			{
+				lost_++;
+				continue;
+			}
+
+			message.index = index;
+			message.type = slot->type;
+			message.size = slot->size;
+			message.frameId = slot->frameId;
+			message.timestamp = slot->timestamp;
+			message.part = slot->part;
+			message.parts = slot->parts;
+			message.data = slot + 1;
+
+			// The header fields may have been overwritten while being copied
+			if (!Valid(message) || message.size > slotSize_ - sizeof(SlotHeader))
+			{
+				lost_++;
+				continue;
+			}
+
+			return true;
+		}
+	}
+
+	bool Valid(const Message& message) const override
+	{
+		const SlotHeader* slot = GetSlot(base_, slotSize_, message.index % numSlots_);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot->sequence.load(std::memory_order_relaxed) == 2 * message.index + 2;
+	}
+
+	void SeekToEnd() override
+	{
+		next_ = header_->published.load(std::memory_order_acquire);
+	}
+
+	uint64_t GetLost() const override
+	{
+		return lost_;
+	}
+
+	~StateReaderImpl()
+	{
+		munmap(const_cast<void*>(base_), size_);
+	}
+
+private:
+
+	const void* base_;
+	size_t size_;
+	const Header* header_;
+	uint32_t numSlots_;
+	uint32_t slotSize_;
+	uint64_t next_;
+	uint64_t lost_;
+};
+
+StateReader::Pointer StateReader::Open(const std::string& name)
+{
+	const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	void* base = MAP_FAILED;
+	const bool sized = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= HEADER_BYTES;
+	if (sized)
+		base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+		return nullptr;
+
+	// The publisher writes the magic once the header is complete
+	const Header* header = static_cast<const Header*>(base);
+	const size_t size = st.st_size;
+	const bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->numSlots > 0 &&
+		header->slotSize > sizeof(SlotHeader) && SharedSize(header->numSlots, header->slotSize) <= size;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!valid)
+	{
+		munmap(base, size);
+		return nullptr;
+	}
+
+	return std::make_unique<StateReaderImpl>(base, size);
+}
+
+#else
+
+StateReader::Pointer StateReader::Open(const std::string& name)
+{
+	return nullptr;
+}
+
+#endif
+
+StateReader::~StateReader() {}
+
+} //namespace ORB_SLAM
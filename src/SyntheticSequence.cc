@@ -0,0 +1,525 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "SyntheticSequence.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include <opencv2/opencv.hpp>
+
+#include "Converter.h"
+#include "System.h"
+
+namespace ORB_SLAM2
+{
+
+// The city is a grid of square cells: streets on the even rows and columns, blocks on the odd ones
+static const float CELL_SIZE = 12.f;
+static const float MIN_BLOCK_HEIGHT = 8.f;
+static const float MAX_BLOCK_HEIGHT = 24.f;
+
+// Corners of the route are rounded over this distance (m)
+static const float CORNER_RADIUS = 4.f;
+
+static const float CAMERA_HEIGHT = 1.5f;
+static const float FAR_DISTANCE = 150.f;
+
+// Largest distance in a depthmap (millimeters in CV_16U)
+static const float MAX_DEPTH = 65.f;
+
+static const uchar SKY_INTENSITY = 190;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Procedural texture
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t Hash(int x, int y, uint32_t seed)
+{
+	uint32_t h = static_cast<uint32_t>(x) * 374761393u + static_cast<uint32_t>(y) * 668265263u + seed * 2246822519u;
+	h = (h ^ (h >> 13)) * 1274126177u;
+	return h ^ (h >> 16);
+}
+
+float SyntheticSequence::Lattice(int x, int y, uint32_t seed)
+{
+	return static_cast<float>(Hash(x, y, seed)) / 4294967295.f;
+}
+
+float SyntheticSequence::ValueNoise(float x, float y, uint32_t seed)
+{
+	const float x0 = std::floor(x);
+	const float y0 = std::floor(y);
+	const int ix = static_cast<int>(x0);
+	const int iy = static_cast<int>(y0);
+	const float sx = (x - x0) * (x - x0) * (3 - 2 * (x - x0));
+	const float sy = (y - y0) * (y - y0) * (3 - 2 * (y - y0));
+	const float top = Lattice(ix, iy, seed) + sx * (Lattice(ix + 1, iy, seed) - Lattice(ix, iy, seed));
+	const float bottom = Lattice(ix, iy + 1, seed) + sx * (Lattice(ix + 1, iy + 1, seed) - Lattice(ix, iy + 1, seed));
+	return top + sy * (bottom - top);
+}
+
+// Quantized multi-scale value noise in surface coordinates (m): flat patches with sharp edges and corners.
+// Octaves finer than the pixel footprint (m) are replaced by their mean, so distant surfaces do not alias.
+static float Texture(float a, float b, uint32_t seed, float footprint)
+{
+	float value = 0.f;
+	float total = 0.f;
+	float amplitude = 0.5f;
+	uint32_t octave = 0;
+	for (float cell = 1.6f; cell > 0.04f; cell *= 0.5f, octave++)
+	{
+		value += amplitude * (cell > 2 * footprint ? SyntheticSequence::ValueNoise(a / cell, b / cell, seed + octave) : 0.5f);
+		total += amplitude;
+		amplitude *= 0.6f;
+	}
+
+	const float contrast = std::min(std::max(2.5f * (value / total - 0.5f) + 0.5f, 0.f), 0.999f);
+	const float levels = 5.f;
+	return std::floor(contrast * levels) / (levels - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Ray casting
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// World frame: x east, z north, y down (as the camera frame), ground plane at y = 0.
+// A ring of blocks surrounds the streets, so the outer streets have buildings on both sides.
+class City
+{
+public:
+
+	City(int blocks, uint32_t seed) : blocks_(blocks), seed_(seed) {}
+
+	bool IsBlock(int cx, int cz) const
+	{
+		return (cx & 1) && (cz & 1) && cx >= -1 && cz >= -1 && cx <= 2 * blocks_ + 1 && cz <= 2 * blocks_ + 1;
+	}
+
+	float BlockHeight(int cx, int cz) const
+	{
+		return MIN_BLOCK_HEIGHT + (MAX_BLOCK_HEIGHT - MIN_BLOCK_HEIGHT) * SyntheticSequence::Lattice(cx, cz, seed_);
+	}
+
+	// Intensity seen along the ray o + t d, where d has a unit z coordinate in the camera frame.
+	// depth receives t, the depth in the camera, or 0 if the ray hits nothing.
+	uchar Cast(const cv::Vec3f& o, const cv::Vec3f& d, float pixelAngle, float& depth) const
+	{
+		float tLimit = FAR_DISTANCE;
+		if (d(1) > 1e-6f)
+			tLimit = std::min(tLimit, -o(1) / d(1));
+
+		// Walls: traversal of the grid cells crossed by the ray on the ground plane
+		int cx = static_cast<int>(std::floor(o(0) / CELL_SIZE));
+		int cz = static_cast<int>(std::floor(o(2) / CELL_SIZE));
+		const int stepX = d(0) > 0 ? 1 : -1;
+		const int stepZ = d(2) > 0 ? 1 : -1;
+		const float INF = std::numeric_limits<float>::max();
+		const float deltaX = std::abs(d(0)) > 1e-9f ? CELL_SIZE / std::abs(d(0)) : INF;
+		const float deltaZ = std::abs(d(2)) > 1e-9f ? CELL_SIZE / std::abs(d(2)) : INF;
+		float nextX = deltaX < INF ? ((cx + (stepX > 0)) * CELL_SIZE - o(0)) / d(0) : INF;
+		float nextZ = deltaZ < INF ? ((cz + (stepZ > 0)) * CELL_SIZE - o(2)) / d(2) : INF;
+
+		for (;;)
+		{
+			const bool crossX = nextX < nextZ;
+			const float t = crossX ? nextX : nextZ;
+			if (t >= tLimit)
+				break;
+
+			if (crossX)
+			{
+				cx += stepX;
+				nextX += deltaX;
+			}
+			else
+			{
+				cz += stepZ;
+				nextZ += deltaZ;
+			}
+
+			if (!IsBlock(cx, cz) || o(1) + t * d(1) <= -BlockHeight(cx, cz))
+				continue;
+
+			// Each face of each block has its own texture
+			const cv::Vec3f P = o + t * d;
+			const int axis = crossX ? 0 : 2;
+			const int side = crossX ? (stepX > 0) : 2 + (stepZ > 0);
+			const uint32_t seed = Hash(cx, cz, seed_ + 4 * side + 1);
+			const float cosine = std::abs(d(axis)) / static_cast<float>(cv::norm(d));
+			const float footprint = t * pixelAngle / std::max(cosine, 0.2f);
+			const float shade = crossX ? 0.85f : 0.65f;
+
+			depth = t;
+			return Intensity(shade * Texture(crossX ? P(2) : P(0), P(1), seed, footprint));
+		}
+
+		if (tLimit < FAR_DISTANCE)
+		{
+			const cv::Vec3f P = o + tLimit * d;
+			const float cosine = d(1) / static_cast<float>(cv::norm(d));
+			const float footprint = tLimit * pixelAngle / std::max(cosine, 0.2f);
+
+			depth = tLimit;
+			return Intensity(Texture(P(0), P(2), seed_, footprint));
+		}
+
+		depth = 0.f;
+		return SKY_INTENSITY;
+	}
+
+private:
+
+	static uchar Intensity(float value)
+	{
+		return cv::saturate_cast<uchar>(25.f + 210.f * value);
+	}
+
+	int blocks_;
+	uint32_t seed_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Route
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static cv::Point2f Intersection(const cv::Point& node)
+{
+	return cv::Point2f((2 * node.x + 0.5f) * CELL_SIZE, (2 * node.y + 0.5f) * CELL_SIZE);
+}
+
+static cv::Point Direction(const cv::Point& from, const cv::Point& to)
+{
+	const cv::Point d = to - from;
+	return cv::Point((d.x > 0) - (d.x < 0), (d.y > 0) - (d.y < 0));
+}
+
+// Intersections of one lap. Every lap starts at (0, 0) heading east and ends there, arriving from the north,
+// so that the laps chain without U-turns (a pure rotation that monocular tracking cannot follow).
+static std::vector<cv::Point> RouteNodes(SyntheticSequence::Route route, int G, uint32_t seed)
+{
+	std::vector<cv::Point> nodes;
+	if (route == SyntheticSequence::LAWNMOWER)
+	{
+		// An even number of rows, to end on the west side (the northern street is not driven if blocks is even)
+		const int rows = (G + 1) & ~1;
+		for (int J = 0; J < rows; J++)
+		{
+			nodes.emplace_back(J % 2 == 0 ? 0 : G, J);
+			nodes.emplace_back(J % 2 == 0 ? G : 0, J);
+		}
+	}
+	else if (route == SyntheticSequence::RANDOM)
+	{
+		std::mt19937 rng(seed);
+		const cv::Point moves[4] = { cv::Point(1, 0), cv::Point(0, 1), cv::Point(-1, 0), cv::Point(0, -1) };
+		const int minSteps = 4 * G;
+
+		nodes.emplace_back(0, 0);
+		nodes.emplace_back(1, 0);
+		for (int step = 1; ; step++)
+		{
+			const cv::Point node = nodes.back();
+			const cv::Point last = Direction(nodes[nodes.size() - 2], node);
+
+			// The way back goes west first, then south: it must not reverse the last move
+			const bool canReturn = node.y > 0 && !(node.x > 0 && last.x > 0) && !(node.x == 0 && last.y > 0);
+			if (step >= minSteps && canReturn)
+				break;
+
+			std::vector<cv::Point> candidates;
+			for (const cv::Point& move : moves)
+			{
+				const cv::Point next = node + move;
+				if (move != cv::Point(-last.x, -last.y) && next.x >= 0 && next.y >= 0 && next.x <= G && next.y <= G)
+					candidates.push_back(next);
+			}
+			nodes.push_back(candidates[std::uniform_int_distribution<int>(0, static_cast<int>(candidates.size()) - 1)(rng)]);
+		}
+		nodes.emplace_back(0, nodes.back().y);
+	}
+	else
+	{
+		nodes.emplace_back(0, 0);
+		nodes.emplace_back(G, 0);
+		nodes.emplace_back(G, G);
+		nodes.emplace_back(0, G);
+	}
+	nodes.emplace_back(0, 0);
+
+	// Straight lines through intersections are a single segment
+	std::vector<cv::Point> simplified;
+	for (const cv::Point& node : nodes)
+	{
+		if (!simplified.empty() && simplified.back() == node)
+			continue;
+		if (simplified.size() >= 2 && Direction(simplified[simplified.size() - 2], simplified.back()) == Direction(simplified.back(), node))
+			simplified.back() = node;
+		else
+			simplified.push_back(node);
+	}
+	return simplified;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SyntheticSequence
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SyntheticSequence::SyntheticSequence(const Parameters& param) : param_(param)
+{
+	param_.blocks = std::max(param_.blocks, 1);
+	param_.laps = std::max(param_.laps, 1);
+	if (param_.numThreads <= 0)
+		param_.numThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+	distances_.push_back(0);
+	for (const cv::Point& node : RouteNodes(param_.route, param_.blocks, param_.seed))
+	{
+		const cv::Point2f waypoint = Intersection(node);
+		if (!waypoints_.empty())
+			distances_.push_back(distances_.back() + cv::norm(waypoint - waypoints_.back()));
+		waypoints_.push_back(waypoint);
+	}
+	lapLength_ = distances_.back();
+	size_ = static_cast<int>(GetLength() / param_.speed) + 1;
+}
+
+int SyntheticSequence::Size() const
+{
+	return size_;
+}
+
+double SyntheticSequence::Timestamp(int i) const
+{
+	return i / param_.fps;
+}
+
+cv::Point2f SyntheticSequence::RoutePosition(double s) const
+{
+	// The route is closed: the laps repeat it
+	s = std::fmod(s, lapLength_);
+	if (s < 0)
+		s += lapLength_;
+
+	const size_t i = std::upper_bound(std::begin(distances_), std::end(distances_), s) - std::begin(distances_);
+	if (i >= distances_.size())
+		return waypoints_.back();
+
+	const float t = static_cast<float>((s - distances_[i - 1]) / (distances_[i] - distances_[i - 1]));
+	return waypoints_[i - 1] + (waypoints_[i] - waypoints_[i - 1]) * t;
+}
+
+cv::Point2f SyntheticSequence::SmoothPosition(double s) const
+{
+	const int K = 8;
+	cv::Point2f sum(0, 0);
+	for (int k = -K; k <= K; k++)
+		sum += RoutePosition(s + k * CORNER_RADIUS / K);
+	return sum * (1.f / (2 * K + 1));
+}
+
+CameraPose SyntheticSequence::GetPose(int i) const
+{
+	const double s = i * static_cast<double>(param_.speed);
+	const cv::Point2f p = SmoothPosition(s);
+	const cv::Point2f forward = SmoothPosition(s + 0.5) - SmoothPosition(s - 0.5);
+
+	// Heading along the route, with a slow sway across the street and some wobble,
+	// so that the motion is never a pure translation along the optical axis
+	const float yaw = std::atan2(forward.x, forward.y) + 0.05f * static_cast<float>(std::sin(s / 9));
+	const float pitch = 0.04f * static_cast<float>(std::sin(s / 11));
+	const float roll = 0.02f * static_cast<float>(std::sin(s / 7));
+	const float sway = 2.f * static_cast<float>(std::sin(s / 23));
+	const float height = CAMERA_HEIGHT + 0.1f * static_cast<float>(std::sin(s / 5));
+
+	const float cy = std::cos(yaw), sy = std::sin(yaw);
+	const float cp = std::cos(pitch), sp = std::sin(pitch);
+	const float cr = std::cos(roll), sr = std::sin(roll);
+	const CameraPose::Mat33 Ry(cy, 0, sy, 0, 1, 0, -sy, 0, cy);
+	const CameraPose::Mat33 Rx(1, 0, 0, 0, cp, -sp, 0, sp, cp);
+	const CameraPose::Mat33 Rz(cr, -sr, 0, sr, cr, 0, 0, 0, 1);
+	const CameraPose::Mat33 Rwc = Ry * Rx * Rz;
+
+	const CameraPose::Mat31 Ow(p.x + sway * cy, -height, p.y - sway * sy);
+	const CameraPose::Mat33 Rcw = Rwc.t();
+	return CameraPose(Rcw, -(Rcw * Ow));
+}
+
+void SyntheticSequence::RenderImage(const CameraPose& Tcw, cv::Mat& image, cv::Mat* depth) const
+{
+	const City city(param_.blocks, param_.seed);
+	const CameraParams& camera = param_.camera;
+	const CameraPose::Mat33 Rwc = Tcw.InvR();
+	const CameraPose::Mat31 Ow = Tcw.Invt();
+	const cv::Vec3f o(Ow(0), Ow(1), Ow(2));
+	const float pixelAngle = 1.f / camera.fx;
+
+	image.create(param_.imageSize, CV_8U);
+	if (depth)
+		depth->create(param_.imageSize, CV_16U);
+
+	auto RenderRows = [&](int first, int step)
+	{
+		for (int v = first; v < image.rows; v += step)
+		{
+			uchar* pixels = image.ptr<uchar>(v);
+			uint16_t* depths = depth ? depth->ptr<uint16_t>(v) : nullptr;
+			for (int u = 0; u < image.cols; u++)
+			{
+				const CameraPose::Mat31 dc((u - camera.cx) / camera.fx, (v - camera.cy) / camera.fy, 1.f);
+				const CameraPose::Mat31 dw = Rwc * dc;
+
+				float t;
+				pixels[u] = city.Cast(o, cv::Vec3f(dw(0), dw(1), dw(2)), pixelAngle, t);
+				if (depths)
+					depths[u] = t < MAX_DEPTH ? static_cast<uint16_t>(std::round(1000 * t)) : 0;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int k = 1; k < param_.numThreads; k++)
+		threads.emplace_back(RenderRows, k, param_.numThreads);
+	RenderRows(0, param_.numThreads);
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+void SyntheticSequence::Render(int i, DatasetFrame& frame) const
+{
+	const CameraPose Tcw = GetPose(i);
+	frame.timestamp = Timestamp(i);
+	frame.image2.release();
+
+	if (param_.sensor == System::STEREO)
+	{
+		// Rectified pair: the right camera is shifted by the baseline along the x axis
+		CameraPose Trw = Tcw;
+		Trw.t()(0) -= param_.camera.baseline;
+		RenderImage(Tcw, frame.image, nullptr);
+		RenderImage(Trw, frame.image2, nullptr);
+	}
+	else if (param_.sensor == System::RGBD)
+	{
+		RenderImage(Tcw, frame.image, &frame.image2);
+	}
+	else
+	{
+		RenderImage(Tcw, frame.image, nullptr);
+	}
+}
+
+double SyntheticSequence::GetLength() const
+{
+	return param_.laps * lapLength_;
+}
+
+const SyntheticSequence::Parameters& SyntheticSequence::GetParameters() const
+{
+	return param_;
+}
+
+bool SyntheticSequence::WriteSettings(const std::string& filename) const
+{
+	std::ofstream ofs(filename);
+	if (!ofs.is_open())
+	{
+		std::cerr << "Failed to create " << filename << std::endl;
+		return false;
+	}
+
+	const CameraParams& camera = param_.camera;
+	ofs << "%YAML:1.0" << std::endl << std::endl;
+	ofs << "# Synthetic sequence: pinhole rectified camera without distortion" << std::endl;
+	ofs << std::setprecision(9);
+	ofs << "Camera.fx: " << camera.fx << std::endl;
+	ofs << "Camera.fy: " << camera.fy << std::endl;
+	ofs << "Camera.cx: " << camera.cx << std::endl;
+	ofs << "Camera.cy: " << camera.cy << std::endl << std::endl;
+	ofs << "Camera.k1: 0.0" << std::endl;
+	ofs << "Camera.k2: 0.0" << std::endl;
+	ofs << "Camera.p1: 0.0" << std::endl;
+	ofs << "Camera.p2: 0.0" << std::endl << std::endl;
+	ofs << "Camera.width: " << param_.imageSize.width << std::endl;
+	ofs << "Camera.height: " << param_.imageSize.height << std::endl << std::endl;
+	ofs << "Camera.fps: " << param_.fps << std::endl;
+	ofs << "Camera.bf: " << camera.bf << std::endl;
+	ofs << "Camera.RGB: 0" << std::endl << std::endl;
+	ofs << "ThDepth: 35.0" << std::endl;
+	ofs << "DepthMapFactor: 1000.0" << std::endl << std::endl;
+	ofs << "ORBextractor.nFeatures: " << (param_.sensor == System::STEREO ? 1200 : 1000) << std::endl;
+	ofs << "ORBextractor.scaleFactor: 1.2" << std::endl;
+	ofs << "ORBextractor.nLevels: 8" << std::endl;
+	ofs << "ORBextractor.iniThFAST: 20" << std::endl;
+	ofs << "ORBextractor.minThFAST: 7" << std::endl << std::endl;
+	ofs << "Viewer.KeyFrameSize: 0.6" << std::endl;
+	ofs << "Viewer.KeyFrameLineWidth: 2" << std::endl;
+	ofs << "Viewer.GraphLineWidth: 1" << std::endl;
+	ofs << "Viewer.PointSize: 2" << std::endl;
+	ofs << "Viewer.CameraSize: 0.7" << std::endl;
+	ofs << "Viewer.CameraLineWidth: 3" << std::endl;
+	ofs << "Viewer.ViewpointX: 0" << std::endl;
+	ofs << "Viewer.ViewpointY: -100" << std::endl;
+	ofs << "Viewer.ViewpointZ: -0.1" << std::endl;
+	ofs << "Viewer.ViewpointF: 2000" << std::endl;
+	return ofs.good();
+}
+
+bool SyntheticSequence::WriteGroundTruth(const std::string& filename) const
+{
+	std::ofstream ofs(filename);
+	if (!ofs.is_open())
+	{
+		std::cerr << "Failed to create " << filename << std::endl;
+		return false;
+	}
+
+	ofs << std::fixed;
+	for (int i = 0; i < size_; i++)
+	{
+		const CameraPose Twc = GetPose(i).Inverse();
+		const auto q = Converter::toQuaternion(Twc.R());
+		ofs << std::setprecision(6) << Timestamp(i) << " ";
+		ofs << std::setprecision(7) << Twc.t()(0) << " " << Twc.t()(1) << " " << Twc.t()(2) << " ";
+		ofs << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << "\n";
+	}
+	return ofs.good();
+}
+
+SyntheticSequence::Parameters::Parameters()
+	: sensor(System::STEREO), route(LOOP), blocks(4), laps(2), speed(0.1f), fps(20.f), seed(0),
+	imageSize(752, 480), numThreads(0)
+{
+	camera.fx = 435.f;
+	camera.fy = 435.f;
+	camera.cx = 376.f;
+	camera.cy = 240.f;
+	camera.baseline = 0.11f;
+	camera.bf = camera.baseline * camera.fx;
+}
+
+} //namespace ORB_SLAM
@@ -21,7 +21,11 @@
 #include "System.h"
 
 #include <thread>
+#include <algorithm>
 #include <iomanip>
+#include <chrono>
+#include <limits>
+#include <unordered_map>
 
 #include "Frame.h"
 #include "KeyFrame.h"
@@ -32,62 +36,113 @@
 #include "KeyFrameDatabase.h"
 #include "ORBVocabulary.h"
 #include "Viewer.h"
-#include "Usleep.h"
 #include "Converter.h"
 #include "ORBextractor.h"
-#include "ORBmatcher.h"
+#include "FrameBuilder.h"
+#include "TrackingBudget.h"
+#include "BackPressure.h"
+#include "LocalizationServer.h"
+#include "LockStats.h"
+#include "ThreadParams.h"
+#include "TrajectoryWriter.h"
+#include "StatePublisher.h"
+#include "Recording.h"
+#include "MemoryStats.h"
 
 namespace ORB_SLAM2
 {
 
-#define LOCK_MUTEX_RESET() std::unique_lock<std::mutex> lock1(mutexReset_);
-#define LOCK_MUTEX_MODE()  std::unique_lock<std::mutex> lock2(mutexMode_);
-#define LOCK_MUTEX_STATE() std::unique_lock<std::mutex> lock3(mutexState_);
+#define LOCK_MUTEX_RESET() auto lock1 = LockMutex(mutexReset_, LOCK_SITE("System::Reset"));
+#define LOCK_MUTEX_MODE()  auto lock2 = LockMutex(mutexMode_, LOCK_SITE("System::Mode"));
+#define LOCK_MUTEX_STATE() auto lock3 = LockMutex(mutexState_, LOCK_SITE("System::State"));
 
-static CameraParams ReadCameraParams(const cv::FileStorage& fs)
+static float ReadFps(const cv::FileStorage& fs)
 {
-	CameraParams param;
-	param.fx = fs["Camera.fx"];
-	param.fy = fs["Camera.fy"];
-	param.cx = fs["Camera.cx"];
-	param.cy = fs["Camera.cy"];
-	param.bf = fs["Camera.bf"];
-	param.baseline = param.bf / param.fx;
-	return param;
+	const float fps = fs["Camera.fps"];
+	return fps == 0 ? 30 : fps;
 }
 
-static cv::Mat1f ReadDistCoeffs(const cv::FileStorage& fs)
+static TrackingBudget::Parameters ReadBudgetParams(const cv::FileStorage& fs, const ORBextractor::Parameters& extractorParams)
 {
-	const float k1 = fs["Camera.k1"];
-	const float k2 = fs["Camera.k2"];
-	const float p1 = fs["Camera.p1"];
-	const float p2 = fs["Camera.p2"];
-	const float k3 = fs["Camera.k3"];
-	cv::Mat1f distCoeffs = k3 == 0 ? (cv::Mat1f(4, 1) << k1, k2, p1, p2) : (cv::Mat1f(5, 1) << k1, k2, p1, p2, k3);
-	return distCoeffs;
+	TrackingBudget::Parameters param;
+	param.budgetMs = fs["Tracking.budgetMs"];
+	param.maxFeatures = extractorParams.nfeatures;
+	param.maxLevels = extractorParams.nlevels;
+
+	const int minFeatures = fs["Tracking.minFeatures"];
+	const int minLevels = fs["Tracking.minLevels"];
+	const int minLocalKeyFrames = fs["Tracking.minLocalKeyFrames"];
+	const float minSearchRadiusScale = fs["Tracking.minSearchRadiusScale"];
+	const int safeInliers = fs["Tracking.safeInliers"];
+
+	param.minFeatures = minFeatures > 0 ? std::min(minFeatures, param.maxFeatures) : param.maxFeatures / 2;
+	param.minLevels = minLevels > 0 ? std::min(minLevels, param.maxLevels) : (param.maxLevels + 1) / 2;
+	if (minLocalKeyFrames > 0)
+		param.minLocalKeyFrames = std::min(minLocalKeyFrames, param.maxLocalKeyFrames);
+	if (minSearchRadiusScale > 0)
+		param.minSearchRadiusScale = std::min(minSearchRadiusScale, 1.f);
+	if (safeInliers > 0)
+		param.safeInliers = safeInliers;
+	return param;
 }
 
-static float ReadFps(const cv::FileStorage& fs)
+static BackPressure::Parameters ReadBackPressureParams(const cv::FileStorage& fs)
 {
-	const float fps = fs["Camera.fps"];
-	return fps == 0 ? 30 : fps;
+	BackPressure::Parameters param;
+	param.downgradeLagMs = fs["BackPressure.downgradeLagMs"];
+	param.dropLagMs = fs["BackPressure.dropLagMs"];
+	param.maxMappingQueue = fs["BackPressure.maxMappingQueue"];
+	param.maxLoopQueue = fs["BackPressure.maxLoopQueue"];
+
+	const int maxConsecutiveDowngrades = fs["BackPressure.maxConsecutiveDowngrades"];
+	const int maxConsecutiveDrops = fs["BackPressure.maxConsecutiveDrops"];
+	if (maxConsecutiveDowngrades > 0)
+		param.maxConsecutiveDowngrades = maxConsecutiveDowngrades;
+	if (maxConsecutiveDrops > 0)
+		param.maxConsecutiveDrops = maxConsecutiveDrops;
+	return param;
 }
 
-static ORBextractor::Parameters ReadExtractorParams(const cv::FileStorage& fs)
+static StatePublisher::Parameters ReadPublisherParams(const cv::FileStorage& fs)
 {
-	ORBextractor::Parameters param;
-	param.nfeatures = fs["ORBextractor.nFeatures"];
-	param.scaleFactor = fs["ORBextractor.scaleFactor"];
-	param.nlevels = fs["ORBextractor.nLevels"];
-	param.iniThFAST = fs["ORBextractor.iniThFAST"];
-	param.minThFAST = fs["ORBextractor.minThFAST"];
+	StatePublisher::Parameters param;
+	if (fs["Publisher.name"].isString())
+		param.name = static_cast<std::string>(fs["Publisher.name"]);
+
+	const int numSlots = fs["Publisher.slots"];
+	const int slotSize = fs["Publisher.slotSize"];
+	if (numSlots > 0)
+		param.numSlots = numSlots;
+	if (slotSize > 0)
+		param.slotSize = slotSize;
 	return param;
 }
 
-static float ReadDepthFactor(const cv::FileStorage& fs)
+static void PrintThreadSettings(const ThreadParams (&params)[NUM_THREAD_ROLES])
 {
-	const float factor = fs["DepthMapFactor"];
-	return fabs(factor) < 1e-5 ? 1 : 1.f / factor;
+	bool header = false;
+	for (const ThreadParams& param : params)
+	{
+		if (param.cpus.empty() && !param.setNice && param.fifoPriority <= 0)
+			continue;
+
+		if (!header)
+			std::cout << std::endl << "Thread Parameters: " << std::endl;
+		header = true;
+
+		std::cout << "- " << param.name << ":";
+		if (!param.cpus.empty())
+		{
+			std::cout << " cpus";
+			for (int cpu : param.cpus)
+				std::cout << " " << cpu;
+		}
+		if (param.setNice)
+			std::cout << ", nice " << param.nice;
+		if (param.fifoPriority > 0)
+			std::cout << ", SCHED_FIFO " << param.fifoPriority;
+		std::cout << std::endl;
+	}
 }
 
 static void PrintSettings(const CameraParams& camera, const cv::Mat1f& distCoeffs,
@@ -119,102 +174,66 @@ static void PrintSettings(const CameraParams& camera, const cv::Mat1f& distCoeff
 		std::cout << std::endl << "Depth Threshold (Close/Far Points): " << thDepth << std::endl;
 }
 
-static void ConvertToGray(const cv::Mat& src, cv::Mat& dst, bool RGB)
+static void PrintBudgetSettings(const TrackingBudget::Parameters& param)
 {
-	static const int codes[] = { cv::COLOR_RGB2GRAY, cv::COLOR_BGR2GRAY, cv::COLOR_RGBA2GRAY, cv::COLOR_BGRA2GRAY };
-
-	const int ch = src.channels();
-	CV_Assert(ch == 1 || ch == 3 || ch == 4);
-
-	if (ch == 1)
-	{
-		dst = src;
-		return;
-	}
-
-	const int idx = ((ch == 3 ? 0 : 1) << 1) + (RGB ? 0 : 1);
-	cv::cvtColor(src, dst, codes[idx]);
+	std::cout << std::endl << "Tracking Budget: " << std::endl;
+	std::cout << "- Time per Frame: " << param.budgetMs << " ms" << std::endl;
+	std::cout << "- Number of Features: " << param.minFeatures << " - " << param.maxFeatures << std::endl;
+	std::cout << "- Scale Levels: " << param.minLevels << " - " << param.maxLevels << std::endl;
+	std::cout << "- Local KeyFrames: " << param.minLocalKeyFrames << " - " << param.maxLocalKeyFrames << std::endl;
+	std::cout << "- Search Radius Scale: " << param.minSearchRadiusScale << " - 1" << std::endl;
+	std::cout << "- Safe Inliers: " << param.safeInliers << std::endl;
 }
 
-static void GetScalePyramidInfo(const ORBextractor& extractor, ScalePyramidInfo& pyramid)
+static double ElapsedMs(std::chrono::steady_clock::time_point t0, std::chrono::steady_clock::time_point t1)
 {
-	pyramid.nlevels = extractor.GetLevels();
-	pyramid.scaleFactor = extractor.GetScaleFactor();
-	pyramid.logScaleFactor = log(pyramid.scaleFactor);
-	pyramid.scaleFactors = extractor.GetScaleFactors();
-	pyramid.invScaleFactors = extractor.GetInverseScaleFactors();
-	pyramid.sigmaSq = extractor.GetScaleSigmaSquares();
-	pyramid.invSigmaSq = extractor.GetInverseScaleSigmaSquares();
+	return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(t1 - t0).count();
 }
 
-// Undistort keypoints given OpenCV distortion parameters.
-// Only for the RGB-D case. Stereo must be already rectified!
-// (called in the constructor).
-static void UndistortKeyPoints(const KeyPoints& src, KeyPoints& dst, const cv::Mat& K, const cv::Mat1f& distCoeffs)
+static void PrintQueueStats(const char* name, const KeyFrameQueue::Stats& stats)
 {
-	if (distCoeffs(0) == 0.f)
-	{
-		dst = src;
-		return;
-	}
-
-	std::vector<cv::Point2f> points(src.size());
-	for (size_t i = 0; i < src.size(); i++)
-		points[i] = src[i].pt;
-
-	cv::undistortPoints(points, points, K, distCoeffs, cv::Mat(), K);
-
-	dst.resize(src.size());
-	for (size_t i = 0; i < src.size(); i++)
-	{
-		cv::KeyPoint keypoint = src[i];
-		keypoint.pt = points[i];
-		dst[i] = keypoint;
-	}
+	std::cout << name << " queue: " << stats.pushed << " keyframes, max depth: " << stats.maxDepth
+		<< ", dwell time mean: " << stats.meanDwellMs << " ms, max: " << stats.maxDwellMs << " ms";
+	if (stats.overflows > 0)
+		std::cout << ", overflows: " << stats.overflows;
+	std::cout << std::endl;
 }
 
-// Computes image bounds for the undistorted image (called in the constructor).
-static ImageBounds ComputeImageBounds(const cv::Mat& image, const cv::Mat& K, const cv::Mat1f& distCoeffs)
+// First keyframe of the largest map in the atlas (nullptr if the map is empty).
+// Trajectories are written relative to it: after a loop closure the first keyframe might not be at the origin.
+static const KeyFrame* GetWorldOrigin(const Map& map)
 {
-	const float h = static_cast<float>(image.rows);
-	const float w = static_cast<float>(image.cols);
-
-	if (distCoeffs(0) == 0.f)
-		return ImageBounds(0.f, w, 0.f, h);
-
-	std::vector<cv::Point2f> corners = { { 0, 0 },{ w, 0 },{ 0, h },{ w, h } };
-	cv::undistortPoints(corners, corners, K, distCoeffs, cv::Mat(), K);
-
-	ImageBounds imageBounds;
-	imageBounds.minx = std::min(corners[0].x, corners[2].x);
-	imageBounds.maxx = std::max(corners[1].x, corners[3].x);
-	imageBounds.miny = std::min(corners[0].y, corners[1].y);
-	imageBounds.maxy = std::max(corners[2].y, corners[3].y);
-	return imageBounds;
+	const std::vector<KeyFrame*> keyframes = map.GetAllKeyFrames();
+	if (keyframes.empty())
+		return nullptr;
+
+	std::unordered_map<int, size_t> nkeyframes;
+	for (const KeyFrame* keyframe : keyframes)
+		nkeyframes[map.GetMapId(keyframe)]++;
+
+	const int mapId = std::max_element(std::begin(nkeyframes), std::end(nkeyframes),
+		[](const std::pair<const int, size_t>& lhs, const std::pair<const int, size_t>& rhs)
+	{ return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first > rhs.first); })->first;
+
+	const KeyFrame* firstKF = nullptr;
+	for (const KeyFrame* keyframe : keyframes)
+		if (map.GetMapId(keyframe) == mapId && (!firstKF || keyframe->id < firstKF->id))
+			firstKF = keyframe;
+	return firstKF;
 }
 
-// Associate a "right" coordinate to a keypoint if there is valid depth in the depthmap.
-static void ComputeStereoFromRGBD(const KeyPoints& keypoints, const KeyPoints& keypointsUn, const cv::Mat& depthImage,
-	const CameraParams& camera, std::vector<float>& uright, std::vector<float>& depth)
+// Frame pose is stored relative to its reference keyframe (which is optimized by BA and pose graph).
+// We need to get first the keyframe pose and then concatenate the relative transformation.
+// Frames tracked in other maps of the atlas than the one of originKF have no pose in it: they are written as lost.
+static void WriteTrajectory(const Trajectory& trajectory, const Map& map, const KeyFrame* originKF,
+	TrajectoryResolver& resolver, TrajectoryWriter& writer)
 {
-	const int nkeypoints = static_cast<int>(keypoints.size());
-
-	uright.assign(nkeypoints, -1.f);
-	depth.assign(nkeypoints, -1.f);
-
-	for (int i = 0; i < nkeypoints; i++)
+	const CameraPose Two = originKF->GetPose().Inverse();
+	const int mapId = map.GetMapId(originKF);
+	for (const TrackPoint& track : trajectory)
 	{
-		const cv::KeyPoint& keypoint = keypoints[i];
-		const cv::KeyPoint& keypointUn = keypointsUn[i];
-
-		const int v = static_cast<int>(keypoint.pt.y);
-		const int u = static_cast<int>(keypoint.pt.x);
-		const float d = depthImage.at<float>(v, u);
-		if (d > 0)
-		{
-			depth[i] = d;
-			uright[i] = keypointUn.pt.x - camera.bf / d;
-		}
+		const bool lost = track.lost || map.GetMapId(track.referenceKF) != mapId;
+		writer.Write(track.timestamp, resolver.Resolve(track) * Two, lost);
 	}
 }
 
@@ -233,10 +252,7 @@ public:
 			localMapper_->RequestStop();
 
 			// Wait until Local Mapping has effectively stopped
-			while (!localMapper_->isStopped())
-			{
-				usleep(1000);
-			}
+			localMapper_->WaitUntilStopped();
 
 			tracker_->InformOnlyTracking(true);
 			activateLocalizationMode_ = false;
@@ -314,8 +330,9 @@ public:
 	using Path = System::Path;
 
 	// Initialize the SLAM system. It launches the Local Mapping, Loop Closing and Viewer threads.
-	SystemImpl(const Path& vocabularyFile, const Path& settingsFile, Sensor sensor, bool useViewer)
-		: sensor_(sensor), viewer_(nullptr)
+	SystemImpl(const VocabularyPointer& voc, const Path& settingsFile, Sensor sensor, bool useViewer)
+		: sensor_(sensor), voc_(voc), viewer_(nullptr), trajectoryWindow_(0), streamOriginKF_(nullptr), lastBigChangeId_(0), nextFrameId_(0), replayMode_(false),
+		memoryLogInterval_(0), lastMemoryLog_(-std::numeric_limits<double>::infinity())
 	{
 		// Output welcome message
 		std::cout << std::endl <<
@@ -337,20 +354,17 @@ public:
 			std::exit(-1);
 		}
 
-		//Load ORB Vocabulary
-		std::cout << std::endl << "Loading ORB Vocabulary. This could take a while..." << std::endl;
-
-		if (!voc_.loadFromTextFile(vocabularyFile))
+		//Check ORB Vocabulary
+		if (!voc_ || voc_->empty())
 		{
-			std::cerr << "Wrong path to vocabulary. " << std::endl;
-			std::cerr << "Falied to open at: " << vocabularyFile << std::endl;
+			std::cerr << "ORB Vocabulary is not loaded." << std::endl;
 			std::exit(-1);
 		}
-		std::cout << "Vocabulary loaded!" << std::endl << std::endl;
 
-		// Load camera parameters from settings file
-		camera_ = ReadCameraParams(settings);
-		distCoeffs_ = ReadDistCoeffs(settings);
+		// Load camera and ORB parameters, and initialize ORB extractors
+		frameBuilder_ = std::make_unique<FrameBuilder>(settings, sensor_);
+		const CameraParams& camera = frameBuilder_->GetCamera();
+		const ORBextractor::Parameters& extractorParams = frameBuilder_->GetExtractorParameters();
 
 		// Load fps
 		const float fps = ReadFps(settings);
@@ -359,55 +373,67 @@ public:
 		const int minFrames = 0;
 		const int maxFrames = static_cast<int>(fps);
 
-		// Load color
-		RGB_ = static_cast<int>(settings["Camera.RGB"]) != 0;
+		// Load depth threshold
+		const float thDepth = camera.baseline * static_cast<float>(settings["ThDepth"]);
 
-		// Load ORB parameters
-		ORBextractor::Parameters extractorParams = ReadExtractorParams(settings);
+		// Load latency budget
+		const TrackingBudget::Parameters budgetParams = ReadBudgetParams(settings, extractorParams);
 
-		// Load depth threshold
-		const float thDepth = camera_.baseline * static_cast<float>(settings["ThDepth"]);
-		
-		// Load depth factor
-		depthFactor_ = sensor == System::RGBD ? ReadDepthFactor(settings) : 1.f;
+		// Load thread scheduling
+		ThreadParams threadParams[NUM_THREAD_ROLES];
+		for (int role = 0; role < NUM_THREAD_ROLES; role++)
+			threadParams[role] = ReadThreadParams(settings, static_cast<ThreadRole>(role));
 
 		// Print settings
-		PrintSettings(camera_, distCoeffs_, fps, RGB_, extractorParams, thDepth, sensor);
+		PrintSettings(camera, frameBuilder_->GetDistCoeffs(), fps, frameBuilder_->IsRGB(), extractorParams, thDepth, sensor);
+		if (budgetParams.budgetMs > 0)
+			PrintBudgetSettings(budgetParams);
+		PrintThreadSettings(threadParams);
 
-		// Initialize ORB extractors
-		extractorL_ = std::make_unique<ORBextractor>(extractorParams);
-		extractorR_ = std::make_unique<ORBextractor>(extractorParams);
+		//Create KeyFrame Database
+		keyFrameDB_ = std::make_unique<KeyFrameDatabase>(*voc_);
+		map_ = std::make_unique<Map>();
 
-		if (sensor == System::MONOCULAR)
-		{
-			extractorParams.nfeatures *= 2;
-			extractorIni_ = std::make_unique<ORBextractor>(extractorParams);
-		}
+		budget_ = std::make_unique<TrackingBudget>(budgetParams);
+		backPressure_ = std::make_unique<BackPressure>(ReadBackPressureParams(settings));
 
-		// Scale Level Info
-		GetScalePyramidInfo(*extractorL_, pyramid_);
-		
-		//Create KeyFrame Database
-		keyFrameDB_ = std::make_unique<KeyFrameDatabase>(voc_);
+		// Input recording
+		if (settings["Recorder.file"].isString())
+			StartRecording(static_cast<std::string>(settings["Recorder.file"]));
+
+		// Live state for external processes
+		const StatePublisher::Parameters publisherParams = ReadPublisherParams(settings);
+		publisher_ = StatePublisher::Create(publisherParams);
+		if (publisher_)
+			std::cout << "Publishing the tracking state in shared memory " << publisherParams.name << std::endl;
+
+		// Memory statistics
+		memoryLogInterval_ = settings["Memory.logInterval"];
 
 		//Initialize the Tracking thread
 		//(it will live in the main thread of execution, the one that called this constructor)
-		const Tracking::Parameters trackParams(minFrames, maxFrames, thDepth);
-		tracker_ = Tracking::Create(this, &voc_, &map_, keyFrameDB_.get(), sensor_, trackParams);
+		//Its scheduling is only changed if the Threads.Tracking keys are set, and it keeps its name.
+		ApplyThreadParams(threadParams[TRACKING_THREAD]);
+		Tracking::Parameters trackParams(minFrames, maxFrames, thDepth);
+		trackParams.maxLostFrames = settings["Atlas.maxLostFrames"];
+		if (trackParams.maxLostFrames > 0)
+			std::cout << "Atlas: a new map is started after " << trackParams.maxLostFrames << " lost frames" << std::endl;
+		tracker_ = Tracking::Create(this, voc_.get(), map_.get(), keyFrameDB_.get(), sensor_, trackParams);
 
 		//Initialize the Local Mapping thread and launch
-		localMapper_ = LocalMapping::Create(&map_, sensor_ == MONOCULAR, thDepth);
-		threads_[THREAD_LOCAL_MAPPING] = std::thread(&ORB_SLAM2::LocalMapping::Run, localMapper_.get());
+		localMapper_ = LocalMapping::Create(map_.get(), sensor_ == MONOCULAR, thDepth);
+		threads_[THREAD_LOCAL_MAPPING] = LaunchThread(threadParams[LOCAL_MAPPING_THREAD], &ORB_SLAM2::LocalMapping::Run, localMapper_.get());
 
 		//Initialize the Loop Closing thread and launch
-		loopCloser_ = LoopClosing::Create(&map_, keyFrameDB_.get(), &voc_, sensor_ != MONOCULAR);
-		threads_[THREAD_LOOP_CLOSING] = std::thread(&ORB_SLAM2::LoopClosing::Run, loopCloser_.get());
+		loopCloser_ = LoopClosing::Create(map_.get(), keyFrameDB_.get(), voc_.get(), sensor_ != MONOCULAR,
+			threadParams[GLOBAL_BA_THREAD]);
+		threads_[THREAD_LOOP_CLOSING] = LaunchThread(threadParams[LOOP_CLOSING_THREAD], &ORB_SLAM2::LoopClosing::Run, loopCloser_.get());
 
 		//Initialize the Viewer thread and launch
 		if (useViewer)
 		{
-			viewer_ = std::make_unique<Viewer>(this, &map_, settingsFile);
-			threads_[THREAD_VIEWER] = std::thread(&Viewer::Run, viewer_.get());
+			viewer_ = std::make_unique<Viewer>(this, map_.get(), settingsFile);
+			threads_[THREAD_VIEWER] = LaunchThread(threadParams[VIEWER_THREAD], &Viewer::Run, viewer_.get());
 		}
 
 		//Set pointers between threads
@@ -426,7 +452,7 @@ public:
 
 	// Proccess the given stereo frame. Images must be synchronized and rectified.
 	// Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
-	// Returns the camera pose (empty if tracking fails).
+	// Returns the camera pose (empty if tracking fails or the frame was dropped under overload).
 	cv::Mat TrackStereo(const cv::Mat& imageL, const cv::Mat& imageR, double timestamp) override
 	{
 		if (sensor_ != STEREO)
@@ -435,45 +461,39 @@ public:
 			std::exit(-1);
 		}
 
+		if (recorder_)
+			recorder_->Write(imageL, imageR, timestamp);
+
 		// Check mode change
 		modeManager_->Update();
 
 		// Check reset
 		resetManager_->Update();
 
-		// Color conversion
-		ConvertToGray(imageL, imageL_, RGB_);
-		ConvertToGray(imageR, imageR_, RGB_);
-
-		// ORB extraction
-		std::thread threadL([&]() { extractorL_->Extract(imageL_, keypointsL_, descriptorsL_); });
-		std::thread threadR([&]() { extractorR_->Extract(imageR_, keypointsR_, descriptorsR_); });
-		threadL.join();
-		threadR.join();
-
-		// Undistortion
-		UndistortKeyPoints(keypointsL_, keypointsUn_, camera_.Mat(), distCoeffs_);
+		// Check overload
+		if (!ApplyBackPressure(timestamp))
+			return cv::Mat();
 
-		// Stereo matching
-		ComputeStereoMatches(
-			keypointsL_, descriptorsL_, extractorL_->GetImagePyramid(),
-			keypointsR_, descriptorsR_, extractorR_->GetImagePyramid(),
-			pyramid_.scaleFactors, pyramid_.invScaleFactors, camera_, uright_, depth_);
-
-		// Computes image bounds for the undistorted image
-		if (imageBounds_.Empty())
-			imageBounds_ = ComputeImageBounds(imageL_, camera_.Mat(), distCoeffs_);
+		const auto t0 = std::chrono::steady_clock::now();
 
 		// Create frame
-		currFrame_ = Frame(&voc_, timestamp, camera_, keypointsL_, keypointsUn_, uright_, depth_,
-			descriptorsL_, pyramid_, imageBounds_);
+		currFrame_ = frameBuilder_->Stereo(nextFrameId_++, voc_.get(), imageL, imageR, timestamp);
 
 		// Update tracker
+		const auto t1 = std::chrono::steady_clock::now();
 		const cv::Mat Tcw = tracker_->Update(currFrame_);
+		const auto t2 = std::chrono::steady_clock::now();
+
+		UpdateBudget(ElapsedMs(t0, t1), ElapsedMs(t1, t2));
+		if (replayMode_)
+			SyncMapping();
+		FlushTrajectoryStream(false);
+		PublishState();
+		LogMemory(timestamp);
 
 		if (viewer_)
 		{
-			viewer_->UpdateFrame(tracker_.get(), currFrame_, imageL_);
+			viewer_->UpdateFrame(tracker_.get(), currFrame_, frameBuilder_->GetImage());
 			if (tracker_->GetState() == Tracking::STATE_OK)
 				viewer_->SetCurrentCameraPose(Tcw);
 		}
@@ -487,7 +507,7 @@ public:
 	// Process the given rgbd frame. Depthmap must be registered to the RGB frame.
 	// Input image: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
 	// Input depthmap: Float (CV_32F).
-	// Returns the camera pose (empty if tracking fails).
+	// Returns the camera pose (empty if tracking fails or the frame was dropped under overload).
 	cv::Mat TrackRGBD(const cv::Mat& image, const cv::Mat& depth, double timestamp) override
 	{
 		if (sensor_ != RGBD)
@@ -496,39 +516,39 @@ public:
 			std::exit(-1);
 		}
 
+		if (recorder_)
+			recorder_->Write(image, depth, timestamp);
+
 		// Check mode change
 		modeManager_->Update();
 
 		// Check reset
 		resetManager_->Update();
 
-		// Color conversion
-		ConvertToGray(image, imageL_, RGB_);
-
-		// ORB extraction
-		extractorL_->Extract(imageL_, keypointsL_, descriptorsL_);
-
-		// Undistortion
-		UndistortKeyPoints(keypointsL_, keypointsUn_, camera_.Mat(), distCoeffs_);
-
-		// Associate a "right" coordinate to a keypoint if there is valid depth in the depthmap.
-		depth.convertTo(depthMap_, CV_32F, depthFactor_);
-		ComputeStereoFromRGBD(keypointsL_, keypointsUn_, depthMap_, camera_, uright_, depth_);
+		// Check overload
+		if (!ApplyBackPressure(timestamp))
+			return cv::Mat();
 
-		// Computes image bounds for the undistorted image
-		if (imageBounds_.Empty())
-			imageBounds_ = ComputeImageBounds(imageL_, camera_.Mat(), distCoeffs_);
+		const auto t0 = std::chrono::steady_clock::now();
 
 		// Create frame
-		currFrame_ = Frame(&voc_, timestamp, camera_, keypointsL_, keypointsUn_, uright_, depth_,
-			descriptorsL_, pyramid_, imageBounds_);
+		currFrame_ = frameBuilder_->RGBD(nextFrameId_++, voc_.get(), image, depth, timestamp);
 
 		// Update tracker
+		const auto t1 = std::chrono::steady_clock::now();
 		const cv::Mat Tcw = tracker_->Update(currFrame_);
+		const auto t2 = std::chrono::steady_clock::now();
+
+		UpdateBudget(ElapsedMs(t0, t1), ElapsedMs(t1, t2));
+		if (replayMode_)
+			SyncMapping();
+		FlushTrajectoryStream(false);
+		PublishState();
+		LogMemory(timestamp);
 
 		if (viewer_)
 		{
-			viewer_->UpdateFrame(tracker_.get(), currFrame_, imageL_);
+			viewer_->UpdateFrame(tracker_.get(), currFrame_, frameBuilder_->GetImage());
 			if (tracker_->GetState() == Tracking::STATE_OK)
 				viewer_->SetCurrentCameraPose(Tcw);
 		}
@@ -541,7 +561,7 @@ public:
 
 	// Proccess the given monocular frame
 	// Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
-	// Returns the camera pose (empty if tracking fails).
+	// Returns the camera pose (empty if tracking fails or the frame was dropped under overload).
 	cv::Mat TrackMonocular(const cv::Mat& image, double timestamp) override
 	{
 		if (sensor_ != MONOCULAR)
@@ -550,34 +570,42 @@ public:
 			std::exit(-1);
 		}
 
+		if (recorder_)
+			recorder_->Write(image, cv::Mat(), timestamp);
+
 		// Check mode change
 		modeManager_->Update();
 
 		// Check reset
 		resetManager_->Update();
 
-		// Color conversion
-		ConvertToGray(image, imageL_, RGB_);
+		// Check overload
+		if (!ApplyBackPressure(timestamp))
+			return cv::Mat();
+
+		const auto t0 = std::chrono::steady_clock::now();
 
 		const int state = tracker_->GetState();
 		const bool init = state == Tracking::STATE_NOT_INITIALIZED || state == Tracking::STATE_NO_IMAGES;
-		auto& extractor = init ? extractorIni_ : extractorL_;
-
-		// ORB extraction
-		extractor->Extract(imageL_, keypointsL_, descriptorsL_);
-
-		// Undistortion
-		UndistortKeyPoints(keypointsL_, keypointsUn_, camera_.Mat(), distCoeffs_);
 
 		// Create frame
-		currFrame_ = Frame(&voc_, timestamp, camera_, keypointsL_, keypointsUn_, descriptorsL_, pyramid_, imageBounds_);
+		currFrame_ = frameBuilder_->Monocular(nextFrameId_++, voc_.get(), image, timestamp, init);
 
 		// Update tracker
+		const auto t1 = std::chrono::steady_clock::now();
 		const cv::Mat Tcw = tracker_->Update(currFrame_);
+		const auto t2 = std::chrono::steady_clock::now();
+
+		UpdateBudget(ElapsedMs(t0, t1), ElapsedMs(t1, t2));
+		if (replayMode_)
+			SyncMapping();
+		FlushTrajectoryStream(false);
+		PublishState();
+		LogMemory(timestamp);
 
 		if (viewer_)
 		{
-			viewer_->UpdateFrame(tracker_.get(), currFrame_, imageL_);
+			viewer_->UpdateFrame(tracker_.get(), currFrame_, frameBuilder_->GetImage());
 			if (tracker_->GetState() == Tracking::STATE_OK)
 				viewer_->SetCurrentCameraPose(Tcw);
 		}
@@ -588,6 +616,156 @@ public:
 		return Tcw;
 	}
 
+	// Decides how to process the current frame under overload. Returns false if the frame must be dropped.
+	bool ApplyBackPressure(double timestamp)
+	{
+		if (!backPressure_->Enabled() || replayMode_)
+			return true;
+
+		const bool trackingOK = tracker_->GetState() == Tracking::STATE_OK;
+		const BackPressure::Decision decision = backPressure_->Update(timestamp,
+			localMapper_->KeyframesInQueue(), loopCloser_->KeyframesInQueue(), trackingOK);
+
+		tracker_->SetMotionOnly(decision == BackPressure::DOWNGRADE);
+		tracker_->SetThrottleKeyFrames(backPressure_->ThrottleKeyFrames());
+
+		if (decision == BackPressure::DROP)
+		{
+			// Keep frame ids in step with the input so that keyframe rules still follow the frame rate
+			nextFrameId_++;
+			return false;
+		}
+
+		return true;
+	}
+
+	// Writes the frames older than the window (or all of them) to the trajectory stream.
+	// They are written a window at a time: at most two windows are kept in memory.
+	void FlushTrajectoryStream(bool all)
+	{
+		if (!trajectoryWriter_)
+			return;
+
+		if (!all && tracker_->GetTrajectory().size() < 2 * trajectoryWindow_)
+			return;
+
+		Trajectory removed;
+		tracker_->TrimTrajectory(all ? 0 : trajectoryWindow_, removed);
+		if (all)
+			removed.insert(std::end(removed), std::begin(tracker_->GetTrajectory()), std::end(tracker_->GetTrajectory()));
+
+		// Poses must not be corrected while the frames are resolved
+		auto lock = LockShared(map_->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
+
+		// The whole stream is written in the frame of the map chosen at the first flush
+		if (!streamOriginKF_)
+			streamOriginKF_ = GetWorldOrigin(*map_);
+		if (!streamOriginKF_)
+			return;
+
+		WriteTrajectory(removed, *map_, streamOriginKF_, trajectoryResolver_, *trajectoryWriter_);
+		trajectoryWriter_->Flush();
+	}
+
+	void PublishState()
+	{
+		if (!publisher_)
+			return;
+
+		// The map must not change while the keyframes and map points are copied
+		auto lock = LockShared(map_->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
+		publisher_->PublishFrame(currFrame_, tracker_->GetState());
+		publisher_->PublishMap(*map_, currFrame_);
+	}
+
+	// Prints the memory statistics every memoryLogInterval_ seconds of input
+	void LogMemory(double timestamp)
+	{
+		if (memoryLogInterval_ <= 0)
+			return;
+
+		// The timestamps may restart (e.g. a new sequence after a reset)
+		if (timestamp >= lastMemoryLog_ && timestamp < lastMemoryLog_ + memoryLogInterval_)
+			return;
+
+		lastMemoryLog_ = timestamp;
+		PrintMemoryStats(std::cout, GetMemoryStats());
+	}
+
+	void SaveTrajectory(const Path& filename, TrajectoryWriter::Format format) const
+	{
+		const KeyFrame* originKF = GetWorldOrigin(*map_);
+		if (!originKF)
+		{
+			std::cerr << "ERROR: the map is empty." << std::endl;
+			return;
+		}
+
+		TrajectoryWriter writer(filename, format);
+		TrajectoryResolver resolver;
+		WriteTrajectory(tracker_->GetTrajectory(), *map_, originKF, resolver, writer);
+
+		std::cout << std::endl << "trajectory saved!" << std::endl;
+	}
+
+	// Adapts the work of the next frame to the time spent in the last one
+	void UpdateBudget(double extractionMs, double trackingMs)
+	{
+		if (!budget_->Enabled() || replayMode_)
+			return;
+
+		const bool lost = tracker_->GetState() != Tracking::STATE_OK;
+		budget_->Update(extractionMs, trackingMs, tracker_->GetNumInliers(), lost);
+		ApplyBudget();
+	}
+
+	void ApplyBudget()
+	{
+		const TrackingBudget::Settings& settings = budget_->GetSettings();
+		frameBuilder_->SetFeatureBudget(settings.nfeatures, settings.nlevels);
+		tracker_->SetLocalMapBudget(settings.maxLocalKeyFrames, settings.searchRadiusScale);
+	}
+
+	// Replay mode: the keyframes inserted by the frame are fully processed before the next frame,
+	// including the loop closures and global BA they trigger
+	void SyncMapping()
+	{
+		localMapper_->WaitUntilIdle();
+		loopCloser_->WaitUntilIdle();
+		loopCloser_->WaitForGBA();
+
+		// Loop correction and global BA stop Local Mapping, wait for it to resume
+		localMapper_->WaitUntilIdle();
+	}
+
+	bool StartRecording(const Path& filename) override
+	{
+		recorder_ = Recorder::Create(filename, sensor_);
+		return recorder_ != nullptr;
+	}
+
+	void StopRecording() override
+	{
+		recorder_.reset();
+	}
+
+	void SetReplayMode(bool flag) override
+	{
+		if (flag && !replayMode_)
+		{
+			// Start from the full quality, whatever the timings of the previous frames were
+			if (budget_->Enabled())
+			{
+				budget_->Reset();
+				ApplyBudget();
+			}
+			backPressure_->Reset();
+			tracker_->SetMotionOnly(false);
+			tracker_->SetThrottleKeyFrames(false);
+		}
+		replayMode_ = flag;
+	}
+
 	// This stops local mapping thread (map building) and performs only camera tracking.
 	void ActivateLocalizationMode() override
 	{
@@ -604,11 +782,10 @@ public:
 	// since last call to this function
 	bool MapChanged() const override
 	{
-		static int n = 0;
-		const int curn = map_.GetLastBigChangeIdx();
-		if (n < curn)
+		const int curn = map_->GetLastBigChangeIdx();
+		if (lastBigChangeId_ < curn)
 		{
-			n = curn;
+			lastBigChangeId_ = curn;
 			return true;
 		}
 		else
@@ -627,10 +804,12 @@ public:
 		if (viewer_)
 		{
 			viewer_->RequestStop();
-			while (!viewer_->isStopped())
-				usleep(3000);
+			viewer_->WaitUntilStopped();
 		}
 
+		// Write the trajectory of the map being reset
+		FlushTrajectoryStream(true);
+
 		// Reset Tracking
 		tracker_->Reset();
 
@@ -650,10 +829,13 @@ public:
 		std::cout << " done" << std::endl;
 
 		// Clear Map (this erase MapPoints and KeyFrames)
-		map_.Clear();
+		map_->Clear();
+		trajectoryResolver_.Clear();
+		streamOriginKF_ = nullptr;
+		if (publisher_)
+			publisher_->PublishReset();
 
-		KeyFrame::nextId = 0;
-		Frame::nextId = 0;
+		nextFrameId_ = 0;
 
 		if (viewer_)
 			viewer_->Release();
@@ -667,20 +849,39 @@ public:
 		localMapper_->RequestFinish();
 		loopCloser_->RequestFinish();
 		if (viewer_)
-		{
 			viewer_->RequestFinish();
-			while (!viewer_->isFinished())
-				usleep(5000);
-		}
 
 		// Wait until all thread have effectively stopped
-		while (!localMapper_->isFinished() || !loopCloser_->isFinished() || loopCloser_->isRunningGBA())
+		for (auto& t : threads_)
+			if (t.joinable()) t.join();
+
+		loopCloser_->WaitForGBA();
+
+		StopTrajectoryStream();
+		StopRecording();
+
+		PrintQueueStats("Local Mapping", localMapper_->GetQueueStats());
+		PrintQueueStats("Loop Closing", loopCloser_->GetQueueStats());
+
+#ifdef ORB_SLAM2_LOCK_STATS
+		PrintLockStats(std::cout);
+#endif
+
+		if (backPressure_->Enabled())
 		{
-			usleep(5000);
+			const BackPressure::Counters& counters = backPressure_->GetCounters();
+			std::cout << "Frames processed: " << counters.processed << ", downgraded: " << counters.downgraded
+				<< ", dropped: " << counters.dropped << ", with keyframes throttled: " << counters.throttled << std::endl;
 		}
 
-		for (auto& t : threads_)
-			if (t.joinable()) t.join();
+		if (memoryLogInterval_ > 0)
+			PrintMemoryStats(std::cout, GetMemoryStats());
+	}
+
+	// Hands the map and the keyframe database over to a localization server
+	LocalizationServer::Pointer CreateLocalizationServer() override
+	{
+		return LocalizationServer::Create(voc_, std::move(map_), std::move(keyFrameDB_));
 	}
 
 	// Save camera trajectory in the TUM RGB-D dataset format.
@@ -696,54 +897,7 @@ public:
 			return;
 		}
 
-		std::vector<KeyFrame*> keyframes = map_.GetAllKeyFrames();
-		std::sort(std::begin(keyframes), std::end(keyframes),
-			[](const KeyFrame* lhs, const KeyFrame* rhs) { return lhs->id < rhs->id; });
-
-		// Transform all keyframes so that the first keyframe is at the origin.
-		// After a loop closure the first keyframe might not be at the origin.
-		const CameraPose Two = keyframes.front()->GetPose().Inverse();
-
-		std::ofstream ofs(filename);
-		ofs << std::fixed;
-
-		// Frame pose is stored relative to its reference keyframe (which is optimized by BA and pose graph).
-		// We need to get first the keyframe pose and then concatenate the relative transformation.
-		// Frames not localized (tracking failure) are not saved.
-
-		// For each frame we have a reference keyframe, the timestamp and a flag
-		// which is true when tracking failed.
-		for (const auto& track : tracker_->GetTrajectory())
-		{
-			if (track.lost)
-				continue;
-
-			const KeyFrame* keyframe = track.referenceKF;
-
-			CameraPose Trw = CameraPose::Origin();
-
-			// If the reference keyframe was culled, traverse the spanning tree to get a suitable keyframe.
-			while (keyframe->isBad())
-			{
-				Trw = Trw * keyframe->Tcp;
-				keyframe = keyframe->GetParent();
-			}
-
-			Trw = Trw * keyframe->GetPose() * Two;
-
-			const CameraPose Tcw = track.Tcr * Trw;
-			const CameraPose Twc = Tcw.Inverse();
-			const auto Rwc = Twc.R();
-			const auto twc = Twc.t();
-
-			const auto q = Converter::toQuaternion(Rwc);
-
-			ofs << std::setprecision(6) << track.timestamp << " ";
-			ofs << std::setprecision(9) << twc(0) << " " << twc(1) << " " << twc(2) << " ";
-			ofs << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << std::endl;
-		}
-
-		std::cout << std::endl << "trajectory saved!" << std::endl;
+		SaveTrajectory(filename, TrajectoryWriter::TUM);
 	}
 
 	// Save keyframe poses in the TUM RGB-D dataset format.
@@ -754,7 +908,18 @@ public:
 	{
 		std::cout << std::endl << "Saving keyframe trajectory to " << filename << " ..." << std::endl;
 
-		std::vector<KeyFrame*> keyframes = map_.GetAllKeyFrames();
+		// Only the largest map of the atlas
+		const KeyFrame* originKF = GetWorldOrigin(*map_);
+		if (!originKF)
+		{
+			std::cerr << "ERROR: the map is empty." << std::endl;
+			return;
+		}
+		const int mapId = map_->GetMapId(originKF);
+
+		std::vector<KeyFrame*> keyframes = map_->GetAllKeyFrames();
+		keyframes.erase(std::remove_if(std::begin(keyframes), std::end(keyframes),
+			[&](const KeyFrame* keyframe) { return map_->GetMapId(keyframe) != mapId; }), std::end(keyframes));
 		std::sort(std::begin(keyframes), std::end(keyframes),
 			[](const KeyFrame* lhs, const KeyFrame* rhs) { return lhs->id < rhs->id; });
 
@@ -796,50 +961,30 @@ public:
 			return;
 		}
 
-		std::vector<KeyFrame*> keyframes = map_.GetAllKeyFrames();
-		std::sort(std::begin(keyframes), std::end(keyframes),
-			[](const KeyFrame* lhs, const KeyFrame* rhs) { return lhs->id < rhs->id; });
-
-		// Transform all keyframes so that the first keyframe is at the origin.
-		// After a loop closure the first keyframe might not be at the origin.
-		const CameraPose Two = keyframes.front()->GetPose().Inverse();
-
-		std::ofstream ofs(filename);
-		ofs << std::fixed;
+		SaveTrajectory(filename, TrajectoryWriter::KITTI);
+	}
 
-		// Frame pose is stored relative to its reference keyframe (which is optimized by BA and pose graph).
-		// We need to get first the keyframe pose and then concatenate the relative transformation.
-		// Frames not localized (tracking failure) are not saved.
+	bool StartTrajectoryStream(const Path& filename, TrajectoryWriter::Format format, int window) override
+	{
+		StopTrajectoryStream();
 
-		// For each frame we have a reference keyframe, the timestamp and a flag
-		// which is true when tracking failed.
-		for (const auto& track : tracker_->GetTrajectory())
+		auto writer = std::make_unique<TrajectoryWriter>(filename, format);
+		if (!writer->IsOpen())
 		{
-			const KeyFrame* keyframe = track.referenceKF;
-
-			CameraPose Trw = CameraPose::Origin();
-
-			while (keyframe->isBad())
-			{
-				//  std::cout << "bad parent" << std::endl;
-				Trw = Trw * keyframe->Tcp;
-				keyframe = keyframe->GetParent();
-			}
-
-			Trw = Trw * keyframe->GetPose() * Two;
-
-			const CameraPose Tcw = track.Tcr * Trw;
-			const CameraPose Twc = Tcw.Inverse();
-			const auto Rwc = Twc.R();
-			const auto twc = Twc.t();
-
-			ofs << std::setprecision(9) <<
-				Rwc(0, 0) << " " << Rwc(0, 1) << " " << Rwc(0, 2) << " " << twc(0) << " " <<
-				Rwc(1, 0) << " " << Rwc(1, 1) << " " << Rwc(1, 2) << " " << twc(1) << " " <<
-				Rwc(2, 0) << " " << Rwc(2, 1) << " " << Rwc(2, 2) << " " << twc(2) << std::endl;
+			std::cerr << "Failed to open trajectory stream " << filename << std::endl;
+			return false;
 		}
 
-		std::cout << std::endl << "trajectory saved!" << std::endl;
+		trajectoryWriter_ = std::move(writer);
+		trajectoryWindow_ = std::max(window, 1);
+		streamOriginKF_ = nullptr;
+		return true;
+	}
+
+	void StopTrajectoryStream() override
+	{
+		FlushTrajectoryStream(true);
+		trajectoryWriter_.reset();
 	}
 
 	// TODO: Save/Load functions
@@ -866,12 +1011,28 @@ public:
 		return trackedKeyPointsUn_;
 	}
 
+	BackPressure::Counters GetBackPressureCounters() const override
+	{
+		return backPressure_->GetCounters();
+	}
+
+	MemoryStats GetMemoryStats() const override
+	{
+		MemoryStats stats;
+		map_->AddMemoryUsage(stats);
+		keyFrameDB_->AddMemoryUsage(stats);
+		stats.vocabulary = voc_->getMemoryUsage();
+
+		const Trajectory& trajectory = tracker_->GetTrajectory();
+		stats.trajectory = HeapBytes(trajectory);
+		stats.trajectoryFrames = trajectory.size();
+		return stats;
+	}
+
 	void ChangeCalibration(const std::string& settingsFile) override
 	{
 		cv::FileStorage settings(settingsFile, cv::FileStorage::READ);
-		camera_ = ReadCameraParams(settings);
-		distCoeffs_ = ReadDistCoeffs(settings);
-		imageBounds_ = ImageBounds();
+		frameBuilder_->ChangeCalibration(settings);
 	}
 
 private:
@@ -880,13 +1041,14 @@ private:
 	Sensor sensor_;
 
 	// ORB vocabulary used for place recognition and feature matching.
-	ORBVocabulary voc_;
+	// It may be shared with other systems.
+	VocabularyPointer voc_;
 
 	// KeyFrame database for place recognition (relocalization and loop detection).
 	std::unique_ptr<KeyFrameDatabase> keyFrameDB_;
 
 	// Map structure that stores the pointers to all KeyFrames and MapPoints.
-	Map map_;
+	std::unique_ptr<Map> map_;
 
 	// Tracker. It receives a frame and computes the associated camera pose.
 	// It also decides when to insert a new keyframe, create some new MapPoints and
@@ -903,6 +1065,14 @@ private:
 	// The viewer draws the map and the current camera pose. It uses Pangolin.
 	std::unique_ptr<Viewer> viewer_;
 
+	// Streamed camera trajectory
+	std::unique_ptr<TrajectoryWriter> trajectoryWriter_;
+	TrajectoryResolver trajectoryResolver_;
+	size_t trajectoryWindow_;
+
+	// First keyframe of the map the stream is written in, fixed at the first flush (see GetWorldOrigin)
+	const KeyFrame* streamOriginKF_;
+
 	// System threads: Local Mapping, Loop Closing, Viewer.
 	// The Tracking thread "lives" in the main execution thread that creates the System object.
 	enum { THREAD_LOCAL_MAPPING, THREAD_LOOP_CLOSING, THREAD_VIEWER, NUM_THREADS };
@@ -911,6 +1081,9 @@ private:
 	// Reset flag
 	std::unique_ptr<ResetManager> resetManager_;
 
+	// Last big change of the map reported by MapChanged
+	mutable int lastBigChangeId_;
+
 	// Change mode flags
 	std::unique_ptr<ModeManager> modeManager_;
 
@@ -922,37 +1095,64 @@ private:
 
 	// Current Frame
 	Frame currFrame_;
-	cv::Mat imageL_;
-	cv::Mat imageR_;
-	cv::Mat depthMap_;
+	frameid_t nextFrameId_;
 
-	KeyPoints keypointsL_, keypointsR_, keypointsUn_;
-	std::vector<float> uright_, depth_;
-	cv::Mat descriptorsL_, descriptorsR_;
-	ImageBounds imageBounds_;
+	// Color conversion, ORB extraction, undistortion and stereo/depth association
+	std::unique_ptr<FrameBuilder> frameBuilder_;
 
-	// ORB
-	std::unique_ptr<ORBextractor> extractorL_;
-	std::unique_ptr<ORBextractor> extractorR_;
-	std::unique_ptr<ORBextractor> extractorIni_;
+	// Per-frame latency budget controller
+	std::unique_ptr<TrackingBudget> budget_;
 
-	// Scale Level Info
-	ScalePyramidInfo pyramid_;
+	// Overload policy (frame dropping and keyframe throttling)
+	std::unique_ptr<BackPressure> backPressure_;
 
-	// Calibration matrix
-	CameraParams camera_;
-	cv::Mat1f distCoeffs_;
+	// Live state for external processes (null if disabled)
+	StatePublisher::Pointer publisher_;
 
-	// For RGB-D inputs only. For some datasets (e.g. TUM) the depthmap values are scaled.
-	float depthFactor_;
+	// Inputs of the Track* calls (null if not recording)
+	Recorder::Pointer recorder_;
 
-	// Color order (true RGB, false BGR, ignored if grayscale)
-	bool RGB_;
+	// Mapping runs in lockstep with tracking, and the budget and overload policy are off (see SetReplayMode)
+	bool replayMode_;
+
+	// Period (seconds of input, 0 disables) and timestamp of the last memory statistics printed
+	double memoryLogInterval_;
+	double lastMemoryLog_;
 };
 
+System::VocabularyPointer System::LoadVocabulary(const Path& vocabularyFile)
+{
+	auto voc = std::make_shared<ORBVocabulary>();
+
+	// vocabularies written by vocabulary_tool are binary
+	const std::string ext = ".bin";
+	const bool binary = vocabularyFile.size() >= ext.size() &&
+		vocabularyFile.compare(vocabularyFile.size() - ext.size(), ext.size(), ext) == 0;
+
+	const bool loaded = binary ? voc->loadFromBinaryFile(vocabularyFile) : voc->loadFromTextFile(vocabularyFile);
+	return loaded ? voc : nullptr;
+}
+
 System::Pointer System::Create(const Path& vocabularyFile, const Path& settingsFile, Sensor sensor, bool useViewer)
 {
-	return std::make_unique<SystemImpl>(vocabularyFile, settingsFile, sensor, useViewer);
+	//Load ORB Vocabulary
+	std::cout << std::endl << "Loading ORB Vocabulary. This could take a while..." << std::endl;
+
+	const VocabularyPointer voc = LoadVocabulary(vocabularyFile);
+	if (!voc)
+	{
+		std::cerr << "Wrong path to vocabulary. " << std::endl;
+		std::cerr << "Falied to open at: " << vocabularyFile << std::endl;
+		std::exit(-1);
+	}
+	std::cout << "Vocabulary loaded!" << std::endl << std::endl;
+
+	return Create(voc, settingsFile, sensor, useViewer);
+}
+
+System::Pointer System::Create(const VocabularyPointer& voc, const Path& settingsFile, Sensor sensor, bool useViewer)
+{
+	return std::make_unique<SystemImpl>(voc, settingsFile, sensor, useViewer);
 }
 
 System::~System() {}
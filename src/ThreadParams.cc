@@ -0,0 +1,167 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ThreadParams.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+namespace ORB_SLAM2
+{
+
+static const char* ROLE_KEYS[NUM_THREAD_ROLES] =
+{
+	"Tracking", "Extractor", "LocalMapping", "LoopClosing", "GlobalBA", "Viewer"
+};
+
+// Linux limits thread names to 15 characters
+static const char* ROLE_NAMES[NUM_THREAD_ROLES] =
+{
+	"orb-tracking", "orb-extractor", "orb-mapping", "orb-loop", "orb-global-ba", "orb-viewer"
+};
+
+// Parses a CPU list such as "0,2-3". Returns false if it is malformed.
+static bool ParseCpuList(const std::string& str, std::vector<int>& cpus)
+{
+	cpus.clear();
+	std::stringstream ss(str);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		int first, last;
+		char dash, extra;
+		std::stringstream range(item);
+		if (!(range >> first))
+			return false;
+		last = first;
+		if (range >> dash && (dash != '-' || !(range >> last)))
+			return false;
+		if (range >> extra || first < 0 || last < first)
+			return false;
+		for (int cpu = first; cpu <= last; cpu++)
+			cpus.push_back(cpu);
+	}
+	return !cpus.empty();
+}
+
+static std::vector<int> ReadCpuList(const cv::FileNode& node, const std::string& key)
+{
+	std::vector<int> cpus;
+	if (node.empty())
+		return cpus;
+
+	const std::string str = node.isString() ? static_cast<std::string>(node) : std::to_string(static_cast<int>(node));
+	if (!ParseCpuList(str, cpus))
+	{
+		std::cerr << "Invalid CPU list for " << key << ": " << str << std::endl;
+		std::exit(-1);
+	}
+
+	const int ncpus = static_cast<int>(std::thread::hardware_concurrency());
+	for (int cpu : cpus)
+		if (ncpus > 0 && cpu >= ncpus)
+			std::cerr << "Warning: " << key << " refers to CPU " << cpu << " but only " << ncpus << " are available" << std::endl;
+	return cpus;
+}
+
+ThreadParams ReadThreadParams(const cv::FileStorage& settings, ThreadRole role)
+{
+	const std::string prefix = std::string("Threads.") + ROLE_KEYS[role] + ".";
+
+	// The tracking thread belongs to the caller
+	const bool callerThread = role == TRACKING_THREAD;
+
+	ThreadParams params(ROLE_NAMES[role]);
+	params.setName = !callerThread;
+	params.cpus = ReadCpuList(settings[prefix + "cpus"], prefix + "cpus");
+	if (params.cpus.empty() && !callerThread)
+		params.cpus = ReadCpuList(settings["Threads.cpus"], "Threads.cpus");
+
+	const cv::FileNode nice = settings[prefix + "nice"];
+	if (!nice.empty())
+	{
+		params.setNice = true;
+		params.nice = nice;
+	}
+
+	params.fifoPriority = settings[prefix + "fifoPriority"];
+	return params;
+}
+
+#ifdef __linux__
+
+void ApplyThreadParams(const ThreadParams& params)
+{
+	if (params.setName && !params.name.empty())
+		pthread_setname_np(pthread_self(), params.name.substr(0, 15).c_str());
+
+	if (!params.cpus.empty())
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : params.cpus)
+			CPU_SET(cpu, &set);
+		const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (error)
+			std::cerr << "Failed to set the CPU affinity of " << params.name << ": " << std::strerror(error) << std::endl;
+	}
+
+	// The nice level is a per-thread attribute on Linux
+	if (params.setNice)
+	{
+		const id_t tid = static_cast<id_t>(syscall(SYS_gettid));
+		if (setpriority(PRIO_PROCESS, tid, params.nice) != 0)
+			std::cerr << "Failed to set the nice level of " << params.name << ": " << std::strerror(errno) << std::endl;
+	}
+
+	if (params.fifoPriority > 0)
+	{
+		sched_param param;
+		param.sched_priority = params.fifoPriority;
+		const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (error)
+			std::cerr << "Failed to set SCHED_FIFO for " << params.name << ": " << std::strerror(error) << std::endl;
+	}
+}
+
+#else
+
+void ApplyThreadParams(const ThreadParams& params)
+{
+	if (!params.cpus.empty() || params.setNice || params.fifoPriority > 0)
+		std::cerr << "Thread scheduling parameters are not supported on this platform" << std::endl;
+}
+
+#endif
+
+ThreadParams::ThreadParams(const std::string& name) : name(name), setName(true), setNice(false), nice(0), fifoPriority(0) {}
+
+} //namespace ORB_SLAM
@@ -22,7 +22,9 @@
 #include "Tracking.h"
 
 #include <iostream>
+#include <algorithm>
 #include <mutex>
+#include <unordered_map>
 
 #include <opencv2/opencv.hpp>
 
@@ -37,8 +39,7 @@
 #include "ORBextractor.h"
 #include "Initializer.h"
 #include "System.h"
-#include "PnPsolver.h"
-#include "Usleep.h"
+#include "Relocalizer.h"
 #include "CameraParameters.h"
 #include "Optimizer.h"
 #include "CameraProjection.h"
@@ -54,7 +55,7 @@ TrackPoint::TrackPoint(const Frame& frame, bool lost)
 
 struct LocalMap
 {
-	LocalMap(Map* map) : map_(map) {}
+	LocalMap(Map* map) : referenceKF(nullptr), maxKeyFrames(80), map_(map), updateId_(0) {}
 
 	void Update(Frame& currFrame)
 	{
@@ -63,41 +64,98 @@ struct LocalMap
 
 		// Update
 		UpdateLocalKeyFrames(currFrame);
-		UpdateLocalPoints(currFrame);
+		UpdateLocalPoints();
+	}
+
+	// Starts a new local map from the given keyframes
+	void Initialize(const std::vector<KeyFrame*>& initialKFs, KeyFrame* initialReferenceKF)
+	{
+		Clear();
+		keyframes = initialKFs;
+		referenceKF = initialReferenceKF;
+		UpdateLocalPoints();
+	}
+
+	void Clear()
+	{
+		referenceKF = nullptr;
+		keyframes.clear();
+		mappoints.clear();
+		pointVotes_.clear();
+		keyframeVotes_.clear();
+		keyframePoints_.clear();
+		localPoints_.clear();
 	}
 
 	void UpdateLocalKeyFrames(Frame& currFrame)
 	{
-		// Each map point vote for the keyframes in which it has been observed
-		std::map<KeyFrame*, int> keyframeCounter;
+		updateId_++;
+
+		// Each map point vote for the keyframes in which it has been observed.
+		// Votes are kept from frame to frame, so only the points that are new in this frame
+		// or whose observations changed have to be visited.
 		for (int i = 0; i < currFrame.N; i++)
 		{
-			if (!currFrame.mappoints[i])
+			MapPoint* mappoint = currFrame.mappoints[i];
+			if (!mappoint)
 				continue;
 
-			MapPoint* mappoint = currFrame.mappoints[i];
-			if (!mappoint->isBad())
+			if (mappoint->isBad())
+			{
+				currFrame.mappoints[i] = nullptr;
+				continue;
+			}
+
+			PointVotes& votes = pointVotes_[mappoint];
+			if (votes.updateId == updateId_)
+				continue;
+
+			votes.updateId = updateId_;
+
+			const unsigned int version = mappoint->GetObservationsVersion();
+			if (!votes.initialized || votes.version != version)
+			{
+				RemoveVotes(votes.keyframes);
+				votes.keyframes.clear();
+				for (const auto& observation : mappoint->GetObservations())
+					votes.keyframes.push_back(observation.first);
+				votes.version = version;
+				votes.initialized = true;
+				AddVotes(votes.keyframes);
+			}
+		}
+
+		// Remove the votes of the points not tracked anymore
+		for (auto it = std::begin(pointVotes_); it != std::end(pointVotes_);)
+		{
+			if (it->second.updateId != updateId_)
 			{
-				for (const auto& observations : mappoint->GetObservations())
-					keyframeCounter[observations.first]++;
+				RemoveVotes(it->second.keyframes);
+				it = pointVotes_.erase(it);
 			}
 			else
 			{
-				currFrame.mappoints[i] = nullptr;
+				++it;
 			}
 		}
 
-		if (keyframeCounter.empty())
+		if (keyframeVotes_.empty())
 			return;
 
 		int maxCount = 0;
 		KeyFrame* maxKeyFrame = nullptr;
 
 		keyframes.clear();
-		keyframes.reserve(3 * keyframeCounter.size());
+		keyframes.reserve(3 * keyframeVotes_.size());
+
+		// The voted keyframes are visited in id order, since the order of the hash map depends on the addresses.
+		// It decides the reference keyframe on ties, the neighbors kept under maxKeyFrames and the order of the points.
+		sortedVotes_.assign(std::begin(keyframeVotes_), std::end(keyframeVotes_));
+		std::sort(std::begin(sortedVotes_), std::end(sortedVotes_),
+			[](const std::pair<KeyFrame*, int>& lhs, const std::pair<KeyFrame*, int>& rhs) { return lhs.first->id < rhs.first->id; });
 
 		// All keyframes that observe a map point are included in the local map. Also check which keyframe shares most points
-		for (const auto& v : keyframeCounter)
+		for (const auto& v : sortedVotes_)
 		{
 			KeyFrame* keyframe = v.first;
 			const int count = v.second;
@@ -116,12 +174,14 @@ struct LocalMap
 		}
 
 		// Include also some not-already-included keyframes that are neighbors to already-included keyframes
-		for (KeyFrame* keyframe : keyframes)
+		const size_t nvoted = keyframes.size();
+		for (size_t k = 0; k < nvoted; k++)
 		{
 			// Limit the number of keyframes
-			if (keyframes.size() > 80)
+			if (static_cast<int>(keyframes.size()) > maxKeyFrames)
 				break;
 
+			KeyFrame* keyframe = keyframes[k];
 			for (KeyFrame* neighborKF : keyframe->GetBestCovisibilityKeyFrames(10))
 			{
 				if (!neighborKF->isBad() && neighborKF->trackReferenceForFrame != currFrame.id)
@@ -162,26 +222,144 @@ struct LocalMap
 		}
 	}
 
-	void UpdateLocalPoints(Frame& currFrame)
+	void UpdateLocalPoints()
 	{
-		mappoints.clear();
+		updateId_++;
+
+		// The map points of a keyframe are read again only if the keyframe
+		// entered the local map or its map points changed since the last update
 		for (KeyFrame* keyframe : keyframes)
 		{
+			KeyFramePoints& entry = keyframePoints_[keyframe];
+			entry.updateId = updateId_;
+
+			const unsigned int version = keyframe->GetMapPointsVersion();
+			if (entry.initialized && entry.version == version)
+				continue;
+
+			for (MapPoint* mappoint : entry.mappoints)
+				RemovePoint(mappoint);
+
+			entry.mappoints.clear();
 			for (MapPoint* mappoint : keyframe->GetMapPointMatches())
 			{
-				if (!mappoint || mappoint->trackReferenceForFrame == currFrame.id || mappoint->isBad())
-					continue;
-
-				mappoints.push_back(mappoint);
-				mappoint->trackReferenceForFrame = currFrame.id;
+				if (mappoint && !mappoint->isBad())
+				{
+					entry.mappoints.push_back(mappoint);
+					AddPoint(mappoint);
+				}
 			}
+
+			entry.version = version;
+			entry.initialized = true;
+		}
+
+		// Remove the points of the keyframes that left the local map, in id order (see UpdateLocalKeyFrames)
+		leftKeyFrames_.clear();
+		for (const auto& entry : keyframePoints_)
+			if (entry.second.updateId != updateId_)
+				leftKeyFrames_.push_back(entry.first);
+		std::sort(std::begin(leftKeyFrames_), std::end(leftKeyFrames_),
+			[](const KeyFrame* lhs, const KeyFrame* rhs) { return lhs->id < rhs->id; });
+
+		for (KeyFrame* keyframe : leftKeyFrames_)
+		{
+			auto it = keyframePoints_.find(keyframe);
+			for (MapPoint* mappoint : it->second.mappoints)
+				RemovePoint(mappoint);
+			keyframePoints_.erase(it);
 		}
 	}
 
 	KeyFrame* referenceKF;
 	std::vector<KeyFrame*> keyframes;
 	std::vector<MapPoint*> mappoints;
+	int maxKeyFrames;
 	Map* map_;
+
+private:
+
+	// Keyframes a tracked map point has voted for
+	struct PointVotes
+	{
+		PointVotes() : version(0), updateId(0), initialized(false) {}
+		std::vector<KeyFrame*> keyframes;
+		unsigned int version;
+		unsigned int updateId;
+		bool initialized;
+	};
+
+	// Map points a local keyframe has contributed to the local map
+	struct KeyFramePoints
+	{
+		KeyFramePoints() : version(0), updateId(0), initialized(false) {}
+		std::vector<MapPoint*> mappoints;
+		unsigned int version;
+		unsigned int updateId;
+		bool initialized;
+	};
+
+	// Number of local keyframes containing a local map point, and its position in mappoints
+	struct LocalPoint
+	{
+		int count;
+		size_t index;
+	};
+
+	void AddVotes(const std::vector<KeyFrame*>& voted)
+	{
+		for (KeyFrame* keyframe : voted)
+			keyframeVotes_[keyframe]++;
+	}
+
+	void RemoveVotes(const std::vector<KeyFrame*>& voted)
+	{
+		for (KeyFrame* keyframe : voted)
+		{
+			auto it = keyframeVotes_.find(keyframe);
+			if (--it->second == 0)
+				keyframeVotes_.erase(it);
+		}
+	}
+
+	void AddPoint(MapPoint* mappoint)
+	{
+		auto it = localPoints_.find(mappoint);
+		if (it != std::end(localPoints_))
+		{
+			it->second.count++;
+			return;
+		}
+
+		localPoints_[mappoint] = { 1, mappoints.size() };
+		mappoints.push_back(mappoint);
+	}
+
+	void RemovePoint(MapPoint* mappoint)
+	{
+		auto it = localPoints_.find(mappoint);
+		if (--it->second.count > 0)
+			return;
+
+		// Move the last point to the position of the removed one
+		const size_t index = it->second.index;
+		MapPoint* last = mappoints.back();
+		mappoints[index] = last;
+		localPoints_[last].index = index;
+		mappoints.pop_back();
+
+		localPoints_.erase(it);
+	}
+
+	std::unordered_map<MapPoint*, PointVotes> pointVotes_;
+	std::unordered_map<KeyFrame*, int> keyframeVotes_;
+	std::unordered_map<KeyFrame*, KeyFramePoints> keyframePoints_;
+	std::unordered_map<MapPoint*, LocalPoint> localPoints_;
+	unsigned int updateId_;
+
+	// Scratch buffers of the updates
+	std::vector<std::pair<KeyFrame*, int>> sortedVotes_;
+	std::vector<KeyFrame*> leftKeyFrames_;
 };
 
 static int DiscardOutliers(Frame& currFrame)
@@ -217,7 +395,7 @@ static void UpdateLastFramePose(Frame& lastFrame, const TrackPoint& lastTrackPoi
 	lastFrame.SetPose(lastTrackPoint.Tcr * CameraPose(referenceKF->GetPose()));
 }
 
-bool TrackWithMotionModel(Frame& currFrame, Frame& lastFrame, const cv::Mat& velocity,
+bool TrackWithMotionModel(Frame& currFrame, Frame& lastFrame, Map* map, const cv::Mat& velocity,
 	int minInliers, int sensor, bool* fewMatches = nullptr)
 {
 	ORBmatcher matcher(0.9f, true);
@@ -243,7 +421,7 @@ bool TrackWithMotionModel(Frame& currFrame, Frame& lastFrame, const cv::Mat& vel
 		return false;
 
 	// Optimize frame pose with all matches
-	Optimizer::PoseOptimization(&currFrame);
+	Optimizer::PoseOptimization(&currFrame, map);
 
 	// Discard outliers
 	const int ninliers = DiscardOutliers(currFrame);
@@ -254,7 +432,8 @@ bool TrackWithMotionModel(Frame& currFrame, Frame& lastFrame, const cv::Mat& vel
 	return ninliers >= minInliers;
 }
 
-static bool TrackReferenceKeyFrame(Frame& currFrame, KeyFrame* referenceKF, Frame& lastFrame, int minInliers = 10)
+static bool TrackReferenceKeyFrame(Frame& currFrame, KeyFrame* referenceKF, Frame& lastFrame, Map* map,
+	int minInliers = 10)
 {
 	// Compute Bag of Words vector
 	currFrame.ComputeBoW();
@@ -273,7 +452,7 @@ static bool TrackReferenceKeyFrame(Frame& currFrame, KeyFrame* referenceKF, Fram
 	currFrame.mappoints = mappoints;
 	currFrame.SetPose(lastFrame.pose);
 
-	Optimizer::PoseOptimization(&currFrame);
+	Optimizer::PoseOptimization(&currFrame, map);
 
 	// Discard outliers
 	const int ninliers = DiscardOutliers(currFrame);
@@ -281,187 +460,6 @@ static bool TrackReferenceKeyFrame(Frame& currFrame, KeyFrame* referenceKF, Fram
 	return ninliers >= minInliers;
 }
 
-class Relocalizer
-{
-public:
-
-	Relocalizer(KeyFrameDatabase* keyFrameDB) : keyFrameDB_(keyFrameDB), lastRelocFrameId_(0) {}
-
-	bool Relocalize(Frame& currFrame)
-	{
-		// Compute Bag of Words Vector
-		currFrame.ComputeBoW();
-
-		// Relocalization is performed when tracking is lost
-		// Track Lost: Query KeyFrame Database for keyframe candidates for relocalisation
-		std::vector<KeyFrame*> candidateKFs = keyFrameDB_->DetectRelocalizationCandidates(&currFrame);
-
-		if (candidateKFs.empty())
-			return false;
-
-		const int nkeyframes = static_cast<int>(candidateKFs.size());
-
-		// We perform first an ORB matching with each candidate
-		// If enough matches are found we setup a PnP solver
-		ORBmatcher matcher(0.75f, true);
-
-		std::vector<std::unique_ptr<PnPsolver>> PnPsolvers;
-		PnPsolvers.resize(nkeyframes);
-
-		std::vector<std::vector<MapPoint*>> vmatches;
-		vmatches.resize(nkeyframes);
-
-		std::vector<bool> discarded;
-		discarded.resize(nkeyframes);
-
-		int ncandidates = 0;
-
-		for (int i = 0; i < nkeyframes; i++)
-		{
-			KeyFrame* keyframe = candidateKFs[i];
-			if (keyframe->isBad())
-			{
-				discarded[i] = true;
-			}
-			else
-			{
-				const int nmatches = matcher.SearchByBoW(keyframe, currFrame, vmatches[i]);
-				if (nmatches < 15)
-				{
-					discarded[i] = true;
-					continue;
-				}
-				else
-				{
-					auto solver = std::make_unique<PnPsolver>(currFrame, vmatches[i]);
-					solver->SetRansacParameters(0.99, 10, 300, 4, 0.5f, 5.991f);
-					PnPsolvers[i] = std::move(solver);
-					ncandidates++;
-				}
-			}
-		}
-
-		// Alternatively perform some iterations of P4P RANSAC
-		// Until we found a camera pose supported by enough inliers
-		bool found = false;
-		ORBmatcher matcher2(0.9f, true);
-
-		while (ncandidates > 0 && !found)
-		{
-			for (int i = 0; i < nkeyframes; i++)
-			{
-				if (discarded[i])
-					continue;
-
-				// Perform 5 Ransac Iterations
-				std::vector<bool> isInlier;
-				int nInliers;
-				bool terminate;
-
-				auto& solver = PnPsolvers[i];
-				const cv::Mat Tcw = solver->iterate(5, terminate, isInlier, nInliers);
-
-				// If Ransac reachs max. iterations discard keyframe
-				if (terminate)
-				{
-					discarded[i] = true;
-					ncandidates--;
-				}
-
-				// If a Camera Pose is computed, optimize
-				if (!Tcw.empty())
-				{
-					currFrame.SetPose(CameraPose(Tcw));
-
-					std::set<MapPoint*> foundPoints;
-
-					const int np = static_cast<int>(isInlier.size());
-
-					for (int j = 0; j < np; j++)
-					{
-						if (isInlier[j])
-						{
-							currFrame.mappoints[j] = vmatches[i][j];
-							foundPoints.insert(vmatches[i][j]);
-						}
-						else
-							currFrame.mappoints[j] = nullptr;
-					}
-
-					int ngood = Optimizer::PoseOptimization(&currFrame);
-
-					if (ngood < 10)
-						continue;
-
-					for (int io = 0; io < currFrame.N; io++)
-						if (currFrame.outlier[io])
-							currFrame.mappoints[io] = nullptr;
-
-					// If few inliers, search by projection in a coarse window and optimize again
-					if (ngood < 50)
-					{
-						int nadditional = matcher2.SearchByProjection(currFrame, candidateKFs[i], foundPoints, 10, 100);
-
-						if (nadditional + ngood >= 50)
-						{
-							ngood = Optimizer::PoseOptimization(&currFrame);
-
-							// If many inliers but still not enough, search by projection again in a narrower window
-							// the camera has been already optimized with many points
-							if (ngood > 30 && ngood < 50)
-							{
-								foundPoints.clear();
-								for (int ip = 0; ip < currFrame.N; ip++)
-									if (currFrame.mappoints[ip])
-										foundPoints.insert(currFrame.mappoints[ip]);
-								nadditional = matcher2.SearchByProjection(currFrame, candidateKFs[i], foundPoints, 3, 64);
-
-								// Final optimization
-								if (ngood + nadditional >= 50)
-								{
-									ngood = Optimizer::PoseOptimization(&currFrame);
-
-									for (int io = 0; io < currFrame.N; io++)
-										if (currFrame.outlier[io])
-											currFrame.mappoints[io] = nullptr;
-								}
-							}
-						}
-					}
-
-
-					// If the pose is supported by enough inliers stop ransacs and continue
-					if (ngood >= 50)
-					{
-						found = true;
-						break;
-					}
-				}
-			}
-		}
-
-		if (!found)
-		{
-			return false;
-		}
-		else
-		{
-			lastRelocFrameId_ = currFrame.id;
-			return true;
-		}
-	}
-
-	frameid_t GetLastRelocFrameId() const
-	{
-		return lastRelocFrameId_;
-	}
-
-private:
-
-	KeyFrameDatabase* keyFrameDB_;
-	frameid_t lastRelocFrameId_;
-};
-
 class NeedNewKeyFrame
 {
 public:
@@ -474,13 +472,18 @@ public:
 
 	void SetLocalMapper(LocalMapping* localMapper) { localMapper_ = localMapper; }
 
-	bool operator()(const Frame& currFrame, const KeyFrame* lastKeyFrame, int matchInliers) const
+	bool operator()(const Frame& currFrame, const KeyFrame* lastKeyFrame, int matchInliers, bool throttle) const
 	{
 		// If Local Mapping is freezed by a Loop Closure do not insert keyframes
 		if (localMapper_->isStopped() || localMapper_->stopRequested())
 			return false;
 
-		const int nkeyframes = static_cast<int>(map_->KeyFramesInMap());
+		// Inserting into a full queue would block the tracking with the map lock held.
+		// Tracking is the only producer, so the queue can not fill up again before the insertion.
+		if (localMapper_->KeyFrameQueueFull())
+			return false;
+
+		const int nkeyframes = static_cast<int>(map_->KeyFramesInMap(map_->GetCurrentMap()));
 
 		// Do not insert keyframes if not enough frames have passed from last relocalisation
 		const int lastRelocFrameId = relocalizer_.GetLastRelocFrameId();
@@ -524,6 +527,10 @@ public:
 		// Condition 2: Few tracked points compared to reference keyframe. Lots of visual odometry compared to map matches.
 		const bool c2 = ((matchInliers < refMatches * refRatio || needToInsertClose) && matchInliers > 15);
 
+		// Under overload only the keyframes needed to keep tracking are inserted
+		if (throttle && !(matchInliers < refMatches * 0.25 || needToInsertClose))
+			return false;
+
 		if ((c1a || c1b || c1c) && c2)
 		{
 			// If the mapping accepts keyframes, insert keyframe.
@@ -658,7 +665,7 @@ static int TrackLocalMap(LocalMap& localMap, Frame& currFrame, float th, bool lo
 	SearchLocalPoints(localMap, currFrame, th);
 
 	// Optimize Pose
-	Optimizer::PoseOptimization(&currFrame);
+	Optimizer::PoseOptimization(&currFrame, localMap.map_);
 	int ninliers = 0;
 
 	// Update MapPoints Statistics
@@ -818,11 +825,11 @@ public:
 		if (withMotionModel)
 		{
 			UpdateLastFramePose(lastFrame, trajectory_.back());
-			success = TrackWithMotionModel(currFrame, lastFrame, velocity, minInliers, sensor_);
+			success = TrackWithMotionModel(currFrame, lastFrame, map_, velocity, minInliers, sensor_);
 		}
 		if (!withMotionModel || (withMotionModel && !success))
 		{
-			success = TrackReferenceKeyFrame(currFrame, localMap_.referenceKF, lastFrame);
+			success = TrackReferenceKeyFrame(currFrame, localMap_.referenceKF, lastFrame, map_);
 		}
 
 		return success;
@@ -846,11 +853,11 @@ public:
 				if (createPoints)
 					CreateMapPointsVO(lastFrame, tempPoints_, map_, thDepth_);
 
-				success = TrackWithMotionModel(currFrame, lastFrame, velocity, minInliers, sensor_, &fewMatches_);
+				success = TrackWithMotionModel(currFrame, lastFrame, map_, velocity, minInliers, sensor_, &fewMatches_);
 			}
 			else
 			{
-				success = TrackReferenceKeyFrame(currFrame, localMap_.referenceKF, lastFrame);
+				success = TrackReferenceKeyFrame(currFrame, localMap_.referenceKF, lastFrame, map_);
 			}
 		}
 		else
@@ -872,7 +879,7 @@ public:
 				if (createPoints)
 					CreateMapPointsVO(lastFrame, tempPoints_, map_, thDepth_);
 
-				successMM = TrackWithMotionModel(currFrame, lastFrame, velocity, minInliers, sensor_, &fewMatches_);
+				successMM = TrackWithMotionModel(currFrame, lastFrame, map_, velocity, minInliers, sensor_, &fewMatches_);
 				mappointsMM = currFrame.mappoints;
 				outlierMM = currFrame.outlier;
 				poseMM = currFrame.pose;
@@ -952,10 +959,12 @@ class TrackingImpl : public Tracking
 {
 public:
 
-	TrackingImpl(System* system, ORBVocabulary* voc, Map* map, KeyFrameDatabase* keyFrameDB,
+	TrackingImpl(System* system, const ORBVocabulary* voc, Map* map, KeyFrameDatabase* keyFrameDB,
 		int sensor, const Parameters& param)
-		: state_(STATE_NO_IMAGES), sensor_(sensor), localization_(false), voc_(voc), keyFrameDB_(keyFrameDB),
-		initializer_(nullptr), localMap_(map), system_(system), map_(map), param_(param), relocalizer_(keyFrameDB),
+		: state_(STATE_NO_IMAGES), sensor_(sensor), localization_(false), motionOnly_(false), throttleKeyFrames_(false),
+		voc_(voc), keyFrameDB_(keyFrameDB),
+		initializer_(nullptr), localMap_(map), system_(system), map_(map), param_(param), matchesInliers_(0),
+		searchRadiusScale_(1.f), lostFrames_(0), relocalizer_(map, keyFrameDB),
 		initPose_(map, localMap_, relocalizer_, trajectory_, sensor, param.thDepth),
 		needNewKeyFrame_(map, localMap_, relocalizer_, param, sensor)
 	{
@@ -971,7 +980,7 @@ public:
 		currFrame.SetPose(CameraPose::Origin());
 
 		// Create KeyFrame
-		KeyFrame* keyframe = new KeyFrame(currFrame, map_, keyFrameDB_);
+		KeyFrame* keyframe = new KeyFrame(currFrame, map_, keyFrameDB_, true);
 
 		// Insert KeyFrame in the map
 		map_->AddKeyFrame(keyframe);
@@ -1004,9 +1013,7 @@ public:
 		lastKeyFrame_ = keyframe;
 		CV_Assert(lastKeyFrame_->frameId == currFrame.id);
 
-		localMap_.keyframes.push_back(keyframe);
-		localMap_.mappoints = map_->GetAllMapPoints();
-		localMap_.referenceKF = keyframe;
+		localMap_.Initialize({ keyframe }, keyframe);
 		currFrame.referenceKF = keyframe;
 
 		map_->SetReferenceMapPoints(localMap_.mappoints);
@@ -1088,7 +1095,7 @@ public:
 	void CreateInitialMapMonocular(Frame& currFrame)
 	{
 		// Create KeyFrames
-		KeyFrame* pKFini = new KeyFrame(initFrame_, map_, keyFrameDB_);
+		KeyFrame* pKFini = new KeyFrame(initFrame_, map_, keyFrameDB_, true);
 		KeyFrame* pKFcur = new KeyFrame(currFrame, map_, keyFrameDB_);
 
 		pKFini->ComputeBoW();
@@ -1133,7 +1140,10 @@ public:
 		// Bundle Adjustment
 		std::cout << "New Map created with " << map_->MapPointsInMap() << " points" << std::endl;
 
-		Optimizer::GlobalBundleAdjustemnt(map_, 20);
+		// Only the new keyframes: the other maps of the atlas are left out
+		std::vector<MapPoint*> initialMPs = pKFini->GetMapPointMatches();
+		initialMPs.erase(std::remove(std::begin(initialMPs), std::end(initialMPs), nullptr), std::end(initialMPs));
+		Optimizer::BundleAdjustment(map_, { pKFini, pKFcur }, initialMPs, 20);
 
 		// Set median depth to 1
 		float medianDepth = pKFini->ComputeSceneMedianDepth(2);
@@ -1141,6 +1151,13 @@ public:
 
 		if (medianDepth < 0 || pKFcur->TrackedMapPoints(1) < 100)
 		{
+			if (param_.maxLostFrames > 0 && map_->MapsInAtlas() > 1)
+			{
+				std::cout << "Wrong initialization, discarding the new map..." << std::endl;
+				DiscardInitialMap(pKFini, pKFcur, initialMPs);
+				return;
+			}
+
 			std::cout << "Wrong initialization, reseting..." << std::endl;
 			system_->RequestReset();
 			return;
@@ -1169,10 +1186,7 @@ public:
 		lastKeyFrame_ = pKFcur;
 		CV_Assert(lastKeyFrame_->frameId == currFrame.id);
 
-		localMap_.keyframes.push_back(pKFcur);
-		localMap_.keyframes.push_back(pKFini);
-		localMap_.mappoints = map_->GetAllMapPoints();
-		localMap_.referenceKF = pKFcur;
+		localMap_.Initialize({ pKFcur, pKFini }, pKFcur);
 		currFrame.referenceKF = pKFcur;
 
 		lastFrame_ = Frame(currFrame);
@@ -1184,6 +1198,32 @@ public:
 		state_ = STATE_OK;
 	}
 
+	// Removes a failed monocular initialization, keeping the other maps of the atlas
+	void DiscardInitialMap(KeyFrame* pKFini, KeyFrame* pKFcur, const std::vector<MapPoint*>& initialMPs)
+	{
+		for (MapPoint* mappoint : initialMPs)
+			map_->EraseMapPoint(mappoint);
+		map_->EraseKeyFrame(pKFini);
+		map_->EraseKeyFrame(pKFcur);
+
+		initializer_.reset(nullptr);
+	}
+
+	// Keeps the current map in the atlas and initializes a new one from the next frames.
+	// Loop Closing merges the maps when it recognizes a place of one in the other.
+	void StartNewMap()
+	{
+		const int mapId = map_->CreateMap();
+		std::cout << "Track lost, starting map " << mapId << " (" << map_->MapsInAtlas() << " maps)" << std::endl;
+
+		state_ = STATE_NOT_INITIALIZED;
+		initializer_.reset(nullptr);
+		localMap_.Clear();
+		velocity_ = cv::Mat();
+		lostFrames_ = 0;
+		relocalizer_.ClearPosePrior();
+	}
+
 	// Main tracking function. It is independent of the input sensor.
 	cv::Mat Update(Frame& currFrame) override
 	{
@@ -1192,8 +1232,14 @@ public:
 
 		lastProcessedState_ = state_;
 
-		// Get Map Mutex -> Map cannot be changed
-		std::unique_lock<std::mutex> lock(map_->mutexMapUpdate);
+		// Get Map Mutex -> Map cannot be changed.
+		// The map is only read (it is not corrected) by the tracking, except when it is initialized.
+		std::unique_lock<SharedMutex> writeLock;
+		std::shared_lock<SharedMutex> readLock;
+		if (state_ == STATE_NOT_INITIALIZED)
+			writeLock = LockMutex(map_->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
+		else
+			readLock = LockShared(map_->mutexMapUpdate, LOCK_SITE("Map::MapUpdate"));
 
 		// Initialize Tracker if not initialized.
 		if (state_ == STATE_NOT_INITIALIZED)
@@ -1211,12 +1257,19 @@ public:
 			{
 				trajectory_.push_back(TrackPoint(currFrame, false));
 			}
+			else if (!trajectory_.empty())
+			{
+				// A new map of the atlas is being initialized
+				trajectory_.push_back(trajectory_.back());
+				trajectory_.back().lost = true;
+			}
 
 			return currFrame.pose.Mat();
 		}
 
 		// System is initialized. Track Frame.
 		bool success = false;
+		const bool relocalization = state_ != STATE_OK;
 
 		// Initial camera pose estimation using motion model or relocalization (if tracking is lost)
 		if (state_ != STATE_OK)
@@ -1239,11 +1292,12 @@ public:
 		// mbVO true means that there are few matches to MapPoints in the map. We cannot retrieve
 		// a local map and therefore we do not perform TrackLocalMap(). Once the system relocalizes
 		// the camera we will use the local map again.
-		if (success && (!localization_ || (localization_ && !initPose_.FewMatches())))
+		// Under overload (motionOnly_) the local map is not tracked either.
+		if (success && !motionOnly_ && (!localization_ || (localization_ && !initPose_.FewMatches())))
 		{
 			// If the camera has been relocalised recently, perform a coarser search
 			const int passedFromLastReloc = currFrame.PassedFrom(relocalizer_.GetLastRelocFrameId());
-			const float th = passedFromLastReloc < 2 ? 5.f : (sensor_ == System::RGBD ? 3.f : 1.f);
+			const float th = searchRadiusScale_ * (passedFromLastReloc < 2 ? 5.f : (sensor_ == System::RGBD ? 3.f : 1.f));
 
 			matchesInliers_ = TrackLocalMap(localMap_, currFrame, th, localization_, sensor_ == System::STEREO);
 
@@ -1255,6 +1309,10 @@ public:
 
 		state_ = success ? STATE_OK : STATE_LOST;
 
+		// Relocalization may have found the camera in another map of the atlas
+		if (success && relocalization && param_.maxLostFrames > 0)
+			map_->SetCurrentMap(map_->GetMapId(localMap_.referenceKF));
+
 		// Score number of observations (for visualization)
 		nobservations_.resize(currFrame.N);
 		for (int i = 0; i < currFrame.N; i++)
@@ -1284,7 +1342,7 @@ public:
 			initPose_.DeleteTemporalMapPoints();
 
 			// Check if we need to insert a new keyframe
-			if (!localization_ && needNewKeyFrame_(currFrame, lastKeyFrame_, matchesInliers_))
+			if (!localization_ && !motionOnly_ && needNewKeyFrame_(currFrame, lastKeyFrame_, matchesInliers_, throttleKeyFrames_))
 			{
 				if (localMapper_->SetNotStop(true))
 				{
@@ -1311,17 +1369,31 @@ public:
 				if (currFrame.mappoints[i] && currFrame.outlier[i])
 					currFrame.mappoints[i] = nullptr;
 			}
+
+			// Relocalization searches around this pose first if tracking gets lost
+			relocalizer_.SetPosePrior(currFrame, velocity_);
 		}
 
-		// Reset if the camera get lost soon after initialization
+		// Reset if the camera get lost soon after initialization.
+		// With the atlas, a new map is started instead (unless this is the only map),
+		// also if the camera stays lost for too long.
+		bool newMap = false;
 		if (state_ == STATE_LOST)
 		{
-			if (map_->KeyFramesInMap() <= 5)
+			const bool recentMap = map_->KeyFramesInMap(map_->GetCurrentMap()) <= 5;
+			if (recentMap && (param_.maxLostFrames <= 0 || map_->MapsInAtlas() <= 1))
 			{
 				std::cout << "Track lost soon after initialisation, reseting..." << std::endl;
 				system_->RequestReset();
 				return cv::Mat();
 			}
+
+			lostFrames_++;
+			newMap = param_.maxLostFrames > 0 && (recentMap || lostFrames_ >= param_.maxLostFrames);
+		}
+		else
+		{
+			lostFrames_ = 0;
 		}
 
 		CV_Assert(currFrame.referenceKF);
@@ -1342,6 +1414,9 @@ public:
 			trajectory_.back().lost = lost;
 		}
 
+		if (newMap)
+			StartNewMap();
+
 		return currFrame.pose.Mat();
 	}
 
@@ -1361,11 +1436,30 @@ public:
 		localization_ = flag;
 	}
 
+	void SetMotionOnly(bool flag) override
+	{
+		motionOnly_ = flag;
+	}
+
+	void SetThrottleKeyFrames(bool flag) override
+	{
+		throttleKeyFrames_ = flag;
+	}
+
 	void Reset() override
 	{
 		state_ = STATE_NO_IMAGES;
 		initializer_.reset(nullptr);
 		trajectory_.clear();
+		localMap_.Clear();
+		lostFrames_ = 0;
+		relocalizer_.ClearPosePrior();
+	}
+
+	void SetLocalMapBudget(int maxLocalKeyFrames, float searchRadiusScale) override
+	{
+		localMap_.maxKeyFrames = maxLocalKeyFrames;
+		searchRadiusScale_ = searchRadiusScale;
 	}
 
 	int GetState() const override
@@ -1373,6 +1467,11 @@ public:
 		return state_;
 	}
 
+	int GetNumInliers() const override
+	{
+		return matchesInliers_;
+	}
+
 	int GetLastProcessedState() const override
 	{
 		return lastProcessedState_;
@@ -1398,6 +1497,17 @@ public:
 		return trajectory_;
 	}
 
+	void TrimTrajectory(size_t maxSize, Trajectory& removed) override
+	{
+		// The last point is needed to track the next frame
+		const size_t keep = std::max(maxSize, size_t(1));
+		while (trajectory_.size() > keep)
+		{
+			removed.push_back(trajectory_.front());
+			trajectory_.pop_front();
+		}
+	}
+
 	bool OnlyTracking() const override
 	{
 		return localization_;
@@ -1426,12 +1536,16 @@ private:
 	// True if local mapping is deactivated and we are performing only localization
 	bool localization_;
 
+	// Overload handling requested by the system
+	bool motionOnly_;
+	bool throttleKeyFrames_;
+
 	//Other Thread Pointers
 	LocalMapping* localMapper_;
 	LoopClosing* loopClosing_;
 
 	//BoW
-	ORBVocabulary* voc_;
+	const ORBVocabulary* voc_;
 	KeyFrameDatabase* keyFrameDB_;
 
 	// Initalization (only for monocular)
@@ -1452,6 +1566,12 @@ private:
 	//Current matches in frame
 	int matchesInliers_;
 
+	// Scale of the search radius in the local map (set by the latency budget)
+	float searchRadiusScale_;
+
+	// Consecutive frames lost (see Parameters::maxLostFrames)
+	int lostFrames_;
+
 	//Last Frame, KeyFrame and Relocalisation Info
 	Frame lastFrame_;
 	KeyFrame* lastKeyFrame_;
@@ -1468,14 +1588,14 @@ private:
 	std::vector<int> nobservations_;
 };
 
-Tracking::Pointer Tracking::Create(System* system, ORBVocabulary* voc, Map* map, KeyFrameDatabase* keyframeDB,
+Tracking::Pointer Tracking::Create(System* system, const ORBVocabulary* voc, Map* map, KeyFrameDatabase* keyframeDB,
 	int sensor, const Parameters& param)
 {
 	return std::make_unique<TrackingImpl>(system, voc, map, keyframeDB, sensor, param);
 }
 
 Tracking::Parameters::Parameters(int minFrames, int maxFrames, float thDepth)
-	: minFrames(minFrames), maxFrames(maxFrames), thDepth(thDepth) {}
+	: minFrames(minFrames), maxFrames(maxFrames), thDepth(thDepth), maxLostFrames(0) {}
 
 Tracking::~Tracking() {}
 
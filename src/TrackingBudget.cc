@@ -0,0 +1,117 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "TrackingBudget.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ORB_SLAM2
+{
+
+// Fraction of the budget below which the quality is allowed to grow again
+static const double HEADROOM_RATIO = 0.8;
+
+// Quality steps per frame
+static const float MAX_SHED_STEP = 0.25f;
+static const float GROW_STEP = 0.02f;
+static const float RECOVER_STEP = 0.1f;
+
+static int Interpolate(int minValue, int maxValue, float t)
+{
+	return minValue + static_cast<int>(std::round(t * (maxValue - minValue)));
+}
+
+TrackingBudget::TrackingBudget(const Parameters& param) : param_(param)
+{
+	Reset();
+}
+
+bool TrackingBudget::Enabled() const
+{
+	return param_.budgetMs > 0;
+}
+
+void TrackingBudget::Update(double extractionMs, double trackingMs, int inliers, bool lost)
+{
+	if (!Enabled())
+		return;
+
+	// Relocalization needs every feature we can get
+	if (lost)
+	{
+		Reset();
+		return;
+	}
+
+	const double totalMs = extractionMs + trackingMs;
+	if (totalMs <= 0)
+		return;
+
+	if (inliers < param_.safeInliers)
+	{
+		// Tracking is close to failure, so accuracy wins over latency
+		extractionQuality_ = std::min(extractionQuality_ + RECOVER_STEP, 1.f);
+		trackingQuality_ = std::min(trackingQuality_ + RECOVER_STEP, 1.f);
+	}
+	else if (totalMs > param_.budgetMs)
+	{
+		// Shed the overrun from each stage in proportion to its share of the frame time
+		const double overrun = (totalMs - param_.budgetMs) / totalMs;
+		const float shedE = static_cast<float>(2 * overrun * extractionMs / totalMs);
+		const float shedT = static_cast<float>(2 * overrun * trackingMs / totalMs);
+		extractionQuality_ = std::max(extractionQuality_ - std::min(shedE, MAX_SHED_STEP), 0.f);
+		trackingQuality_ = std::max(trackingQuality_ - std::min(shedT, MAX_SHED_STEP), 0.f);
+	}
+	else if (totalMs < HEADROOM_RATIO * param_.budgetMs)
+	{
+		extractionQuality_ = std::min(extractionQuality_ + GROW_STEP, 1.f);
+		trackingQuality_ = std::min(trackingQuality_ + GROW_STEP, 1.f);
+	}
+
+	UpdateSettings();
+}
+
+void TrackingBudget::Reset()
+{
+	extractionQuality_ = 1.f;
+	trackingQuality_ = 1.f;
+	UpdateSettings();
+}
+
+const TrackingBudget::Settings& TrackingBudget::GetSettings() const
+{
+	return settings_;
+}
+
+void TrackingBudget::UpdateSettings()
+{
+	settings_.nfeatures = Interpolate(param_.minFeatures, param_.maxFeatures, extractionQuality_);
+	settings_.nlevels = Interpolate(param_.minLevels, param_.maxLevels, extractionQuality_);
+	settings_.maxLocalKeyFrames = Interpolate(param_.minLocalKeyFrames, param_.maxLocalKeyFrames, trackingQuality_);
+	settings_.searchRadiusScale = param_.minSearchRadiusScale + trackingQuality_ * (1.f - param_.minSearchRadiusScale);
+}
+
+TrackingBudget::Parameters::Parameters()
+	: budgetMs(0.f), maxFeatures(2000), minFeatures(1000), maxLevels(8), minLevels(4),
+	maxLocalKeyFrames(80), minLocalKeyFrames(20), minSearchRadiusScale(0.7f), safeInliers(60) {}
+
+} //namespace ORB_SLAM
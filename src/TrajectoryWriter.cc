@@ -0,0 +1,130 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 RaYl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "TrajectoryWriter.h"
+
+#include <iomanip>
+#include <cstdint>
+
+#include "Tracking.h"
+#include "KeyFrame.h"
+#include "Converter.h"
+
+namespace ORB_SLAM2
+{
+
+static const char BINARY_MAGIC[8] = { 'O', 'R', 'B', 'T', 'R', 'A', 'J', '1' };
+
+template <typename T>
+static void WriteBinary(std::ofstream& ofs, T value)
+{
+	ofs.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& filename, Format format)
+	: ofs_(filename, format == BINARY ? std::ios::binary : std::ios::out), format_(format)
+{
+	ofs_ << std::fixed;
+	if (format_ == BINARY)
+		ofs_.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+}
+
+bool TrajectoryWriter::IsOpen() const
+{
+	return ofs_.is_open() && ofs_.good();
+}
+
+void TrajectoryWriter::Write(double timestamp, const CameraPose& Tcw, bool lost)
+{
+	if (format_ == TUM && lost)
+		return;
+
+	const CameraPose Twc = Tcw.Inverse();
+	const auto Rwc = Twc.R();
+	const auto twc = Twc.t();
+
+	if (format_ == KITTI)
+	{
+		ofs_ << std::setprecision(9) <<
+			Rwc(0, 0) << " " << Rwc(0, 1) << " " << Rwc(0, 2) << " " << twc(0) << " " <<
+			Rwc(1, 0) << " " << Rwc(1, 1) << " " << Rwc(1, 2) << " " << twc(1) << " " <<
+			Rwc(2, 0) << " " << Rwc(2, 1) << " " << Rwc(2, 2) << " " << twc(2) << "\n";
+		return;
+	}
+
+	const auto q = Converter::toQuaternion(Rwc);
+	if (format_ == TUM)
+	{
+		ofs_ << std::setprecision(6) << timestamp << " ";
+		ofs_ << std::setprecision(9) << twc(0) << " " << twc(1) << " " << twc(2) << " ";
+		ofs_ << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << "\n";
+		return;
+	}
+
+	WriteBinary<double>(ofs_, timestamp);
+	for (int i = 0; i < 3; i++)
+		WriteBinary<float>(ofs_, twc(i));
+	for (int i = 0; i < 4; i++)
+		WriteBinary<float>(ofs_, static_cast<float>(q[i]));
+	WriteBinary<uint8_t>(ofs_, lost ? 1 : 0);
+}
+
+void TrajectoryWriter::Flush()
+{
+	ofs_.flush();
+}
+
+CameraPose TrajectoryResolver::Resolve(const TrackPoint& track)
+{
+	const KeyFrame* referenceKF = track.referenceKF;
+	if (!referenceKF->isBad())
+		return track.Tcr * referenceKF->GetPose();
+
+	// Follow the cached links, then the parents, until a keyframe that is not culled.
+	// The pose and the parent of a culled keyframe do not change anymore.
+	CameraPose Tra = CameraPose::Origin();
+	const KeyFrame* keyframe = referenceKF;
+	while (keyframe->isBad())
+	{
+		const auto it = links_.find(keyframe);
+		if (it != std::end(links_))
+		{
+			Tra = Tra * it->second.Tka;
+			keyframe = it->second.ancestor;
+		}
+		else
+		{
+			Tra = Tra * keyframe->Tcp;
+			keyframe = keyframe->GetParent();
+		}
+	}
+
+	links_[referenceKF] = { keyframe, Tra };
+
+	return track.Tcr * Tra * keyframe->GetPose();
+}
+
+void TrajectoryResolver::Clear()
+{
+	links_.clear();
+}
+
+} //namespace ORB_SLAM
@@ -28,10 +28,10 @@
 #include "MapDrawer.h"
 #include "Tracking.h"
 #include "System.h"
-#include "Usleep.h"
+#include "LockStats.h"
 
-#define LOCK_MUTEX_STOP()   std::unique_lock<std::mutex> lock1(mutexStop_);
-#define LOCK_MUTEX_FINISH() std::unique_lock<std::mutex> lock2(mutexFinish_);
+#define LOCK_MUTEX_STOP()   auto lock1 = LockMutex(mutexStop_, LOCK_SITE("Viewer::Stop"));
+#define LOCK_MUTEX_FINISH() auto lock2 = LockMutex(mutexFinish_, LOCK_SITE("Viewer::Finish"));
 
 namespace ORB_SLAM2
 {
@@ -163,10 +163,7 @@ void Viewer::Run()
 
 		if (Stop())
 		{
-			while (isStopped())
-			{
-				usleep(3000);
-			}
+			signal_.Wait([this] { return !isStopped() || CheckFinish(); });
 		}
 
 		if (CheckFinish())
@@ -180,8 +177,11 @@ void Viewer::Run()
 
 void Viewer::RequestFinish()
 {
-	LOCK_MUTEX_FINISH();
-	finishRequested_ = true;
+	{
+		LOCK_MUTEX_FINISH();
+		finishRequested_ = true;
+	}
+	signal_.Notify();
 }
 
 bool Viewer::CheckFinish() const
@@ -192,8 +192,11 @@ bool Viewer::CheckFinish() const
 
 void Viewer::SetFinish()
 {
-	LOCK_MUTEX_FINISH();
-	finished_ = true;
+	{
+		LOCK_MUTEX_FINISH();
+		finished_ = true;
+	}
+	signal_.Notify();
 }
 
 bool Viewer::isFinished() const
@@ -215,28 +218,35 @@ bool Viewer::isStopped() const
 	return stopped_;
 }
 
-bool Viewer::Stop()
+void Viewer::WaitUntilStopped()
 {
-	LOCK_MUTEX_STOP();
-	LOCK_MUTEX_FINISH();
+	signal_.Wait([this] { return isStopped() || isFinished(); });
+}
 
-	if (finishRequested_)
-		return false;
-	else if (stopRequested_)
+bool Viewer::Stop()
+{
 	{
+		LOCK_MUTEX_STOP();
+		LOCK_MUTEX_FINISH();
+
+		if (finishRequested_ || !stopRequested_)
+			return false;
+
 		stopped_ = true;
 		stopRequested_ = false;
-		return true;
 	}
+	signal_.Notify();
 
-	return false;
-
+	return true;
 }
 
 void Viewer::Release()
 {
-	LOCK_MUTEX_STOP();
-	stopped_ = false;
+	{
+		LOCK_MUTEX_STOP();
+		stopped_ = false;
+	}
+	signal_.Notify();
 }
 
 void Viewer::SetCurrentCameraPose(const cv::Mat& Tcw)